@@ -135,6 +135,13 @@ app.add_middleware(
     allow_headers=["*"],
 )
 
+# Prometheus metrics (/metrics)
+try:
+    from optimization.metrics import instrument_fastapi
+    instrument_fastapi(app)
+except ImportError as e:
+    print(f"Warning: Metrics endpoint not available: {e}")
+
 # Pydantic models
 class ChatRequest(BaseModel):
     message: str
@@ -122,6 +122,11 @@ limiter = Limiter(
     storage_uri="memory://"
 )
 
+# Prometheus metrics (/metrics) - exempt from rate limits so scrapes never fail
+from companion_baas.optimization.metrics import instrument_flask
+instrument_flask(app)
+limiter.exempt(app.view_functions['prometheus_metrics'])
+
 # Thread pool for concurrent AI processing
 ai_executor = ThreadPoolExecutor(max_workers=10, thread_name_prefix="ai_worker")
 
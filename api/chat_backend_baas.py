@@ -391,6 +391,13 @@ app = Flask(__name__)
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
 
+# Prometheus metrics (/metrics) - optional, this backend runs standalone
+try:
+    from companion_baas.optimization.metrics import instrument_flask
+    instrument_flask(app)
+except ImportError as e:
+    logger.warning(f"Metrics endpoint not available: {e}")
+
 # ============================================================================
 # API ROUTES
 # ============================================================================
@@ -92,6 +92,13 @@ app.add_middleware(
     allow_headers=["*"],
 )
 
+# Prometheus metrics (/metrics)
+try:
+    from companion_baas.optimization.metrics import instrument_fastapi
+    instrument_fastapi(app)
+except ImportError as e:
+    logger.warning(f"Metrics endpoint not available: {e}")
+
 # Initialize Chat Controller
 chat_controller = ChatController()
 
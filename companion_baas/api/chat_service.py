@@ -79,6 +79,14 @@ def get_token_from_request():
         return auth_header[7:]
     return None
 
+def get_optional_user_id():
+    """Id of the authenticated user, or None for anonymous requests (shared AGI state)"""
+    token = get_token_from_request()
+    if not token:
+        return None
+    user = auth_manager.get_user_by_token(token)
+    return str(user['id']) if user else None
+
 def require_auth(f):
     """Decorator to require authentication for a route"""
     @wraps(f)
@@ -122,6 +130,11 @@ limiter = Limiter(
     storage_uri="memory://"
 )
 
+# Prometheus metrics (/metrics) - exempt from rate limits so scrapes never fail
+from companion_baas.optimization.metrics import instrument_flask
+instrument_flask(app)
+limiter.exempt(app.view_functions['prometheus_metrics'])
+
 # Thread pool for concurrent AI processing
 ai_executor = ThreadPoolExecutor(max_workers=10, thread_name_prefix="ai_worker")
 
@@ -950,7 +963,7 @@ def get_brain_stats():
 def get_agi_personality():
     """Get brain's current personality"""
     try:
-        personality = companion_brain.get_personality()
+        personality = companion_brain.get_personality(user_id=get_optional_user_id())
         if personality:
             return jsonify({
                 'success': True,
@@ -1029,7 +1042,7 @@ def agi_think():
         if not query:
             return jsonify({'error': 'query required'}), 400
         
-        result = companion_brain.think_with_agi(query, mode)
+        result = companion_brain.think_with_agi(query, mode, user_id=get_optional_user_id())
         
         return jsonify({
             'success': result.get('success', True),
@@ -63,6 +63,10 @@ app.add_middleware(
     allow_headers=["*"],
 )
 
+# Prometheus metrics (/metrics)
+from optimization.metrics import instrument_fastapi
+instrument_fastapi(app)
+
 # Global brain instance
 brain: Optional[UnifiedCompanionBrain] = None
 
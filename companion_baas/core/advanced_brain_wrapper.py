@@ -528,6 +528,12 @@ class AdvancedBrainWrapper:
     def get_usage_stats(self) -> Dict[str, Any]:
         """Get usage statistics"""
         return self.usage_stats.copy()
+    
+    def close(self):
+        """Apply pending feedback, persist buffered training data and long-term memory"""
+        self.learning.close()
+        self.finetuning.close()
+        self.longterm_memory.close()
 
 
 # Convenience function
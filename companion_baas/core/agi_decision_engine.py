@@ -17,12 +17,27 @@ Workflow:
 """
 
 import logging
+import time
+import uuid
+import threading
+from collections import OrderedDict, deque
 from typing import Dict, List, Optional, Any, Set, Tuple
 from datetime import datetime
 from enum import Enum
 import re
 import json
-from dataclasses import dataclass, field
+from dataclasses import dataclass, field, replace
+from concurrent.futures import ThreadPoolExecutor, Future, wait, FIRST_COMPLETED
+
+try:
+    from companion_baas.optimization.tracing import tracer, traced, current_span, SPAN_KIND_CLIENT
+except ImportError:
+    from optimization.tracing import tracer, traced, current_span, SPAN_KIND_CLIENT
+
+try:
+    from companion_baas.core.query_analyzer import QueryAnalyzer, modules_for
+except ImportError:
+    from core.query_analyzer import QueryAnalyzer, modules_for
 
 logger = logging.getLogger(__name__)
 
@@ -81,6 +96,41 @@ class ModuleType(Enum):
     AUTONOMOUS_SYSTEM = "autonomous_system"
 
 
+# Plan DAG: each step lists the steps whose output it consumes. Steps with
+# no path between them (retrieval, reasoning, code execution) run concurrently.
+STEP_DEPENDENCIES: Dict[str, List[str]] = {
+    'prepare_context': [],
+    'gather_information': ['prepare_context'],
+    'perform_reasoning': ['prepare_context'],
+    'execute_code': ['prepare_context'],
+    'generate_response': ['gather_information', 'perform_reasoning', 'execute_code'],
+    'learn_from_interaction': ['generate_response'],
+    'finalize_response': ['generate_response'],
+}
+
+# Per-step deadlines (seconds); a step past its deadline is abandoned
+STEP_DEADLINES: Dict[str, float] = {
+    'prepare_context': 5.0,
+    'gather_information': 15.0,
+    'perform_reasoning': 15.0,
+    'execute_code': 30.0,
+    'generate_response': 90.0,
+    'learn_from_interaction': 30.0,
+    'finalize_response': 5.0,
+}
+DEFAULT_STEP_DEADLINE = 30.0
+
+# Steps that never affect the reply: dispatched after the response is built
+BACKGROUND_STEPS: Set[str] = {'learn_from_interaction'}
+
+# Step outputs appended after the query in the generation prompt (label, step)
+GENERATION_CONTEXT_SECTIONS = (
+    ('Available information', 'gather_information'),
+    ('Reasoning', 'perform_reasoning'),
+    ('Execution result', 'execute_code'),
+)
+
+
 @dataclass
 class DecisionPlan:
     """A plan of action decided by AGI"""
@@ -94,6 +144,7 @@ class DecisionPlan:
     estimated_time: float  # Estimated seconds
     priority: int  # 1-5 (5 = highest)
     metadata: Dict[str, Any] = field(default_factory=dict)
+    dependencies: Dict[str, List[str]] = field(default_factory=dict)  # step -> upstream steps (DAG)
 
 
 @dataclass
@@ -107,6 +158,7 @@ class ExecutionResult:
     steps_completed: int
     errors: List[str] = field(default_factory=list)
     learned_insights: List[str] = field(default_factory=list)
+    background_steps: List[str] = field(default_factory=list)  # Fire-and-forget after the response
 
 
 class AGIDecisionEngine:
@@ -121,19 +173,48 @@ class AGIDecisionEngine:
     5. Learns from outcomes
     """
     
-    def __init__(self, brain):
+    def __init__(self, brain, max_parallel_steps: int = 8, history_size: int = 1000,
+                 plan_cache_size: int = 256):
         """
         Initialize AGI Decision Engine
         
         Args:
             brain: CompanionBrain instance (gives access to all modules)
+            max_parallel_steps: Worker threads for concurrent plan steps
+            history_size: Decisions/executions kept in the history ring buffers
+            plan_cache_size: Query signatures whose plans are cached (LRU)
         """
         self.brain = brain
-        self.decision_history: List[DecisionPlan] = []
-        self.execution_history: List[ExecutionResult] = []
-        
-        # Learning: Track what works
-        self.pattern_success_rates: Dict[str, float] = {}
+        self.max_parallel_steps = max_parallel_steps
+        self.step_executor = ThreadPoolExecutor(max_workers=max_parallel_steps, thread_name_prefix="agi_step")
+        # Steps abandoned at their deadline but still running (they hold workers)
+        self._stuck_steps: Set[Future] = set()
+        self._executor_lock = threading.Lock()
+        
+        # Shared with the brain's model router so each query is analyzed once
+        self.query_analyzer: QueryAnalyzer = getattr(brain, 'query_analyzer', None) or QueryAnalyzer()
+        self.classifier_retrain_interval = 100  # decisions between classifier refits
+        # Refits run off the request path, one at a time
+        self._retrain_executor = ThreadPoolExecutor(max_workers=1, thread_name_prefix="agi_retrain")
+        self._retrain_pending = False
+        # Bounded ring buffers: memory stays flat with uptime
+        self.history_size = history_size
+        self.decision_history: deque = deque(maxlen=history_size)
+        self.execution_history: deque = deque(maxlen=history_size)
+        
+        # Plan cache: query signature -> plan template (LRU)
+        self.plan_cache_size = plan_cache_size
+        self._plan_cache: "OrderedDict[Tuple, DecisionPlan]" = OrderedDict()
+        self._plan_cache_modules: Optional[frozenset] = None
+        self._plan_cache_lock = threading.Lock()
+        # Cheap availability probe: brain attribute presence per module
+        self._module_attrs = tuple(m.value for m in ModuleType
+                                   if m not in (ModuleType.MODEL_ROUTER, ModuleType.CONTEXT_MANAGER))
+        self._module_presence: Optional[Tuple[bool, ...]] = None
+        self._module_availability: frozenset = frozenset()
+        
+        # Learning: Track what works (recent outcomes per pattern)
+        self.pattern_success_rates: Dict[str, deque] = {}
         self.module_combinations: Dict[str, int] = {}  # Track successful combos
         
         # Decision statistics
@@ -143,11 +224,17 @@ class AGIDecisionEngine:
             'failed_decisions': 0,
             'average_confidence': 0.0,
             'modules_used_count': {},
-            'query_types_handled': {}
+            'query_types_handled': {},
+            'plan_cache_hits': 0,
+            'plan_cache_misses': 0,
+            'plan_cache_invalidations': 0,
+            'steps_timed_out': 0,
+            'executor_recycles': 0
         }
         
         logger.info("🤖 AGI Decision Engine initialized - Autonomous intelligence active")
     
+    @traced("agi.analyze_and_decide")
     def analyze_and_decide(self, query: str, context: Optional[Dict[str, Any]] = None) -> DecisionPlan:
         """
         Main decision-making method
@@ -170,58 +257,93 @@ class AGIDecisionEngine:
         
         logger.info(f"🧠 AGI analyzing query: '{query[:100]}...'")
         
-        # Step 1: Understand the query
-        query_type = self._classify_query(query)
-        query_intent = self._extract_intent(query)
-        complexity = self._assess_complexity(query)
-        
-        # Step 2: Decide which modules are needed
-        required_modules = self._decide_modules(query, query_type, query_intent, complexity)
-        
-        # Step 3: Create execution plan
-        execution_order = self._plan_execution(required_modules, query, query_type)
-        
-        # Step 4: Estimate confidence based on available modules
-        confidence = self._calculate_confidence(required_modules, query_type)
-        
-        # Step 5: Generate reasoning
-        reasoning = self._generate_reasoning(query, query_type, required_modules, execution_order)
+        # Step 1: Understand the query (single memoized pass)
+        analysis = self.query_analyzer.analyze(query)
+        query_type = QueryType(analysis.query_type)
+        query_intent = analysis.intent
+        complexity = analysis.complexity
+        
+        # Step 2: Reuse the plan for this query shape if we've decided it before
+        available = self._available_modules()
+        signature = (analysis.query_type, query_intent, complexity, available)
+        template = self._get_cached_plan(signature, available)
+        plan_cached = template is not None
+        
+        if template is None:
+            # Step 3: Decide which modules are needed
+            required_modules = self._decide_modules(query, query_type, query_intent, complexity)
+            
+            # Step 4: Create execution plan
+            execution_order = self._plan_execution(required_modules, query, query_type)
+            
+            # Step 5: Estimate confidence based on available modules
+            confidence = self._calculate_confidence(required_modules, query_type)
+            
+            # Step 6: Generate reasoning
+            reasoning = self._generate_reasoning(query, query_type, required_modules, execution_order)
+            
+            template = DecisionPlan(
+                decision_id='',
+                query_type=query_type,
+                confidence=confidence,
+                modules_to_use=required_modules,
+                execution_order=execution_order,
+                expected_outcome=self._predict_outcome(query_type, required_modules),
+                reasoning=reasoning,
+                estimated_time=self._estimate_time(required_modules, complexity),
+                priority=self._calculate_priority(query_type, complexity),
+                dependencies=self._plan_dependencies(execution_order)
+            )
+            self._cache_plan(signature, template)
         
-        # Create decision plan
-        import uuid
-        decision_plan = DecisionPlan(
+        # Create decision plan (fresh id and per-query metadata; lists copied
+        # so callers can't mutate the cached template)
+        decision_plan = replace(
+            template,
             decision_id=str(uuid.uuid4())[:8],
-            query_type=query_type,
-            confidence=confidence,
-            modules_to_use=required_modules,
-            execution_order=execution_order,
-            expected_outcome=self._predict_outcome(query_type, required_modules),
-            reasoning=reasoning,
-            estimated_time=self._estimate_time(required_modules, complexity),
-            priority=self._calculate_priority(query_type, complexity),
+            modules_to_use=list(template.modules_to_use),
+            execution_order=list(template.execution_order),
+            dependencies={step: list(deps) for step, deps in template.dependencies.items()},
             metadata={
                 'query_length': len(query),
                 'context_provided': bool(context),
                 'complexity': complexity,
-                'intent': query_intent
+                'intent': query_intent,
+                'analysis_source': analysis.source,
+                'normalized_query': QueryAnalyzer.normalize(query),
+                'plan_cached': plan_cached
             }
         )
+        required_modules = decision_plan.modules_to_use
+        confidence = decision_plan.confidence
+        reasoning = decision_plan.reasoning
         
         # Log decision
         self.decision_history.append(decision_plan)
         self.stats['query_types_handled'][query_type.value] = \
             self.stats['query_types_handled'].get(query_type.value, 0) + 1
         
+        # Periodically refit the fallback classifier on what we've seen (in the background)
+        if self.stats['total_decisions'] % self.classifier_retrain_interval == 0 and not self._retrain_pending:
+            self._retrain_pending = True
+            self._retrain_executor.submit(self._retrain_in_background)
+        
         logger.info(f"✅ AGI decided: Use {len(required_modules)} modules with {confidence:.1%} confidence")
         logger.debug(f"   Modules: {[m.value for m in required_modules]}")
         logger.debug(f"   Reasoning: {reasoning}")
         
         return decision_plan
     
+    @traced("agi.execute_decision")
     def execute_decision(self, plan: DecisionPlan, query: str, context: Optional[Dict[str, Any]] = None) -> ExecutionResult:
         """
         Execute the decision plan autonomously
         
+        Steps run as a dependency DAG: every step whose upstream steps have
+        finished is dispatched at once, each under its own deadline, so the
+        reply arrives after the critical path rather than the sum of all
+        steps. Background steps (learning) run after the response is built.
+        
         Args:
             plan: Decision plan to execute
             query: Original query
@@ -237,39 +359,105 @@ class AGIDecisionEngine:
         modules_used = []
         response_data = {}
         
-        logger.info(f"🚀 AGI executing plan {plan.decision_id}: {len(plan.execution_order)} steps")
+        dependencies = plan.dependencies or self._plan_dependencies(plan.execution_order)
+        foreground = [step for step in plan.execution_order if step not in BACKGROUND_STEPS]
+        background = [step for step in plan.execution_order if step in BACKGROUND_STEPS]
+        step_index = {step: idx for idx, step in enumerate(plan.execution_order, 1)}
+        
+        logger.info(f"🚀 AGI executing plan {plan.decision_id}: {len(plan.execution_order)} steps "
+                   f"({len(background)} in background)")
         
         try:
-            # Execute each step in the plan
-            for step_idx, step in enumerate(plan.execution_order, 1):
-                try:
-                    logger.debug(f"  Step {step_idx}/{len(plan.execution_order)}: {step}")
-                    
-                    # Execute step based on type
-                    step_result = self._execute_step(step, query, context, response_data)
-                    
-                    # Store result for next steps
-                    if step_result:
-                        response_data[step] = step_result
-                        modules_used.append(step)
-                    
-                    steps_completed += 1
+            # Execute the plan DAG: dispatch every ready step concurrently
+            pending = list(foreground)
+            resolved: Set[str] = set()  # finished, failed or timed out
+            running: Dict[Future, Tuple[str, float]] = {}
+            aborted = False
+            
+            while pending or running:
+                for step in [s for s in pending if all(d in resolved for d in dependencies.get(s, []))]:
+                    pending.remove(step)
+                    logger.debug(f"  Step {step_index[step]}/{len(plan.execution_order)}: {step}")
+                    future = self._submit_step(
+                        tracer.wrap(self._run_step), step, step_index[step], query, context, dict(response_data)
+                    )
+                    running[future] = (step, time.monotonic() + STEP_DEADLINES.get(step, DEFAULT_STEP_DEADLINE))
+                
+                if not running:
+                    # Nothing runnable: a dependency outside the plan
+                    break
+                
+                next_deadline = min(deadline for _, deadline in running.values())
+                done, _ = wait(list(running), timeout=max(0.0, next_deadline - time.monotonic()),
+                               return_when=FIRST_COMPLETED)
+                
+                now = time.monotonic()
+                for future in list(running):
+                    step, deadline = running[future]
+                    if future in done:
+                        del running[future]
+                        resolved.add(step)
+                        try:
+                            step_result = future.result()
+                        except Exception as e:
+                            error_msg = f"Step '{step}' failed: {str(e)}"
+                        else:
+                            # Store result for downstream steps
+                            if step_result:
+                                response_data[step] = step_result
+                                modules_used.append(step)
+                            steps_completed += 1
+                            continue
+                    elif now >= deadline:
+                        # Abandon the step (cancelled if it has not started)
+                        del running[future]
+                        resolved.add(step)
+                        self._abandon_step(future)
+                        error_msg = f"Step '{step}' exceeded {STEP_DEADLINES.get(step, DEFAULT_STEP_DEADLINE):g}s deadline"
+                    else:
+                        continue
                     
-                except Exception as e:
-                    error_msg = f"Step '{step}' failed: {str(e)}"
                     logger.error(f"❌ {error_msg}")
                     errors.append(error_msg)
                     
                     # AGI decides: Continue or abort?
-                    if not self._should_continue_after_error(step, plan, steps_completed):
+                    if not aborted and not self._should_continue_after_error(step, plan, steps_completed):
                         logger.warning("⚠️ AGI decided to abort execution")
-                        break
+                        aborted = True
+                        pending.clear()
+                
+                if aborted:
+                    # Don't wait on in-flight siblings of a fatal failure
+                    for future in running:
+                        self._abandon_step(future)
+                    break
             
             # Synthesize final response from all step results
             final_response = self._synthesize_response(response_data, plan, query)
             
             success = len(errors) == 0 or steps_completed > 0
             
+            # Fire-and-forget: learning never delays the reply. Submitted
+            # without the request's trace context, so it is traced as its
+            # own root instead of ending inside an already-finished trace.
+            scheduled = []
+            if not aborted:
+                request_trace = current_span().trace_id
+                for step in background:
+                    if all(d in resolved for d in dependencies.get(step, [])):
+                        future = self._submit_step(
+                            self._run_step, step, step_index[step], query, context, dict(response_data),
+                            request_trace
+                        )
+                        future.add_done_callback(self._log_background_failure)
+                        scheduled.append(step)
+            
+            span = current_span()
+            span.set_attribute('agi.decision_id', plan.decision_id)
+            span.set_attribute('agi.steps_planned', len(plan.execution_order))
+            span.set_attribute('agi.steps_completed', steps_completed)
+            span.set_attribute('agi.background_steps', scheduled)
+            
             # Learn from execution
             learned_insights = self._learn_from_execution(plan, success, steps_completed, errors)
             
@@ -283,7 +471,8 @@ class AGIDecisionEngine:
                 execution_time=execution_time,
                 steps_completed=steps_completed,
                 errors=errors,
-                learned_insights=learned_insights
+                learned_insights=learned_insights,
+                background_steps=scheduled
             )
             
             # Update statistics
@@ -299,7 +488,7 @@ class AGIDecisionEngine:
                     self.stats['modules_used_count'].get(module, 0) + 1
             
             logger.info(f"{'✅' if success else '⚠️'} AGI execution {'completed' if success else 'partial'}: "
-                       f"{steps_completed}/{len(plan.execution_order)} steps in {execution_time:.2f}s")
+                       f"{steps_completed}/{len(foreground)} steps in {execution_time:.2f}s")
             
             return result
             
@@ -317,88 +506,106 @@ class AGIDecisionEngine:
                 learned_insights=[]
             )
     
-    def _classify_query(self, query: str) -> QueryType:
-        """Classify what type of query this is"""
-        query_lower = query.lower()
-        
-        # Patterns for different query types
-        patterns = {
-            QueryType.CODING: [
-                r'\bcode\b', r'\bfunction\b', r'\bclass\b', r'\bdebug\b', r'\bfix\b',
-                r'\bpython\b', r'\bjavascript\b', r'\bjava\b', r'\b(def|function|class)\s',
-                r'\bimport\b', r'\berror\b.*\bcode\b'
-            ],
-            QueryType.RESEARCH: [
-                r'\bsearch\b', r'\bfind\b', r'\bresearch\b', r'\blook up\b', r'\bwhat is\b',
-                r'\bwho is\b', r'\bwhen did\b', r'\bwhere is\b', r'\bhow to\b',
-                r'\blatest\b', r'\bcurrent\b', r'\bnews\b', r'\binformation\b'
-            ],
-            QueryType.ANALYSIS: [
-                r'\banalyze\b', r'\bcompare\b', r'\bevaluate\b', r'\bexamine\b',
-                r'\bwhy\b', r'\bexplain\b', r'\breason\b', r'\bcause\b', r'\beffect\b'
-            ],
-            QueryType.CREATIVE: [
-                r'\bcreate\b', r'\bgenerate\b', r'\bwrite\b', r'\bcompose\b',
-                r'\bdesign\b', r'\bmake\b', r'\bstory\b', r'\bpoem\b', r'\bidea\b'
-            ],
-            QueryType.EXECUTION: [
-                r'\brun\b', r'\bexecute\b', r'\bcalculate\b', r'\bcompute\b',
-                r'\bprocess\b', r'\bperform\b'
-            ],
-            QueryType.LEARNING: [
-                r'\blearn\b', r'\bteach\b', r'\bremember\b', r'\bstore\b',
-                r'\bunderstand\b', r'\bconcept\b'
-            ],
-            QueryType.MULTIMODAL: [
-                r'\bimage\b', r'\bpicture\b', r'\bphoto\b', r'\baudio\b',
-                r'\bvideo\b', r'\bvisualize\b'
-            ]
-        }
-        
-        # Score each type
-        scores = {}
-        for qtype, pattern_list in patterns.items():
-            score = sum(1 for pattern in pattern_list if re.search(pattern, query_lower))
-            if score > 0:
-                scores[qtype] = score
+    def _run_step(self, step: str, step_idx: int, query: str, context: Dict[str, Any],
+                  response_data: Dict[str, Any], request_trace: Optional[str] = None) -> Optional[Any]:
+        """
+        Run one plan step in a worker thread (response_data is a snapshot of upstream results)
         
-        # Return highest scoring type
-        if scores:
-            return max(scores.items(), key=lambda x: x[1])[0]
+        request_trace links a detached background step to the request it belongs to.
+        """
+        with tracer.span(f"agi.step.{step}", {'agi.step_index': step_idx}) as step_span:
+            if request_trace:
+                step_span.set_attribute('agi.request_trace_id', request_trace)
+            step_result = self._execute_step(step, query, context, response_data)
+            step_span.set_attribute('agi.step_produced_result', step_result is not None)
+            return step_result
+    
+    def _abandon_step(self, future: Future):
+        """
+        Give up on a step past its deadline
         
-        # Default to conversational
-        return QueryType.CONVERSATIONAL
+        Queued steps are cancelled. A running one cannot be interrupted, so
+        it is tracked until it finishes; once half the workers are held by
+        such steps, new work moves to a fresh pool and the old one drains.
+        """
+        self.stats['steps_timed_out'] += 1
+        if future.cancel():
+            return
+        with self._executor_lock:
+            self._stuck_steps.add(future)
+            stuck = len(self._stuck_steps)
+        future.add_done_callback(self._release_stuck_step)
+        
+        if stuck * 2 >= self.max_parallel_steps:
+            with self._executor_lock:
+                old_executor = self.step_executor
+                self.step_executor = ThreadPoolExecutor(max_workers=self.max_parallel_steps,
+                                                        thread_name_prefix="agi_step")
+                # Stuck steps now count against the retired pool only
+                self._stuck_steps.clear()
+                # Under the lock: no submit can race onto the retired pool
+                old_executor.shutdown(wait=False)
+            self.stats['executor_recycles'] += 1
+            logger.warning(f"⚠️ {stuck} AGI steps stuck past their deadline - moved to a fresh worker pool")
+    
+    def _submit_step(self, function, *args) -> Future:
+        """Submit to the current step pool (the lock orders this against a pool swap)"""
+        with self._executor_lock:
+            return self.step_executor.submit(function, *args)
+    
+    def _release_stuck_step(self, future: Future):
+        with self._executor_lock:
+            self._stuck_steps.discard(future)
+    
+    @staticmethod
+    def _log_background_failure(future: Future):
+        """Done-callback for fire-and-forget steps"""
+        if not future.cancelled() and future.exception() is not None:
+            logger.warning(f"⚠️ Background AGI step failed: {future.exception()}")
+    
+    def _classify_query(self, query: str) -> QueryType:
+        """Classify what type of query this is"""
+        return QueryType(self.query_analyzer.analyze(query).query_type)
     
     def _extract_intent(self, query: str) -> str:
         """Extract the user's intent from query"""
-        query_lower = query.lower()
-        
-        if any(word in query_lower for word in ['how', 'what', 'why', 'when', 'where', 'who']):
-            return "information_seeking"
-        elif any(word in query_lower for word in ['create', 'make', 'generate', 'build']):
-            return "creation"
-        elif any(word in query_lower for word in ['fix', 'solve', 'debug', 'error']):
-            return "problem_solving"
-        elif any(word in query_lower for word in ['help', 'assist', 'guide']):
-            return "assistance"
-        else:
-            return "general"
+        return self.query_analyzer.analyze(query).intent
     
     def _assess_complexity(self, query: str) -> str:
         """Assess query complexity: simple, medium, complex"""
-        word_count = len(query.split())
-        has_code = bool(re.search(r'[{}()\[\];]', query))
-        has_technical = any(term in query.lower() for term in [
-            'algorithm', 'architecture', 'system', 'database', 'api',
-            'framework', 'library', 'integration', 'optimization'
-        ])
-        
-        if word_count > 50 or has_code or has_technical:
-            return "complex"
-        elif word_count > 20:
-            return "medium"
-        else:
-            return "simple"
+        return self.query_analyzer.analyze(query).complexity
+    
+    def _retrain_in_background(self):
+        try:
+            self.train_query_classifier()
+        except Exception as e:
+            logger.warning(f"⚠️ Query classifier refit failed: {e}")
+        finally:
+            self._retrain_pending = False
+    
+    def train_query_classifier(self) -> int:
+        """
+        Refit the analyzer's fallback classifier from decision history
+        
+        Labels come from keyword-classified decisions whose execution
+        succeeded, so the classifier extends confident routing to queries
+        that carry no keyword signal.
+        
+        Returns:
+            Number of training examples used
+        """
+        # Snapshots: request threads keep appending while this runs
+        succeeded = {r.decision_id for r in list(self.execution_history) if r.success}
+        examples = [
+            (plan.metadata['normalized_query'], plan.query_type.value)
+            for plan in list(self.decision_history)
+            if plan.decision_id in succeeded
+            and plan.metadata.get('analysis_source') == 'keywords'
+            and plan.metadata.get('normalized_query')
+        ]
+        if examples:
+            self.query_analyzer.train_classifier(examples)
+        return len(examples)
     
     def _decide_modules(self, query: str, query_type: QueryType, intent: str, complexity: str) -> List[ModuleType]:
         """
@@ -417,39 +624,10 @@ class AGIDecisionEngine:
         modules.add(ModuleType.CONTEXT_MANAGER)
         
         # Query type specific modules
-        if query_type == QueryType.CODING:
-            modules.add(ModuleType.CODE_EXECUTOR)
-            modules.add(ModuleType.NEURAL_REASONING)
-            if complexity == "complex":
-                modules.add(ModuleType.ADVANCED_REASONING)
-        
-        elif query_type == QueryType.RESEARCH:
-            modules.add(ModuleType.WEB_SEARCH)
-            modules.add(ModuleType.WEB_CRAWLER)
-            modules.add(ModuleType.KNOWLEDGE_RETRIEVER)
-            modules.add(ModuleType.SEARCH_ENGINE)
-        
-        elif query_type == QueryType.ANALYSIS:
-            modules.add(ModuleType.NEURAL_REASONING)
-            modules.add(ModuleType.ADVANCED_REASONING)
-            modules.add(ModuleType.KNOWLEDGE_RETRIEVER)
-        
-        elif query_type == QueryType.CREATIVE:
-            modules.add(ModuleType.PERSONALITY_ENGINE)
-            modules.add(ModuleType.NEURAL_REASONING)
-        
-        elif query_type == QueryType.EXECUTION:
-            modules.add(ModuleType.CODE_EXECUTOR)
-            modules.add(ModuleType.TOOL_EXECUTOR)
+        for module_name in modules_for(query_type.value, complexity):
+            modules.add(ModuleType(module_name))
         
-        elif query_type == QueryType.LEARNING:
-            modules.add(ModuleType.SELF_LEARNING)
-            modules.add(ModuleType.KNOWLEDGE_RETRIEVER)
-        
-        elif query_type == QueryType.MULTIMODAL:
-            modules.add(ModuleType.MULTIMODAL_PROCESSOR)
-        
-        elif query_type == QueryType.AUTONOMOUS:
+        if query_type == QueryType.AUTONOMOUS:
             if self.brain.autonomous_system:
                 modules.add(ModuleType.AUTONOMOUS_SYSTEM)
         
@@ -462,6 +640,50 @@ class AGIDecisionEngine:
         
         return list(available_modules)
     
+    def _available_modules(self) -> frozenset:
+        """Every module the brain can currently provide (part of the plan signature)"""
+        brain = self.brain
+        presence = tuple(bool(getattr(brain, name, None)) for name in self._module_attrs)
+        if presence != self._module_presence:
+            self._module_presence = presence
+            self._module_availability = frozenset(self._filter_available_modules(set(ModuleType)))
+        return self._module_availability
+    
+    def _get_cached_plan(self, signature: Tuple, available: frozenset) -> Optional[DecisionPlan]:
+        """
+        Look up a plan template for a query signature
+        
+        The whole cache is dropped when module availability changes, so
+        plans never reference modules that came or went since they were made.
+        """
+        with self._plan_cache_lock:
+            if available != self._plan_cache_modules:
+                if self._plan_cache:
+                    self.stats['plan_cache_invalidations'] += 1
+                    logger.info("🔄 Module availability changed - plan cache invalidated")
+                self._plan_cache.clear()
+                self._plan_cache_modules = available
+            template = self._plan_cache.get(signature)
+            if template is None:
+                self.stats['plan_cache_misses'] += 1
+                return None
+            self._plan_cache.move_to_end(signature)
+            self.stats['plan_cache_hits'] += 1
+            return template
+    
+    def _cache_plan(self, signature: Tuple, template: DecisionPlan):
+        """Store a plan template (LRU eviction)"""
+        with self._plan_cache_lock:
+            self._plan_cache[signature] = template
+            if len(self._plan_cache) > self.plan_cache_size:
+                self._plan_cache.popitem(last=False)
+    
+    def invalidate_plan_cache(self):
+        """Drop all cached plans (e.g. after changing planning rules)"""
+        with self._plan_cache_lock:
+            self._plan_cache.clear()
+            self.stats['plan_cache_invalidations'] += 1
+    
     def _filter_available_modules(self, modules: Set[ModuleType]) -> List[ModuleType]:
         """Filter to only modules that are actually available"""
         available = []
@@ -521,6 +743,21 @@ class AGIDecisionEngine:
         
         return steps
     
+    def _plan_dependencies(self, execution_order: List[str]) -> Dict[str, List[str]]:
+        """
+        Build the plan DAG: keep only dependencies on steps that are in the plan
+        
+        Unknown steps depend on the step before them, preserving their order.
+        """
+        planned = set(execution_order)
+        dependencies = {}
+        for idx, step in enumerate(execution_order):
+            if step in STEP_DEPENDENCIES:
+                dependencies[step] = [d for d in STEP_DEPENDENCIES[step] if d in planned]
+            else:
+                dependencies[step] = execution_order[idx - 1:idx]
+        return dependencies
+    
     def _execute_step(self, step: str, query: str, context: Dict[str, Any], 
                      response_data: Dict[str, Any]) -> Optional[Any]:
         """Execute a single step in the plan"""
@@ -539,14 +776,16 @@ class AGIDecisionEngine:
             
             if self.brain.knowledge_retriever:
                 try:
-                    kr_result = self.brain.knowledge_retriever.retrieve(query)
+                    with tracer.span("knowledge.retrieve", kind=SPAN_KIND_CLIENT):
+                        kr_result = self.brain.knowledge_retriever.retrieve(query)
                     results.append(kr_result)
                 except:
                     pass
             
             if self.brain.search_engine:
                 try:
-                    search_result = self.brain.search_engine.search(query)
+                    with tracer.span("search.query", kind=SPAN_KIND_CLIENT):
+                        search_result = self.brain.search_engine.search(query)
                     results.append(search_result)
                 except:
                     pass
@@ -580,22 +819,14 @@ class AGIDecisionEngine:
         
         elif step == "generate_response":
             # Generate response using LLM
-            # Gather all context from previous steps
-            full_context = {
-                'query': query,
-                'information': response_data.get('gather_information'),
-                'reasoning': response_data.get('perform_reasoning'),
-                'execution': response_data.get('execute_code')
-            }
-            
-            # Build comprehensive prompt
-            prompt = query
-            if full_context.get('information'):
-                prompt += f"\n\nAvailable information: {full_context['information']}"
-            if full_context.get('reasoning'):
-                prompt += f"\n\nReasoning: {full_context['reasoning']}"
-            if full_context.get('execution'):
-                prompt += f"\n\nExecution result: {full_context['execution']}"
+            # Build the prompt in one pass from the query and prior step outputs
+            # (the static system prefix is added, pre-rendered, by the provider layer)
+            sections = [query]
+            for label, source_step in GENERATION_CONTEXT_SECTIONS:
+                value = response_data.get(source_step)
+                if value:
+                    sections.append(f"{label}: {value}")
+            prompt = "\n\n".join(sections)
             
             # Use brain's LLM to generate response
             response = self.brain._call_llm(prompt)
@@ -616,13 +847,14 @@ class AGIDecisionEngine:
             if self.brain.self_learning:
                 try:
                     response = response_data.get('generate_response', '')
-                    self.brain.self_learning.episodic.store_episode(
-                        query, 
-                        str(response), 
-                        context, 
-                        outcome={'success': True},
-                        emotions="positive"
-                    )
+                    with tracer.span("memory.store_episode"):
+                        self.brain.self_learning.episodic.store_episode(
+                            query, 
+                            str(response), 
+                            context, 
+                            outcome={'success': True},
+                            emotions="positive"
+                        )
                 except:
                     pass
             return None
@@ -723,7 +955,7 @@ class AGIDecisionEngine:
         # Track success rate for this pattern
         pattern_key = f"{plan.query_type.value}_{len(plan.modules_to_use)}_modules"
         if pattern_key not in self.pattern_success_rates:
-            self.pattern_success_rates[pattern_key] = []
+            self.pattern_success_rates[pattern_key] = deque(maxlen=self.history_size)
         
         self.pattern_success_rates[pattern_key].append(1.0 if success else 0.0)
         
@@ -758,5 +990,18 @@ class AGIDecisionEngine:
             )[:5],
             'pattern_success_rates': {
                 k: sum(v) / len(v) for k, v in self.pattern_success_rates.items()
-            }
+            },
+            'query_analyzer': self.query_analyzer.get_stats(),
+            'plan_cache': {
+                'size': len(self._plan_cache),
+                'hits': self.stats['plan_cache_hits'],
+                'misses': self.stats['plan_cache_misses'],
+                'invalidations': self.stats['plan_cache_invalidations'],
+                'hit_rate': (
+                    self.stats['plan_cache_hits'] /
+                    (self.stats['plan_cache_hits'] + self.stats['plan_cache_misses'])
+                    if self.stats['plan_cache_hits'] + self.stats['plan_cache_misses'] else 0.0
+                )
+            },
+            'history_size': len(self.decision_history)
         }
@@ -20,9 +20,13 @@ from typing import Dict, List, Optional, Any, Union, Callable, Tuple
 from datetime import datetime, timedelta
 import uuid
 import time
+import threading
 from enum import Enum
 import asyncio
+import contextvars
+import functools
 import hashlib
+import inspect
 import json
 
 # Optional numpy import for environments that don't have it (like Vercel)
@@ -44,6 +48,64 @@ sys.path.insert(0, baas_dir)
 
 logger = logging.getLogger(__name__)
 
+# Prometheus metrics, quantile sketches, tracing, hedging, prompt templates and shared embeddings
+try:
+    from companion_baas.optimization.metrics import metrics as prom_metrics
+    from companion_baas.optimization.sketches import DecayingSketch, QuantileSketch
+    from companion_baas.optimization.tracing import tracer, traced, current_span, SPAN_KIND_SERVER, SPAN_KIND_CLIENT
+    from companion_baas.optimization.hedging import HedgedExecutor, hedge_budget
+    from companion_baas.optimization.prompt_cache import PromptTemplate, PromptSegments
+    from companion_baas.optimization.embedding_service import get_embedding_service
+except ImportError:
+    from optimization.metrics import metrics as prom_metrics
+    from optimization.sketches import DecayingSketch, QuantileSketch
+    from optimization.tracing import tracer, traced, current_span, SPAN_KIND_SERVER, SPAN_KIND_CLIENT
+    from optimization.hedging import HedgedExecutor, hedge_budget
+    from optimization.prompt_cache import PromptTemplate, PromptSegments
+    from optimization.embedding_service import get_embedding_service
+
+# Shared single-pass query analysis (AGI engine + model router) and adaptive routing
+try:
+    from companion_baas.core.query_analyzer import QueryAnalyzer, hashed_embedding
+    from companion_baas.core.model_router import model_router as shared_model_router
+except ImportError:
+    from core.query_analyzer import QueryAnalyzer, hashed_embedding
+    from core.model_router import model_router as shared_model_router
+
+# Caller tenant of the request being served (charged for hedged provider calls).
+# Copied into worker threads along with the tracing context (tracer.wrap).
+_request_tenant: contextvars.ContextVar = contextvars.ContextVar('companion_request_tenant', default=None)
+
+
+def _tenant_scoped(func: Callable) -> Callable:
+    """Bind the call's user_id as the request tenant while func runs (nested calls keep the outer tenant)"""
+    position = list(inspect.signature(func).parameters).index('user_id')
+
+    def bind(args, kwargs):
+        user_id = kwargs.get('user_id', args[position] if len(args) > position else None)
+        return _request_tenant.set(user_id) if user_id else None
+
+    if asyncio.iscoroutinefunction(func):
+        @functools.wraps(func)
+        async def async_wrapper(*args, **kwargs):
+            token = bind(args, kwargs)
+            try:
+                return await func(*args, **kwargs)
+            finally:
+                if token is not None:
+                    _request_tenant.reset(token)
+        return async_wrapper
+
+    @functools.wraps(func)
+    def wrapper(*args, **kwargs):
+        token = bind(args, kwargs)
+        try:
+            return func(*args, **kwargs)
+        finally:
+            if token is not None:
+                _request_tenant.reset(token)
+    return wrapper
+
 # ============================================================================
 # CIRCUIT BREAKER PATTERN (Tier 2 Reliability)
 # ============================================================================
@@ -52,12 +114,8 @@ logger = logging.getLogger(__name__)
 # SEMANTIC CACHE (Tier 3 - Advanced Caching)
 # ============================================================================
 
-try:
-    from sentence_transformers import SentenceTransformer
-    SENTENCE_TRANSFORMERS_AVAILABLE = True
-except ImportError:
-    SENTENCE_TRANSFORMERS_AVAILABLE = False
-    logger.debug("sentence-transformers not available for semantic caching")
+# Embeddings come from the shared EmbeddingService (optimization/embedding_service.py),
+# which reports itself unavailable when sentence-transformers is not installed
 
 class SemanticCache:
     """
@@ -80,32 +138,29 @@ class SemanticCache:
         self.hits = 0
         self.misses = 0
         self.model_name = model_name  # Store model name for lazy loading
+        # Process-wide embedder: one model shared with every other consumer
+        self.embedder = get_embedding_service(model_name)
+        
+        # Pre-bound metric series (no label lookup on the hot path)
+        self._hit_metric = prom_metrics.cache_events.labels('semantic', 'hit')
+        self._miss_metric = prom_metrics.cache_events.labels('semantic', 'miss')
         
         # Don't initialize model during startup - lazy load when needed
         logger.info("✅ Semantic cache initialized (lazy loading)")
     
     def _ensure_model_loaded(self):
-        """Lazy load the sentence transformer model when needed"""
-        if self.model is None and SENTENCE_TRANSFORMERS_AVAILABLE:
-            try:
-                self.model = SentenceTransformer(self.model_name)
-                logger.info(f"✅ Semantic cache model loaded: {self.model_name}")
-            except Exception as e:
-                logger.warning(f"⚠️ Failed to load semantic cache model: {e}")
-                self.model = None
+        """Lazy load the shared embedding model when needed"""
+        if self.model is None:
+            self.model = self.embedder.load()
     
     def _compute_embedding(self, text: str) -> Optional[list]:
-        """Compute embedding for text"""
+        """Compute embedding for text (shared service: cached, micro-batched)"""
         if not HAS_NUMPY:
             return None  # Return None when numpy is not available
         self._ensure_model_loaded()
         if not self.model:
             return None
-        try:
-            return self.model.encode(text, convert_to_numpy=True)
-        except Exception as e:
-            logger.warning(f"Embedding computation failed: {e}")
-            return None
+        return self.embedder.encode(text)
     
     def _cosine_similarity(self, vec1, vec2) -> float:
         """Compute cosine similarity between two vectors"""
@@ -129,12 +184,14 @@ class SemanticCache:
         """
         if not self.model or not self.cache:
             self.misses += 1
+            self._miss_metric.inc()
             return None
         
         # Compute query embedding
         query_embedding = self._compute_embedding(query)
         if query_embedding is None:
             self.misses += 1
+            self._miss_metric.inc()
             return None
         
         # Find most similar cached query
@@ -155,10 +212,12 @@ class SemanticCache:
         
         if best_match:
             self.hits += 1
+            self._hit_metric.inc()
             logger.info(f"✅ Semantic cache HIT (similarity: {best_similarity:.3f})")
             return best_match['response']
         
         self.misses += 1
+        self._miss_metric.inc()
         return None
     
     def set(self, query: str, response: str, context: Optional[Dict] = None):
@@ -209,7 +268,8 @@ class SemanticCache:
             'hit_rate': hit_rate,
             'cache_size': len(self.cache),
             'max_size': self.max_size,
-            'threshold': self.similarity_threshold
+            'threshold': self.similarity_threshold,
+            'embeddings': self.embedder.get_stats()
         }
     
     def clear(self):
@@ -231,17 +291,34 @@ class MultiModelConsensus:
     """
     Query multiple models and combine results for higher accuracy.
     Useful for critical queries that need validation.
+    
+    Responses are handled as they arrive: each batch of new answers is
+    embedded in one call and compared against the answers so far, and as
+    soon as a quorum of models agree the best agreeing answer is returned
+    and the stragglers are cancelled.
+    
+    Agreement is cosine similarity, so the default threshold depends on
+    the embedder: sentence embeddings put paraphrased answers at ~0.75+
+    and different answers to the same question at ~0.4-0.6, while the
+    hashed bag-of-words fallback scores paraphrases 0.4-0.9 and different
+    answers <= 0.25. (The old 0.6 was tuned for word-set Jaccard overlap.)
     """
+    DENSE_MIN_AGREEMENT = 0.70
+    HASHED_MIN_AGREEMENT = 0.35
+    
     def __init__(self, brain_instance):
         self.brain = brain_instance
         self.consensus_queries = 0
         self.total_models_queried = 0
+        self.early_quorum_stops = 0
+        self.stragglers_cancelled = 0
         
     async def query_with_consensus(
         self,
         message: str,
         models: Optional[List[str]] = None,
-        min_agreement: float = 0.6
+        min_agreement: Optional[float] = None,
+        quorum: Optional[int] = None
     ) -> Dict[str, Any]:
         """
         Query multiple models and combine responses
@@ -249,7 +326,9 @@ class MultiModelConsensus:
         Args:
             message: Query message
             models: List of model names (default: 3 recommended models)
-            min_agreement: Minimum agreement threshold (0.0-1.0)
+            min_agreement: Minimum cosine agreement (default: per embedder,
+                DENSE_MIN_AGREEMENT or HASHED_MIN_AGREEMENT)
+            quorum: Agreeing models needed to stop early (default: majority)
             
         Returns:
             Dict with combined response, confidence, and individual results
@@ -257,27 +336,62 @@ class MultiModelConsensus:
         if not models:
             # Use diverse model set for consensus (using OpenRouter for reliability)
             models = ['qwen-4b', 'qwen-4b', 'deepseek-coder']  # Removed phi-2-reasoner
+        if quorum is None:
+            quorum = len(models) // 2 + 1
+        quorum = max(1, min(quorum, len(models)))
         
         self.consensus_queries += 1
-        logger.info(f"🤝 Running consensus query with {len(models)} models")
+        logger.info(f"🤝 Running consensus query with {len(models)} models (quorum {quorum})")
         
-        # Query all models in parallel
-        tasks = []
-        for model in models:
-            tasks.append(self._query_model(message, model))
+        # Fan out to all models; consume answers in completion order
+        pending = {
+            asyncio.ensure_future(self._query_model(message, model)): model
+            for model in models
+        }
+        successful_results = []
+        vectors = []
+        similarities = []  # similarities[i][j] between successful results i and j
+        group = None
+        dense = None  # embedder kind, fixed by the first batch for the whole query
+        auto_threshold = min_agreement is None
+        loop = asyncio.get_running_loop()
         
-        results = await asyncio.gather(*tasks, return_exceptions=True)
-        self.total_models_queried += len(models)
+        try:
+            while pending and group is None:
+                done, _ = await asyncio.wait(pending, return_when=asyncio.FIRST_COMPLETED)
+                arrived = []
+                for task in done:
+                    model = pending.pop(task)
+                    result = task.result()
+                    if isinstance(result, dict) and result.get('success'):
+                        arrived.append({
+                            'model': model,
+                            'response': result.get('response', ''),
+                            'confidence': result.get('confidence', 0.5)
+                        })
+                if arrived:
+                    # Model inference off the event loop
+                    new_vectors, batch_dense = await loop.run_in_executor(
+                        None, self._embed, [r['response'] for r in arrived], dense
+                    )
+                    if dense and not batch_dense:
+                        # Dense embedder failed mid-query: re-embed earlier answers with the fallback
+                        vectors[:], _ = self._embed([r['response'] for r in successful_results], False)
+                        similarities[:] = [[self._cosine(a, b) for b in vectors] for a in vectors]
+                    dense = batch_dense
+                    if auto_threshold:
+                        min_agreement = self.DENSE_MIN_AGREEMENT if dense else self.HASHED_MIN_AGREEMENT
+                    group = self._add_results(
+                        arrived, new_vectors, successful_results, vectors, similarities, min_agreement, quorum
+                    )
+        finally:
+            # Quorum reached (or caller cancelled): stop waiting for stragglers
+            for task in pending:
+                task.cancel()
         
-        # Filter successful results
-        successful_results = []
-        for i, result in enumerate(results):
-            if not isinstance(result, Exception) and result.get('success'):
-                successful_results.append({
-                    'model': models[i],
-                    'response': result.get('response', ''),
-                    'confidence': result.get('confidence', 0.5)
-                })
+        cancelled = len(pending)
+        self.total_models_queried += len(models) - cancelled
+        self.stragglers_cancelled += cancelled
         
         if not successful_results:
             return {
@@ -286,8 +400,15 @@ class MultiModelConsensus:
                 'response': None
             }
         
-        # Combine responses
-        combined = self._combine_responses(successful_results, min_agreement)
+        if group is not None:
+            combined = self._quorum_response(successful_results, similarities, group)
+            if cancelled:
+                self.early_quorum_stops += 1
+                logger.info(f"⚡ Consensus quorum reached after {len(successful_results)}/{len(models)} models, "
+                            f"cancelled {cancelled}")
+        else:
+            combined = self._combine_responses(successful_results, min_agreement, similarities)
+        combined['agreement_threshold'] = min_agreement
         
         return {
             'success': True,
@@ -297,7 +418,10 @@ class MultiModelConsensus:
             'individual_results': successful_results,
             'metadata': {
                 'consensus_type': combined['method'],
-                'agreement_score': combined['agreement']
+                'agreement_score': combined['agreement'],
+                'agreement_threshold': combined['agreement_threshold'],
+                'quorum': quorum,
+                'models_cancelled': cancelled
             }
         }
     
@@ -318,11 +442,104 @@ class MultiModelConsensus:
             
             result = await loop.run_in_executor(None, _call)
             return result
+        except asyncio.CancelledError:
+            raise
         except Exception as e:
             logger.warning(f"Model {model} query failed: {e}")
             return {'success': False, 'error': str(e)}
     
-    def _combine_responses(self, results: List[Dict], min_agreement: float) -> Dict[str, Any]:
+    def _embed(self, texts: List[str], dense: Optional[bool] = None) -> Tuple[List[Any], bool]:
+        """
+        Embed responses in one batched call: the semantic cache's sentence
+        transformer when available, else dependency-free hashed embeddings.
+        The whole batch uses one encoder (a text the embedder could not
+        encode sends every text to the fallback), so vectors are comparable.
+        Vectors are L2-normalized, so a dot product is the cosine similarity.
+        Blocking (model inference): async callers run it in an executor.
+        
+        Args:
+            texts: Responses to embed
+            dense: False to use hashed embeddings (earlier answers were hashed)
+        
+        Returns:
+            (vectors, whether they are dense sentence embeddings)
+        """
+        cache = getattr(self.brain, 'semantic_cache', None)
+        if dense is not False and cache is not None and HAS_NUMPY:
+            vectors = cache.embedder.encode_many(texts)
+            if vectors is not None and all(v is not None for v in vectors):
+                return [v / (np.linalg.norm(v) or 1.0) for v in vectors], True
+        return [hashed_embedding((text or '').lower()) for text in texts], False
+    
+    @staticmethod
+    def _cosine(a: Any, b: Any) -> float:
+        """Cosine similarity of two normalized vectors (dense or sparse); 0 if not comparable"""
+        if isinstance(a, dict) or isinstance(b, dict):
+            if not (isinstance(a, dict) and isinstance(b, dict)):
+                return 0.0
+            if len(b) < len(a):
+                a, b = b, a
+            return sum(value * b.get(index, 0.0) for index, value in a.items())
+        if len(a) != len(b):
+            return 0.0
+        return float(np.dot(a, b))
+    
+    def _similarity_matrix(self, responses: List[str]) -> List[List[float]]:
+        """Pairwise similarity of responses from one batched embedding call"""
+        vectors, _ = self._embed(responses)
+        return [[self._cosine(a, b) for b in vectors] for a in vectors]
+    
+    def _add_results(
+        self,
+        arrived: List[Dict],
+        new_vectors: List[Any],
+        results: List[Dict],
+        vectors: List[Any],
+        similarities: List[List[float]],
+        min_agreement: float,
+        quorum: int
+    ) -> Optional[List[int]]:
+        """
+        Add newly arrived answers and check for a quorum
+        
+        Extends the similarity matrix by the new answers' rows/columns
+        only (earlier pairs are not recomputed).
+        
+        Returns:
+            Indices of an agreeing group of at least `quorum` results, or None
+        """
+        for result, vector in zip(arrived, new_vectors):
+            row = [self._cosine(vector, other) for other in vectors]
+            for i, sim in enumerate(row):
+                similarities[i].append(sim)
+            similarities.append(row + [1.0])
+            results.append(result)
+            vectors.append(vector)
+        
+        best_group = None
+        for i, row in enumerate(similarities):
+            group = [j for j, sim in enumerate(row) if sim >= min_agreement]
+            if len(group) >= quorum and (best_group is None or len(group) > len(best_group)):
+                best_group = group
+        return best_group
+    
+    def _quorum_response(self, results: List[Dict], similarities: List[List[float]], group: List[int]) -> Dict[str, Any]:
+        """Best answer of an agreeing group, confidence scaled by its agreement"""
+        if len(group) == 1:
+            agreement = 1.0
+        else:
+            pairs = [similarities[i][j] for n, i in enumerate(group) for j in group[n + 1:]]
+            agreement = sum(pairs) / len(pairs)
+        best = max((results[i] for i in group), key=lambda x: x['confidence'])
+        return {
+            'response': best['response'],
+            'confidence': best['confidence'] * agreement,
+            'method': 'quorum_consensus' if len(group) > 1 else 'single',
+            'agreement': agreement
+        }
+    
+    def _combine_responses(self, results: List[Dict], min_agreement: Optional[float],
+                           similarities: Optional[List[List[float]]] = None) -> Dict[str, Any]:
         """
         Combine multiple model responses
         
@@ -339,14 +556,15 @@ class MultiModelConsensus:
                 'agreement': 1.0
             }
         
-        # Calculate response similarity (simple word overlap)
-        similarities = []
-        for i in range(len(results)):
-            for j in range(i+1, len(results)):
-                sim = self._response_similarity(results[i]['response'], results[j]['response'])
-                similarities.append(sim)
+        # Pairwise response similarity (one batched embedding call)
+        if similarities is None:
+            vectors, dense = self._embed([r['response'] for r in results])
+            similarities = [[self._cosine(a, b) for b in vectors] for a in vectors]
+            if min_agreement is None:
+                min_agreement = self.DENSE_MIN_AGREEMENT if dense else self.HASHED_MIN_AGREEMENT
+        pairs = [similarities[i][j] for i in range(len(results)) for j in range(i + 1, len(results))]
         
-        avg_similarity = sum(similarities) / len(similarities) if similarities else 0.0
+        avg_similarity = sum(pairs) / len(pairs) if pairs else 0.0
         
         # High agreement → use best response
         if avg_similarity >= min_agreement:
@@ -370,18 +588,11 @@ class MultiModelConsensus:
         }
     
     def _response_similarity(self, resp1: str, resp2: str) -> float:
-        """Calculate similarity between two responses (simple word overlap)"""
+        """Calculate similarity between two responses (embedding cosine)"""
         try:
-            words1 = set(resp1.lower().split())
-            words2 = set(resp2.lower().split())
-            
-            if not words1 or not words2:
+            if not resp1 or not resp2:
                 return 0.0
-            
-            intersection = len(words1 & words2)
-            union = len(words1 | words2)
-            
-            return intersection / union if union > 0 else 0.0
+            return self._similarity_matrix([resp1, resp2])[0][1]
         except Exception:
             return 0.0
     
@@ -402,7 +613,9 @@ class MultiModelConsensus:
         return {
             'consensus_queries': self.consensus_queries,
             'total_models_queried': self.total_models_queried,
-            'avg_models_per_query': avg_models
+            'avg_models_per_query': avg_models,
+            'early_quorum_stops': self.early_quorum_stops,
+            'stragglers_cancelled': self.stragglers_cancelled
         }
 
 
@@ -452,6 +665,8 @@ class PromptOptimizer:
         
         self.variants[task_type][variant_id] = {
             'prompt': prompt_template,
+            # Parsed once: static prefix reused verbatim, only the suffix is formatted
+            'template': PromptTemplate(prompt_template),
             'stats': {
                 'uses': 0,
                 'successes': 0,
@@ -584,6 +799,18 @@ class PromptOptimizer:
             return self.variants[task_type][variant_id]['prompt']
         return None
     
+    def render_variant(self, task_type: str, variant_id: str, params: Dict[str, Any]) -> Optional[PromptSegments]:
+        """
+        Render a variant as static prefix + dynamic suffix
+        
+        Raises:
+            KeyError: A template parameter is missing from params
+        """
+        variant = self.variants.get(task_type, {}).get(variant_id)
+        if variant is None:
+            return None
+        return variant['template'].render(**params)
+    
     def get_stats(self, task_type: Optional[str] = None) -> Dict[str, Any]:
         """
         Get optimization statistics
@@ -624,26 +851,49 @@ class PerformanceMonitor:
     """
     Advanced observability with percentile calculations (P50, P95, P99).
     Tracks latency distributions and provides detailed performance insights.
+    
+    Each metric is a sliding-window quantile sketch: recording is O(1) with
+    fixed memory, and percentiles/histograms are read from the sketch
+    without sorting raw samples. Sketches export/merge across processes.
     """
     
-    def __init__(self, max_samples: int = 10000):
+    def __init__(self, max_samples: int = 10000, window_seconds: float = 300.0,
+                 window_slices: int = 10, relative_accuracy: float = 0.01):
         """
         Initialize performance monitor
         
         Args:
-            max_samples: Maximum number of samples to keep per metric (rolling window)
+            max_samples: Kept for compatibility (sketches use fixed memory)
+            window_seconds: Sliding window for percentiles
+            window_slices: Sub-windows the window decays by
+            relative_accuracy: Max relative error of reported percentiles
         """
         self.max_samples = max_samples
+        self.window_seconds = window_seconds
+        self.window_slices = window_slices
+        self.relative_accuracy = relative_accuracy
         
-        # Store latency samples for different operations
-        # Structure: {metric_name: [latency1, latency2, ...]}
-        self.metrics: Dict[str, List[float]] = {}
+        # Latency sketches for different operations
+        # Structure: {metric_name: DecayingSketch}
+        self.metrics: Dict[str, DecayingSketch] = {}
         
-        # Counters for operations
+        # Counters for operations (lifetime)
         self.operation_counts: Dict[str, int] = {}
         
         logger.info("✅ Performance monitor initialized")
     
+    def _sketch(self, metric_name: str) -> DecayingSketch:
+        """Get or create the sketch for a metric"""
+        sketch = self.metrics.get(metric_name)
+        if sketch is None:
+            sketch = self.metrics.setdefault(metric_name, DecayingSketch(
+                window_seconds=self.window_seconds,
+                slices=self.window_slices,
+                relative_accuracy=self.relative_accuracy
+            ))
+            self.operation_counts.setdefault(metric_name, 0)
+        return sketch
+    
     def record(self, metric_name: str, latency: float):
         """
         Record a latency measurement
@@ -652,16 +902,8 @@ class PerformanceMonitor:
             metric_name: Name of the metric (e.g., 'think', 'llm_call', 'cache_lookup')
             latency: Latency in seconds
         """
-        if metric_name not in self.metrics:
-            self.metrics[metric_name] = []
-            self.operation_counts[metric_name] = 0
-        
-        self.metrics[metric_name].append(latency)
-        self.operation_counts[metric_name] += 1
-        
-        # Enforce rolling window
-        if len(self.metrics[metric_name]) > self.max_samples:
-            self.metrics[metric_name].pop(0)
+        self._sketch(metric_name).add(latency)
+        self.operation_counts[metric_name] = self.operation_counts.get(metric_name, 0) + 1
     
     def calculate_percentile(self, values: List[float], percentile: float) -> float:
         """
@@ -698,7 +940,10 @@ class PerformanceMonitor:
         Returns:
             Dict with p50, p95, p99, min, max, mean, count
         """
-        if metric_name not in self.metrics or not self.metrics[metric_name]:
+        sketch = self.metrics.get(metric_name)
+        snapshot = sketch.snapshot() if sketch else None
+        
+        if snapshot is None or snapshot.count == 0:
             return {
                 'p50': 0.0,
                 'p95': 0.0,
@@ -709,16 +954,14 @@ class PerformanceMonitor:
                 'count': 0
             }
         
-        values = self.metrics[metric_name]
-        
         return {
-            'p50': self.calculate_percentile(values, 50),
-            'p95': self.calculate_percentile(values, 95),
-            'p99': self.calculate_percentile(values, 99),
-            'min': min(values),
-            'max': max(values),
-            'mean': sum(values) / len(values),
-            'count': len(values)
+            'p50': snapshot.quantile(0.50),
+            'p95': snapshot.quantile(0.95),
+            'p99': snapshot.quantile(0.99),
+            'min': snapshot.min,
+            'max': snapshot.max,
+            'mean': snapshot.mean(),
+            'count': snapshot.count
         }
     
     def get_histogram(self, metric_name: str, num_buckets: int = 10) -> Dict[str, Any]:
@@ -732,23 +975,25 @@ class PerformanceMonitor:
         Returns:
             Dict with bucket ranges and counts
         """
-        if metric_name not in self.metrics or not self.metrics[metric_name]:
+        sketch = self.metrics.get(metric_name)
+        snapshot = sketch.snapshot() if sketch else None
+        
+        if snapshot is None or snapshot.count == 0:
             return {
                 'buckets': [],
                 'counts': [],
                 'total': 0
             }
         
-        values = self.metrics[metric_name]
-        min_val = min(values)
-        max_val = max(values)
+        min_val = snapshot.min
+        max_val = snapshot.max
         
         if min_val == max_val:
             # All values are the same
             return {
                 'buckets': [f"{min_val:.3f}"],
-                'counts': [len(values)],
-                'total': len(values)
+                'counts': [snapshot.count],
+                'total': snapshot.count
             }
         
         # Create buckets
@@ -761,15 +1006,15 @@ class PerformanceMonitor:
             bucket_end = bucket_start + bucket_size
             buckets.append(f"{bucket_start:.3f}-{bucket_end:.3f}")
         
-        # Count values in each bucket
-        for value in values:
-            bucket_idx = min(int((value - min_val) / bucket_size), num_buckets - 1)
-            counts[bucket_idx] += 1
+        # Re-bin sketch buckets (not raw samples) into equal-width ranges
+        for value, count in snapshot.iter_buckets():
+            bucket_idx = int((value - min_val) / bucket_size)
+            counts[min(max(bucket_idx, 0), num_buckets - 1)] += count
         
         return {
             'buckets': buckets,
             'counts': counts,
-            'total': len(values)
+            'total': snapshot.count
         }
     
     def get_stats(self) -> Dict[str, Any]:
@@ -781,18 +1026,44 @@ class PerformanceMonitor:
         """
         stats = {
             'total_metrics': len(self.metrics),
-            'total_samples': sum(len(v) for v in self.metrics.values()),
+            'total_samples': 0,
+            'window_seconds': self.window_seconds,
             'metrics': {}
         }
         
-        for metric_name in self.metrics.keys():
+        for metric_name in list(self.metrics.keys()):
+            percentiles = self.get_percentiles(metric_name)
+            stats['total_samples'] += percentiles['count']
             stats['metrics'][metric_name] = {
-                'percentiles': self.get_percentiles(metric_name),
+                'percentiles': percentiles,
                 'total_operations': self.operation_counts.get(metric_name, 0)
             }
         
         return stats
     
+    def export_sketches(self) -> Dict[str, Dict[str, Any]]:
+        """
+        Export current-window sketches for merging in another process
+        
+        Returns:
+            {metric_name: serialized QuantileSketch}
+        """
+        return {
+            name: sketch.snapshot().to_dict()
+            for name, sketch in list(self.metrics.items())
+        }
+    
+    def merge_sketches(self, exported: Dict[str, Dict[str, Any]]):
+        """
+        Merge sketches exported by another worker (see export_sketches)
+        
+        Merged samples join the current window slice and decay normally.
+        """
+        for metric_name, data in exported.items():
+            remote = QuantileSketch.from_dict(data)
+            self._sketch(metric_name).merge_sketch(remote)
+            self.operation_counts[metric_name] = self.operation_counts.get(metric_name, 0) + remote.count
+    
     def reset(self, metric_name: Optional[str] = None):
         """
         Reset metrics
@@ -802,7 +1073,7 @@ class PerformanceMonitor:
         """
         if metric_name:
             if metric_name in self.metrics:
-                self.metrics[metric_name] = []
+                self.metrics[metric_name].clear()
                 self.operation_counts[metric_name] = 0
         else:
             self.metrics = {}
@@ -1069,6 +1340,16 @@ class CompanionBrain:
         # Initialize Advanced Features (8 Advanced Capabilities)
         self._initialize_advanced_features()
         
+        # Shared query analysis: one memoized pass feeds AGI planning and model routing
+        self.query_analyzer = QueryAnalyzer()
+        # Adaptive model router (process-wide: shares evidence with the API wrapper)
+        self.model_router = shared_model_router
+        # Hedged provider calls: race an alternate model when the primary passes its p90
+        self.hedging_enabled = self.config.get(
+            'hedging', os.getenv('COMPANION_HEDGING', 'true').lower() != 'false'
+        )
+        self.hedged_executor = HedgedExecutor(hedge_budget)
+        
         # Initialize AGI Features (Tier 4) - Optional
         self._initialize_agi_features()
         
@@ -1113,6 +1394,8 @@ class CompanionBrain:
         logger.info(f"🛡️ Circuit breakers initialized: {len(self.circuit_breakers)} components protected")
         logger.info(f"🎯 Tier 3 features: Semantic cache={'✅' if self.semantic_cache.model else '⚠️'}, Consensus=✅, Prompt optimizer=✅, Performance monitor=✅")
     
+    @traced("brain.think", kind=SPAN_KIND_SERVER)
+    @_tenant_scoped
     def think(
         self,
         message: str,
@@ -1158,6 +1441,10 @@ class CompanionBrain:
         start_time = datetime.now()
         think_start = start_time  # Track think() latency
         
+        span = current_span()
+        span.set_attribute('app_type', self.app_type)
+        span.set_attribute('message.length', len(message))
+        
         # AGI DECISION ENGINE - Autonomous intelligence
         if use_agi_decision and self.enable_agi and self.agi_decision_engine:
             return self._think_with_agi(message, context, tools, user_id, conversation_id, start_time)
@@ -1206,7 +1493,9 @@ class CompanionBrain:
                     'tools': sorted(tools),
                     'has_history': len(chat_history) > 1
                 }
-                cached = self.semantic_cache.get(message, cache_context)
+                with tracer.span("cache.semantic_lookup") as cache_span:
+                    cached = self.semantic_cache.get(message, cache_context)
+                    cache_span.set_attribute('cache.hit', bool(cached))
                 if cached:
                     self.stats['cached_responses'] += 1
                     logger.info(f"⚡ Using semantic cached response")
@@ -1240,6 +1529,7 @@ class CompanionBrain:
                     'has_history': len(chat_history) > 1
                 }
                 cached = response_cache.get(message, cache_context)
+                prom_metrics.cache_events.labels('response', 'hit' if cached else 'miss').inc()
                 if cached:
                     self.stats['cached_responses'] += 1
                     logger.info(f"⚡ Using cached response")
@@ -1306,11 +1596,14 @@ class CompanionBrain:
                     'success': True
                 }
             
-            api_response = generate_companion_response(
-                message=message,
-                tools=tools,
-                chat_history=chat_history[:-1]  # Exclude the message we just added
-            )
+            with tracer.span("llm.generate", kind=SPAN_KIND_CLIENT) as llm_span:
+                api_response = generate_companion_response(
+                    message=message,
+                    tools=tools,
+                    chat_history=chat_history[:-1]  # Exclude the message we just added
+                )
+                llm_span.set_attribute('llm.model', str(api_response.model))
+                llm_span.set_attribute('llm.success', bool(api_response.success))
             
             if api_response.success:
                 self.success_count += 1
@@ -1356,6 +1649,7 @@ class CompanionBrain:
                 self.performance_monitor.record('think_total', think_latency)
                 self.performance_monitor.record('llm_call', response_time)
                 self.performance_monitor.record(f'model_{model_name}', response_time)
+                prom_metrics.think_latency.labels('legacy').observe(think_latency)
                 
                 logger.info(f"✅ Brain generated response in {response_time:.2f}s using {model_name}")
                 
@@ -1391,6 +1685,7 @@ class CompanionBrain:
         except Exception as e:
             self.stats['failed_requests'] += 1
             logger.error(f"❌ Brain error: {str(e)}")
+            current_span().record_exception(e)
             
             return {
                 'response': "I encountered an unexpected error while processing your request.",
@@ -1403,6 +1698,7 @@ class CompanionBrain:
                 'error': str(e)
             }
     
+    @traced("brain.think_agi")
     def _think_with_agi(self, message: str, context: Optional[Dict[str, Any]], 
                        tools: Optional[List[str]], user_id: Optional[str], 
                        conversation_id: Optional[str], start_time: datetime) -> Dict[str, Any]:
@@ -1466,6 +1762,12 @@ class CompanionBrain:
             # Calculate total time
             total_time = (datetime.now() - start_time).total_seconds()
             
+            span = current_span()
+            span.set_attribute('agi.decision_id', decision_plan.decision_id)
+            span.set_attribute('agi.query_type', decision_plan.query_type.value)
+            span.set_attribute('agi.steps_completed', execution_result.steps_completed)
+            span.set_attribute('agi.decision_time_s', decision_time)
+            
             if execution_result.success:
                 self.success_count += 1
                 self.stats['successful_requests'] += 1
@@ -1496,6 +1798,7 @@ class CompanionBrain:
                         'confidence': decision_plan.confidence,
                         'modules_used': execution_result.modules_used,
                         'steps_completed': execution_result.steps_completed,
+                        'background_steps': execution_result.background_steps,
                         'execution_time': execution_time,
                         'decision_time': decision_time,
                         'total_time': total_time,
@@ -1539,6 +1842,7 @@ class CompanionBrain:
         except Exception as e:
             self.stats['failed_requests'] += 1
             logger.error(f"❌ AGI thinking error: {str(e)}")
+            current_span().record_exception(e)
             import traceback
             logger.debug(traceback.format_exc())
             
@@ -1546,6 +1850,7 @@ class CompanionBrain:
             logger.info("⚠️ Falling back to legacy thinking mode")
             return self._think_legacy(message, context, tools, user_id, conversation_id, start_time)
     
+    @traced("brain.think_legacy")
     def _think_legacy(self, message: str, context: Optional[Dict[str, Any]], 
                      tools: Optional[List[str]], user_id: Optional[str], 
                      conversation_id: Optional[str], start_time: datetime) -> Dict[str, Any]:
@@ -1699,15 +2004,15 @@ class CompanionBrain:
             if not model:
                 model = self._route_to_best_model(message=message, task=task)
 
-            # Prepare callable for retry wrapper
-            def _call():
-                return bytez.generate(
+            # Prepare callable for retry wrapper (per model, so it can be hedged)
+            def _make_call(call_model):
+                return lambda: bytez.generate(
                     messages=[{'role': 'user', 'content': message}],
-                    model=model,
+                    model=call_model,
                     max_tokens=1024  # Set reasonable token limit like Groq
                 )
 
-            result = self._call_with_retry(_call, provider='bytez', model=model)
+            result = self._call_hedged(_make_call, model, message, task=task)
             
             response_time = (datetime.now() - start_time).total_seconds()
             
@@ -1835,7 +2140,7 @@ class CompanionBrain:
     # ------------------------------------------------------------------
     def _call_with_retry(self, func: Callable, max_retries: int = 3, backoff_factor: float = 1.5, 
                         provider: Optional[str] = None, model: Optional[str] = None, 
-                        use_circuit_breaker: bool = True):
+                        use_circuit_breaker: bool = True, cancel_event: Optional[threading.Event] = None):
         """
         Call a synchronous function with retries, exponential backoff, and circuit breaker protection.
         Returns the successful function result or raises the last exception.
@@ -1848,35 +2153,52 @@ class CompanionBrain:
             provider: Provider name for metrics and circuit breaker
             model: Model name for metrics
             use_circuit_breaker: Enable circuit breaker protection
+            cancel_event: Set by a hedged call's winner; stops further attempts
         """
+        metric_provider = provider or 'unknown'
+        metric_model = model or 'default'
+        
         # Wrap with circuit breaker if enabled and available
         if use_circuit_breaker and provider and provider in self.circuit_breakers:
             breaker = self.circuit_breakers[provider]
             # Check if circuit is open
             if breaker.state == CircuitState.OPEN:
                 logger.warning(f"⚠️ Circuit breaker for '{provider}' is OPEN, skipping request")
+                prom_metrics.llm_requests.labels(metric_provider, metric_model, 'circuit_open').inc()
                 raise RuntimeError(f"Circuit breaker '{provider}' is OPEN")
         
         attempt = 0
         last_exc = None
         while attempt < max_retries:
+            if cancel_event is not None and cancel_event.is_set():
+                raise RuntimeError(f"Call cancelled for provider={provider} model={model}")
             try:
                 start = time.time()
                 
-                # Execute with circuit breaker protection if enabled
-                if use_circuit_breaker and provider and provider in self.circuit_breakers:
-                    result = self.circuit_breakers[provider].call(func)
-                else:
-                    result = func()
+                with tracer.span("llm.call", {
+                    'llm.provider': metric_provider,
+                    'llm.model': metric_model,
+                    'llm.attempt': attempt + 1
+                }, kind=SPAN_KIND_CLIENT):
+                    # Execute with circuit breaker protection if enabled
+                    if use_circuit_breaker and provider and provider in self.circuit_breakers:
+                        result = self.circuit_breakers[provider].call(func)
+                    else:
+                        result = func()
                     
                 elapsed = time.time() - start
+                prom_metrics.llm_requests.labels(metric_provider, metric_model, 'success').inc()
+                prom_metrics.llm_latency.labels(metric_provider, metric_model).observe(elapsed)
+                
+                # Feed the adaptive router (latency, throughput)
+                if model:
+                    self.model_router.record(
+                        model, elapsed, True, provider=provider, tokens=self._result_tokens(result)
+                    )
 
-                # record latency per provider
+                # record latency per provider (sketch: O(1), fixed memory)
                 if provider:
-                    key = f"latency_{provider}"
-                    self.stats.setdefault('phase_latencies', {})
-                    self.stats['phase_latencies'].setdefault(key, [])
-                    self.stats['phase_latencies'][key].append(elapsed)
+                    self.performance_monitor.record(f'provider_{provider}', elapsed)
 
                 # model usage
                 if model:
@@ -1887,9 +2209,16 @@ class CompanionBrain:
                 return result
             except Exception as e:
                 last_exc = e
+                prom_metrics.llm_requests.labels(metric_provider, metric_model, 'error').inc()
+                if model:
+                    self.model_router.record(model, time.time() - start, False, provider=provider)
                 wait = backoff_factor * (2 ** attempt)
                 logger.warning(f"Retry {attempt+1}/{max_retries} failed for provider={provider} model={model}: {e}; retrying in {wait:.1f}s")
-                time.sleep(wait)
+                if cancel_event is not None:
+                    # Wake early if a hedged sibling already answered
+                    cancel_event.wait(wait)
+                else:
+                    time.sleep(wait)
                 attempt += 1
 
         # exhausted retries
@@ -1898,6 +2227,95 @@ class CompanionBrain:
             raise last_exc
         raise RuntimeError(f"Retries exhausted for provider={provider} model={model}")
 
+    def _result_tokens(self, result: Any) -> int:
+        """
+        Generated tokens in a provider result: reported usage when the
+        provider returns it, else estimated from the text. Handles plain
+        strings, result dicts (Bytez: {'response': ...}) and SDK objects
+        with .usage / .choices.
+        """
+        if isinstance(result, str):
+            return self._estimate_tokens(result)
+        if isinstance(result, dict):
+            if not result.get('success', True):
+                return 0
+            usage = result.get('usage') or (result.get('metadata') or {}).get('usage')
+            if isinstance(usage, dict):
+                reported = usage.get('completion_tokens') or usage.get('total_tokens')
+                if reported:
+                    return int(reported)
+            reported = (result.get('metadata') or {}).get('tokens')
+            if reported:
+                return int(reported)
+            for key in ('response', 'text', 'content', 'output'):
+                if isinstance(result.get(key), str):
+                    return self._estimate_tokens(result[key])
+            return 0
+        usage = getattr(result, 'usage', None)
+        reported = getattr(usage, 'completion_tokens', None) or getattr(usage, 'total_tokens', None)
+        if reported:
+            return int(reported)
+        choices = getattr(result, 'choices', None)
+        if choices:
+            message = getattr(choices[0], 'message', None)
+            return self._estimate_tokens(getattr(message, 'content', None) or '')
+        return 0
+
+    @staticmethod
+    def _is_usable_response(result: Any) -> bool:
+        """Whether a provider result is an answer (not empty, not a failure dict)"""
+        if isinstance(result, dict):
+            return bool(result.get('success', True))
+        return bool(result)
+
+    def _call_hedged(self, make_call: Callable[[Optional[str]], Callable], model: Optional[str],
+                     message: str, task: Optional[str] = None, provider: str = 'bytez'):
+        """
+        Provider call with retries, hedged against tail latency.
+        If the primary model has not answered within its observed p90, the
+        same request goes to the router's best alternate model; the first
+        usable answer wins and the loser stops retrying. Extra calls are
+        capped per caller tenant (the user_id given to think(); app_type
+        for anonymous requests) by the shared hedge budget.
+
+        Args:
+            make_call: Builds the zero-arg provider call for a model
+            model: Primary model (from _route_to_best_model)
+            message: Request text, used to pick the alternate
+            task: Optional task hint, used to pick the alternate
+            provider: Provider name for metrics and circuit breaker
+        """
+        if not self.hedging_enabled or not model:
+            return self._call_with_retry(make_call(model), provider=provider, model=model)
+
+        tokens = self._estimate_tokens(message)
+        context = self._routing_context(message, task, tokens)
+        alternate_model = self.model_router.select(context, estimated_tokens=tokens, exclude=[model])
+        hedge_delay = self.model_router.latency_quantile(
+            model, 0.9, default=self.model_router.latency_slo / 2
+        )
+
+        def _primary(cancel_event):
+            return self._call_with_retry(make_call(model), provider=provider, model=model,
+                                         cancel_event=cancel_event)
+
+        def _alternate(cancel_event):
+            # One attempt: the primary keeps its own retries running
+            return self._call_with_retry(make_call(alternate_model), max_retries=1, provider=provider,
+                                         model=alternate_model, cancel_event=cancel_event)
+
+        outcome = self.hedged_executor.call(
+            tracer.wrap(_primary),
+            tracer.wrap(_alternate) if alternate_model else None,
+            hedge_delay,
+            tenant=_request_tenant.get() or self.app_type,
+            is_usable=self._is_usable_response,
+            on_hedge=lambda result: prom_metrics.llm_hedges.labels(self.app_type, result).inc()
+        )
+        if outcome.winner == 'hedge':
+            logger.info(f"🏁 Hedged {model} → {alternate_model} won after {outcome.latency:.2f}s (p90 {hedge_delay:.2f}s)")
+        return outcome.result
+
     def _manage_context_window(self, conversation_context: Dict[str, Any], max_turns: int = 40, use_llm_summary: bool = True):
         """
         Trim or summarize conversation history to avoid token limits.
@@ -1965,10 +2383,35 @@ Summary:"""
             return 0
         return len(text) // 4
     
+    def _routing_context(self, message: str, task: Optional[str] = None, tokens: int = 0) -> str:
+        """
+        Map a request to a ModelRouter context: task hint first, then
+        context size, then content patterns (shared, memoized analysis)
+        """
+        # Task hints override heuristics
+        if task:
+            if 'code' in task:
+                return 'code'
+            if 'reason' in task or 'think' in task:
+                return 'reasoning'
+            if 'chat' in task:
+                return 'chat'
+
+        # Token-based routing for long context
+        if tokens > 4000:
+            # Very long context -> models with large context windows
+            return 'long_context'
+        if tokens > 2000:
+            return 'medium_context'
+
+        return self.query_analyzer.analyze((message or "").lower()).model_route
+
     def _route_to_best_model(self, message: str, task: Optional[str] = None, estimated_tokens: Optional[int] = None) -> Optional[str]:
         """
-        Intelligent heuristic-based model router.
-        Selects specialized models based on task type, content patterns, and context size.
+        Adaptive model router.
+        Maps the request to a routing context (task hint, context size, content
+        patterns), then lets the shared ModelRouter pick a model for it from
+        live latency/error evidence under the latency SLO and cost budget.
         Returns a model name compatible with Bytez or None to let provider choose.
         
         Args:
@@ -1980,49 +2423,11 @@ Summary:"""
             Model name string or None
         """
         try:
-            text = (message or "").lower()
             tokens = estimated_tokens or self._estimate_tokens(message)
-
-            # Task hints override heuristics
-            if task:
-                if 'code' in task:
-                    return 'deepseek-coder'
-                if 'reason' in task or 'think' in task:
-                    return 'qwen-4b'  # Changed from phi-2-reasoner (Bytez too slow)
-                if 'chat' in task:
-                    return 'qwen-4b'
-
-            # Token-based routing for long context
-            if tokens > 4000:
-                # Very long context -> use model with large context window
-                logger.debug(f"📏 Long context detected ({tokens} tokens) → using qwen-72b")
-                return 'qwen-72b'
-            elif tokens > 2000:
-                # Medium-long context
-                return 'qwen-32b'
-
-            # Content pattern heuristics
-            code_patterns = ['def ', 'import ', 'class ', 'function ', 'const ', 'var ', 
-                           'console.log', 'print(', 'return ', '```', 'async ', 'await ']
-            if any(k in text for k in code_patterns):
-                logger.debug("💻 Code pattern detected → using deepseek-coder")
-                return 'deepseek-coder'
-
-            reasoning_patterns = ['why', 'how', 'because', 'explain', 'prove', 'analyze',
-                                'compare', 'evaluate', 'reason', 'logic']
-            if any(k in text for k in reasoning_patterns):
-                logger.debug("🧠 Reasoning pattern detected → using qwen-4b")
-                return 'qwen-4b'  # Changed from phi-2-reasoner (Bytez too slow)
-
-            math_patterns = ['calculate', 'compute', 'equation', 'formula', 'solve', 
-                           'integral', 'derivative', 'theorem']
-            if any(k in text for k in math_patterns):
-                logger.debug("🔢 Math pattern detected → using qwen-math")
-                return 'qwen-math'
-
-            # Default: fast general chat model
-            logger.debug("💬 General chat → using qwen-4b")
-            return 'qwen-4b'
+            context = self._routing_context(message, task, tokens)
+            model = self.model_router.select(context, estimated_tokens=tokens)
+            logger.debug(f"🎯 Routing context '{context}' ({tokens} tokens) → {model}")
+            return model
         except Exception as e:
             logger.warning(f"⚠️ Model routing failed: {e}, using default")
             return None
@@ -2032,8 +2437,9 @@ Summary:"""
         self, 
         message: str,
         models: Optional[List[str]] = None,
-        min_agreement: float = 0.6,
-        context: Optional[Dict[str, Any]] = None
+        min_agreement: Optional[float] = None,
+        context: Optional[Dict[str, Any]] = None,
+        quorum: Optional[int] = None
     ) -> Dict[str, Any]:
         """
         Query multiple models in parallel and combine results with consensus scoring.
@@ -2044,8 +2450,11 @@ Summary:"""
         Args:
             message: The user message/query
             models: List of model names to query (default: ['qwen-4b', 'phi-2-reasoner', 'deepseek-coder'])
-            min_agreement: Minimum agreement threshold for consensus (0.0-1.0)
+            min_agreement: Minimum cosine agreement for consensus (0.0-1.0;
+                default depends on the embedder, see MultiModelConsensus)
             context: Optional conversation context dict
+            quorum: Agreeing models needed to answer early and cancel the rest
+                    (default: majority of models)
             
         Returns:
             Dict with keys:
@@ -2068,7 +2477,7 @@ Summary:"""
         """
         try:
             # Check semantic cache first for the consensus query
-            cache_context = f"consensus_{models or 'default'}_{min_agreement}"
+            cache_context = f"consensus_{models or 'default'}_{min_agreement}_{quorum}"
             cached = self.semantic_cache.get(message, cache_context)
             if cached:
                 logger.info("⚡ Using cached consensus result")
@@ -2085,7 +2494,8 @@ Summary:"""
             result = await self.multi_model_consensus.query_with_consensus(
                 message, 
                 models=models, 
-                min_agreement=min_agreement
+                min_agreement=min_agreement,
+                quorum=quorum
             )
             
             # Cache the consensus result
@@ -2169,19 +2579,16 @@ Summary:"""
             logger.warning(f"⚠️ No prompt variants for task: {task_type}")
             return str(task_params.get('task') or task_params.get('topic') or str(task_params))
         
-        # Get prompt template
-        template = self.prompt_optimizer.get_variant_prompt(task_type, variant_id)
-        if not template:
-            return str(task_params.get('task') or task_params.get('topic') or str(task_params))
-        
-        # Fill in parameters
+        # Fill in parameters (pre-parsed template: static prefix + dynamic suffix)
         try:
-            prompt = template.format(**task_params)
+            segments = self.prompt_optimizer.render_variant(task_type, variant_id, task_params)
+            if segments is None:
+                return str(task_params.get('task') or task_params.get('topic') or str(task_params))
             logger.debug(f"📝 Using prompt variant: {task_type}/{variant_id}")
-            return prompt
+            return segments.text
         except KeyError as e:
             logger.warning(f"⚠️ Missing parameter for prompt template: {e}")
-            return template
+            return self.prompt_optimizer.get_variant_prompt(task_type, variant_id)
     
     def record_prompt_result(
         self,
@@ -2310,16 +2717,18 @@ Summary:"""
             'active_conversations': len(self.contexts)
         }
 
-        # Compute simple averages for phase latencies if available
-        lat = stats.get('phase_latencies', {})
+        # Per-provider latency from the performance monitor sketches
         avg_lat = {}
-        for k, arr in lat.items():
-            try:
-                avg_lat[k] = sum(arr) / len(arr) if arr else 0.0
-            except Exception:
-                avg_lat[k] = 0.0
+        pct_lat = {}
+        for metric_name in list(self.performance_monitor.metrics.keys()):
+            if metric_name.startswith('provider_'):
+                key = f"latency_{metric_name[len('provider_'):]}"
+                percentiles = self.performance_monitor.get_percentiles(metric_name)
+                avg_lat[key] = percentiles['mean']
+                pct_lat[key] = percentiles
 
         stats['phase_latency_averages'] = avg_lat
+        stats['phase_latency_percentiles'] = pct_lat
         
         # Add circuit breaker states
         stats['circuit_breakers'] = {
@@ -2332,12 +2741,16 @@ Summary:"""
         stats['multi_model_consensus'] = self.multi_model_consensus.get_stats()
         stats['prompt_optimizer'] = self.prompt_optimizer.get_stats()
         stats['performance_monitor'] = self.performance_monitor.get_stats()
+        stats['model_routing'] = self.model_router.get_stats()
+        stats['hedging'] = {'enabled': self.hedging_enabled, **self.hedged_executor.get_stats()}
 
         return stats
     
+    @traced("search.web", kind=SPAN_KIND_CLIENT)
     def search_web(self, query: str, deep_search: bool = False) -> Dict[str, Any]:
         """Direct web search capability"""
         try:
+            current_span().set_attribute('search.deep', deep_search)
             results = search_wrapper.enhanced_search_with_mining(query, deep_search=deep_search)
             return {
                 'success': True,
@@ -2345,6 +2758,7 @@ Summary:"""
             }
         except Exception as e:
             logger.error(f"Web search error: {e}")
+            current_span().record_exception(e)
             return {
                 'success': False,
                 'error': str(e)
@@ -2497,7 +2911,9 @@ Summary:"""
         self.local_intelligence = None
         self.neural_reasoning = None
         self.personality_engine = None
+        self._personality_lock = threading.RLock()  # shared engine mutates on every interaction
         self.self_learning = None
+        self.tenant_state = None  # Per-user overlays on the two above
         self.autonomous_system = None
         self.agi_decision_engine = None  # The autonomous decision-making core
         
@@ -2551,6 +2967,15 @@ Summary:"""
             except Exception as e:
                 logger.warning(f"⚠️ Self-Learning System failed: {e}")
             
+            # Per-user state: copy-on-write personality and learning overlays
+            if self.personality_engine or self.self_learning:
+                try:
+                    from companion_baas.core.tenant_state import TenantStateManager
+                    self.tenant_state = TenantStateManager(self.personality_engine, self.self_learning)
+                    logger.info("✅ Tenant State Manager initialized")
+                except Exception as e:
+                    logger.warning(f"⚠️ Tenant State Manager failed: {e}")
+            
             # Initialize Autonomous System (only if explicitly enabled)
             if self.enable_autonomy:
                 try:
@@ -2839,7 +3264,8 @@ Summary:"""
                 create_worker_thread(
                     thread_info,
                     task_queue,
-                    lambda task: self.personality_engine.process_interaction(task['message'])
+                    lambda task: self._with_personality_lock(
+                        self.personality_engine.process_interaction, task['message'])
                 )
             
             thread_id = self.thread_manager.create_thread(
@@ -3062,47 +3488,54 @@ Summary:"""
         return phases
     
     def _register_default_prompt_variants(self):
-        """Register default prompt variants for A/B testing"""
+        """
+        Register default prompt variants for A/B testing
+        
+        Templates put their static instructions first and the task last, so
+        the instruction prefix is identical across calls and can be served
+        from provider prefix/KV caches.
+        """
         # Code generation task variants
         self.prompt_optimizer.register_variant(
             'code_generation',
             'detailed',
-            'Generate clean, well-documented code for the following task:\n{task}\n\nRequirements: Include comments, error handling, and follow best practices.'
+            'Generate clean, well-documented code. Requirements: Include comments, error handling, and follow best practices.\n\nTask:\n{task}'
         )
         self.prompt_optimizer.register_variant(
             'code_generation',
             'concise',
-            'Write efficient code for: {task}\n\nFocus on brevity and performance.'
+            'Write efficient code. Focus on brevity and performance.\n\nTask: {task}'
         )
         
         # Explanation task variants
         self.prompt_optimizer.register_variant(
             'explanation',
             'detailed',
-            'Provide a comprehensive explanation of:\n{topic}\n\nInclude examples, analogies, and step-by-step breakdown.'
+            'Provide a comprehensive explanation. Include examples, analogies, and step-by-step breakdown.\n\nTopic:\n{topic}'
         )
         self.prompt_optimizer.register_variant(
             'explanation',
             'simple',
-            'Explain {topic} in simple terms that anyone can understand.'
+            'Explain the following in simple terms that anyone can understand.\n\nTopic: {topic}'
         )
         
         # Debugging task variants
         self.prompt_optimizer.register_variant(
             'debugging',
             'systematic',
-            'Analyze this code for bugs:\n{code}\n\nProvide: 1) Issue identification, 2) Root cause, 3) Fix, 4) Prevention tips.'
+            'Analyze this code for bugs. Provide: 1) Issue identification, 2) Root cause, 3) Fix, 4) Prevention tips.\n\nCode:\n{code}'
         )
         self.prompt_optimizer.register_variant(
             'debugging',
             'quick_fix',
-            'Find and fix bugs in:\n{code}\n\nProvide corrected code with brief explanation.'
+            'Find and fix bugs in the code below. Provide corrected code with brief explanation.\n\nCode:\n{code}'
         )
     
     # ============================================================================
     # NEW PHASE METHODS
     # ============================================================================
     
+    @traced("tool.execute_code", kind=SPAN_KIND_CLIENT)
     def execute_code(
         self,
         code: str,
@@ -3150,12 +3583,14 @@ Summary:"""
             }
         except Exception as e:
             logger.error(f"Code execution error: {e}")
+            current_span().record_exception(e)
             return {
                 'success': False,
                 'error': str(e),
                 'output': None
             }
     
+    @traced("tool.call", kind=SPAN_KIND_CLIENT)
     def call_tool(
         self,
         tool_name: str,
@@ -3182,6 +3617,7 @@ Summary:"""
                 'result': None
             }
         
+        current_span().set_attribute('tool.name', tool_name)
         try:
             if self.profiler:
                 with self.profiler.measure(f"tool_{tool_name}"):
@@ -3192,6 +3628,7 @@ Summary:"""
             if self.monitor:
                 self.monitor.record_request(f"tool_{tool_name}", 0.001, "success")
             
+            current_span().set_attribute('tool.cached', bool(result.cached))
             return {
                 'success': True,
                 'result': result.result,
@@ -3200,6 +3637,7 @@ Summary:"""
             }
         except Exception as e:
             logger.error(f"Tool execution error: {e}")
+            current_span().record_exception(e)
             if self.monitor:
                 self.monitor.record_error("tool_error", str(e))
             return {
@@ -3214,6 +3652,7 @@ Summary:"""
             return []
         return self.tool_registry.list_tools()
     
+    @traced("search.semantic", kind=SPAN_KIND_CLIENT)
     def semantic_search(
         self,
         query: str,
@@ -3248,12 +3687,14 @@ Summary:"""
             }
         except Exception as e:
             logger.error(f"Semantic search error: {e}")
+            current_span().record_exception(e)
             return {
                 'success': False,
                 'error': str(e),
                 'results': []
             }
     
+    @traced("search.hybrid", kind=SPAN_KIND_CLIENT)
     def hybrid_search(
         self,
         query: str,
@@ -3286,12 +3727,14 @@ Summary:"""
             }
         except Exception as e:
             logger.error(f"Hybrid search error: {e}")
+            current_span().record_exception(e)
             return {
                 'success': False,
                 'error': str(e),
                 'results': []
             }
     
+    @traced("web.crawl", kind=SPAN_KIND_CLIENT)
     def crawl_web(
         self,
         url: str,
@@ -3314,6 +3757,7 @@ Summary:"""
                 'content': None
             }
         
+        current_span().set_attribute('http.url', url)
         try:
             result = self.web_crawler.crawl(url)
             return {
@@ -3323,6 +3767,7 @@ Summary:"""
             }
         except Exception as e:
             logger.error(f"Web crawling error: {e}")
+            current_span().record_exception(e)
             return {
                 'success': False,
                 'error': str(e),
@@ -3349,6 +3794,7 @@ Summary:"""
     # ADVANCED FEATURES METHODS (8 Capabilities)
     # ============================================================================
     
+    @traced("brain.call_llm")
     def _call_llm(self, prompt: str, **kwargs) -> str:
         """
         Internal LLM caller for advanced features
@@ -3380,13 +3826,15 @@ Summary:"""
                 bytez = self.providers['bytez']
                 model = self._route_to_best_model(prompt)
 
-                def _call():
-                    # prefer chat if available, else generate
-                    if hasattr(bytez, 'chat'):
-                        return bytez.chat(prompt, model=model)
-                    return bytez.generate(messages=[{'role': 'user', 'content': prompt}], model=model)
+                def _make_call(call_model):
+                    def _call():
+                        # prefer chat if available, else generate
+                        if hasattr(bytez, 'chat'):
+                            return bytez.chat(prompt, model=call_model)
+                        return bytez.generate(messages=[{'role': 'user', 'content': prompt}], model=call_model)
+                    return _call
 
-                result = self._call_with_retry(_call, provider='bytez', model=model)
+                result = self._call_hedged(_make_call, model, prompt)
                 return result
             
             return "LLM not available"
@@ -3655,6 +4103,8 @@ Summary:"""
     # ASYNC THINKING (Tier 2 - Parallel Phase Execution)
     # ============================================================================
     
+    @traced("brain.think_async", kind=SPAN_KIND_SERVER)
+    @_tenant_scoped
     async def think_async(
         self,
         message: str,
@@ -3752,6 +4202,7 @@ Summary:"""
             
         except Exception as e:
             logger.error(f"❌ Async think error: {e}")
+            current_span().record_exception(e)
             self.stats['failed_requests'] += 1
             return {
                 'response': f"I encountered an error: {str(e)}",
@@ -3763,8 +4214,9 @@ Summary:"""
                 'error': str(e)
             }
     
+    @traced("brain.phases_parallel")
     async def _execute_phases_parallel(self, message: str, tools: List[str], context: Dict) -> Dict[str, Any]:
-        """Execute independent phases concurrently"""
+        """Execute independent phases concurrently (each gathered task inherits the span context)"""
         tasks = []
         phase_names = []
         
@@ -3785,11 +4237,13 @@ Summary:"""
         
         # Execute all tasks concurrently
         if tasks:
+            current_span().set_attribute('phases', phase_names)
             results = await asyncio.gather(*tasks, return_exceptions=True)
             return {name: result for name, result in zip(phase_names, results) if not isinstance(result, Exception)}
         
         return {}
     
+    @traced("brain.phases_sequential")
     async def _execute_phases_sequential(self, message: str, tools: List[str], context: Dict) -> Dict[str, Any]:
         """Execute phases sequentially (fallback)"""
         results = {}
@@ -3805,26 +4259,29 @@ Summary:"""
         
         return results
     
+    @traced("phase.knowledge")
     async def _async_knowledge_lookup(self, query: str) -> Dict[str, Any]:
         """Async knowledge retrieval"""
         try:
             loop = asyncio.get_event_loop()
-            result = await loop.run_in_executor(None, lambda: self.knowledge_retriever.search(query) if self.knowledge_retriever else None)
+            result = await loop.run_in_executor(None, tracer.wrap(lambda: self.knowledge_retriever.search(query) if self.knowledge_retriever else None))
             return {'success': True, 'data': result}
         except Exception as e:
             logger.warning(f"Knowledge lookup failed: {e}")
             return {'success': False, 'error': str(e)}
     
+    @traced("phase.web")
     async def _async_web_search(self, query: str, deep: bool = False) -> Dict[str, Any]:
         """Async web search"""
         try:
             loop = asyncio.get_event_loop()
-            result = await loop.run_in_executor(None, lambda: self.search_web(query, deep_search=deep))
+            result = await loop.run_in_executor(None, tracer.wrap(lambda: self.search_web(query, deep_search=deep)))
             return result
         except Exception as e:
             logger.warning(f"Web search failed: {e}")
             return {'success': False, 'error': str(e)}
     
+    @traced("phase.code")
     async def _async_code_analysis(self, message: str) -> Dict[str, Any]:
         """Async code analysis"""
         try:
@@ -3835,6 +4292,7 @@ Summary:"""
         except Exception as e:
             return {'success': False, 'error': str(e)}
     
+    @traced("brain.final_response")
     async def _generate_final_response(self, message: str, phase_results: Dict[str, Any], context: Dict) -> str:
         """Generate final response using phase results and LLM"""
         try:
@@ -3858,7 +4316,7 @@ Summary:"""
             
             # Generate response using LLM
             loop = asyncio.get_event_loop()
-            response = await loop.run_in_executor(None, lambda: self._call_llm(enriched_message))
+            response = await loop.run_in_executor(None, tracer.wrap(lambda: self._call_llm(enriched_message)))
             
             return response
         except Exception as e:
@@ -3869,21 +4327,36 @@ Summary:"""
     # AGI FEATURES (Tier 4) - Enhanced Intelligence Methods
     # ============================================================================
     
-    def get_personality(self) -> Optional[Dict[str, Any]]:
-        """Get current personality state (AGI feature)"""
+    def _with_personality_lock(self, function, *args, **kwargs):
+        with self._personality_lock:
+            return function(*args, **kwargs)
+    
+    def get_personality(self, user_id: Optional[str] = None) -> Optional[Dict[str, Any]]:
+        """Get current personality state (AGI feature), per user when user_id is given"""
         if not self.enable_agi or not self.personality_engine:
             return None
         
+        engine, lock = self.personality_engine, self._personality_lock
+        if user_id and self.tenant_state:
+            state = self.tenant_state.get(user_id)
+            if state.personality is not None:
+                engine, lock = state.personality, state.lock
+        
+        with lock:
+            traits_dict = engine.traits.to_dict()
+            emotion = engine.emotional_state.current_emotion.value
+            intensity = engine.emotional_state.emotion_intensity
+            personality_id = engine.personality_id
+        
         # Get dominant traits (top 3)
-        traits_dict = self.personality_engine.traits.to_dict()
         sorted_traits = sorted(traits_dict.items(), key=lambda x: x[1], reverse=True)
         dominant_traits = [name for name, _ in sorted_traits[:3]]
         
         return {
-            'personality_id': self.personality_engine.personality_id,
+            'personality_id': personality_id,
             'traits': traits_dict,
-            'emotion': self.personality_engine.emotional_state.current_emotion.value,
-            'emotion_intensity': self.personality_engine.emotional_state.emotion_intensity,
+            'emotion': emotion,
+            'emotion_intensity': intensity,
             'dominant_traits': dominant_traits
         }
     
@@ -3942,13 +4415,15 @@ Summary:"""
             logger.error(f"Failed to teach concept: {e}")
             return False
     
-    def think_with_agi(self, query: str, mode: str = "auto") -> Dict[str, Any]:
+    def think_with_agi(self, query: str, mode: str = "auto",
+                       user_id: Optional[str] = None) -> Dict[str, Any]:
         """
         Enhanced thinking with AGI features
         
         Args:
             query: The question or task
             mode: Thinking mode (auto, reasoning, creative, conceptual)
+            user_id: Style and learn with this user's own state
         
         Returns:
             Dict with response and AGI metadata
@@ -3974,21 +4449,29 @@ Summary:"""
                     reasoning_result = {"thoughts": [query], "conclusion": query}
             
             # Step 2: Generate base response
-            base_response = self.think(query)
+            base_response = self.think(query, user_id=user_id)
+            tenant_state = self.tenant_state if user_id else None
             
             # Step 3: Apply personality styling (if enabled)
             if self.personality_engine and base_response.get('success'):
-                styled_response = self.personality_engine.style_response(
-                    base_response['response'],
-                    query
-                )
+                if tenant_state:
+                    styled_response = tenant_state.process_interaction(user_id, query, base_response['response'])
+                else:
+                    with self._personality_lock:
+                        styled_response = self.personality_engine.process_interaction(query, base_response['response'])
                 base_response['response'] = styled_response
-                
-                # Update emotion based on interaction
-                self.personality_engine.update_emotion("analytical" if "?" in query else "neutral")
             
             # Step 4: Learn from interaction (if enabled)
-            if self.self_learning:
+            if tenant_state:
+                tenant_state.learn_from_interaction(
+                    user_id,
+                    query,
+                    base_response['response'],
+                    {"mode": mode, "reasoning": reasoning_result},
+                    {},  # outcome
+                    "neutral"  # emotions
+                )
+            elif self.self_learning:
                 self.self_learning.episodic.store_episode(
                     query,
                     base_response['response'],
@@ -4255,6 +4738,15 @@ Summary:"""
             logger.info("🛑 Shutting down thread manager...")
             self.thread_manager.shutdown(timeout=timeout)
         
+        if getattr(self, 'tenant_state', None):
+            self.tenant_state.close()
+        
+        if getattr(self, 'self_learning', None):
+            self.self_learning.close()
+        
+        if getattr(self, 'advanced', None):
+            self.advanced.close()
+        
     def __repr__(self):
         agi_status = " [AGI]" if self.enable_agi else ""
         autonomous_status = " [AUTONOMOUS]" if self.enable_autonomy else ""
@@ -11,6 +11,13 @@ from datetime import datetime, timezone
 import os
 import uuid
 
+try:
+    from companion_baas.optimization.tracing import traced, SPAN_KIND_CLIENT
+except ImportError:
+    from optimization.tracing import traced, SPAN_KIND_CLIENT
+
+_DB_SPAN_ATTRIBUTES = {'db.system': 'sqlite'}
+
 class Database:
     def __init__(self, db_path: str = "companion.db"):
         # Use test database if running tests
@@ -69,6 +76,7 @@ class Database:
             
             conn.commit()
 
+    @traced("db.create_conversation", _DB_SPAN_ATTRIBUTES, kind=SPAN_KIND_CLIENT)
     def create_conversation(self, conversation_id: str, title: str = "New Chat") -> Dict:
         """Create a new conversation"""
         now = datetime.now(timezone.utc).isoformat()
@@ -149,6 +157,7 @@ class Database:
             
             return conversations
 
+    @traced("db.add_message", _DB_SPAN_ATTRIBUTES, kind=SPAN_KIND_CLIENT)
     def add_message(self, conversation_id: str, message: Dict):
         """Add a message to a conversation"""
         with sqlite3.connect(self.db_path) as conn:
@@ -193,6 +202,7 @@ class Database:
                 "processing_time": message.get("processing_time")
             }
 
+    @traced("db.delete_conversation", _DB_SPAN_ATTRIBUTES, kind=SPAN_KIND_CLIENT)
     def delete_conversation(self, conversation_id: str):
         """Delete a conversation and its messages"""
         with sqlite3.connect(self.db_path) as conn:
@@ -215,6 +225,7 @@ class Database:
                 return json.loads(row[0])
             return None
 
+    @traced("db.update_conversation_metadata", _DB_SPAN_ATTRIBUTES, kind=SPAN_KIND_CLIENT)
     def update_conversation_metadata(self, conversation_id: str, metadata: Dict):
         """Update conversation metadata"""
         with sqlite3.connect(self.db_path) as conn:
@@ -225,6 +236,7 @@ class Database:
             )
             conn.commit()
 
+    @traced("db.update_message_content", _DB_SPAN_ATTRIBUTES, kind=SPAN_KIND_CLIENT)
     def update_message_content(self, conversation_id: str, message_id: str, content: str):
         """Update message content (for streaming)"""
         with sqlite3.connect(self.db_path) as conn:
@@ -0,0 +1,608 @@
+"""
+Offline Evaluation Harness
+==========================
+
+Replays a recorded request corpus against candidate models or routes
+before a change ships.
+
+- Corpus streamed from JSONL (or any iterable of RecordedRequest); each
+  request is sent to every candidate, with bounded concurrency
+- Quality (scorer + token F1), latency and cost computed in the workers
+- Paired comparison against a baseline with a sequential test (mixture
+  SPRT): the p-values stay valid while results stream in, so a run can
+  stop as soon as every quality comparison is decided
+- StubProvider: deterministic local provider (seeded accuracy, virtual
+  latency) for reproducible CI runs
+- RoutedCandidate: a ModelRouter policy; models are picked on the harness
+  thread in corpus order and outcomes fed back a fixed number of requests
+  later, so a seeded router replays identically at any concurrency
+"""
+
+import json
+import math
+import time
+import hashlib
+import logging
+import threading
+from collections import deque
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+from dataclasses import dataclass, field
+from itertools import islice
+from typing import Any, Callable, Dict, Iterable, Iterator, List, Optional, Sequence, Tuple
+
+logger = logging.getLogger(__name__)
+
+
+# ----------------------------------------------------------------------
+# Scoring
+# ----------------------------------------------------------------------
+def exact_or_contains(prediction: str, reference: str) -> float:
+    """1.0 for an exact match, 0.5 if the reference appears in the prediction"""
+    prediction, reference = prediction.strip(), reference.strip()
+    if prediction == reference:
+        return 1.0
+    if reference and reference.lower() in prediction.lower():
+        return 0.5
+    return 0.0
+
+
+def token_f1(prediction: str, reference: str) -> float:
+    """Bag-of-words F1 between prediction and reference"""
+    predicted, expected = prediction.lower().split(), reference.lower().split()
+    if not predicted or not expected:
+        return float(predicted == expected)
+    remaining: Dict[str, int] = {}
+    for token in expected:
+        remaining[token] = remaining.get(token, 0) + 1
+    overlap = 0
+    for token in predicted:
+        if remaining.get(token, 0) > 0:
+            remaining[token] -= 1
+            overlap += 1
+    if not overlap:
+        return 0.0
+    precision, recall = overlap / len(predicted), overlap / len(expected)
+    return 2 * precision * recall / (precision + recall)
+
+
+# ----------------------------------------------------------------------
+# Statistics
+# ----------------------------------------------------------------------
+class RunningStats:
+    """Streaming mean / variance (Welford)"""
+
+    __slots__ = ('n', 'mean', '_m2')
+
+    def __init__(self):
+        self.n = 0
+        self.mean = 0.0
+        self._m2 = 0.0
+
+    def add(self, value: float):
+        self.n += 1
+        delta = value - self.mean
+        self.mean += delta / self.n
+        self._m2 += delta * (value - self.mean)
+
+    @property
+    def variance(self) -> float:
+        """Sample variance"""
+        return self._m2 / (self.n - 1) if self.n > 1 else 0.0
+
+    @property
+    def stderr(self) -> float:
+        return math.sqrt(self.variance / self.n) if self.n else 0.0
+
+    def confidence_interval(self, z: float = 1.96) -> List[float]:
+        """Normal-approximation interval for the mean (95% by default)"""
+        half = z * self.stderr
+        return [self.mean - half, self.mean + half]
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {'n': self.n, 'mean': self.mean, 'ci95': self.confidence_interval()}
+
+
+def msprt_p_value(difference: float, variance: float, tau2: float) -> float:
+    """
+    Mixture-SPRT p-value for H0: true difference == 0
+
+    Args:
+        difference: Estimated difference
+        variance: Variance of that estimate (e.g. sigma^2 / n)
+        tau2: Variance of the normal mixing distribution over effect sizes
+
+    Valid at every sample size when the running minimum is reported.
+    """
+    if variance <= 0 or tau2 <= 0:
+        return 1.0
+    log_ratio = 0.5 * math.log(variance / (variance + tau2)) + \
+        tau2 * difference * difference / (2 * variance * (variance + tau2))
+    return 1.0 if log_ratio <= 0 else max(0.0, math.exp(-log_ratio))
+
+
+class SequentialTest:
+    """
+    Always-valid paired test on streamed differences (candidate - baseline)
+
+    The mixing variance defaults to the per-observation variance (unit
+    information prior), which keeps the test scale-free across metrics.
+    """
+
+    def __init__(self, higher_is_better: bool = True, alpha: float = 0.05,
+                 min_samples: int = 20, tau2: Optional[float] = None):
+        self.higher_is_better = higher_is_better
+        self.alpha = alpha
+        self.min_samples = min_samples
+        self.tau2 = tau2
+        self.stats = RunningStats()
+        self.p_value = 1.0
+        self.decided_at: Optional[int] = None
+
+    def add(self, difference: float):
+        stats = self.stats
+        stats.add(difference)
+        if stats.n < self.min_samples:
+            return
+        variance = stats.variance
+        if variance <= 0:
+            # Identical differences every time: decided unless they are all zero
+            p = 0.0 if stats.mean != 0 else 1.0
+        else:
+            p = msprt_p_value(stats.mean, variance / stats.n, self.tau2 or variance)
+        self.p_value = min(self.p_value, p)
+        if self.decided_at is None and self.p_value < self.alpha:
+            self.decided_at = stats.n
+
+    @property
+    def significant(self) -> bool:
+        return self.decided_at is not None
+
+    @property
+    def verdict(self) -> str:
+        if not self.significant:
+            return 'inconclusive'
+        improved = self.stats.mean > 0 if self.higher_is_better else self.stats.mean < 0
+        return 'better' if improved else 'worse'
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            'pairs': self.stats.n,
+            'mean_difference': self.stats.mean,
+            'ci95': self.stats.confidence_interval(),
+            'p_value': self.p_value,
+            'significant': self.significant,
+            'decided_at': self.decided_at,
+            'verdict': self.verdict
+        }
+
+
+def _percentile(sorted_values: Sequence[float], q: float) -> float:
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, max(0, int(math.ceil(q * len(sorted_values))) - 1))
+    return sorted_values[index]
+
+
+# ----------------------------------------------------------------------
+# Corpus and candidates
+# ----------------------------------------------------------------------
+@dataclass
+class RecordedRequest:
+    """One logged request to replay"""
+    request_id: str
+    prompt: str
+    reference: str = ""          # expected / accepted answer ("" = unscored)
+    context: str = "chat"        # routing context
+    metadata: Dict[str, Any] = field(default_factory=dict)
+
+
+def load_corpus(path: str) -> Iterator[RecordedRequest]:
+    """
+    Stream RecordedRequests from JSONL
+
+    Accepts the harness's own fields (prompt, reference, context) as well
+    as TrainingStore exports (input/output, alpaca instruction/output,
+    OpenAI messages).
+    """
+    with open(path, encoding='utf-8') as f:
+        for line_number, line in enumerate(f):
+            if not line.strip():
+                continue
+            record = json.loads(line)
+            if 'messages' in record:
+                by_role = {message['role']: message['content'] for message in record['messages']}
+                prompt, reference = by_role.get('user', ''), by_role.get('assistant', '')
+            else:
+                prompt = record.get('prompt', record.get('input', record.get('instruction', '')))
+                reference = record.get('reference', record.get('output', ''))
+            yield RecordedRequest(
+                request_id=str(record.get('request_id', record.get('id', line_number))),
+                prompt=prompt,
+                reference=reference,
+                context=record.get('context', 'chat'),
+                metadata=record.get('metadata') or {}
+            )
+
+
+@dataclass
+class CandidateResponse:
+    """A candidate's answer; optional fields are filled in by the harness"""
+    text: str
+    model: Optional[str] = None
+    latency_ms: Optional[float] = None   # None = measured wall time
+    prompt_tokens: Optional[int] = None  # None = estimated (~4 chars/token)
+    completion_tokens: Optional[int] = None
+    cost: Optional[float] = None         # None = tokens * cost_per_1k_tokens
+
+
+class Candidate:
+    """A model (or model + prompt / settings) under evaluation"""
+
+    def __init__(self, name: str, generate: Callable[[str], Any], cost_per_1k_tokens: float = 0.0):
+        """
+        Args:
+            name: Label in the report
+            generate: prompt -> str or CandidateResponse
+            cost_per_1k_tokens: Used when the response carries no cost
+        """
+        self.name = name
+        self.generate = generate
+        self.cost_per_1k_tokens = cost_per_1k_tokens
+
+    def prepare(self, request: RecordedRequest) -> Any:
+        """Per-request decision, made on the harness thread in corpus order (passed to call)"""
+        return None
+
+    def call(self, request: RecordedRequest, plan: Any = None) -> Any:
+        return self.generate(request.prompt)
+
+    def observe(self, outcome: '_Outcome'):
+        """Scored outcome, fed back in corpus order"""
+
+    def price(self, response: CandidateResponse) -> float:
+        return self.cost_per_1k_tokens
+
+
+class RoutedCandidate(Candidate):
+    """
+    A routing policy under evaluation: a ModelRouter picks the model per
+    request context, generate(model, prompt) calls it, and each outcome is
+    recorded back into the router
+
+    Selection and feedback happen in corpus order on the harness thread;
+    give the router a seed and a fixed clock for a reproducible report.
+    """
+
+    def __init__(self, name: str, router, generate: Callable[[str, str], Any]):
+        super().__init__(name, generate)
+        self.router = router
+
+    def prepare(self, request: RecordedRequest) -> Optional[str]:
+        return self.router.select(request.context, estimated_tokens=len(request.prompt) // 4)
+
+    def call(self, request: RecordedRequest, plan: Optional[str] = None) -> Any:
+        if plan is None:
+            raise RuntimeError(f"no model available for context {request.context!r}")
+        response = self.generate(plan, request.prompt)
+        if not isinstance(response, CandidateResponse):
+            response = CandidateResponse(text=str(response))
+        response.model = response.model or plan
+        return response
+
+    def observe(self, outcome: '_Outcome'):
+        if outcome.plan is not None:
+            self.router.record(outcome.plan, outcome.latency_ms / 1000.0, outcome.error is None)
+
+    def price(self, response: CandidateResponse) -> float:
+        arm = self.router.arms.get(response.model) if response.model else None
+        return arm.cost_per_1k_tokens if arm else 0.0
+
+
+class StubProvider:
+    """
+    Deterministic local provider for CI
+
+    Answers a prompt correctly (its reference from `answers`) with
+    probability `accuracy`, decided by a seeded hash of the prompt, so
+    every run gives the same outputs; latency is virtual (reported, not
+    slept) unless sleep=True.
+    """
+
+    def __init__(self, answers: Optional[Dict[str, str]] = None, accuracy: float = 0.8,
+                 latency_ms: float = 50.0, jitter_ms: float = 10.0, seed: int = 0,
+                 sleep: bool = False, model: str = "stub"):
+        self.answers = answers or {}
+        self.accuracy = accuracy
+        self.latency_ms = latency_ms
+        self.jitter_ms = jitter_ms
+        self.seed = seed
+        self.sleep = sleep
+        self.model = model
+        self.calls = 0
+        self._lock = threading.Lock()
+
+    @classmethod
+    def for_corpus(cls, corpus: Iterable[RecordedRequest], **kwargs) -> 'StubProvider':
+        """Stub that knows the reference answer of every request in corpus"""
+        return cls(answers={request.prompt: request.reference for request in corpus}, **kwargs)
+
+    def _uniform(self, prompt: str, salt: str) -> float:
+        digest = hashlib.blake2b(f"{self.seed}:{salt}:{prompt}".encode('utf-8'), digest_size=8).digest()
+        return int.from_bytes(digest, 'big') / 2 ** 64
+
+    def __call__(self, prompt: str, *_) -> CandidateResponse:
+        with self._lock:
+            self.calls += 1
+        latency = self.latency_ms + self.jitter_ms * (2 * self._uniform(prompt, 'latency') - 1)
+        if self.sleep:
+            time.sleep(latency / 1000.0)
+        reference = self.answers.get(prompt)
+        if reference is not None and self._uniform(prompt, 'quality') < self.accuracy:
+            text = reference
+        else:
+            text = f"I'm not sure about: {prompt[:40]}"
+        return CandidateResponse(text=text, model=self.model, latency_ms=latency)
+
+
+# ----------------------------------------------------------------------
+# Harness
+# ----------------------------------------------------------------------
+@dataclass
+class _Outcome:
+    request_id: str
+    candidate: str
+    score: float
+    f1: float
+    latency_ms: float
+    cost: float
+    error: Optional[str] = None
+    plan: Any = None
+
+
+class _CandidateTotals:
+    def __init__(self):
+        self.quality = RunningStats()
+        self.f1 = RunningStats()
+        self.cost = RunningStats()
+        self.latencies: List[float] = []
+        self.errors = 0
+
+    def to_dict(self) -> Dict[str, Any]:
+        latencies = sorted(self.latencies)
+        requests = self.quality.n
+        return {
+            'requests': requests,
+            'errors': self.errors,
+            'error_rate': self.errors / requests if requests else 0.0,
+            'quality': self.quality.to_dict(),
+            'token_f1': self.f1.mean,
+            'latency_ms': {
+                'mean': sum(latencies) / len(latencies) if latencies else 0.0,
+                'p50': _percentile(latencies, 0.50),
+                'p90': _percentile(latencies, 0.90),
+                'p99': _percentile(latencies, 0.99)
+            },
+            'cost': {'total': self.cost.mean * self.cost.n, 'per_request': self.cost.mean}
+        }
+
+
+class OfflineEvalHarness:
+    """
+    Replays a corpus against candidates and compares them to a baseline
+
+    Features:
+    - Bounded concurrency (about 2 x concurrency calls in flight; the
+      corpus is consumed lazily)
+    - Per-candidate quality with CI, token F1, latency percentiles, cost
+    - Paired sequential tests per metric vs. the baseline, optional early stop
+    """
+
+    def __init__(
+        self,
+        candidates: Sequence[Candidate],
+        baseline: Optional[str] = None,
+        concurrency: int = 8,
+        scorer: Callable[[str, str], float] = exact_or_contains,
+        alpha: float = 0.05,
+        min_samples: int = 20,
+        early_stop: bool = False
+    ):
+        """
+        Initialize harness
+
+        Args:
+            candidates: Candidates to replay against (names must be unique)
+            baseline: Name of the reference candidate (default: the first)
+            concurrency: Worker threads
+            scorer: (prediction, reference) -> quality in [0, 1]
+            alpha: Significance level of the sequential tests
+            min_samples: Pairs before a test may decide
+            early_stop: Stop once every quality comparison is significant
+        """
+        if not candidates:
+            raise ValueError("at least one candidate is required")
+        self.candidates = list(candidates)
+        self.baseline = baseline or self.candidates[0].name
+        if self.baseline not in {candidate.name for candidate in self.candidates}:
+            raise ValueError(f"unknown baseline {self.baseline!r}")
+        self.concurrency = max(1, concurrency)
+        self.scorer = scorer
+        self.alpha = alpha
+        self.min_samples = min_samples
+        self.early_stop = early_stop
+
+    def _evaluate(self, index: int, candidate: Candidate, request: RecordedRequest,
+                  plan: Any) -> Tuple[int, _Outcome]:
+        """Call one candidate and score the answer (runs in a worker)"""
+        start = time.perf_counter()
+        try:
+            response = candidate.call(request, plan)
+            elapsed_ms = (time.perf_counter() - start) * 1000
+            if not isinstance(response, CandidateResponse):
+                response = CandidateResponse(text=str(response))
+        except Exception as e:
+            return index, _Outcome(request.request_id, candidate.name, 0.0, 0.0,
+                                   (time.perf_counter() - start) * 1000, 0.0, error=str(e), plan=plan)
+
+        text = response.text
+        latency = response.latency_ms if response.latency_ms is not None else elapsed_ms
+        cost = response.cost
+        if cost is None:
+            prompt_tokens = response.prompt_tokens if response.prompt_tokens is not None else len(request.prompt) // 4
+            completion_tokens = response.completion_tokens if response.completion_tokens is not None else len(text) // 4
+            cost = (prompt_tokens + completion_tokens) * candidate.price(response) / 1000.0
+        score = self.scorer(text, request.reference) if request.reference else 0.0
+        f1 = token_f1(text, request.reference) if request.reference else 0.0
+        return index, _Outcome(request.request_id, candidate.name, score, f1, latency, cost, plan=plan)
+
+    def run(self, corpus: Iterable[RecordedRequest], limit: Optional[int] = None) -> Dict[str, Any]:
+        """
+        Replay the corpus
+
+        Calls run concurrently, but results are aggregated in corpus order,
+        so a deterministic provider gives an identical report on every run.
+        Candidates prepare request i after observing exactly the outcomes
+        of requests before i - 2 x concurrency.
+
+        Args:
+            corpus: RecordedRequests (e.g. load_corpus(path))
+            limit: Replay at most this many requests
+
+        Returns:
+            Report with per-candidate metrics and baseline comparisons
+        """
+        totals = {candidate.name: _CandidateTotals() for candidate in self.candidates}
+        tests = {
+            candidate.name: {
+                'quality': SequentialTest(True, self.alpha, self.min_samples),
+                'latency_ms': SequentialTest(False, self.alpha, self.min_samples),
+                'cost': SequentialTest(False, self.alpha, self.min_samples)
+            }
+            for candidate in self.candidates if candidate.name != self.baseline
+        }
+        pending: Dict[int, Dict[str, _Outcome]] = {}
+        observed: deque = deque()  # (index, paired) aggregated, not yet observed
+        feedback_lag = 2 * self.concurrency
+        next_index = 0
+        stopped_early = False
+        start = time.perf_counter()
+
+        def aggregate(paired: Dict[str, _Outcome]) -> bool:
+            """Fold one fully answered request in; True when the run may stop"""
+            for name, outcome in paired.items():
+                candidate_totals = totals[name]
+                candidate_totals.quality.add(outcome.score)
+                candidate_totals.f1.add(outcome.f1)
+                candidate_totals.cost.add(outcome.cost)
+                if outcome.error is None:
+                    candidate_totals.latencies.append(outcome.latency_ms)
+                else:
+                    candidate_totals.errors += 1
+
+            base = paired[self.baseline]
+            for name, metric_tests in tests.items():
+                other = paired[name]
+                metric_tests['quality'].add(other.score - base.score)
+                metric_tests['cost'].add(other.cost - base.cost)
+                if other.error is None and base.error is None:
+                    metric_tests['latency_ms'].add(other.latency_ms - base.latency_ms)
+            return self.early_stop and bool(tests) and all(
+                metric_tests['quality'].significant for metric_tests in tests.values()
+            )
+
+        def collect(done) -> bool:
+            """Buffer finished calls, aggregate complete requests in order"""
+            nonlocal next_index
+            for future in done:
+                index, outcome = future.result()
+                pending.setdefault(index, {})[outcome.candidate] = outcome
+            while len(pending.get(next_index, ())) == len(self.candidates):
+                paired = pending.pop(next_index)
+                observed.append((next_index, paired))
+                next_index += 1
+                if aggregate(paired):
+                    return True
+            return False
+
+        def observe(before: float):
+            """Feed outcomes of requests < before back to the candidates, in order"""
+            while observed and observed[0][0] < before:
+                _, paired = observed.popleft()
+                for candidate in self.candidates:
+                    candidate.observe(paired[candidate.name])
+
+        with ThreadPoolExecutor(max_workers=self.concurrency, thread_name_prefix="offline_eval") as pool:
+            in_flight = set()
+            requests = corpus if limit is None else islice(corpus, limit)
+            for index, request in enumerate(requests):
+                while next_index < index - feedback_lag and in_flight and not stopped_early:
+                    done, in_flight = wait(in_flight, return_when=FIRST_COMPLETED)
+                    stopped_early = collect(done)
+                if stopped_early:
+                    break
+                observe(index - feedback_lag)
+                for candidate in self.candidates:
+                    plan = candidate.prepare(request)
+                    in_flight.add(pool.submit(self._evaluate, index, candidate, request, plan))
+                while len(in_flight) >= 2 * self.concurrency and not stopped_early:
+                    done, in_flight = wait(in_flight, return_when=FIRST_COMPLETED)
+                    stopped_early = collect(done)
+                if stopped_early:
+                    break
+            if stopped_early:
+                for future in in_flight:
+                    future.cancel()
+            else:
+                stopped_early = collect(wait(in_flight).done)
+        observe(math.inf)
+
+        duration = time.perf_counter() - start
+        report = {
+            'requests': next_index,
+            'baseline': self.baseline,
+            'concurrency': self.concurrency,
+            'duration_seconds': duration,
+            'stopped_early': stopped_early,
+            'candidates': {name: candidate_totals.to_dict() for name, candidate_totals in totals.items()},
+            'comparisons': {
+                name: {metric: test.to_dict() for metric, test in metric_tests.items()}
+                for name, metric_tests in tests.items()
+            }
+        }
+        logger.info(f"🧪 Offline eval: {next_index} requests x {len(self.candidates)} candidates "
+                     f"in {duration:.2f}s")
+        return report
+
+
+# Example usage
+if __name__ == "__main__":
+    print("=" * 70)
+    print("OFFLINE EVAL HARNESS - Replay, Compare, Sequential Significance")
+    print("=" * 70)
+
+    corpus = [
+        RecordedRequest(str(i), f"What is {i} + {i}?", str(2 * i), context="math")
+        for i in range(2000)
+    ]
+    current = StubProvider.for_corpus(corpus, accuracy=0.70, latency_ms=120, seed=1, model="current")
+    proposed = StubProvider.for_corpus(corpus, accuracy=0.80, latency_ms=90, seed=2, model="proposed")
+
+    harness = OfflineEvalHarness(
+        [Candidate("current", current, cost_per_1k_tokens=0.5),
+         Candidate("proposed", proposed, cost_per_1k_tokens=0.8)],
+        concurrency=16, early_stop=True
+    )
+    report = harness.run(corpus)
+
+    print(f"\nReplayed {report['requests']} requests in {report['duration_seconds']:.2f}s "
+          f"(stopped early: {report['stopped_early']})")
+    for name, metrics in report['candidates'].items():
+        quality = metrics['quality']
+        print(f"  {name:9s} quality {quality['mean']:.3f} "
+              f"[{quality['ci95'][0]:.3f}, {quality['ci95'][1]:.3f}]  "
+              f"p50 {metrics['latency_ms']['p50']:.0f} ms  cost/request ${metrics['cost']['per_request']:.5f}")
+    for metric, result in report['comparisons']['proposed'].items():
+        print(f"  proposed vs current {metric:10s}: {result['verdict']:12s} "
+              f"p={result['p_value']:.4f} (decided after {result['decided_at']} pairs)")
+
+    print("\n" + "=" * 70)
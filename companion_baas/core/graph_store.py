@@ -0,0 +1,356 @@
+"""
+Graph Store
+===========
+
+In-memory directed multigraph shared by the knowledge graphs
+(SemanticMemory, the hybrid engine's KnowledgeGraph).
+
+- Hash index from node key to a dense integer id (optionally normalized,
+  e.g. case-insensitive names)
+- Per-node adjacency lists grouped by relation type, in both directions
+- freeze() packs adjacency into CSR arrays (compact, cache-friendly
+  traversal); the next mutation thaws it back into lists
+- Bounded BFS / k-hop and shortest-path queries
+- Bulk loading and JSON persistence
+"""
+
+import os
+import json
+import logging
+import threading
+from array import array
+from collections import deque
+from typing import Any, Callable, Dict, Iterable, Iterator, List, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+DIRECTIONS = ('out', 'in', 'both')
+
+
+class GraphStore:
+    """
+    Hash-indexed adjacency-list graph with optional CSR freezing
+
+    Features:
+    - O(1) node lookup by key, O(degree) neighbor queries
+    - Typed edges (relation name) with outgoing and incoming adjacency
+    - k-hop / path queries bounded by depth and result count
+    - bulk_load(), save() / load()
+    """
+
+    def __init__(self, normalize: Optional[Callable[[str], str]] = None):
+        """
+        Initialize store
+
+        Args:
+            normalize: Maps a key to its index form (e.g. str.lower); the
+                first spelling seen is kept as the node's display key
+        """
+        self._normalize = normalize or (lambda key: key)
+        self._index: Dict[str, int] = {}
+        self._keys: List[str] = []
+        self._data: List[Any] = []
+
+        self._relation_codes: Dict[str, int] = {}
+        self._relation_names: List[str] = []
+
+        # node id -> {relation code -> [neighbor ids]}; None while frozen
+        self._out: Optional[List[Dict[int, List[int]]]] = []
+        self._in: Optional[List[Dict[int, List[int]]]] = []
+        # direction -> (indptr, neighbor ids, relation codes); None while mutable
+        self._csr: Optional[Dict[str, Tuple[array, array, array]]] = None
+
+        self.edge_count = 0
+        self._lock = threading.RLock()
+
+    def __len__(self) -> int:
+        return len(self._keys)
+
+    def __contains__(self, key: str) -> bool:
+        return self._normalize(key) in self._index
+
+    @property
+    def frozen(self) -> bool:
+        return self._csr is not None
+
+    # ------------------------------------------------------------------
+    # Mutation
+    # ------------------------------------------------------------------
+    def add_node(self, key: str, data: Any = None, replace: bool = False) -> int:
+        """
+        Add a node (no-op if the key exists, unless replace is set)
+
+        Returns:
+            Node id
+        """
+        with self._lock:
+            normalized = self._normalize(key)
+            node = self._index.get(normalized)
+            if node is not None:
+                if replace:
+                    self._data[node] = data
+                return node
+
+            if self._csr is not None:
+                self._thaw()
+            node = len(self._keys)
+            self._index[normalized] = node
+            self._keys.append(key)
+            self._data.append(data)
+            self._out.append({})
+            self._in.append({})
+            return node
+
+    def add_edge(self, source: str, relation: str, target: str) -> Tuple[int, int]:
+        """
+        Add a typed edge, creating missing endpoints (parallel edges allowed)
+
+        Returns:
+            (source id, target id)
+        """
+        with self._lock:
+            src = self.add_node(source)
+            dst = self.add_node(target)
+            if self._csr is not None:
+                self._thaw()
+            code = self._relation_code(relation)
+            self._out[src].setdefault(code, []).append(dst)
+            self._in[dst].setdefault(code, []).append(src)
+            self.edge_count += 1
+            return src, dst
+
+    def bulk_load(self, nodes: Iterable[Tuple[str, Any]] = (),
+                  edges: Iterable[Tuple[str, str, str]] = (), freeze: bool = True):
+        """
+        Load many nodes and edges at once
+
+        Args:
+            nodes: (key, data) pairs
+            edges: (source, relation, target) triples
+            freeze: Pack into CSR afterwards (for read-mostly graphs)
+        """
+        with self._lock:
+            for key, data in nodes:
+                self.add_node(key, data)
+            for source, relation, target in edges:
+                self.add_edge(source, relation, target)
+            if freeze:
+                self.freeze()
+
+    def _relation_code(self, relation: str) -> int:
+        code = self._relation_codes.get(relation)
+        if code is None:
+            code = self._relation_codes[relation] = len(self._relation_names)
+            self._relation_names.append(relation)
+        return code
+
+    # ------------------------------------------------------------------
+    # CSR
+    # ------------------------------------------------------------------
+    def freeze(self):
+        """Pack adjacency lists into CSR arrays (until the next mutation)"""
+        with self._lock:
+            if self._csr is not None:
+                return
+            self._csr = {'out': self._pack(self._out), 'in': self._pack(self._in)}
+            self._out = self._in = None
+
+    @staticmethod
+    def _pack(adjacency: List[Dict[int, List[int]]]) -> Tuple[array, array, array]:
+        indptr, neighbors, relations = array('q', [0]), array('q'), array('l')
+        for by_relation in adjacency:
+            for code, ids in by_relation.items():
+                neighbors.extend(ids)
+                relations.extend([code] * len(ids))
+            indptr.append(len(neighbors))
+        return indptr, neighbors, relations
+
+    def _thaw(self):
+        """Unpack CSR back into mutable adjacency lists"""
+        adjacency = {}
+        for direction, (indptr, neighbors, relations) in self._csr.items():
+            lists = []
+            for node in range(len(indptr) - 1):
+                by_relation: Dict[int, List[int]] = {}
+                for i in range(indptr[node], indptr[node + 1]):
+                    by_relation.setdefault(relations[i], []).append(neighbors[i])
+                lists.append(by_relation)
+            adjacency[direction] = lists
+        self._out, self._in = adjacency['out'], adjacency['in']
+        self._csr = None
+
+    # ------------------------------------------------------------------
+    # Queries
+    # ------------------------------------------------------------------
+    def node_id(self, key: str) -> Optional[int]:
+        """Id of a node, or None"""
+        return self._index.get(self._normalize(key))
+
+    def key(self, node: int) -> str:
+        """Display key of a node id"""
+        return self._keys[node]
+
+    def get(self, key: str, default: Any = None) -> Any:
+        """Data attached to a node"""
+        node = self.node_id(key)
+        return default if node is None else self._data[node]
+
+    def data(self, node: int) -> Any:
+        """Data attached to a node id"""
+        return self._data[node]
+
+    def _neighbor_ids(self, node: int, relation: Optional[str], direction: str) -> Iterator[int]:
+        code = None
+        if relation is not None:
+            code = self._relation_codes.get(relation)
+            if code is None:
+                return
+        for side in (('out', 'in') if direction == 'both' else (direction,)):
+            if self._csr is not None:
+                indptr, neighbors, relations = self._csr[side]
+                start, end = indptr[node], indptr[node + 1]
+                if code is None:
+                    yield from neighbors[start:end]
+                else:
+                    for i in range(start, end):
+                        if relations[i] == code:
+                            yield neighbors[i]
+            else:
+                by_relation = (self._out if side == 'out' else self._in)[node]
+                if code is None:
+                    for ids in by_relation.values():
+                        yield from ids
+                else:
+                    yield from by_relation.get(code, ())
+
+    def neighbors(self, key: str, relation: Optional[str] = None, direction: str = 'out') -> List[str]:
+        """
+        Adjacent node keys (duplicates kept for parallel edges)
+
+        Args:
+            key: Node key
+            relation: Only edges of this type (None = any)
+            direction: 'out', 'in' or 'both'
+        """
+        if direction not in DIRECTIONS:
+            raise ValueError(f"direction must be one of {DIRECTIONS}")
+        with self._lock:
+            node = self.node_id(key)
+            if node is None:
+                return []
+            return [self._keys[n] for n in self._neighbor_ids(node, relation, direction)]
+
+    def k_hop(self, key: str, max_depth: int = 2, relation: Optional[str] = None,
+              direction: str = 'both', limit: Optional[int] = None) -> List[int]:
+        """
+        Node ids within max_depth hops, nearest first (start excluded)
+
+        Args:
+            key: Start node key
+            max_depth: Maximum hops
+            relation: Only follow edges of this type
+            direction: 'out', 'in' or 'both'
+            limit: Stop after this many nodes
+        """
+        with self._lock:
+            start = self.node_id(key)
+            if start is None:
+                return []
+            visited = {start}
+            found: List[int] = []
+            frontier = [start]
+            for _ in range(max_depth):
+                next_frontier = []
+                for node in frontier:
+                    for neighbor in self._neighbor_ids(node, relation, direction):
+                        if neighbor in visited:
+                            continue
+                        visited.add(neighbor)
+                        found.append(neighbor)
+                        if limit is not None and len(found) >= limit:
+                            return found
+                        next_frontier.append(neighbor)
+                if not next_frontier:
+                    break
+                frontier = next_frontier
+            return found
+
+    def shortest_path(self, start: str, end: str, max_hops: int = 3,
+                      relation: Optional[str] = None, direction: str = 'out') -> Optional[List[str]]:
+        """Fewest-hop path from start to end as node keys, or None"""
+        with self._lock:
+            source, target = self.node_id(start), self.node_id(end)
+            if source is None or target is None:
+                return None
+            parents = {source: None}
+            queue = deque([(source, 0)])
+            while queue:
+                node, depth = queue.popleft()
+                if node == target:
+                    path = []
+                    while node is not None:
+                        path.append(self._keys[node])
+                        node = parents[node]
+                    return path[::-1]
+                if depth == max_hops:
+                    continue
+                for neighbor in self._neighbor_ids(node, relation, direction):
+                    if neighbor not in parents:
+                        parents[neighbor] = node
+                        queue.append((neighbor, depth + 1))
+            return None
+
+    def edges(self) -> Iterator[Tuple[str, str, str]]:
+        """All edges as (source, relation, target) key triples"""
+        with self._lock:
+            for node in range(len(self._keys)):
+                source = self._keys[node]
+                if self._csr is not None:
+                    indptr, neighbors, relations = self._csr['out']
+                    for i in range(indptr[node], indptr[node + 1]):
+                        yield source, self._relation_names[relations[i]], self._keys[neighbors[i]]
+                else:
+                    for code, ids in self._out[node].items():
+                        for neighbor in ids:
+                            yield source, self._relation_names[code], self._keys[neighbor]
+
+    # ------------------------------------------------------------------
+    # Persistence
+    # ------------------------------------------------------------------
+    def save(self, path: str):
+        """Write nodes and edges to a JSON file (node data must be JSON-serializable)"""
+        with self._lock:
+            payload = {
+                'nodes': [[key, data] for key, data in zip(self._keys, self._data)],
+                'edges': [list(edge) for edge in self.edges()]
+            }
+        tmp_path = f"{path}.tmp"
+        with open(tmp_path, 'w') as f:
+            json.dump(payload, f)
+        os.replace(tmp_path, path)
+
+    @classmethod
+    def load(cls, path: str, normalize: Optional[Callable[[str], str]] = None,
+             freeze: bool = True) -> 'GraphStore':
+        """Read a store written by save()"""
+        with open(path) as f:
+            payload = json.load(f)
+        store = cls(normalize=normalize)
+        store.bulk_load(
+            ((key, data) for key, data in payload.get('nodes', [])),
+            (tuple(edge) for edge in payload.get('edges', [])),
+            freeze=freeze
+        )
+        logger.info(f"📚 Graph loaded from {path}: {len(store)} nodes, {store.edge_count} edges")
+        return store
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Size and layout"""
+        nodes = len(self._keys)
+        return {
+            'nodes': nodes,
+            'edges': self.edge_count,
+            'relation_types': len(self._relation_names),
+            'avg_out_degree': self.edge_count / nodes if nodes else 0.0,
+            'frozen': self.frozen
+        }
@@ -13,14 +13,34 @@ This module enables the brain to:
 
 import os
 import json
+import time
 import asyncio
+import logging
+import threading
 import subprocess
-from typing import Optional, List, Dict, Any
-from dataclasses import dataclass
+from collections import OrderedDict, deque
+from typing import Optional, List, Dict, Any, Awaitable, Callable
+from dataclasses import dataclass, field
 from enum import Enum
 import httpx
 from pathlib import Path
 
+# Prompt prefix reuse accounting and hashed embeddings (stdlib only)
+try:
+    from companion_baas.optimization.prompt_cache import prompt_cache
+    from companion_baas.core.query_analyzer import hashed_embedding
+except ImportError:
+    from optimization.prompt_cache import prompt_cache
+    from core.query_analyzer import hashed_embedding
+
+logger = logging.getLogger(__name__)
+
+# Phrases that mark a local draft as unsure (escalate to cloud)
+UNCERTAINTY_MARKERS = (
+    "i'm not sure", "i am not sure", "i don't know", "i do not know",
+    "i cannot", "i can't", "as an ai", "not enough information", "unclear"
+)
+
 
 class ModelSource(Enum):
     """Source of model execution"""
@@ -41,6 +61,300 @@ class ModelInfo:
     last_used: Optional[float] = None
 
 
+@dataclass
+class _QueuedRequest:
+    """A local inference request waiting for a model slot"""
+    model: str
+    run: Callable[[], Awaitable[Any]]
+    future: asyncio.Future
+    enqueued_at: float = field(default_factory=time.monotonic)
+
+
+class _LoopState:
+    """Queues of one event loop (asyncio primitives can't cross loops)"""
+    
+    def __init__(self, loop: asyncio.AbstractEventLoop):
+        self.loop = loop
+        self.queues: Dict[str, deque] = {}
+        self.wakeup = asyncio.Event()
+        self.dispatcher: Optional[asyncio.Task] = None
+    
+    def queued(self) -> int:
+        return sum(len(q) for q in self.queues.values())
+
+
+class LocalInferenceScheduler:
+    """
+    Continuous-batching scheduler for one local inference server.
+    
+    Requests are queued per model. Each model gets up to `num_parallel`
+    concurrent requests (Ollama batches concurrent requests for a loaded
+    model into shared forward passes), and a slot is refilled as soon as
+    a request finishes. Models that already have requests running are
+    served first, so prompts for the same model are batched together
+    instead of swapping models on every call.
+    
+    Resident models are tracked against a memory budget; loading a cold
+    model evicts the least recently used idle model. When the queue is
+    full or the estimated wait exceeds `max_wait`, new requests are
+    rejected immediately (None) so callers can fall back to the cloud.
+    
+    Several threads may each drive their own event loop (asyncio.run per
+    request). Queues are kept per loop; model slots, residency, latency
+    and stats are shared across loops under a thread lock, and every loop
+    is woken when a slot frees up (it may be the one another loop waits for).
+    """
+    
+    def __init__(
+        self,
+        num_parallel: int = 4,
+        memory_budget_gb: float = 8.0,
+        max_queue: int = 64,
+        max_wait: float = 30.0,
+        model_size: Optional[Callable[[str], float]] = None,
+        unload: Optional[Callable[[str], Awaitable[Any]]] = None
+    ):
+        """
+        Args:
+            num_parallel: Concurrent requests per model (match OLLAMA_NUM_PARALLEL)
+            memory_budget_gb: Memory available for resident models
+            max_queue: Queued requests across all models before rejecting
+            max_wait: Seconds a request may wait (estimated on admission, enforced on dispatch)
+            model_size: Model name -> size in GB
+            unload: Coroutine that unloads a model from the server
+        """
+        self.num_parallel = num_parallel
+        self.memory_budget_gb = memory_budget_gb
+        self.max_queue = max_queue
+        self.max_wait = max_wait
+        self._model_size = model_size or (lambda model: 4.0)
+        self._unload = unload
+        
+        self._lock = threading.Lock()
+        self._states: Dict[asyncio.AbstractEventLoop, _LoopState] = {}
+        self._resident: "OrderedDict[str, float]" = OrderedDict()  # LRU: model -> GB
+        self._in_flight: Dict[str, int] = {}  # running requests per model, all loops
+        self._latency: Dict[str, float] = {}  # EWMA seconds per request
+        
+        self.stats = {
+            'submitted': 0,
+            'completed': 0,
+            'rejected': 0,
+            'expired': 0,
+            'cancelled': 0,
+            'evictions': 0,
+            'max_queue_depth': 0
+        }
+    
+    # ------------------------------------------------------------------
+    # Submission and admission control
+    # ------------------------------------------------------------------
+    def _state(self) -> _LoopState:
+        """Queue state of the running loop (created on first use)"""
+        loop = asyncio.get_running_loop()
+        with self._lock:
+            state = self._states.get(loop)
+            if state is None:
+                # Loops finished by asyncio.run are closed; their queues are empty
+                for closed in [l for l in self._states if l.is_closed()]:
+                    del self._states[closed]
+                state = self._states[loop] = _LoopState(loop)
+            return state
+    
+    def _all_states(self) -> List[_LoopState]:
+        with self._lock:
+            return list(self._states.values())
+    
+    def _count(self, stat: str, n: int = 1):
+        with self._lock:
+            self.stats[stat] += n
+    
+    def queued(self) -> int:
+        """Requests waiting across all models and loops"""
+        return sum(state.queued() for state in self._all_states())
+    
+    def estimated_wait(self, model: str) -> float:
+        """Expected queueing delay for a new request to a model"""
+        ahead = sum(len(state.queues.get(model, ())) for state in self._all_states())
+        ahead += self._in_flight.get(model, 0)
+        return ahead / self.num_parallel * self._latency.get(model, 0.0)
+    
+    async def submit(self, model: str, run: Callable[[], Awaitable[Any]]) -> Any:
+        """
+        Queue a request and wait for its result
+        
+        Args:
+            model: Model the request runs on
+            run: Coroutine factory performing the request
+            
+        Returns:
+            The request's result, or None if rejected or expired in the queue
+        """
+        state = self._state()
+        self._count('submitted')
+        if self.queued() >= self.max_queue or self.estimated_wait(model) > self.max_wait:
+            self._count('rejected')
+            return None
+        
+        request = _QueuedRequest(model, run, state.loop.create_future())
+        state.queues.setdefault(model, deque()).append(request)
+        depth = self.queued()
+        with self._lock:
+            self.stats['max_queue_depth'] = max(self.stats['max_queue_depth'], depth)
+        
+        if state.dispatcher is None or state.dispatcher.done():
+            state.dispatcher = state.loop.create_task(self._dispatch(state))
+        state.wakeup.set()
+        return await request.future
+    
+    # ------------------------------------------------------------------
+    # Dispatch
+    # ------------------------------------------------------------------
+    def _dispatch_order(self, state: _LoopState) -> List[str]:
+        """Models with waiting requests: running first, then resident, then oldest waiter"""
+        waiting = [model for model, queue in state.queues.items() if queue]
+        return sorted(waiting, key=lambda model: (
+            self._in_flight.get(model, 0) == 0,
+            model not in self._resident,
+            state.queues[model][0].enqueued_at
+        ))
+    
+    def _reserve_slot(self, model: str, state: _LoopState) -> bool:
+        """
+        Take one of a model's slots (shared by all loops), first making it fit
+        the memory budget by evicting idle LRU models
+        """
+        states = self._all_states()
+        with self._lock:
+            if self._in_flight.get(model, 0) >= self.num_parallel:
+                return False
+            if model in self._resident:
+                self._resident.move_to_end(model)
+            else:
+                size = self._model_size(model)
+                used = sum(self._resident.values())
+                while self._resident and used + size > self.memory_budget_gb:
+                    # Prefer idle models nobody is waiting for, then any idle model
+                    idle = [m for m in self._resident if not self._in_flight.get(m)]
+                    victims = [m for m in idle if not any(s.queues.get(m) for s in states)] or idle
+                    if not victims:
+                        return False  # everything resident is busy; wait for a slot
+                    victim = victims[0]
+                    used -= self._resident.pop(victim)
+                    self.stats['evictions'] += 1
+                    if self._unload:
+                        state.loop.create_task(self._unload(victim))
+                self._resident[model] = size
+            self._in_flight[model] = self._in_flight.get(model, 0) + 1
+            return True
+    
+    def _release_slot(self, model: str):
+        """Free a model slot and wake every loop (any of them may be waiting for it)"""
+        with self._lock:
+            self._in_flight[model] -= 1
+            states = list(self._states.values())
+        for state in states:
+            try:
+                state.loop.call_soon_threadsafe(state.wakeup.set)
+            except RuntimeError:
+                pass  # loop already closed
+    
+    def _expire(self, state: _LoopState, now: float) -> Optional[float]:
+        """
+        Drop cancelled and over-age requests from this loop's queues
+        
+        Returns:
+            When the oldest remaining request expires (None if nothing is queued)
+        """
+        next_expiry = None
+        for queue in state.queues.values():
+            while queue and (queue[0].future.cancelled() or queue[0].enqueued_at + self.max_wait < now):
+                request = queue.popleft()
+                if request.future.cancelled():
+                    self._count('cancelled')  # caller gave up (timeout, lost speculative race)
+                    continue
+                self._count('expired')
+                if not request.future.done():
+                    request.future.set_result(None)
+            if queue:
+                expiry = queue[0].enqueued_at + self.max_wait
+                next_expiry = expiry if next_expiry is None else min(next_expiry, expiry)
+        return next_expiry
+    
+    async def _dispatch(self, state: _LoopState):
+        """Keep every admitted model's slots full until this loop's queues drain"""
+        while state.queued():
+            state.wakeup.clear()
+            self._expire(state, time.monotonic())
+            for model in self._dispatch_order(state):
+                queue = state.queues[model]
+                while queue:
+                    if queue[0].future.cancelled():
+                        queue.popleft()  # caller gave up (timeout, lost speculative race)
+                        self._count('cancelled')
+                        continue
+                    if not self._reserve_slot(model, state):
+                        break
+                    state.loop.create_task(self._run(queue.popleft()))
+            # Requests left waiting still expire on time if no slot frees up
+            next_expiry = self._expire(state, time.monotonic())
+            if next_expiry is not None:
+                try:
+                    await asyncio.wait_for(state.wakeup.wait(), timeout=max(0.0, next_expiry - time.monotonic()))
+                except asyncio.TimeoutError:
+                    pass
+    
+    async def _run(self, request: _QueuedRequest):
+        """Execute one request and free its slot"""
+        start = time.monotonic()
+        ran = not request.future.cancelled()
+        try:
+            if ran:
+                work = asyncio.ensure_future(request.run())
+                # A caller that gives up mid-request frees the slot immediately
+                request.future.add_done_callback(lambda f: work.cancel() if f.cancelled() else None)
+                try:
+                    result = await work
+                except asyncio.CancelledError:
+                    if not work.cancelled() or not request.future.cancelled():
+                        raise
+                    result = None
+                if not request.future.done():
+                    request.future.set_result(result)
+        except Exception as e:
+            if not request.future.done():
+                request.future.set_exception(e)
+        finally:
+            elapsed = time.monotonic() - start
+            ran = ran and not request.future.cancelled()
+            with self._lock:
+                if ran:
+                    previous = self._latency.get(request.model)
+                    self._latency[request.model] = elapsed if previous is None else 0.8 * previous + 0.2 * elapsed
+                    self.stats['completed'] += 1
+                else:
+                    self.stats['cancelled'] += 1
+            self._release_slot(request.model)
+    
+    def get_stats(self) -> Dict[str, Any]:
+        """Queue depth, residency and admission counters"""
+        states = self._all_states()
+        with self._lock:
+            stats = dict(self.stats)
+            resident = dict(self._resident)
+            latency = dict(self._latency)
+            in_flight = sum(self._in_flight.values())
+        return {
+            **stats,
+            'queued': sum(state.queued() for state in states),
+            'in_flight': in_flight,
+            'event_loops': len(states),
+            'resident_models': list(resident),
+            'resident_gb': round(sum(resident.values()), 2),
+            'avg_latency': {model: round(latency, 3) for model, latency in latency.items()}
+        }
+
+
 class OllamaManager:
     """
     Manages Ollama installation and model lifecycle.
@@ -52,6 +366,16 @@ class OllamaManager:
         self.models_dir.mkdir(parents=True, exist_ok=True)
         
         self.base_url = "http://localhost:11434"
+        # Keep models (and their KV cache) loaded between calls so a repeated
+        # prompt prefix is not prefilled again
+        self.keep_alive = os.getenv('OLLAMA_KEEP_ALIVE', '30m')
+        # Per-model queues, slot refill and LRU residency for the local server
+        self.scheduler = LocalInferenceScheduler(
+            num_parallel=int(os.getenv('OLLAMA_NUM_PARALLEL', '4')),
+            memory_budget_gb=float(os.getenv('OLLAMA_MEMORY_BUDGET_GB', '8')),
+            model_size=self.model_size,
+            unload=self.unload_model
+        )
         self.available_models = {}
         self.downloaded_models = set()
         
@@ -210,8 +534,8 @@ class OllamaManager:
             print(f"❌ Error downloading {model_name}: {e}")
             return False
     
-    async def auto_select_models(self, task_type: str = 'general') -> List[str]:
-        """Auto-select best models for task type based on installed models"""
+    def _preferred_models(self, task_type: str) -> List[str]:
+        """Preferred local models for a task type, best first"""
         # Map task types to preferred models (prioritize installed models)
         task_model_map = {
             'coding': ['codeqwen:7b', 'codegemma:2b', 'codellama', 'deepseek-coder'],
@@ -221,12 +545,13 @@ class OllamaManager:
             'technical': ['codeqwen:7b', 'deepseek-r1:1.5b', 'deepseek-coder', 'codellama'],
             'fast': ['deepseek-r1:1.5b', 'codegemma:2b', 'llama3.2:3b']
         }
-        
-        preferred = task_model_map.get(task_type, ['llama3.2:3b', 'llama3.2'])
-        
+        return task_model_map.get(task_type, ['llama3.2:3b', 'llama3.2'])
+    
+    def installed_models(self, task_type: str = 'general') -> List[str]:
+        """Best already-downloaded models for a task type (never pulls; safe on the request path)"""
         # Check which are downloaded
         available = []
-        for model in preferred:
+        for model in self._preferred_models(task_type):
             # Try exact match first
             if model in self.downloaded_models:
                 available.append(model)
@@ -238,30 +563,79 @@ class OllamaManager:
         if not available and self.downloaded_models:
             available.append(list(self.downloaded_models)[0])
         
-        # If still none, download first preferred
-        if not available and preferred:
-            model_to_download = preferred[0]
+        return available
+    
+    async def auto_select_models(self, task_type: str = 'general') -> List[str]:
+        """Auto-select best models for task type, downloading the first preferred if none is installed"""
+        available = self.installed_models(task_type)
+        
+        # If still none, download first preferred (minutes: setup paths only, never per request)
+        if not available:
+            model_to_download = self._preferred_models(task_type)[0]
             if await self.download_model(model_to_download):
                 available.append(model_to_download)
         
         return available
     
+    def model_size(self, model: str) -> float:
+        """Approximate resident size of a model in GB (catalog, else 4GB)"""
+        info = self.model_catalog.get(model) or self.model_catalog.get(model.split(':')[0])
+        if info is None:
+            info = next((i for i in self.model_catalog.values() if i.name == model), None)
+        return info.size_gb if info else 4.0
+    
+    async def unload_model(self, model: str):
+        """Ask Ollama to unload a model (keep_alive=0 frees its memory)"""
+        try:
+            async with httpx.AsyncClient(timeout=10.0) as client:
+                await client.post(f"{self.base_url}/api/generate",
+                                  json={'model': model, 'keep_alive': 0})
+        except Exception as e:
+            logger.warning(f"⚠️ Could not unload {model}: {e}")
+    
     async def query_local(self, model: str, prompt: str, 
                          temperature: float = 0.7,
-                         max_tokens: int = 2000) -> Optional[Dict[str, Any]]:
-        """Query a local Ollama model"""
+                         max_tokens: int = 2000,
+                         system: Optional[str] = None) -> Optional[Dict[str, Any]]:
+        """
+        Query a local Ollama model through the scheduler
+        
+        Returns None when the request fails or is shed by admission
+        control (queue full / expected wait too long).
+        """
+        return await self.scheduler.submit(
+            model,
+            lambda: self._query_local_direct(model, prompt, temperature, max_tokens, system)
+        )
+    
+    async def _query_local_direct(self, model: str, prompt: str,
+                                  temperature: float = 0.7,
+                                  max_tokens: int = 2000,
+                                  system: Optional[str] = None) -> Optional[Dict[str, Any]]:
+        """
+        Send one generate request to Ollama
+        
+        The static system prefix goes in `system` (rendered ahead of the
+        prompt) and keep_alive holds the model loaded, so consecutive calls
+        sharing a prefix only prefill the new tokens.
+        """
+        payload = {
+            'model': model,
+            'prompt': prompt,
+            'keep_alive': self.keep_alive,
+            'options': {
+                'temperature': temperature,
+                'num_predict': max_tokens
+            }
+        }
+        if system:
+            payload['system'] = system
+        prompt_cache.track(f"ollama:{model}", (system or '') + prompt)
         try:
             async with httpx.AsyncClient(timeout=60.0) as client:
                 response = await client.post(
                     f"{self.base_url}/api/generate",
-                    json={
-                        'model': model,
-                        'prompt': prompt,
-                        'temperature': temperature,
-                        'options': {
-                            'num_predict': max_tokens
-                        }
-                    }
+                    json=payload
                 )
                 
                 if response.status_code == 200:
@@ -288,7 +662,10 @@ class OllamaManager:
         return {
             'downloaded_models': list(self.downloaded_models),
             'available_models': list(self.model_catalog.keys()),
-            'models_dir': str(self.models_dir)
+            'models_dir': str(self.models_dir),
+            'keep_alive': self.keep_alive,
+            'prompt_cache': prompt_cache.get_stats(),
+            'scheduler': self.scheduler.get_stats()
         }
 
 
@@ -296,24 +673,46 @@ class HybridInferenceEngine:
     """
     Orchestrates local and cloud models intelligently.
     Tries local first, falls back to cloud if needed.
+    
+    Speculative mode answers from a fast local model first, checks the
+    draft with self-consistency (two local samples at different
+    temperatures, batched on the same model) and escalates to the cloud
+    only when the samples disagree or the draft looks unsure.
     """
     
-    def __init__(self, ollama_manager: OllamaManager, cloud_client: Any = None):
+    def __init__(self, ollama_manager: OllamaManager, cloud_client: Any = None,
+                 consistency_threshold: float = 0.5, local_timeout: float = 10.0):
+        """
+        Args:
+            ollama_manager: Local model manager
+            cloud_client: Object with async query(prompt, task_type)
+            consistency_threshold: Min similarity between local samples to accept a draft
+            local_timeout: Seconds to wait for the local draft before escalating
+        """
         self.ollama = ollama_manager
         self.cloud_client = cloud_client
+        self.consistency_threshold = consistency_threshold
+        self.local_timeout = local_timeout
         
         self.stats = {
             'local_calls': 0,
             'cloud_calls': 0,
             'fallback_count': 0,
             'total_latency_local': 0.0,
-            'total_latency_cloud': 0.0
+            'total_latency_cloud': 0.0,
+            'speculative_requests': 0,
+            'speculative_accepted': 0,
+            'escalations': 0,
+            'saved_latency': 0.0
         }
     
     async def infer(self, prompt: str, 
                    task_type: str = 'general',
                    prefer_local: bool = False,  # Changed default to False - prioritize cloud
-                   timeout: float = 30.0) -> Dict[str, Any]:
+                   timeout: float = 30.0,
+                   system: Optional[str] = None,
+                   speculative: bool = False,
+                   on_draft: Optional[Callable[[str], Any]] = None) -> Dict[str, Any]:
         """
         Intelligent inference with hybrid approach.
         
@@ -321,18 +720,23 @@ class HybridInferenceEngine:
         1. Try cloud first (default - faster responses)
         2. Fallback to local if cloud fails/unavailable
         3. Can force local with prefer_local=True
+        4. speculative=True: local draft first, cloud only if the draft fails its check
+        
+        `system` is the static prompt prefix; local models receive it as
+        Ollama's system prompt, cloud clients get it prepended.
         """
-        import time
+        if speculative:
+            return await self._infer_speculative(prompt, task_type, system, on_draft)
         
         result = None
         
-        # Try local first (only if explicitly requested)
+        # Try local first (only if explicitly requested and a model is installed)
         if prefer_local:
-            local_models = await self.ollama.auto_select_models(task_type)
+            local_models = self.ollama.installed_models(task_type)
             
             if local_models:
                 start = time.time()
-                result = await self.ollama.query_local(local_models[0], prompt)
+                result = await self.ollama.query_local(local_models[0], prompt, system=system)
                 latency = time.time() - start
                 
                 if result:
@@ -344,35 +748,148 @@ class HybridInferenceEngine:
         
         # Fallback to cloud
         if self.cloud_client:
-            try:
-                start = time.time()
-                
-                # Use existing cloud infrastructure
-                cloud_response = await self.cloud_client.query(prompt, task_type)
-                
-                latency = time.time() - start
-                self.stats['cloud_calls'] += 1
-                self.stats['total_latency_cloud'] += latency
-                self.stats['fallback_count'] += 1
-                
-                return {
-                    'response': cloud_response,
-                    'model': 'cloud',
-                    'source': ModelSource.CLOUD_BYTEZ.value,
-                    'latency': latency
-                }
-            except Exception as e:
-                print(f"❌ Cloud fallback failed: {e}")
-                return {
-                    'response': "Error: Both local and cloud inference failed.",
-                    'error': str(e)
-                }
+            self.stats['fallback_count'] += 1
+            return await self._infer_cloud(prompt, task_type, system)
         
         return {
             'response': "Error: No inference engine available.",
             'error': 'No local or cloud models available'
         }
     
+    async def _infer_cloud(self, prompt: str, task_type: str,
+                           system: Optional[str] = None) -> Dict[str, Any]:
+        """Run the request on the cloud client"""
+        try:
+            start = time.time()
+            
+            # Use existing cloud infrastructure
+            cloud_prompt = f"{system}\n\n{prompt}" if system else prompt
+            cloud_response = await self.cloud_client.query(cloud_prompt, task_type)
+            
+            latency = time.time() - start
+            self.stats['cloud_calls'] += 1
+            self.stats['total_latency_cloud'] += latency
+            
+            return {
+                'response': cloud_response,
+                'model': 'cloud',
+                'source': ModelSource.CLOUD_BYTEZ.value,
+                'latency': latency
+            }
+        except Exception as e:
+            print(f"❌ Cloud fallback failed: {e}")
+            return {
+                'response': "Error: Both local and cloud inference failed.",
+                'error': str(e)
+            }
+    
+    def _draft_confidence(self, draft: Optional[Dict[str, Any]],
+                          check: Optional[Dict[str, Any]]) -> float:
+        """
+        Self-consistency score of a local draft (0.0-1.0)
+        
+        Similarity between two independent local samples; unsure or
+        near-empty drafts score 0.
+        """
+        if not draft or not draft.get('response'):
+            return 0.0
+        text = draft['response'].lower()
+        if len(text.split()) < 2 or any(marker in text for marker in UNCERTAINTY_MARKERS):
+            return 0.0
+        if not check or not check.get('response'):
+            return 0.0
+        a = hashed_embedding(text)
+        b = hashed_embedding(check['response'].lower())
+        if len(b) < len(a):
+            a, b = b, a
+        return sum(value * b.get(index, 0.0) for index, value in a.items())
+    
+    async def _local_samples(self, model: str, prompt: str, system: Optional[str],
+                             on_draft: Optional[Callable[[str], Any]]):
+        """
+        Draft (low temperature) and check (high temperature) samples
+        
+        Both are submitted together so the scheduler batches them. on_draft
+        fires as soon as the draft arrives; whatever is still running at
+        local_timeout is cancelled so it stops holding a model slot. A round
+        that produced a draft counts as one local call, with its wall time.
+        """
+        loop = asyncio.get_running_loop()
+        start = time.time()
+        deadline = loop.time() + self.local_timeout
+        draft_task = loop.create_task(self.ollama.query_local(model, prompt, temperature=0.2, system=system))
+        check_task = loop.create_task(self.ollama.query_local(model, prompt, temperature=0.9, system=system))
+        samples = []
+        try:
+            for task in (draft_task, check_task):
+                done, _ = await asyncio.wait({task}, timeout=max(0.0, deadline - loop.time()))
+                if not done or task.exception() is not None or not task.result():
+                    samples.append(None)
+                    break  # no draft (or no time left): nothing to check
+                samples.append(task.result())
+                if task is draft_task and on_draft and samples[0].get('response'):
+                    try:
+                        on_draft(samples[0]['response'])
+                    except Exception as e:
+                        logger.warning(f"⚠️ Draft callback failed: {e}")
+        finally:
+            for task in (draft_task, check_task):
+                if not task.done():
+                    task.cancel()
+            if samples and samples[0]:
+                self.stats['local_calls'] += 1
+                self.stats['total_latency_local'] += time.time() - start
+        return samples[0] if samples else None, samples[1] if len(samples) > 1 else None
+    
+    async def _infer_speculative(self, prompt: str, task_type: str,
+                                 system: Optional[str] = None,
+                                 on_draft: Optional[Callable[[str], Any]] = None) -> Dict[str, Any]:
+        """Local draft + self-consistency check, escalating to cloud on failure"""
+        # Speculate only on a model that is already installed; pulling one takes minutes
+        local_models = self.ollama.installed_models(task_type)
+        if not local_models and self.cloud_client:
+            return await self._infer_cloud(prompt, task_type, system)
+        
+        self.stats['speculative_requests'] += 1
+        start = time.time()
+        draft = check = None
+        if local_models:
+            draft, check = await self._local_samples(local_models[0], prompt, system, on_draft)
+        local_latency = time.time() - start
+        
+        confidence = self._draft_confidence(draft, check)
+        if draft and confidence >= self.consistency_threshold:
+            self.stats['speculative_accepted'] += 1
+            # Saved latency: what the cloud path costs on average, minus what we spent
+            cloud_calls = self.stats['cloud_calls']
+            if cloud_calls:
+                avg_cloud = self.stats['total_latency_cloud'] / cloud_calls
+                self.stats['saved_latency'] += max(0.0, avg_cloud - local_latency)
+            return {
+                **draft,
+                'latency': local_latency,
+                'source': ModelSource.LOCAL_OLLAMA.value,
+                'speculative': True,
+                'escalated': False,
+                'confidence': confidence
+            }
+        
+        if not self.cloud_client:
+            # Nothing to escalate to: a low-confidence local answer beats none
+            if draft and draft.get('response'):
+                return {**draft, 'latency': local_latency, 'speculative': True,
+                        'escalated': False, 'confidence': confidence}
+            return {
+                'response': "Error: No inference engine available.",
+                'error': 'No local or cloud models available'
+            }
+        
+        self.stats['escalations'] += 1
+        result = await self._infer_cloud(prompt, task_type, system)
+        result['latency'] = time.time() - start
+        result.update({'speculative': True, 'escalated': True, 'confidence': confidence})
+        return result
+    
     async def multi_model_orchestration(self, prompt: str,
                                        models: Optional[List[str]] = None,
                                        strategy: str = 'parallel') -> List[Dict[str, Any]]:
@@ -427,7 +944,13 @@ class HybridInferenceEngine:
             'fallback_count': self.stats['fallback_count'],
             'local_percentage': (self.stats['local_calls'] / total_calls * 100) if total_calls > 0 else 0,
             'avg_latency_local': (self.stats['total_latency_local'] / self.stats['local_calls']) if self.stats['local_calls'] > 0 else 0,
-            'avg_latency_cloud': (self.stats['total_latency_cloud'] / self.stats['cloud_calls']) if self.stats['cloud_calls'] > 0 else 0
+            'avg_latency_cloud': (self.stats['total_latency_cloud'] / self.stats['cloud_calls']) if self.stats['cloud_calls'] > 0 else 0,
+            'speculative_requests': self.stats['speculative_requests'],
+            'speculative_accepted': self.stats['speculative_accepted'],
+            'escalations': self.stats['escalations'],
+            'escalation_rate': (self.stats['escalations'] / self.stats['speculative_requests']) if self.stats['speculative_requests'] > 0 else 0,
+            'saved_latency_total': round(self.stats['saved_latency'], 3),
+            'saved_latency_avg': (self.stats['saved_latency'] / self.stats['speculative_accepted']) if self.stats['speculative_accepted'] > 0 else 0
         }
 
 
@@ -478,9 +1001,19 @@ class LocalIntelligenceCore:
         print(f"✅ Local Intelligence Core initialized")
     
     async def think(self, prompt: str, task_type: str = 'general',
-                   prefer_local: bool = False) -> Dict[str, Any]:
-        """Main thinking interface - defaults to cloud for speed"""
-        return await self.hybrid_engine.infer(prompt, task_type, prefer_local)
+                   prefer_local: bool = False,
+                   system: Optional[str] = None,
+                   speculative: bool = False,
+                   on_draft: Optional[Callable[[str], Any]] = None) -> Dict[str, Any]:
+        """
+        Main thinking interface - defaults to cloud for speed
+        
+        speculative=True answers from a local draft when it passes the
+        self-consistency check and escalates to cloud otherwise; on_draft
+        receives the local draft as soon as it is ready.
+        """
+        return await self.hybrid_engine.infer(prompt, task_type, prefer_local, system=system,
+                                              speculative=speculative, on_draft=on_draft)
     
     async def download_model(self, model_name: str) -> bool:
         """Download a specific model"""
@@ -11,8 +11,15 @@ Extended context and memory management:
 - Hierarchical memory organization
 """
 
+import os
+import json
+import heapq
+import bisect
 import logging
 import time
+import threading
+from collections import OrderedDict
+from concurrent.futures import Future, ThreadPoolExecutor
 from typing import Dict, List, Optional, Any, Tuple
 from dataclasses import dataclass, field
 from enum import Enum
@@ -122,16 +129,40 @@ class TokenCounter:
 
 
 class ContextCompressor:
-    """Compress context to fit in window"""
+    """
+    Compress context to fit in window
+
+    Features:
+    - Hierarchical summaries: fixed spans of messages are summarized,
+      then span summaries are merged
+    - Summaries cached by content hash, so only new spans reach the LLM
+    - Extraction / chunking usable as zero-LLM fast paths
+    """
+    
+    SUMMARY_PREFIX = "Previous conversation summary: "
     
-    def __init__(self, llm_function):
+    def __init__(self, llm_function, span_size: int = 8, cache_size: int = 512):
+        """
+        Initialize compressor
+
+        Args:
+            llm_function: prompt -> text, used for summaries
+            span_size: Messages summarized per LLM call
+            cache_size: Cached span/merge summaries
+        """
         self.llm_function = llm_function
+        self.span_size = span_size
+        self.cache_size = cache_size
+        self._summaries: "OrderedDict[str, str]" = OrderedDict()
+        self._cache_lock = threading.Lock()
+        self.stats = {'llm_calls': 0, 'cache_hits': 0}
     
     def compress_messages(
         self,
         messages: List[Dict[str, Any]],
         target_tokens: int,
-        strategy: CompressionStrategy = CompressionStrategy.SUMMARIZATION
+        strategy: CompressionStrategy = CompressionStrategy.SUMMARIZATION,
+        allow_llm: bool = True
     ) -> List[Dict[str, Any]]:
         """
         Compress messages to fit target token count
@@ -140,6 +171,8 @@ class ContextCompressor:
             messages: List of messages
             target_tokens: Target token count
             strategy: Compression strategy
+            allow_llm: False forces a zero-LLM strategy (extraction, then
+                chunking to the target) e.g. under load
             
         Returns:
             Compressed messages
@@ -151,6 +184,8 @@ class ContextCompressor:
         
         logger.info(f"Compressing {current_tokens} tokens to {target_tokens}")
         
+        if strategy == CompressionStrategy.SUMMARIZATION and not allow_llm:
+            return self._compress_by_chunking(messages, target_tokens)
         if strategy == CompressionStrategy.SUMMARIZATION:
             return self._compress_by_summarization(messages, target_tokens)
         elif strategy == CompressionStrategy.EXTRACTION:
@@ -160,6 +195,76 @@ class ContextCompressor:
         else:
             return messages[:target_tokens // 100]  # Fallback: truncate
     
+    # ------------------------------------------------------------------
+    # Cached, hierarchical summaries
+    # ------------------------------------------------------------------
+    @classmethod
+    def summary_message(cls, summary: str) -> Dict[str, Any]:
+        """Window message carrying a running summary"""
+        return {"role": "system", "content": f"{cls.SUMMARY_PREFIX}{summary}", "summarized": True}
+    
+    @classmethod
+    def summary_text(cls, message: Dict[str, Any]) -> Optional[str]:
+        """Summary carried by a summary message, else None"""
+        if not message.get("summarized"):
+            return None
+        content = message.get("content", "")
+        return content[len(cls.SUMMARY_PREFIX):] if content.startswith(cls.SUMMARY_PREFIX) else content
+    
+    def _cached_summary(self, prompt: str) -> str:
+        """LLM answer to a summary prompt, reused while its content is unchanged"""
+        key = hashlib.sha1(prompt.encode('utf-8')).hexdigest()
+        with self._cache_lock:
+            summary = self._summaries.get(key)
+            if summary is not None:
+                self._summaries.move_to_end(key)
+                self.stats['cache_hits'] += 1
+                return summary
+        
+        summary = self.llm_function(prompt).strip()
+        with self._cache_lock:
+            self.stats['llm_calls'] += 1
+            self._summaries[key] = summary
+            while len(self._summaries) > self.cache_size:
+                self._summaries.popitem(last=False)
+        return summary
+    
+    def _summarize_span(self, messages: List[Dict[str, Any]]) -> str:
+        content = "\n\n".join([
+            f"{m.get('role', 'user')}: {m.get('content', '')}"
+            for m in messages
+        ])
+        prompt = f"""Summarize the following conversation concisely, preserving key information:
+
+{content}
+
+Summary:"""
+        return self._cached_summary(prompt)
+    
+    def _merge_summaries(self, summaries: List[str]) -> str:
+        if len(summaries) == 1:
+            return summaries[0]
+        content = "\n\n".join(summaries)
+        prompt = f"""Merge these consecutive conversation summaries into one concise summary, preserving key information:
+
+{content}
+
+Summary:"""
+        return self._cached_summary(prompt)
+    
+    def summarize(self, messages: List[Dict[str, Any]], previous: Optional[str] = None) -> str:
+        """
+        Summarize messages, extending an earlier summary if given
+
+        Messages are summarized in spans of span_size; spans already seen
+        (same content) come from the cache, so extending a conversation
+        only pays for its new spans plus one merge.
+        """
+        summaries = [previous] if previous else []
+        for start in range(0, len(messages), self.span_size):
+            summaries.append(self._summarize_span(messages[start:start + self.span_size]))
+        return self._merge_summaries(summaries) if summaries else ""
+    
     def _compress_by_summarization(
         self,
         messages: List[Dict[str, Any]],
@@ -170,30 +275,17 @@ class ContextCompressor:
             return messages
         
         # Keep most recent messages, summarize older ones
-        recent_count = len(messages) // 3
+        recent_count = max(1, len(messages) // 3)
         recent_messages = messages[-recent_count:]
         old_messages = messages[:-recent_count]
         
-        # Summarize old messages
-        old_content = "\n\n".join([
-            f"{m.get('role', 'user')}: {m.get('content', '')}"
-            for m in old_messages
-        ])
-        
-        summary_prompt = f"""Summarize the following conversation concisely, preserving key information:
-
-{old_content}
-
-Summary:"""
-        
-        summary = self.llm_function(summary_prompt)
+        # Earlier summaries are carried forward instead of re-summarized
+        previous = [self.summary_text(m) for m in old_messages if m.get("summarized")]
+        fresh = [m for m in old_messages if not m.get("summarized")]
+        summary = self.summarize(fresh, previous=self._merge_summaries(previous) if previous else None)
         
         # Create compressed context
-        compressed = [
-            {"role": "system", "content": f"Previous conversation summary: {summary}"}
-        ] + recent_messages
-        
-        return compressed
+        return [self.summary_message(summary)] + recent_messages
     
     def _compress_by_extraction(
         self,
@@ -206,7 +298,7 @@ Summary:"""
         filtered = []
         for msg in messages:
             content = msg.get("content", "").lower()
-            if any(kw in content for kw in important_keywords):
+            if msg.get("summarized") or any(kw in content for kw in important_keywords):
                 filtered.append(msg)
         
         # Always keep at least the last 2 messages
@@ -220,30 +312,178 @@ Summary:"""
         messages: List[Dict[str, Any]],
         target_tokens: int
     ) -> List[Dict[str, Any]]:
-        """Chunk messages to fit target"""
-        result = []
-        current_tokens = 0
+        """Chunk messages to fit target (running summaries are kept first)"""
+        pinned = [m for m in messages if m.get("summarized")]
+        current_tokens = sum(TokenCounter.count_message_tokens(m) for m in pinned)
+        if current_tokens > target_tokens:
+            pinned, current_tokens = [], 0
         
         # Start from most recent
+        result = []
         for msg in reversed(messages):
+            if msg.get("summarized"):
+                continue
             msg_tokens = TokenCounter.count_message_tokens(msg)
             if current_tokens + msg_tokens <= target_tokens:
-                result.insert(0, msg)
+                result.append(msg)
                 current_tokens += msg_tokens
             else:
                 break
         
-        return result
+        return pinned + result[::-1]
 
 
 class HierarchicalMemory:
-    """Hierarchical memory organization"""
+    """
+    Hierarchical memory organization
+
+    Features:
+    - Per-level index ordered by last access (recency-weighted top-k
+      stops early instead of scoring every node)
+    - Importance-ordered index (sorted, bisect insertion)
+    - Iterative subtree walk
+    - Optional append-only JSON-lines node log, replayed on startup and
+      compacted into a snapshot once it holds more records than live nodes
+
+    Nodes returned here may be read freely; change content, summary or
+    importance through update_node() so indexes and the log stay in sync.
+    """
     
-    def __init__(self):
+    UPDATABLE_FIELDS = frozenset({'content', 'summary', 'importance', 'metadata'})
+    
+    def __init__(self, log_path: Optional[str] = None, compact_min_records: int = 1000):
+        """
+        Initialize hierarchical memory
+
+        Args:
+            log_path: Node log file (None = memory only)
+            compact_min_records: Log records needed before compaction is considered
+        """
         self.nodes: Dict[str, MemoryNode] = {}
         self.node_counter = 0
         self.roots: List[str] = []  # Root node IDs
-        
+
+        # level -> node ids, least recently accessed first
+        self._by_level: Dict[MemoryLevel, "OrderedDict[str, None]"] = {
+            level: OrderedDict() for level in MemoryLevel
+        }
+        self._max_importance: Dict[MemoryLevel, float] = {level: 0.0 for level in MemoryLevel}
+        # (-importance, insertion order, node id), most important first
+        self._by_importance: List[Tuple[float, int, str]] = []
+        self._lock = threading.RLock()
+
+        self.log_path = log_path
+        self.compact_min_records = compact_min_records
+        self._log = None
+        self._log_records = 0
+        if log_path:
+            self._replay_log()
+            self._log = open(log_path, 'a', encoding='utf-8')
+
+    # ------------------------------------------------------------------
+    # Indexes
+    # ------------------------------------------------------------------
+    def _index_node(self, node: MemoryNode):
+        self.nodes[node.id] = node
+        self._by_level[node.level][node.id] = None
+        self._max_importance[node.level] = max(self._max_importance[node.level], node.importance)
+        bisect.insort(self._by_importance, (-node.importance, len(self.nodes), node.id))
+
+        if node.parent and node.parent in self.nodes:
+            self.nodes[node.parent].children.append(node.id)
+        else:
+            self.roots.append(node.id)
+
+    def _reindex_importance(self, node: MemoryNode, old_importance: float):
+        for i in range(bisect.bisect_left(self._by_importance, (-old_importance,)), len(self._by_importance)):
+            if self._by_importance[i][2] == node.id:
+                _, order, _ = self._by_importance.pop(i)
+                break
+        else:
+            order = len(self.nodes)
+        bisect.insort(self._by_importance, (-node.importance, order, node.id))
+        self._max_importance[node.level] = max(self._max_importance[node.level], node.importance)
+
+    # ------------------------------------------------------------------
+    # Node log
+    # ------------------------------------------------------------------
+    def _replay_log(self):
+        """Rebuild nodes and indexes from the log (last record per id wins)"""
+        if not os.path.exists(self.log_path):
+            return
+        records: Dict[str, Dict[str, Any]] = {}
+        with open(self.log_path, encoding='utf-8') as f:
+            for line in f:
+                line = line.strip()
+                if not line:
+                    continue
+                try:
+                    data = json.loads(line)
+                except json.JSONDecodeError:
+                    logger.warning(f"Skipping corrupt memory log record in {self.log_path}")
+                    continue
+                records[data['id']] = data
+                self._log_records += 1
+
+        for data in records.values():
+            node = MemoryNode(**{**data, 'level': MemoryLevel(data['level']), 'children': []})
+            self._index_node(node)
+        # Records come back in creation order; top_by_level needs access order
+        for level, ids in self._by_level.items():
+            self._by_level[level] = OrderedDict(
+                (node_id, None) for node_id in sorted(ids, key=lambda node_id: self.nodes[node_id].last_accessed)
+            )
+        self.node_counter = max((self._id_counter(node_id) for node_id in records), default=0)
+        logger.info(f"📚 Hierarchical memory: {len(records)} nodes loaded from {self.log_path}")
+
+    @staticmethod
+    def _id_counter(node_id: str) -> int:
+        """Counter part of a node id (node_<level>_<counter>)"""
+        try:
+            return int(node_id.rsplit('_', 1)[1])
+        except (IndexError, ValueError):
+            return 0
+
+    def _append(self, node: MemoryNode):
+        if self._log is None:
+            return
+        record = node.to_dict()
+        record.pop('children')  # rebuilt from parent links on replay
+        self._log.write(json.dumps(record, default=str) + '\n')
+        self._log.flush()
+        self._log_records += 1
+        if self._log_records >= max(self.compact_min_records, 2 * len(self.nodes)):
+            self.compact()
+
+    def compact(self):
+        """Rewrite the log as one record per live node (captures access stats too)"""
+        with self._lock:
+            if not self.log_path:
+                return
+            tmp_path = f"{self.log_path}.tmp"
+            with open(tmp_path, 'w', encoding='utf-8') as f:
+                for node in self.nodes.values():
+                    record = node.to_dict()
+                    record.pop('children')
+                    f.write(json.dumps(record, default=str) + '\n')
+            if self._log is not None:
+                self._log.close()
+            os.replace(tmp_path, self.log_path)
+            self._log = open(self.log_path, 'a', encoding='utf-8')
+            self._log_records = len(self.nodes)
+            logger.debug(f"Compacted memory log to {self._log_records} records")
+
+    def close(self):
+        """Compact and close the node log"""
+        with self._lock:
+            if self._log is not None:
+                self.compact()
+                self._log.close()
+                self._log = None
+
+    # ------------------------------------------------------------------
+    # Nodes
+    # ------------------------------------------------------------------
     def create_node(
         self,
         content: str,
@@ -265,41 +505,58 @@ class HierarchicalMemory:
         Returns:
             Created MemoryNode
         """
-        self.node_counter += 1
-        node_id = f"node_{level.value}_{self.node_counter}_{int(time.time())}"
-        
-        node = MemoryNode(
-            id=node_id,
-            level=level,
-            content=content,
-            summary=None,
-            children=[],
-            parent=parent_id,
-            metadata=metadata or {},
-            importance=importance,
-            access_count=0,
-            created_at=time.time(),
-            last_accessed=time.time()
-        )
-        
-        self.nodes[node_id] = node
-        
-        # Update parent
-        if parent_id and parent_id in self.nodes:
-            self.nodes[parent_id].children.append(node_id)
-        else:
-            self.roots.append(node_id)
-        
+        with self._lock:
+            self.node_counter += 1
+            now = time.time()
+            node = MemoryNode(
+                id=f"node_{level.value}_{self.node_counter}",
+                level=level,
+                content=content,
+                summary=None,
+                children=[],
+                parent=parent_id,
+                metadata=metadata or {},
+                importance=importance,
+                access_count=0,
+                created_at=now,
+                last_accessed=now
+            )
+            self._index_node(node)
+            self._append(node)
+        return node
+    
+    def update_node(self, node_id: str, **fields) -> Optional[MemoryNode]:
+        """Change content / summary / importance / metadata and log the change"""
+        fixed = set(fields) - self.UPDATABLE_FIELDS
+        if fixed:
+            # level, parent and timestamps key the indexes; promote_to_longterm() moves levels
+            raise ValueError(f"update_node cannot change {', '.join(sorted(fixed))}")
+        with self._lock:
+            node = self.nodes.get(node_id)
+            if not node:
+                return None
+            old_importance = node.importance
+            for name, value in fields.items():
+                setattr(node, name, value)
+            if node.importance != old_importance:
+                self._reindex_importance(node, old_importance)
+            self._append(node)
         return node
     
     def get_node(self, node_id: str) -> Optional[MemoryNode]:
         """Get node and update access"""
-        node = self.nodes.get(node_id)
-        if node:
-            node.access_count += 1
-            node.last_accessed = time.time()
+        with self._lock:
+            node = self.nodes.get(node_id)
+            if node:
+                node.access_count += 1
+                node.last_accessed = time.time()
+                self._by_level[node.level].move_to_end(node_id)
         return node
     
+    def count(self, level: MemoryLevel) -> int:
+        """Nodes at a level"""
+        return len(self._by_level[level])
+    
     def get_path_to_root(self, node_id: str) -> List[MemoryNode]:
         """Get path from node to root"""
         path = []
@@ -315,20 +572,65 @@ class HierarchicalMemory:
         return path
     
     def get_children_recursive(self, node_id: str) -> List[MemoryNode]:
-        """Get all children recursively"""
-        children = []
+        """Get all descendants (pre-order, iterative)"""
         node = self.nodes.get(node_id)
-        
         if not node:
-            return children
+            return []
         
-        for child_id in node.children:
-            child = self.nodes.get(child_id)
+        descendants = []
+        stack = list(reversed(node.children))
+        while stack:
+            child = self.nodes.get(stack.pop())
             if child:
-                children.append(child)
-                children.extend(self.get_children_recursive(child_id))
-        
-        return children
+                descendants.append(child)
+                stack.extend(reversed(child.children))
+        return descendants
+    
+    def top_by_level(self, level: MemoryLevel, limit: int = 10) -> List[MemoryNode]:
+        """
+        Highest importance / (seconds since last access + 1) at a level
+
+        Walks the level from most recently accessed and stops once even
+        the level's maximum importance could not beat the current top-k.
+        """
+        if limit <= 0:
+            return []
+        with self._lock:
+            now = time.time()
+            max_importance = self._max_importance[level]
+            top: List[Tuple[float, int, str]] = []  # min-heap of (score, -rank, id)
+            for rank, node_id in enumerate(reversed(self._by_level[level])):
+                node = self.nodes[node_id]
+                decay = 1.0 / (now - node.last_accessed + 1)
+                if len(top) >= limit and max_importance * decay <= top[0][0]:
+                    break
+                item = (node.importance * decay, -rank, node_id)
+                if len(top) < limit:
+                    heapq.heappush(top, item)
+                elif item > top[0]:
+                    heapq.heapreplace(top, item)
+            return [self.nodes[node_id] for _, _, node_id in sorted(top, reverse=True)]
+    
+    def top_by_importance(self, min_importance: float = 0.0, limit: int = 10) -> List[MemoryNode]:
+        """Most important nodes (at least min_importance), highest first"""
+        with self._lock:
+            result = []
+            for negative_importance, _, node_id in self._by_importance:
+                if -negative_importance < min_importance or len(result) >= limit:
+                    break
+                result.append(self.nodes[node_id])
+            return result
+    
+    def created_since(self, cutoff: float, limit: int = 10) -> List[MemoryNode]:
+        """Newest nodes created at or after cutoff, newest first"""
+        with self._lock:
+            result = []
+            for node_id in reversed(self.nodes):
+                node = self.nodes[node_id]
+                if node.created_at < cutoff or len(result) >= limit:
+                    break
+                result.append(node)
+            return result
     
     def promote_to_longterm(self, node_id: str, summary: str):
         """Promote node to long-term memory with summary"""
@@ -364,15 +666,8 @@ class MemoryRetriever:
         limit: int = 10
     ) -> List[MemoryNode]:
         """Retrieve memories by level"""
-        nodes = [n for n in self.memory.nodes.values() if n.level == level]
-        
-        # Sort by importance and recency
-        nodes.sort(
-            key=lambda n: n.importance * (1.0 / (time.time() - n.last_accessed + 1)),
-            reverse=True
-        )
-        
-        return nodes[:limit]
+        # Sorted by importance and recency
+        return self.memory.top_by_level(level, limit)
     
     def retrieve_by_importance(
         self,
@@ -380,9 +675,7 @@ class MemoryRetriever:
         limit: int = 10
     ) -> List[MemoryNode]:
         """Retrieve important memories"""
-        nodes = [n for n in self.memory.nodes.values() if n.importance >= min_importance]
-        nodes.sort(key=lambda n: n.importance, reverse=True)
-        return nodes[:limit]
+        return self.memory.top_by_importance(min_importance, limit)
     
     def retrieve_recent(
         self,
@@ -391,9 +684,7 @@ class MemoryRetriever:
     ) -> List[MemoryNode]:
         """Retrieve recent memories"""
         cutoff = time.time() - (hours * 3600)
-        nodes = [n for n in self.memory.nodes.values() if n.created_at >= cutoff]
-        nodes.sort(key=lambda n: n.created_at, reverse=True)
-        return nodes[:limit]
+        return self.memory.created_since(cutoff, limit)
     
     def retrieve_context(
         self,
@@ -440,7 +731,17 @@ class LongtermMemorySystem:
     Manages extended context beyond session limits
     """
     
-    def __init__(self, llm_function, max_context_tokens: int = 8000):
+    def __init__(self, llm_function, max_context_tokens: int = 8000,
+                 log_path: Optional[str] = None):
+        """
+        Initialize long-term memory
+
+        Args:
+            llm_function: LLM function for summarization
+            max_context_tokens: Maximum context window tokens
+            log_path: Node log for persistence (defaults to
+                COMPANION_LONGTERM_LOG; unset keeps memory in-process only)
+        """
         self.llm_function = llm_function
         self.max_context_tokens = max_context_tokens
         
@@ -451,7 +752,16 @@ class LongtermMemorySystem:
         )
         
         self.compressor = ContextCompressor(llm_function)
-        self.hierarchical_memory = HierarchicalMemory()
+        # Messages evicted from a full window are folded into the running
+        # summary by one background worker; writers never wait for the LLM
+        self.max_pending_messages = 200
+        self._window_lock = threading.RLock()
+        self._running_summary: Optional[str] = None
+        self._pending_summary: List[Dict[str, Any]] = []
+        self._summarizing = False
+        self._summarizer = ThreadPoolExecutor(max_workers=1, thread_name_prefix="memory_summarizer")
+        self._summary_future: Optional[Future] = None
+        self.hierarchical_memory = HierarchicalMemory(log_path or os.getenv('COMPANION_LONGTERM_LOG'))
         self.retriever = MemoryRetriever(self.hierarchical_memory)
         
         self.enabled = True
@@ -483,11 +793,11 @@ class LongtermMemorySystem:
         message = {"role": role, "content": content}
         token_count = TokenCounter.count_message_tokens(message)
         
-        if not self.context_window.can_fit(token_count):
-            # Compress if needed
-            self._compress_context()
-        
-        self.context_window.add_message(message, token_count)
+        with self._window_lock:
+            if not self.context_window.can_fit(token_count):
+                # Zero-LLM eviction now, summarization in the background
+                self._evict_for_summary()
+            self.context_window.add_message(message, token_count)
     
     def store_longterm(
         self,
@@ -516,7 +826,8 @@ class LongtermMemorySystem:
         if not summary and len(content) > 500:
             summary = self._generate_summary(content)
         
-        node.summary = summary
+        if summary:
+            self.hierarchical_memory.update_node(node.id, summary=summary)
         logger.info(f"Stored in long-term memory: {node.id}")
         return node
     
@@ -578,9 +889,7 @@ class LongtermMemorySystem:
         """Get memory system statistics"""
         nodes_by_level = {}
         for level in MemoryLevel:
-            nodes_by_level[level.value] = len(
-                [n for n in self.hierarchical_memory.nodes.values() if n.level == level]
-            )
+            nodes_by_level[level.value] = self.hierarchical_memory.count(level)
         
         return {
             "total_nodes": len(self.hierarchical_memory.nodes),
@@ -588,29 +897,104 @@ class LongtermMemorySystem:
             "context_usage": self.context_window.get_usage_ratio(),
             "context_messages": len(self.context_window.messages),
             "context_tokens": self.context_window.current_tokens,
-            "max_tokens": self.max_context_tokens
+            "max_tokens": self.max_context_tokens,
+            "pending_summary_messages": len(self._pending_summary),
+            "summaries": dict(self.compressor.stats)
         }
     
+    def _set_window(self, messages: List[Dict[str, Any]]):
+        self.context_window.messages = messages
+        self.context_window.current_tokens = sum(
+            TokenCounter.count_message_tokens(m) for m in messages
+        )
+    
+    def _evict_for_summary(self, target_ratio: float = 0.7):
+        """Drop the oldest messages (chunking) and queue them for summarization"""
+        with self._window_lock:
+            messages = self.context_window.messages
+            target_tokens = int(self.max_context_tokens * target_ratio)
+            kept = self.compressor.compress_messages(messages, target_tokens, CompressionStrategy.CHUNKING)
+            kept_ids = {id(m) for m in kept}
+            evicted = [m for m in messages if id(m) not in kept_ids and not m.get("summarized")]
+            self._set_window(kept)
+            self.context_window.compressed = True
+            if not evicted:
+                return
+            
+            self._pending_summary.extend(evicted)
+            del self._pending_summary[:-self.max_pending_messages]
+            if not self._summarizing:
+                self._summarizing = True
+                self._summary_future = self._summarizer.submit(self._summarize_pending)
+    
+    def _summarize_pending(self):
+        """Background: fold evicted messages into the running summary"""
+        while True:
+            with self._window_lock:
+                batch, self._pending_summary = self._pending_summary, []
+                previous = self._running_summary
+                if not batch:
+                    self._summarizing = False
+                    return
+            
+            try:
+                summary = self.compressor.summarize(batch, previous=previous)
+            except Exception as e:
+                logger.warning(f"⚠️ Background summarization failed: {e}")
+                with self._window_lock:
+                    self._pending_summary[:0] = batch
+                    del self._pending_summary[:-self.max_pending_messages]
+                    self._summarizing = False
+                return
+            
+            with self._window_lock:
+                self._running_summary = summary
+                messages = [m for m in self.context_window.messages if not m.get("summarized")]
+                self._set_window([self.compressor.summary_message(summary)] + messages)
+                if self.context_window.current_tokens > self.max_context_tokens:
+                    self._evict_for_summary()
+            logger.debug(f"Running summary updated ({len(batch)} messages folded in)")
+    
+    def flush_summaries(self, timeout: Optional[float] = None):
+        """Wait for background summarization to catch up"""
+        future = self._summary_future
+        if future is not None:
+            future.result(timeout=timeout)
+    
+    def close(self, timeout: Optional[float] = 10.0):
+        """Let the running summary finish, stop its worker and close the node log"""
+        try:
+            self.flush_summaries(timeout=timeout)
+        except Exception as e:
+            logger.warning(f"⚠️ Background summarization did not finish: {e}")
+        self._summarizer.shutdown(wait=False)
+        self.hierarchical_memory.close()
+    
     def _compress_context(
         self,
         strategy: CompressionStrategy = CompressionStrategy.SUMMARIZATION,
         target_ratio: float = 0.7
     ):
-        """Compress context window"""
+        """Compress context window (LLM work runs outside the window lock)"""
         target_tokens = int(self.max_context_tokens * target_ratio)
+        with self._window_lock:
+            snapshot = list(self.context_window.messages)
         
         compressed_messages = self.compressor.compress_messages(
-            self.context_window.messages,
+            snapshot,
             target_tokens,
             strategy
         )
         
-        # Update window
-        self.context_window.messages = compressed_messages
-        self.context_window.current_tokens = sum(
-            TokenCounter.count_message_tokens(m) for m in compressed_messages
-        )
-        self.context_window.compressed = True
+        # Keep anything written to the window while compressing
+        with self._window_lock:
+            snapshot_ids = {id(m) for m in snapshot}
+            added = [m for m in self.context_window.messages if id(m) not in snapshot_ids]
+            self._set_window(compressed_messages + added)
+            self.context_window.compressed = True
+            for message in compressed_messages:
+                if message.get("summarized"):
+                    self._running_summary = self.compressor.summary_text(message)
         
         logger.info(f"Context compressed to {self.context_window.current_tokens} tokens")
     
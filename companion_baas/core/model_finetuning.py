@@ -11,14 +11,26 @@ Enables model adaptation and fine-tuning:
 - Performance tracking
 """
 
+import os
 import logging
 import json
 import time
-from typing import Dict, List, Optional, Any, Tuple, Callable
+from concurrent.futures import ThreadPoolExecutor
+from typing import Dict, Iterable, Iterator, List, Optional, Any, Tuple, Callable
 from dataclasses import dataclass, field
 from enum import Enum
 import statistics
-import hashlib
+
+try:
+    from companion_baas.core.training_store import TrainingStore, content_hash, take_best
+    from companion_baas.core.eval_harness import (
+        Candidate, OfflineEvalHarness, RecordedRequest, RunningStats, exact_or_contains, msprt_p_value
+    )
+except ImportError:
+    from core.training_store import TrainingStore, content_hash, take_best
+    from core.eval_harness import (
+        Candidate, OfflineEvalHarness, RecordedRequest, RunningStats, exact_or_contains, msprt_p_value
+    )
 
 logger = logging.getLogger(__name__)
 
@@ -51,6 +63,7 @@ class TrainingExample:
     metadata: Dict[str, Any]
     quality_score: float  # 0.0 to 1.0
     created_at: float
+    dataset_type: str = DatasetType.INSTRUCTION.value
     
     def to_dict(self) -> Dict[str, Any]:
         return {
@@ -59,9 +72,23 @@ class TrainingExample:
             "output": self.output_text,
             "metadata": self.metadata,
             "quality_score": self.quality_score,
+            "dataset_type": self.dataset_type,
             "created_at": self.created_at
         }
     
+    @classmethod
+    def from_row(cls, row: Dict[str, Any]) -> 'TrainingExample':
+        """Build from a TrainingStore row"""
+        return cls(
+            id=row['id'],
+            input_text=row['input'],
+            output_text=row['output'],
+            metadata=json.loads(row['metadata']),
+            quality_score=row['quality_score'],
+            created_at=row['created_at'],
+            dataset_type=row['dataset_type']
+        )
+    
     def to_training_format(self, format_type: str = "openai") -> Dict[str, Any]:
         """Convert to specific training format"""
         if format_type == "openai":
@@ -141,27 +168,46 @@ class EvaluationMetrics:
 
 
 class TrainingDataPreparator:
-    """Prepare training data from interactions"""
+    """
+    Prepare training data from interactions
+
+    Examples are deduplicated by content hash of (input, output). With a
+    store path (or COMPANION_TRAINING_STORE) they go to an on-disk
+    columnar TrainingStore instead of memory, and iter_examples() /
+    export_jsonl() stream from it.
+    """
     
-    def __init__(self):
+    def __init__(self, store_path: Optional[str] = None):
+        """
+        Initialize preparator
+
+        Args:
+            store_path: TrainingStore directory (None = keep examples in memory)
+        """
         self.examples: Dict[str, TrainingExample] = {}
         self.example_counter = 0
+        self.duplicates_skipped = 0
+        
+        store_path = store_path or os.getenv('COMPANION_TRAINING_STORE')
+        self.store: Optional[TrainingStore] = TrainingStore(store_path) if store_path else None
         
     def add_example(
         self,
         input_text: str,
         output_text: str,
         quality_score: float = 0.8,
-        metadata: Optional[Dict[str, Any]] = None
+        metadata: Optional[Dict[str, Any]] = None,
+        dataset_type: str = DatasetType.INSTRUCTION.value
     ) -> TrainingExample:
         """
-        Add training example
+        Add training example (an identical input/output pair is kept once)
         
         Args:
             input_text: Input/prompt text
             output_text: Expected output
             quality_score: Quality score (0.0-1.0)
             metadata: Additional metadata
+            dataset_type: DatasetType value, used for export filtering
             
         Returns:
             Created TrainingExample
@@ -175,10 +221,19 @@ class TrainingDataPreparator:
             output_text=output_text,
             metadata=metadata or {},
             quality_score=quality_score,
-            created_at=time.time()
+            created_at=time.time(),
+            dataset_type=dataset_type
         )
         
-        self.examples[example_id] = example
+        if self.store is not None:
+            if self.store.append(input_text, output_text, quality_score, dataset_type,
+                                 example.metadata, example.created_at) is None:
+                self.duplicates_skipped += 1
+        elif example_id in self.examples:
+            self.duplicates_skipped += 1
+            return self.examples[example_id]
+        else:
+            self.examples[example_id] = example
         return example
     
     def add_from_conversation(
@@ -197,15 +252,42 @@ class TrainingDataPreparator:
                         input_text=user_msg[1],
                         output_text=assistant_msg[1],
                         quality_score=quality_score,
-                        metadata={"source": "conversation"}
+                        metadata={"source": "conversation"},
+                        dataset_type=DatasetType.CONVERSATION.value
                     )
     
+    def iter_examples(self, min_quality: float = 0.0,
+                      dataset_types: Optional[Iterable[str]] = None) -> Iterator[TrainingExample]:
+        """Stream examples matching quality and type, in insertion order"""
+        if self.store is not None:
+            for row in self.store.scan(min_quality, dataset_types):
+                yield TrainingExample.from_row(row)
+            return
+        types = set(dataset_types) if dataset_types is not None else None
+        for ex in list(self.examples.values()):
+            if ex.quality_score >= min_quality and (types is None or ex.dataset_type in types):
+                yield ex
+    
+    def iter_best(self, limit: int, min_quality: float = 0.0,
+                  dataset_types: Optional[Iterable[str]] = None) -> Iterator[TrainingExample]:
+        """The `limit` highest-quality matching examples, in insertion order"""
+        if self.store is not None:
+            for row in self.store.scan_best(limit, min_quality, dataset_types):
+                yield TrainingExample.from_row(row)
+            return
+        yield from take_best(self.iter_examples(min_quality, dataset_types),
+                             (ex.quality_score for ex in self.iter_examples(min_quality, dataset_types)),
+                             limit, lambda ex: ex.quality_score)
+    
+    def count(self, min_quality: float = 0.0, dataset_types: Optional[Iterable[str]] = None) -> int:
+        """Number of examples matching quality and type"""
+        if self.store is not None:
+            return self.store.count(min_quality, dataset_types)
+        return sum(1 for _ in self.iter_examples(min_quality, dataset_types))
+    
     def filter_by_quality(self, min_score: float = 0.7) -> List[TrainingExample]:
         """Filter examples by quality score"""
-        filtered = [
-            ex for ex in self.examples.values()
-            if ex.quality_score >= min_score
-        ]
+        filtered = list(self.iter_examples(min_score))
         filtered.sort(key=lambda ex: ex.quality_score, reverse=True)
         return filtered
     
@@ -214,27 +296,76 @@ class TrainingDataPreparator:
         format_type: str = "openai",
         min_quality: float = 0.7,
         max_examples: Optional[int] = None
-    ) -> List[Dict[str, Any]]:
+    ) -> Iterator[Dict[str, Any]]:
         """
         Export dataset in specific format
         
         Args:
             format_type: Export format
             min_quality: Minimum quality score
-            max_examples: Maximum examples to export
+            max_examples: Maximum examples to export (the highest-quality ones)
             
         Returns:
-            List of formatted examples
+            Iterator of formatted examples in insertion order (the same
+            selection export_jsonl() writes)
         """
-        examples = self.filter_by_quality(min_quality)
+        if max_examples is None:
+            examples = self.iter_examples(min_quality)
+        else:
+            examples = self.iter_best(max_examples, min_quality)
+        
+        for ex in examples:
+            yield ex.to_training_format(format_type)
+    
+    def export_jsonl(
+        self,
+        output_path: str,
+        format_type: str = "openai",
+        min_quality: float = 0.7,
+        dataset_types: Optional[Iterable[str]] = None,
+        max_examples: Optional[int] = None
+    ) -> int:
+        """
+        Stream matching examples to a JSONL file (insertion order, bounded memory;
+        with max_examples, the highest-quality ones)
         
-        if max_examples:
-            examples = examples[:max_examples]
+        Returns:
+            Examples written
+        """
+        if self.store is not None:
+            return self.store.export_jsonl(output_path, format_type, min_quality, dataset_types, max_examples)
         
-        return [ex.to_training_format(format_type) for ex in examples]
+        if max_examples is None:
+            examples = self.iter_examples(min_quality, dataset_types)
+        else:
+            examples = self.iter_best(max_examples, min_quality, dataset_types)
+        written = 0
+        with open(output_path, 'w', encoding='utf-8') as f:
+            for ex in examples:
+                f.write(json.dumps(ex.to_training_format(format_type), ensure_ascii=False) + "\n")
+                written += 1
+        return written
+    
+    def close(self):
+        """Write buffered examples to the store"""
+        if self.store is not None:
+            self.store.close()
     
     def get_statistics(self) -> Dict[str, Any]:
         """Get dataset statistics"""
+        if self.store is not None:
+            stats = self.store.get_stats()
+            if not stats['rows']:
+                return {"total": 0}
+            return {
+                "total_examples": stats['rows'],
+                "avg_quality_score": stats['avg_quality_score'],
+                "avg_input_length": stats['avg_input_length'],
+                "avg_output_length": stats['avg_output_length'],
+                "high_quality_count": self.store.count(0.8),
+                "duplicates_skipped": self.duplicates_skipped
+            }
+        
         if not self.examples:
             return {"total": 0}
         
@@ -247,13 +378,13 @@ class TrainingDataPreparator:
             "avg_quality_score": statistics.mean(scores),
             "avg_input_length": statistics.mean(input_lengths),
             "avg_output_length": statistics.mean(output_lengths),
-            "high_quality_count": len(self.filter_by_quality(0.8))
+            "high_quality_count": self.count(0.8),
+            "duplicates_skipped": self.duplicates_skipped
         }
     
     def _generate_id(self, input_text: str, output_text: str) -> str:
-        """Generate unique example ID"""
-        combined = f"{input_text}:{output_text}:{time.time()}"
-        return hashlib.sha256(combined.encode()).hexdigest()[:16]
+        """Example ID from its content (same id as the TrainingStore row)"""
+        return f"{content_hash(input_text, output_text) & 0xFFFFFFFFFFFFFFFF:016x}"
 
 
 class FineTuningJob:
@@ -330,7 +461,8 @@ class ModelEvaluator:
         self,
         model_id: str,
         test_data: List[TrainingExample],
-        llm_function: Callable
+        llm_function: Callable,
+        concurrency: int = 1
     ) -> EvaluationMetrics:
         """
         Evaluate model on test data
@@ -339,33 +471,32 @@ class ModelEvaluator:
             model_id: Model identifier
             test_data: Test examples
             llm_function: Function to call model
+            concurrency: Examples scored in parallel (llm_function must be thread-safe)
             
         Returns:
             EvaluationMetrics
         """
         logger.info(f"Evaluating model: {model_id} on {len(test_data)} examples")
         
-        correct = 0
-        total_latency = 0.0
-        
-        for example in test_data:
+        def score(example: TrainingExample) -> Tuple[float, float]:
             start_time = time.time()
-            
-            # Get model prediction
             try:
                 prediction = llm_function(example.input_text)
                 latency = (time.time() - start_time) * 1000  # ms
-                total_latency += latency
-                
-                # Simple accuracy check (exact match or contains)
-                if prediction.strip() == example.output_text.strip():
-                    correct += 1
-                elif example.output_text.strip().lower() in prediction.lower():
-                    correct += 0.5  # Partial credit
-                    
+                # Exact match, or partial credit when the reference is contained
+                return exact_or_contains(prediction, example.output_text), latency
             except Exception as e:
                 logger.error(f"Evaluation error: {e}")
+                return 0.0, 0.0
         
+        if concurrency > 1 and len(test_data) > 1:
+            with ThreadPoolExecutor(max_workers=concurrency, thread_name_prefix="model_eval") as pool:
+                results = list(pool.map(score, test_data))
+        else:
+            results = [score(example) for example in test_data]
+        
+        correct = sum(result[0] for result in results)
+        total_latency = sum(result[1] for result in results)
         accuracy = correct / len(test_data) if test_data else 0
         avg_latency = total_latency / len(test_data) if test_data else 0
         
@@ -418,9 +549,18 @@ class ModelEvaluator:
 
 
 class ABTestFramework:
-    """A/B testing for model variants"""
+    """
+    A/B testing for model variants
+
+    Scores are aggregated in streaming form (mean / variance per arm), and
+    significance uses an always-valid sequential test, so results may be
+    checked after every request without inflating false positives.
+    """
     
-    def __init__(self):
+    MIN_SAMPLES = 30
+    
+    def __init__(self, alpha: float = 0.05):
+        self.alpha = alpha
         self.experiments: Dict[str, Dict[str, Any]] = {}
         self.experiment_counter = 0
         
@@ -455,9 +595,10 @@ class ABTestFramework:
             "created_at": time.time(),
             "status": "active",
             "results": {
-                "model_a": {"requests": 0, "avg_score": 0.0, "scores": []},
-                "model_b": {"requests": 0, "avg_score": 0.0, "scores": []}
-            }
+                "model_a": {"requests": 0, "avg_score": 0.0, "stats": RunningStats()},
+                "model_b": {"requests": 0, "avg_score": 0.0, "stats": RunningStats()}
+            },
+            "p_value": 1.0
         }
         
         logger.info(f"A/B experiment created: {name}")
@@ -497,9 +638,21 @@ class ABTestFramework:
         variant = "model_a" if model_id == exp["model_a"] else "model_b"
         results = exp["results"][variant]
         
-        results["requests"] += 1
-        results["scores"].append(score)
-        results["avg_score"] = statistics.mean(results["scores"])
+        results["stats"].add(score)
+        results["requests"] = results["stats"].n
+        results["avg_score"] = results["stats"].mean
+        
+        # Running minimum of the mixture-SPRT p-value (valid under continuous monitoring)
+        stats_a = exp["results"]["model_a"]["stats"]
+        stats_b = exp["results"]["model_b"]["stats"]
+        if stats_a.n >= self.MIN_SAMPLES and stats_b.n >= self.MIN_SAMPLES:
+            variance = stats_a.variance / stats_a.n + stats_b.variance / stats_b.n
+            tau2 = (stats_a.variance + stats_b.variance) / 2
+            if variance > 0:
+                p_value = msprt_p_value(stats_a.mean - stats_b.mean, variance, tau2)
+            else:
+                p_value = 0.0 if stats_a.mean != stats_b.mean else 1.0
+            exp["p_value"] = min(exp["p_value"], p_value)
     
     def get_experiment_results(self, experiment_id: str) -> Dict[str, Any]:
         """Get experiment results"""
@@ -510,12 +663,16 @@ class ABTestFramework:
         results_a = exp["results"]["model_a"]
         results_b = exp["results"]["model_b"]
         
-        # Determine statistical significance (simplified)
-        if results_a["requests"] < 30 or results_b["requests"] < 30:
+        stats_a, stats_b = results_a["stats"], results_b["stats"]
+        
+        # Sequential significance (needs MIN_SAMPLES per arm)
+        if results_a["requests"] < self.MIN_SAMPLES or results_b["requests"] < self.MIN_SAMPLES:
             significance = "insufficient_data"
         else:
-            score_diff = abs(results_a["avg_score"] - results_b["avg_score"])
-            significance = "significant" if score_diff > 0.05 else "not_significant"
+            significance = "significant" if exp["p_value"] < self.alpha else "not_significant"
+        
+        diff = stats_a.mean - stats_b.mean
+        diff_stderr = (stats_a.stderr ** 2 + stats_b.stderr ** 2) ** 0.5
         
         return {
             "experiment_id": experiment_id,
@@ -523,13 +680,18 @@ class ABTestFramework:
             "model_a": {
                 "id": exp["model_a"],
                 "requests": results_a["requests"],
-                "avg_score": results_a["avg_score"]
+                "avg_score": results_a["avg_score"],
+                "ci95": stats_a.confidence_interval()
             },
             "model_b": {
                 "id": exp["model_b"],
                 "requests": results_b["requests"],
-                "avg_score": results_b["avg_score"]
+                "avg_score": results_b["avg_score"],
+                "ci95": stats_b.confidence_interval()
             },
+            "score_diff": diff,
+            "score_diff_ci95": [diff - 1.96 * diff_stderr, diff + 1.96 * diff_stderr],
+            "p_value": exp["p_value"],
             "winner": exp["model_a"] if results_a["avg_score"] > results_b["avg_score"] else exp["model_b"],
             "significance": significance
         }
@@ -541,8 +703,15 @@ class ModelFinetuningSystem:
     Handles training, evaluation, and deployment
     """
     
-    def __init__(self):
-        self.data_preparator = TrainingDataPreparator()
+    def __init__(self, training_store: Optional[str] = None):
+        """
+        Initialize system
+
+        Args:
+            training_store: Directory for the columnar training store
+                (defaults to COMPANION_TRAINING_STORE; unset keeps data in memory)
+        """
+        self.data_preparator = TrainingDataPreparator(training_store)
         self.evaluator = ModelEvaluator()
         self.ab_framework = ABTestFramework()
         self.jobs: Dict[str, FineTuningJob] = {}
@@ -594,11 +763,11 @@ class ModelFinetuningSystem:
         Returns:
             Job ID
         """
-        # Get high-quality training data
-        examples = self.data_preparator.filter_by_quality(min_quality)
+        # Count high-quality training data
+        dataset_size = self.data_preparator.count(min_quality)
         
-        if len(examples) < 10:
-            raise ValueError(f"Insufficient training data: {len(examples)} examples (minimum 10)")
+        if dataset_size < 10:
+            raise ValueError(f"Insufficient training data: {dataset_size} examples (minimum 10)")
         
         self.job_counter += 1
         job_id = f"ft_job_{self.job_counter}_{int(time.time())}"
@@ -606,11 +775,11 @@ class ModelFinetuningSystem:
         job = FineTuningJob(
             job_id=job_id,
             config=config,
-            dataset_size=len(examples)
+            dataset_size=dataset_size
         )
         
         self.jobs[job_id] = job
-        logger.info(f"Created fine-tuning job: {job_id} with {len(examples)} examples")
+        logger.info(f"Created fine-tuning job: {job_id} with {dataset_size} examples")
         
         return job_id
     
@@ -672,6 +841,57 @@ class ModelFinetuningSystem:
         """Compare two models"""
         return self.evaluator.compare_models(model_a_id, model_b_id)
     
+    def run_offline_eval(
+        self,
+        models: Dict[str, Callable],
+        corpus: Iterable[RecordedRequest],
+        baseline: Optional[str] = None,
+        concurrency: int = 8,
+        limit: Optional[int] = None,
+        early_stop: bool = False
+    ) -> Dict[str, Any]:
+        """
+        Replay a recorded corpus against several models in parallel
+        
+        Args:
+            models: model_id -> prompt function (str or CandidateResponse)
+            corpus: Recorded requests (e.g. eval_harness.load_corpus(path))
+            baseline: Model the others are compared to (default: the first)
+            concurrency: Parallel model calls
+            limit: Replay at most this many requests
+            early_stop: Stop once every model's quality differs significantly from the baseline
+            
+        Returns:
+            Harness report; each model's metrics are also recorded for compare_models()
+        """
+        harness = OfflineEvalHarness(
+            [Candidate(model_id, function) for model_id, function in models.items()],
+            baseline=baseline, concurrency=concurrency, early_stop=early_stop
+        )
+        report = harness.run(corpus, limit=limit)
+        
+        for model_id, metrics in report["candidates"].items():
+            latency = metrics["latency_ms"]["mean"]
+            evaluation = EvaluationMetrics(
+                accuracy=metrics["quality"]["mean"],
+                f1_score=metrics["token_f1"],
+                latency_ms=latency,
+                throughput=1000 / latency if latency > 0 else 0,
+                custom_metrics={
+                    "latency_p99_ms": metrics["latency_ms"]["p99"],
+                    "cost_per_request": metrics["cost"]["per_request"],
+                    "error_rate": metrics["error_rate"]
+                }
+            )
+            self.evaluator.evaluation_history.append({
+                "model_id": model_id,
+                "timestamp": time.time(),
+                "metrics": evaluation.to_dict(),
+                "test_size": metrics["requests"]
+            })
+        
+        return report
+    
     def create_ab_test(
         self,
         name: str,
@@ -691,9 +911,26 @@ class ModelFinetuningSystem:
             return {"error": "Job not found"}
         return job.to_dict()
     
+    def export_training_data(
+        self,
+        output_path: str,
+        format_type: str = "openai",
+        min_quality: float = 0.7,
+        dataset_types: Optional[Iterable[str]] = None,
+        max_examples: Optional[int] = None
+    ) -> int:
+        """Stream the training set to JSONL ('openai' or 'alpaca'); returns examples written"""
+        return self.data_preparator.export_jsonl(
+            output_path, format_type, min_quality, dataset_types, max_examples
+        )
+    
     def get_dataset_stats(self) -> Dict[str, Any]:
         """Get training dataset statistics"""
         return self.data_preparator.get_statistics()
+    
+    def close(self):
+        """Persist buffered training data (call on shutdown)"""
+        self.data_preparator.close()
 
 
 # Convenience function
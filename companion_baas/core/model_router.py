@@ -1,14 +1,377 @@
 """
 Model Router - Intelligent model selection and routing
-Coming soon in Phase 2
+
+Adaptive, latency- and cost-aware model selection shared by the brain
+(_route_to_best_model / _call_with_retry) and the legacy API wrapper.
+
+Each routing context (code, reasoning, math, chat, long context, ...)
+has an ordered list of candidate models; the first is the preferred one.
+Every call outcome is fed back into a per-model posterior on the
+probability of a "good" response: one that succeeded *within the latency
+SLO*. While the preferred model's posterior mean meets the target good
+rate it serves the context, apart from a small fixed exploration share
+that keeps the alternates' evidence fresh. Once it drops below the
+target, models are picked by Thompson sampling, so slow or failing
+providers lose traffic after a handful of requests, long before a circuit
+breaker trips, and win it back as their evidence ages out.
 """
 
+import time
+import random
+import logging
+import threading
+from dataclasses import dataclass, field
+from typing import Any, Dict, List, Optional, Sequence, Tuple
+
+try:
+    from companion_baas.optimization.sketches import DecayingSketch
+except ImportError:
+    from optimization.sketches import DecayingSketch
+
+logger = logging.getLogger(__name__)
+
+
+# Candidate models per routing context: (model, provider, cost per 1k tokens).
+# Order matters: the first model is preferred until evidence says otherwise.
+DEFAULT_ROUTES: Dict[str, List[Tuple[str, str, float]]] = {
+    'chat': [('qwen-4b', 'bytez', 0.0), ('tinyllama', 'bytez', 0.0)],
+    'code': [('deepseek-coder', 'bytez', 0.0), ('qwen-4b', 'bytez', 0.0)],
+    'reasoning': [('qwen-4b', 'bytez', 0.0), ('phi-2', 'bytez', 0.0)],
+    'math': [('qwen-math', 'bytez', 0.0), ('qwen-4b', 'bytez', 0.0)],
+    'medium_context': [('qwen-32b', 'bytez', 0.0), ('qwen-72b', 'bytez', 0.0)],
+    'long_context': [('qwen-72b', 'bytez', 0.0), ('qwen-32b', 'bytez', 0.0)],
+}
+
+# Beta prior pseudo-counts (successes, failures)
+PREFERRED_PRIOR = (8.0, 1.0)
+ALTERNATE_PRIOR = (2.0, 1.0)
+
+# Sampled score an alternate must beat the preferred model by (switching cost)
+# once the preferred model is degraded
+SWITCH_MARGIN = 0.05
+
+# Posterior good rate at which the preferred model counts as healthy, and the
+# share of a healthy context's traffic sent to alternates to keep probing them
+TARGET_GOOD_RATE = 0.8
+EXPLORATION_RATE = 0.02
+
+
+@dataclass
+class ModelArm:
+    """Live health of one model"""
+    model: str
+    provider: str
+    cost_per_1k_tokens: float = 0.0
+    good: float = 0.0          # discounted count of successes within SLO
+    bad: float = 0.0           # discounted count of errors and SLO misses
+    updated_at: float = 0.0
+    requests: int = 0
+    errors: int = 0
+    slo_misses: int = 0
+    tokens_per_second: float = 0.0  # EWMA throughput
+    latency: DecayingSketch = field(default_factory=lambda: DecayingSketch(window_seconds=600, slices=10))
+
+
 class ModelRouter:
-    """Routes requests to the best available model"""
-    
-    def __init__(self):
-        pass
-    
+    """
+    Routes requests to the best available model
+
+    Features:
+    - Preferred model keeps its context while its "success within SLO"
+      rate meets the target (alternates get a fixed exploration share)
+    - Thompson sampling over "success within SLO" once it degrades
+    - Evidence discounted per observation and over time (degradation shifts
+      traffic quickly; recovered providers are re-probed)
+    - Per-request cost budget filter
+    - Live latency distributions (p50/p90/p99), error rates, token throughput
+    """
+
+    def __init__(
+        self,
+        latency_slo: float = 10.0,
+        cost_budget: Optional[float] = None,
+        discount: float = 0.9,
+        half_life_seconds: float = 300.0,
+        routes: Optional[Dict[str, List[Tuple[str, str, float]]]] = None,
+        seed: Optional[int] = None,
+        clock=time.monotonic,
+        target_good_rate: float = TARGET_GOOD_RATE,
+        exploration_rate: float = EXPLORATION_RATE
+    ):
+        """
+        Initialize router
+
+        Args:
+            latency_slo: Seconds; slower successes count against a model
+            cost_budget: Max estimated cost per request (None = unlimited)
+            discount: Weight kept by old evidence on each new observation
+            half_life_seconds: Evidence half-life when a model gets no traffic
+            routes: Context -> ordered candidates (defaults to DEFAULT_ROUTES)
+            seed: RNG seed (tests)
+            clock: Time source (injectable for tests)
+            target_good_rate: Posterior good rate below which the preferred
+                model is considered degraded
+            exploration_rate: Share of a healthy context's traffic sent to alternates
+        """
+        self.latency_slo = latency_slo
+        self.cost_budget = cost_budget
+        self.discount = discount
+        self.half_life_seconds = half_life_seconds
+        self.target_good_rate = target_good_rate
+        self.exploration_rate = exploration_rate
+        self._rng = random.Random(seed)
+        self._clock = clock
+        self._lock = threading.Lock()
+
+        self.arms: Dict[str, ModelArm] = {}
+        self.routes: Dict[str, List[str]] = {}
+        for context, candidates in (routes or DEFAULT_ROUTES).items():
+            for model, provider, cost in candidates:
+                self.register(context, model, provider, cost)
+
+        self.stats = {'selections': 0, 'selections_by_context': {}, 'fallback_selections': 0,
+                      'explorations': 0, 'degraded_selections': 0}
+
+    def register(self, context: str, model: str, provider: str = 'bytez', cost_per_1k_tokens: float = 0.0):
+        """
+        Add a candidate model to a routing context (appended = lower preference)
+
+        Args:
+            context: Routing context name
+            model: Model name
+            provider: Provider serving the model
+            cost_per_1k_tokens: Estimated cost per 1k tokens
+        """
+        with self._lock:
+            if model not in self.arms:
+                self.arms[model] = ModelArm(model, provider, cost_per_1k_tokens, updated_at=self._clock())
+            candidates = self.routes.setdefault(context, [])
+            if model not in candidates:
+                candidates.append(model)
+
+    # ------------------------------------------------------------------
+    # Selection
+    # ------------------------------------------------------------------
+    def _decayed(self, arm: ModelArm, now: float) -> Tuple[float, float]:
+        """Evidence after time decay (idle models drift back to their prior)"""
+        idle = now - arm.updated_at
+        if idle <= 0 or self.half_life_seconds <= 0:
+            return arm.good, arm.bad
+        factor = 0.5 ** (idle / self.half_life_seconds)
+        return arm.good * factor, arm.bad * factor
+
+    def _good_rate(self, model: str, now: float) -> float:
+        """Posterior mean good rate of the preferred model for its context"""
+        good, bad = self._decayed(self.arms[model], now)
+        prior_good, prior_bad = PREFERRED_PRIOR
+        return (prior_good + good) / (prior_good + prior_bad + good + bad)
+
+    def select(
+        self,
+        context: str,
+        estimated_tokens: int = 0,
+        candidates: Optional[Sequence[str]] = None,
+        exclude: Optional[Sequence[str]] = None
+    ) -> Optional[str]:
+        """
+        Pick a model for a request
+
+        Args:
+            context: Routing context (code, reasoning, math, chat, ...)
+            estimated_tokens: Request size, for the cost budget
+            candidates: Override the context's candidate list (unknown models
+                        are registered on the fly, in the given order)
+            exclude: Models not to use (e.g. already tried)
+
+        Returns:
+            Model name, or None when no candidate is available
+        """
+        if candidates is not None:
+            for model in candidates:
+                if model not in self.arms or model not in self.routes.get(context, ()):
+                    self.register(context, model)
+            pool = list(candidates)
+        else:
+            pool = list(self.routes.get(context) or self.routes.get('chat', []))
+        if exclude:
+            pool = [m for m in pool if m not in exclude]
+        if not pool:
+            return None
+
+        preferred = self.routes.get(context, pool)[0] if self.routes.get(context) else pool[0]
+        now = self._clock()
+
+        with self._lock:
+            affordable = pool
+            if self.cost_budget is not None:
+                affordable = [
+                    m for m in pool
+                    if self.arms[m].cost_per_1k_tokens * estimated_tokens / 1000.0 <= self.cost_budget
+                ]
+                if not affordable:
+                    # Nothing fits the budget: cheapest model wins
+                    self.stats['fallback_selections'] += 1
+                    affordable = [min(pool, key=lambda m: self.arms[m].cost_per_1k_tokens)]
+
+            alternates = [m for m in affordable if m != preferred]
+            if preferred in affordable and self._good_rate(preferred, now) >= self.target_good_rate:
+                # Healthy: stay on the preferred model, probe alternates rarely
+                best_model = preferred
+                if alternates and self._rng.random() < self.exploration_rate:
+                    best_model = self._rng.choice(alternates)
+                    self.stats['explorations'] += 1
+            else:
+                best_model, best_sample = affordable[0], -1.0
+                for model in affordable:
+                    good, bad = self._decayed(self.arms[model], now)
+                    prior_good, prior_bad = PREFERRED_PRIOR if model == preferred else ALTERNATE_PRIOR
+                    sample = self._rng.betavariate(prior_good + good, prior_bad + bad)
+                    if model != preferred:
+                        sample -= SWITCH_MARGIN
+                    if sample > best_sample:
+                        best_model, best_sample = model, sample
+                self.stats['degraded_selections'] += 1
+
+            self.stats['selections'] += 1
+            by_context = self.stats['selections_by_context'].setdefault(context, {})
+            by_context[best_model] = by_context.get(best_model, 0) + 1
+        return best_model
+
+    # ------------------------------------------------------------------
+    # Feedback
+    # ------------------------------------------------------------------
+    def record(
+        self,
+        model: str,
+        latency: float,
+        success: bool,
+        provider: Optional[str] = None,
+        tokens: int = 0
+    ):
+        """
+        Feed back one call outcome
+
+        Args:
+            model: Model that served the call
+            latency: Seconds
+            success: Whether the call returned a usable result
+            provider: Provider (used when the model wasn't registered)
+            tokens: Generated tokens (for throughput)
+        """
+        now = self._clock()
+        with self._lock:
+            arm = self.arms.get(model)
+            if arm is None:
+                arm = self.arms[model] = ModelArm(model, provider or 'unknown', updated_at=now)
+            good, bad = self._decayed(arm, now)
+            within_slo = latency <= self.latency_slo
+            arm.good = good * self.discount + (1.0 if success and within_slo else 0.0)
+            arm.bad = bad * self.discount + (0.0 if success and within_slo else 1.0)
+            arm.updated_at = now
+            arm.requests += 1
+            if not success:
+                arm.errors += 1
+            elif not within_slo:
+                arm.slo_misses += 1
+            if success and tokens and latency > 0:
+                tps = tokens / latency
+                arm.tokens_per_second = tps if not arm.tokens_per_second else 0.8 * arm.tokens_per_second + 0.2 * tps
+        if success:
+            arm.latency.add(latency)
+
+    def latency_quantile(self, model: str, q: float, default: Optional[float] = None) -> Optional[float]:
+        """Observed latency quantile for a model (default when no samples)"""
+        arm = self.arms.get(model)
+        if arm is None:
+            return default
+        snapshot = arm.latency.snapshot()
+        if snapshot.count == 0:
+            return default
+        return snapshot.quantile(q)
+
+    # ------------------------------------------------------------------
+    # Legacy API / reporting
+    # ------------------------------------------------------------------
     def select_model(self, message, app_type, tools):
         """Select the best model for the request"""
-        pass
+        tools = tools or []
+        if 'code' in tools:
+            context = 'code'
+        elif 'think' in tools or 'deepthink' in tools:
+            context = 'reasoning'
+        elif len(message or '') // 4 > 4000:
+            context = 'long_context'
+        else:
+            context = 'chat'
+        return self.select(context, estimated_tokens=len(message or '') // 4)
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Per-model health and routing distribution"""
+        now = self._clock()
+        models = {}
+        for name, arm in list(self.arms.items()):
+            good, bad = self._decayed(arm, now)
+            snapshot = arm.latency.snapshot()
+            models[name] = {
+                'provider': arm.provider,
+                'requests': arm.requests,
+                'error_rate': arm.errors / arm.requests if arm.requests else 0.0,
+                'slo_miss_rate': arm.slo_misses / arm.requests if arm.requests else 0.0,
+                'recent_good_probability': (good + 1.0) / (good + bad + 2.0),
+                'latency_p50': snapshot.quantile(0.5),
+                'latency_p90': snapshot.quantile(0.9),
+                'latency_p99': snapshot.quantile(0.99),
+                'tokens_per_second': arm.tokens_per_second,
+                'cost_per_1k_tokens': arm.cost_per_1k_tokens
+            }
+        with self._lock:
+            by_context = {c: dict(v) for c, v in self.stats['selections_by_context'].items()}
+        return {
+            'latency_slo': self.latency_slo,
+            'cost_budget': self.cost_budget,
+            'selections': self.stats['selections'],
+            'fallback_selections': self.stats['fallback_selections'],
+            'explorations': self.stats['explorations'],
+            'degraded_selections': self.stats['degraded_selections'],
+            'selections_by_context': by_context,
+            'models': models
+        }
+
+
+# Shared router (brain and API wrapper feed and read the same evidence)
+model_router = ModelRouter()
+
+
+# Example usage
+if __name__ == "__main__":
+    print("=" * 70)
+    print("MODEL ROUTER - Adaptive Routing Under a Latency SLO")
+    print("=" * 70)
+
+    fake_now = [0.0]
+    router = ModelRouter(latency_slo=2.0, seed=7, clock=lambda: fake_now[0])
+
+    def simulate(rounds: int, degraded: bool) -> Dict[str, int]:
+        picks = {}
+        for _ in range(rounds):
+            model = router.select('code', estimated_tokens=300)
+            picks[model] = picks.get(model, 0) + 1
+            if model == 'deepseek-coder' and degraded:
+                router.record(model, random.uniform(4.0, 9.0), random.random() > 0.3, tokens=200)
+            else:
+                router.record(model, random.uniform(0.5, 1.5), True, tokens=200)
+        return picks
+
+    print(f"\nHealthy provider:  {simulate(200, degraded=False)}")
+    print(f"Degraded provider: {simulate(200, degraded=True)}")
+    fake_now[0] += 900  # 15 minutes later: stale evidence has aged out
+    print(f"Recovered:         {simulate(200, degraded=False)}")
+
+    stats = router.get_stats()['models']
+    for name in ('deepseek-coder', 'qwen-4b'):
+        s = stats[name]
+        print(f"\n{name}: requests={s['requests']} errors={s['error_rate']:.1%} "
+              f"slo_miss={s['slo_miss_rate']:.1%} p90={s['latency_p90']:.2f}s "
+              f"tps={s['tokens_per_second']:.0f}")
+
+    print("\n" + "=" * 70)
@@ -14,11 +14,37 @@ But: prompt → internal reasoning → concepts → synthesis → response
 """
 
 import numpy as np
-from typing import List, Dict, Any, Optional, Tuple
+from typing import List, Dict, Any, Callable, Optional, Tuple
 from dataclasses import dataclass, field
 from datetime import datetime
 import asyncio
-from sentence_transformers import SentenceTransformer
+
+# Shared embedding model (loaded once per process, cached, micro-batched)
+try:
+    from companion_baas.optimization.embedding_service import get_embedding_service
+except ImportError:
+    from optimization.embedding_service import get_embedding_service
+
+# Rendered system prefixes (shared with the provider clients' reuse accounting)
+try:
+    from companion_baas.optimization.prompt_cache import prompt_cache
+except ImportError:
+    from optimization.prompt_cache import prompt_cache
+
+
+def _render_reasoning_system(stage: str) -> str:
+    """Static instructions for a chain-of-thought stage (sent as the system prefix)"""
+    prompt = "You are the reasoning core of Companion AI. Work through problems carefully and state assumptions."
+    if stage == 'step':
+        prompt += " Given the previous steps, produce the next reasoning step and end with a one-sentence conclusion."
+    else:
+        prompt += " Combine the reasoning steps into a clear, direct final answer to the original question."
+    return prompt
+
+
+def reasoning_system_prompt(stage: str) -> str:
+    """System prefix for a reasoning stage, rendered once per stage"""
+    return prompt_cache.get(('reasoning_system', stage), lambda: _render_reasoning_system(stage))
 
 
 @dataclass
@@ -57,13 +83,12 @@ class ThoughtSpace:
     """
     
     def __init__(self, model_name: str = 'all-MiniLM-L6-v2'):
-        try:
-            self.model = SentenceTransformer(model_name)
-            self.enabled = True
-        except Exception as e:
-            print(f"⚠️ ThoughtSpace: sentence-transformers not available: {e}")
-            self.enabled = False
-            self.model = None
+        self.model_name = model_name
+        self.embedder = get_embedding_service(model_name)
+        self.model = self.embedder.load()
+        self.enabled = self.model is not None
+        if not self.enabled:
+            print("⚠️ ThoughtSpace: sentence-transformers not available")
         
         self.thought_history: List[ThoughtVector] = []
     
@@ -73,7 +98,9 @@ class ThoughtSpace:
             return None
         
         try:
-            vector = self.model.encode(text, convert_to_numpy=True)
+            vector = self.embedder.encode(text)
+            if vector is None:
+                return None
             thought = ThoughtVector(
                 content=text,
                 vector=vector,
@@ -102,7 +129,7 @@ class ThoughtSpace:
         return {
             'enabled': self.enabled,
             'total_thoughts': len(self.thought_history),
-            'model': 'all-MiniLM-L6-v2' if self.enabled else None
+            'model': self.model_name if self.enabled else None
         }
 
 
@@ -128,7 +155,8 @@ class ChainOfThought:
         self.local_intelligence = local_intelligence
         self.reasoning_chains: List[List[ReasoningStep]] = []
     
-    async def reason(self, query: str, max_steps: int = 5) -> List[ReasoningStep]:
+    async def reason(self, query: str, max_steps: int = 5,
+                     on_step: Optional[Callable[[int, str], Any]] = None) -> List[ReasoningStep]:
         """
         Perform multi-step reasoning on a query.
         
@@ -137,6 +165,11 @@ class ChainOfThought:
         2. Generate sub-questions
         3. Reason through each step
         4. Build towards conclusion
+        
+        Intermediate steps run speculatively when a local model is already
+        installed (local draft, cloud only when the draft fails its
+        self-consistency check) and on the cloud otherwise; on_step(step_number,
+        text) receives each step's local draft as soon as it is ready.
         """
         steps = []
         
@@ -144,7 +177,8 @@ class ChainOfThought:
         step1 = await self._generate_step(
             step_number=1,
             prompt=f"First, let me understand: {query}\n\nWhat is being asked here?",
-            previous_steps=[]
+            previous_steps=[],
+            on_step=on_step
         )
         steps.append(step1)
         
@@ -152,7 +186,8 @@ class ChainOfThought:
         step2 = await self._generate_step(
             step_number=2,
             prompt=f"Given: {step1.conclusion}\n\nWhat are the key sub-problems or aspects to address?",
-            previous_steps=steps
+            previous_steps=steps,
+            on_step=on_step
         )
         steps.append(step2)
         
@@ -161,7 +196,8 @@ class ChainOfThought:
             step = await self._generate_step(
                 step_number=i,
                 prompt=f"Building on: {step2.conclusion}\n\nLet me reason through this step by step...",
-                previous_steps=steps
+                previous_steps=steps,
+                on_step=on_step
             )
             steps.append(step)
             
@@ -177,7 +213,8 @@ class ChainOfThought:
         return steps
     
     async def _generate_step(self, step_number: int, prompt: str, 
-                            previous_steps: List[ReasoningStep]) -> ReasoningStep:
+                            previous_steps: List[ReasoningStep],
+                            on_step: Optional[Callable[[int, str], Any]] = None) -> ReasoningStep:
         """Generate a single reasoning step"""
         
         # Build context from previous steps
@@ -188,13 +225,15 @@ class ChainOfThought:
         
         full_prompt = f"{context}\n\n{prompt}"
         
-        # Get reasoning from model (prefer cloud for speed)
+        # Intermediate steps: fast local draft, escalated to cloud when unsure
         if self.local_intelligence:
             try:
                 result = await self.local_intelligence.think(
                     full_prompt,
                     task_type="reasoning",
-                    prefer_local=False  # Use cloud for faster responses
+                    system=reasoning_system_prompt('step'),
+                    speculative=True,
+                    on_draft=(lambda draft: on_step(step_number, draft)) if on_step else None
                 )
                 reasoning = result.get('response', '')[:500]  # Limit length
             except Exception as e:
@@ -250,7 +289,8 @@ class ChainOfThought:
                 result = await self.local_intelligence.think(
                     prompt,
                     task_type="reasoning",
-                    prefer_local=False  # Use cloud for faster responses
+                    prefer_local=False,  # Use cloud for faster responses
+                    system=reasoning_system_prompt('synthesis')
                 )
                 conclusion = result.get('response', '')
             except:
@@ -446,19 +486,20 @@ class NeuralReasoningEngine:
         
         self.reasoning_count = 0
     
-    async def reason(self, query: str, mode: str = "chain_of_thought") -> Dict[str, Any]:
+    async def reason(self, query: str, mode: str = "chain_of_thought",
+                     on_step: Optional[Callable[[int, str], Any]] = None) -> Dict[str, Any]:
         """
         Main reasoning interface.
         
         Modes:
-        - chain_of_thought: Multi-step reasoning
+        - chain_of_thought: Multi-step reasoning (on_step streams step drafts)
         - creative: Creative synthesis
         - conceptual: Concept-based reasoning
         """
         self.reasoning_count += 1
         
         if mode == "chain_of_thought":
-            steps = await self.chain_of_thought.reason(query)
+            steps = await self.chain_of_thought.reason(query, on_step=on_step)
             return {
                 'mode': 'chain_of_thought',
                 'steps': len(steps),
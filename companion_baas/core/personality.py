@@ -12,13 +12,21 @@ This module enables the brain to:
 Each brain instance becomes a unique individual!
 """
 
-import numpy as np
-from typing import Dict, Any, List, Optional, Tuple
-from dataclasses import dataclass, field
+import re
+import time
+import random
+from collections import ChainMap, deque
+from types import MappingProxyType
+from typing import Dict, Any, Iterable, Iterator, List, Optional, Tuple
 from datetime import datetime
 from enum import Enum
-import json
-import random
+
+try:
+    import numpy as np
+    HAS_NUMPY = True
+except ImportError:
+    np = None
+    HAS_NUMPY = False
 
 
 class Emotion(Enum):
@@ -35,69 +43,200 @@ class Emotion(Enum):
     ANALYTICAL = "analytical"
 
 
-@dataclass
+TRAIT_NAMES: Tuple[str, ...] = (
+    'curiosity', 'creativity', 'caution', 'empathy',
+    'humor', 'confidence', 'analytical', 'expressiveness'
+)
+TRAIT_INDEX: Dict[str, int] = {name: i for i, name in enumerate(TRAIT_NAMES)}
+
+
+def _vector(values: Iterable[float]):
+    """Trait vector: float64 numpy array, or a list when numpy is missing"""
+    if HAS_NUMPY:
+        return np.array(list(values), dtype=np.float64)
+    return [float(v) for v in values]
+
+
 class PersonalityTraits:
     """
     Core personality traits as vectors (0.0 to 1.0).
     These define the brain's character.
+
+    All traits live in one vector ordered like TRAIT_NAMES; the named
+    attributes read and write its slots. `version` changes on every
+    mutation so derived tables (emotion rules, suffix rules) know when
+    to rebuild. fork() shares the vector copy-on-write.
     """
-    curiosity: float = 0.7      # How eager to explore and learn
-    creativity: float = 0.8     # How imaginative and novel
-    caution: float = 0.5        # How careful and risk-averse
-    empathy: float = 0.6        # How emotionally aware
-    humor: float = 0.4          # How playful and funny
-    confidence: float = 0.7     # How self-assured
-    analytical: float = 0.8     # How logical and systematic
-    expressiveness: float = 0.6 # How emotionally expressive
-    
+    __slots__ = ('vector', 'version', '_owned')
+
+    def __init__(
+        self,
+        curiosity: float = 0.7,      # How eager to explore and learn
+        creativity: float = 0.8,     # How imaginative and novel
+        caution: float = 0.5,        # How careful and risk-averse
+        empathy: float = 0.6,        # How emotionally aware
+        humor: float = 0.4,          # How playful and funny
+        confidence: float = 0.7,     # How self-assured
+        analytical: float = 0.8,     # How logical and systematic
+        expressiveness: float = 0.6  # How emotionally expressive
+    ):
+        self.vector = _vector((curiosity, creativity, caution, empathy,
+                               humor, confidence, analytical, expressiveness))
+        self.version = 0
+        self._owned = True  # False while the vector may be shared with a fork
+
+    def __repr__(self) -> str:
+        fields = ", ".join(f"{name}={value!r}" for name, value in self.to_dict().items())
+        return f"PersonalityTraits({fields})"
+
+    def __eq__(self, other) -> bool:
+        if not isinstance(other, PersonalityTraits):
+            return NotImplemented
+        return self.to_dict() == other.to_dict()
+
     def to_dict(self) -> Dict[str, float]:
         """Convert to dictionary"""
-        return {
-            'curiosity': self.curiosity,
-            'creativity': self.creativity,
-            'caution': self.caution,
-            'empathy': self.empathy,
-            'humor': self.humor,
-            'confidence': self.confidence,
-            'analytical': self.analytical,
-            'expressiveness': self.expressiveness
-        }
-    
-    def to_vector(self) -> np.ndarray:
-        """Convert to numpy vector for mathematical operations"""
-        return np.array([
-            self.curiosity,
-            self.creativity,
-            self.caution,
-            self.empathy,
-            self.humor,
-            self.confidence,
-            self.analytical,
-            self.expressiveness
-        ])
-    
+        return dict(zip(TRAIT_NAMES, map(float, self.vector)))
+
+    def to_vector(self):
+        """Copy of the trait vector for mathematical operations"""
+        return _vector(self.vector)
+
     @classmethod
-    def from_vector(cls, vector: np.ndarray) -> 'PersonalityTraits':
-        """Create from numpy vector"""
-        return cls(
-            curiosity=float(vector[0]),
-            creativity=float(vector[1]),
-            caution=float(vector[2]),
-            empathy=float(vector[3]),
-            humor=float(vector[4]),
-            confidence=float(vector[5]),
-            analytical=float(vector[6]),
-            expressiveness=float(vector[7])
-        )
-    
+    def from_vector(cls, vector) -> 'PersonalityTraits':
+        """Create from a vector ordered like TRAIT_NAMES"""
+        return cls(*(float(v) for v in vector[:len(TRAIT_NAMES)]))
+
+    def fork(self) -> 'PersonalityTraits':
+        """
+        Copy-on-write clone: both sides share one vector until either
+        mutates, which then copies it first
+        """
+        child = PersonalityTraits.__new__(PersonalityTraits)
+        child.vector = self.vector
+        child.version = 0
+        child._owned = self._owned = False
+        return child
+
+    @property
+    def shared(self) -> bool:
+        """Whether the vector may still be shared with a fork"""
+        return not self._owned
+
+    def _own(self):
+        if not self._owned:
+            self.vector = _vector(self.vector)
+            self._owned = True
+
+    @staticmethod
+    def impact_vector(experience_impact: Dict[str, float]):
+        """Dense impact vector for a {trait: impact} dict (unknown traits ignored)"""
+        delta = [0.0] * len(TRAIT_NAMES)
+        for trait, impact in experience_impact.items():
+            index = TRAIT_INDEX.get(trait)
+            if index is not None:
+                delta[index] += impact
+        return _vector(delta)
+
     def evolve(self, experience_impact: Dict[str, float], learning_rate: float = 0.01):
         """Evolve traits based on experiences"""
-        for trait, impact in experience_impact.items():
-            if hasattr(self, trait):
-                current = getattr(self, trait)
-                # Apply learning with bounds [0, 1]
-                new_value = np.clip(current + learning_rate * impact, 0.0, 1.0)
-                setattr(self, trait, new_value)
+        self.evolve_vector(self.impact_vector(experience_impact), learning_rate)
+
+    def evolve_batch(self, experience_impacts: Iterable[Dict[str, float]], learning_rate: float = 0.01):
+        """
+        Evolve from many experiences with a single vector update
+
+        Impacts are summed, then applied and clipped once (same result as
+        applying them one by one unless a trait crosses a bound midway).
+        """
+        total = [0.0] * len(TRAIT_NAMES)
+        for experience_impact in experience_impacts:
+            for trait, impact in experience_impact.items():
+                index = TRAIT_INDEX.get(trait)
+                if index is not None:
+                    total[index] += impact
+        self.evolve_vector(_vector(total), learning_rate)
+
+    def evolve_vector(self, delta, learning_rate: float = 0.01):
+        """vector += learning_rate * delta, kept within [0, 1]"""
+        self._own()
+        if HAS_NUMPY:
+            self.vector += learning_rate * np.asarray(delta, dtype=np.float64)
+            np.clip(self.vector, 0.0, 1.0, out=self.vector)
+        else:
+            self.vector = [min(max(v + learning_rate * d, 0.0), 1.0) for v, d in zip(self.vector, delta)]
+        self.version += 1
+
+
+def _trait_property(index: int) -> property:
+    def get(self) -> float:
+        return float(self.vector[index])
+
+    def set(self, value: float):
+        self._own()
+        self.vector[index] = value
+        self.version += 1
+
+    return property(get, set)
+
+
+for _index, _name in enumerate(TRAIT_NAMES):
+    setattr(PersonalityTraits, _name, _trait_property(_index))
+
+
+# Keyword groups in priority order: the first group with any occurrence
+# (substring match on the lowercased text) decides the emotion.
+EMOTION_KEYWORD_GROUPS: Tuple[Tuple[str, ...], ...] = (
+    ('why', 'how', 'what', 'explain'),
+    ('problem', 'error', 'bug', 'issue'),
+    ('great', 'awesome', 'amazing', 'wow'),
+    ('help', 'support', 'feel', 'understand'),
+    ('fun', 'joke', 'play', 'haha'),
+    ('uncertain', 'maybe', 'not sure', 'unsure'),
+)
+_NO_KEYWORD = len(EMOTION_KEYWORD_GROUPS)
+
+# One compiled scanner for every keyword. The lookahead makes matches
+# zero-width, so overlapping keywords ("funderstand") are all seen; at a
+# given position the group listed first wins.
+_EMOTION_KEYWORDS = re.compile('(?=(?:' + '|'.join(
+    '(' + '|'.join(map(re.escape, words)) + ')' for words in EMOTION_KEYWORD_GROUPS
+) + '))')
+
+
+def match_keyword_group(text_lower: str) -> int:
+    """Index of the highest-priority keyword group in the text (len(groups) if none)"""
+    best = _NO_KEYWORD
+    for match in _EMOTION_KEYWORDS.finditer(text_lower):
+        group = match.lastindex - 1
+        if group < best:
+            best = group
+            if best == 0:
+                break
+    return best
+
+
+def _build_emotion_table(traits: PersonalityTraits) -> Tuple[Emotion, ...]:
+    """Emotion for each keyword group (plus the no-keyword default) given the traits"""
+    curiosity, analytical = traits.curiosity, traits.analytical
+    if curiosity > 0.7:
+        default = Emotion.CURIOUS
+    elif analytical > 0.7:
+        default = Emotion.ANALYTICAL
+    elif traits.empathy > 0.7:
+        default = Emotion.EMPATHETIC
+    else:
+        default = Emotion.NEUTRAL
+
+    return (
+        Emotion.CURIOUS if curiosity > 0.6 else Emotion.ANALYTICAL if analytical > 0.6 else Emotion.THOUGHTFUL,
+        Emotion.SERIOUS if traits.caution > 0.6 else Emotion.ANALYTICAL,
+        Emotion.EXCITED if traits.expressiveness > 0.5 else Emotion.CONFIDENT,
+        Emotion.EMPATHETIC if traits.empathy > 0.6 else Emotion.THOUGHTFUL,
+        Emotion.PLAYFUL if traits.humor > 0.5 else Emotion.NEUTRAL,
+        Emotion.UNCERTAIN,
+        default
+    )
 
 
 class EmotionalState:
@@ -106,19 +245,21 @@ class EmotionalState:
     Emotions influence response style and decisions.
     """
     
-    def __init__(self, default_emotion: Emotion = Emotion.NEUTRAL):
+    def __init__(self, default_emotion: Emotion = Emotion.NEUTRAL, history_size: int = 1000):
         self.current_emotion = default_emotion
         self.emotion_intensity = 0.5  # 0.0 to 1.0
-        self.emotion_history: List[Tuple[Emotion, float, float]] = []
+        self.emotion_history: "deque[Tuple[Emotion, float, float]]" = deque(maxlen=history_size)
         self.state_transitions = 0
+        self._table_key: Optional[Tuple[int, int]] = None
+        self._table: Tuple[Emotion, ...] = ()
     
     def set_emotion(self, emotion: Emotion, intensity: float = 0.5):
         """Set current emotional state"""
         self.emotion_history.append(
-            (self.current_emotion, self.emotion_intensity, datetime.now().timestamp())
+            (self.current_emotion, self.emotion_intensity, time.time())
         )
         self.current_emotion = emotion
-        self.emotion_intensity = np.clip(intensity, 0.0, 1.0)
+        self.emotion_intensity = min(max(float(intensity), 0.0), 1.0)
         self.state_transitions += 1
     
     def infer_emotion_from_context(self, context: str, traits: PersonalityTraits) -> Emotion:
@@ -126,54 +267,12 @@ class EmotionalState:
         Infer appropriate emotion based on context and personality.
         More curious brains get CURIOUS, more analytical get ANALYTICAL, etc.
         """
-        context_lower = context.lower()
-        
-        # Pattern matching with personality influence
-        if any(word in context_lower for word in ['why', 'how', 'what', 'explain']):
-            if traits.curiosity > 0.6:
-                return Emotion.CURIOUS
-            elif traits.analytical > 0.6:
-                return Emotion.ANALYTICAL
-            else:
-                return Emotion.THOUGHTFUL
-        
-        elif any(word in context_lower for word in ['problem', 'error', 'bug', 'issue']):
-            if traits.caution > 0.6:
-                return Emotion.SERIOUS
-            else:
-                return Emotion.ANALYTICAL
-        
-        elif any(word in context_lower for word in ['great', 'awesome', 'amazing', 'wow']):
-            if traits.expressiveness > 0.5:
-                return Emotion.EXCITED
-            else:
-                return Emotion.CONFIDENT
-        
-        elif any(word in context_lower for word in ['help', 'support', 'feel', 'understand']):
-            if traits.empathy > 0.6:
-                return Emotion.EMPATHETIC
-            else:
-                return Emotion.THOUGHTFUL
-        
-        elif any(word in context_lower for word in ['fun', 'joke', 'play', 'haha']):
-            if traits.humor > 0.5:
-                return Emotion.PLAYFUL
-            else:
-                return Emotion.NEUTRAL
-        
-        elif any(word in context_lower for word in ['uncertain', 'maybe', 'not sure', 'unsure']):
-            return Emotion.UNCERTAIN
-        
-        else:
-            # Default based on dominant trait
-            if traits.curiosity > 0.7:
-                return Emotion.CURIOUS
-            elif traits.analytical > 0.7:
-                return Emotion.ANALYTICAL
-            elif traits.empathy > 0.7:
-                return Emotion.EMPATHETIC
-            else:
-                return Emotion.NEUTRAL
+        # Trait thresholds only change when the traits do
+        key = (id(traits), traits.version)
+        if key != self._table_key:
+            self._table = _build_emotion_table(traits)
+            self._table_key = key
+        return self._table[match_keyword_group(context.lower())]
     
     def get_stats(self) -> Dict[str, Any]:
         """Get emotional state statistics"""
@@ -185,15 +284,170 @@ class EmotionalState:
         }
 
 
+EMOTIONAL_PREFIXES: Dict[Emotion, Tuple[str, ...]] = {
+    Emotion.CURIOUS: (
+        "Interesting question!",
+        "That's fascinating!",
+        "Great question!",
+        "I'm intrigued by this!"
+    ),
+    Emotion.EXCITED: (
+        "Wow, this is exciting!",
+        "I love this topic!",
+        "Great to explore this!",
+        "This is really cool!"
+    ),
+    Emotion.THOUGHTFUL: (
+        "Let me think about this carefully...",
+        "This requires some thought...",
+        "Hmm, interesting consideration...",
+        "Let's think through this..."
+    ),
+    Emotion.CONFIDENT: (
+        "I can definitely help with this!",
+        "Here's what I know:",
+        "I'm confident about this:",
+        "Let me explain clearly:"
+    ),
+    Emotion.UNCERTAIN: (
+        "I'm not entirely sure, but...",
+        "This is a bit complex...",
+        "Let me try to help, though I'm uncertain:",
+        "I'll do my best here..."
+    ),
+    Emotion.PLAYFUL: (
+        "Fun question!",
+        "Let's have some fun with this!",
+        "This should be interesting!",
+        "Ooh, I like this!"
+    ),
+    Emotion.EMPATHETIC: (
+        "I understand where you're coming from.",
+        "I can see why this matters to you.",
+        "Let me help you with this.",
+        "I hear you, and here's my take:"
+    ),
+    Emotion.ANALYTICAL: (
+        "Let's break this down systematically:",
+        "Analyzing this carefully:",
+        "From a logical perspective:",
+        "Let me examine this methodically:"
+    )
+}
+
+# (trait, threshold, probability, closings), checked in this order
+PERSONALITY_SUFFIXES: Tuple[Tuple[str, float, float, Tuple[str, ...]], ...] = (
+    # Curiosity: Add follow-up question
+    ('curiosity', 0.7, 0.4, (
+        "What aspects would you like to explore further?",
+        "Does this spark any other questions?",
+        "Would you like to dive deeper into any part?",
+        "Curious about anything else related to this?"
+    )),
+    # Empathy: Add supportive statement
+    ('empathy', 0.7, 0.3, (
+        "Hope this helps!",
+        "Let me know if you need more clarity.",
+        "Feel free to ask if you need more details!",
+        "I'm here if you have more questions!"
+    )),
+    # Caution: Add disclaimer
+    ('caution', 0.7, 0.3, (
+        "Please verify this for your specific case.",
+        "Consider double-checking for your context.",
+        "This is my understanding, but always verify!",
+        "Use this as a starting point and validate further."
+    )),
+    # Humor: Add light touch
+    ('humor', 0.6, 0.2, (
+        "😊",
+        "(Hope that made sense!)",
+        "Fun stuff, right?",
+        "Pretty neat, if you ask me!"
+    )),
+)
+
+INTENSITY_BUCKETS = 10
+PREFIX_MIN_INTENSITY = 0.3  # Low intensity, no prefix
+PREFIX_MIN_LENGTH = 50      # Only for substantial responses
+SUFFIX_MIN_LENGTH = 100
+
+# Prefix templates per (emotion, intensity bucket), separator included
+_PREFIX_TABLE: Dict[Tuple[Emotion, int], Tuple[str, ...]] = {
+    (emotion, bucket): (
+        tuple(f"{prefix} " for prefix in EMOTIONAL_PREFIXES.get(emotion, ()))
+        if bucket >= PREFIX_MIN_INTENSITY * INTENSITY_BUCKETS else ()
+    )
+    for emotion in Emotion
+    for bucket in range(INTENSITY_BUCKETS + 1)
+}
+
+
+def _intensity_bucket(intensity: float) -> int:
+    if intensity < PREFIX_MIN_INTENSITY:
+        return 0
+    return min(max(int(intensity * INTENSITY_BUCKETS), 0), INTENSITY_BUCKETS)
+
+
+class _FormalityRewriter:
+    """Single-pass phrase substitution (contractions in or out)"""
+
+    def __init__(self, replacements: Dict[str, str]):
+        self.replacements = replacements
+        self.pattern = re.compile('|'.join(map(re.escape, replacements)))
+        # Chars that must stay buffered while streaming so no phrase is split
+        self.holdback = max(map(len, replacements)) - 1
+
+    def sub(self, text: str) -> str:
+        return self.pattern.sub(self._replace, text)
+
+    def _replace(self, match) -> str:
+        return self.replacements[match.group(0)]
+
+    def sub_partial(self, text: str) -> Tuple[str, str]:
+        """
+        Rewrite the part of an unfinished text that later input can't change
+
+        Returns:
+            (rewritten head, raw tail to prepend to the next chunk)
+        """
+        cut = len(text) - self.holdback
+        if cut <= 0:
+            return "", text
+        # A phrase starting before the cut lies entirely within text
+        for match in self.pattern.finditer(text):
+            if match.start() >= cut:
+                break
+            cut = max(cut, match.end())
+        return self.sub(text[:cut]), text[cut:]
+
+
+_CASUAL = _FormalityRewriter({"do not": "don't", "cannot": "can't", "will not": "won't"})
+_FORMAL = _FormalityRewriter({"don't": "do not", "can't": "cannot", "won't": "will not"})
+
+
+def _formality_rewriter(formality_level: float) -> Optional[_FormalityRewriter]:
+    if formality_level < 0.3:
+        return _CASUAL
+    if formality_level > 0.7:
+        return _FORMAL
+    return None
+
+
 class ResponseStyler:
     """
     Adapts response style based on personality and emotion.
     Makes each brain sound unique!
+
+    Prefix templates are precomputed per (emotion, intensity bucket) and
+    the trait-dependent suffix rules are rebuilt only when traits change.
     """
     
     def __init__(self, traits: PersonalityTraits, emotional_state: EmotionalState):
         self.traits = traits
         self.emotional_state = emotional_state
+        self._suffix_key: Optional[Tuple[int, int]] = None
+        self._suffix_rules: List[Tuple[float, Tuple[str, ...]]] = []
     
     def style_response(self, raw_response: str) -> str:
         """
@@ -209,121 +463,62 @@ class ResponseStyler:
         """
         
         styled = raw_response
-        emotion = self.emotional_state.current_emotion
-        intensity = self.emotional_state.emotion_intensity
         
         # Add emotional prefix based on state
-        prefix = self._get_emotional_prefix(emotion, intensity)
-        if prefix and len(styled) > 50:  # Only for substantial responses
-            styled = f"{prefix} {styled}"
+        prefix = self._pick_prefix()
+        if prefix and len(styled) > PREFIX_MIN_LENGTH:
+            styled = prefix + styled
         
         # Add personality-driven suffix
         suffix = self._get_personality_suffix()
-        if suffix and len(styled) > 100:
+        if suffix and len(styled) > SUFFIX_MIN_LENGTH:
             styled = f"{styled}\n\n{suffix}"
         
         return styled
     
+    def stream(self, formality_level: float = 0.5) -> 'StyledStream':
+        """Incremental styler for a reply that arrives in chunks"""
+        return StyledStream(self._pick_prefix(), self._get_personality_suffix(),
+                            _formality_rewriter(formality_level))
+    
+    def style_stream(self, chunks: Iterable[str], formality_level: float = 0.5) -> Iterator[str]:
+        """Style a chunked reply, yielding styled text as soon as it is final"""
+        stream = self.stream(formality_level)
+        for chunk in chunks:
+            styled = stream.feed(chunk)
+            if styled:
+                yield styled
+        tail = stream.close()
+        if tail:
+            yield tail
+    
+    def _pick_prefix(self) -> str:
+        """Opening for the current emotional state, separator included"""
+        state = self.emotional_state
+        templates = _PREFIX_TABLE.get(
+            (state.current_emotion, _intensity_bucket(state.emotion_intensity)), ()
+        )
+        return random.choice(templates) if templates else ""
+    
     def _get_emotional_prefix(self, emotion: Emotion, intensity: float) -> str:
         """Get opening based on emotional state"""
-        if intensity < 0.3:
-            return ""  # Low intensity, no prefix
-        
-        prefixes = {
-            Emotion.CURIOUS: [
-                "Interesting question!",
-                "That's fascinating!",
-                "Great question!",
-                "I'm intrigued by this!"
-            ],
-            Emotion.EXCITED: [
-                "Wow, this is exciting!",
-                "I love this topic!",
-                "Great to explore this!",
-                "This is really cool!"
-            ],
-            Emotion.THOUGHTFUL: [
-                "Let me think about this carefully...",
-                "This requires some thought...",
-                "Hmm, interesting consideration...",
-                "Let's think through this..."
-            ],
-            Emotion.CONFIDENT: [
-                "I can definitely help with this!",
-                "Here's what I know:",
-                "I'm confident about this:",
-                "Let me explain clearly:"
-            ],
-            Emotion.UNCERTAIN: [
-                "I'm not entirely sure, but...",
-                "This is a bit complex...",
-                "Let me try to help, though I'm uncertain:",
-                "I'll do my best here..."
-            ],
-            Emotion.PLAYFUL: [
-                "Fun question!",
-                "Let's have some fun with this!",
-                "This should be interesting!",
-                "Ooh, I like this!"
-            ],
-            Emotion.EMPATHETIC: [
-                "I understand where you're coming from.",
-                "I can see why this matters to you.",
-                "Let me help you with this.",
-                "I hear you, and here's my take:"
-            ],
-            Emotion.ANALYTICAL: [
-                "Let's break this down systematically:",
-                "Analyzing this carefully:",
-                "From a logical perspective:",
-                "Let me examine this methodically:"
-            ]
-        }
-        
-        if emotion in prefixes:
-            return random.choice(prefixes[emotion])
-        return ""
+        templates = _PREFIX_TABLE.get((emotion, _intensity_bucket(intensity)), ())
+        return random.choice(templates)[:-1] if templates else ""
     
     def _get_personality_suffix(self) -> str:
         """Get closing based on personality traits"""
-        suffixes = []
-        
-        # Curiosity: Add follow-up question
-        if self.traits.curiosity > 0.7 and random.random() < 0.4:
-            suffixes.append(random.choice([
-                "What aspects would you like to explore further?",
-                "Does this spark any other questions?",
-                "Would you like to dive deeper into any part?",
-                "Curious about anything else related to this?"
-            ]))
-        
-        # Empathy: Add supportive statement
-        if self.traits.empathy > 0.7 and random.random() < 0.3:
-            suffixes.append(random.choice([
-                "Hope this helps!",
-                "Let me know if you need more clarity.",
-                "Feel free to ask if you need more details!",
-                "I'm here if you have more questions!"
-            ]))
-        
-        # Caution: Add disclaimer
-        if self.traits.caution > 0.7 and random.random() < 0.3:
-            suffixes.append(random.choice([
-                "Please verify this for your specific case.",
-                "Consider double-checking for your context.",
-                "This is my understanding, but always verify!",
-                "Use this as a starting point and validate further."
-            ]))
-        
-        # Humor: Add light touch
-        if self.traits.humor > 0.6 and random.random() < 0.2:
-            suffixes.append(random.choice([
-                "😊",
-                "(Hope that made sense!)",
-                "Fun stuff, right?",
-                "Pretty neat, if you ask me!"
-            ]))
+        key = (id(self.traits), self.traits.version)
+        if key != self._suffix_key:
+            traits = self.traits
+            self._suffix_rules = [
+                (probability, closings)
+                for trait, threshold, probability, closings in PERSONALITY_SUFFIXES
+                if getattr(traits, trait) > threshold
+            ]
+            self._suffix_key = key
         
+        suffixes = [random.choice(closings) for probability, closings in self._suffix_rules
+                    if random.random() < probability]
         return " ".join(suffixes)
     
     def adjust_formality(self, response: str, formality_level: float) -> str:
@@ -332,18 +527,68 @@ class ResponseStyler:
         formality_level: 0.0 (casual) to 1.0 (formal)
         """
         # Simplified: This would use NLP in production
-        if formality_level < 0.3:
-            # Make casual
-            response = response.replace("do not", "don't")
-            response = response.replace("cannot", "can't")
-            response = response.replace("will not", "won't")
-        elif formality_level > 0.7:
-            # Make formal
-            response = response.replace("don't", "do not")
-            response = response.replace("can't", "cannot")
-            response = response.replace("won't", "will not")
-        
-        return response
+        rewriter = _formality_rewriter(formality_level)
+        return rewriter.sub(response) if rewriter else response
+
+
+class StyledStream:
+    """
+    Applies personality styling to a reply chunk by chunk
+
+    Output joined together equals style_response() followed by
+    adjust_formality() on the whole reply. Prefix and suffix are chosen
+    up front; the prefix is emitted once the reply is long enough to get
+    one (the first ~50 characters are held until then), the suffix on
+    close(). A few trailing characters are held back between chunks so a
+    phrase rewritten for formality is never split.
+    """
+
+    def __init__(self, prefix: str, suffix: str, rewriter: Optional[_FormalityRewriter] = None):
+        self.prefix = prefix
+        self.suffix = suffix
+        self._rewriter = rewriter
+        self._held: List[str] = []   # raw text before the prefix decision
+        self._raw_length = 0
+        self._decided = not prefix   # no prefix -> nothing to wait for
+        self._prefixed = False
+        self._tail = ""              # text awaiting formality rewrite
+        self.closed = False
+
+    def feed(self, chunk: str) -> str:
+        """Add a chunk; returns styled text that is ready to send (may be empty)"""
+        if self.closed:
+            raise ValueError("stream already closed")
+        self._raw_length += len(chunk)
+        if not self._decided:
+            self._held.append(chunk)
+            if self._raw_length <= PREFIX_MIN_LENGTH:
+                return ""
+            self._decided = self._prefixed = True
+            chunk = self.prefix + "".join(self._held)
+            self._held = []
+        return self._emit(chunk, final=False)
+
+    def close(self) -> str:
+        """Finish the reply; returns the remaining styled text"""
+        if self.closed:
+            return ""
+        self.closed = True
+        text = "".join(self._held)
+        self._held = []
+        length = self._raw_length + (len(self.prefix) if self._prefixed else 0)
+        if self.suffix and length > SUFFIX_MIN_LENGTH:
+            text = f"{text}\n\n{self.suffix}"
+        return self._emit(text, final=True)
+
+    def _emit(self, text: str, final: bool) -> str:
+        if self._rewriter is None:
+            return text
+        text = self._tail + text
+        if final:
+            self._tail = ""
+            return self._rewriter.sub(text)
+        styled, self._tail = self._rewriter.sub_partial(text)
+        return styled
 
 
 class VoiceEvolution:
@@ -363,6 +608,23 @@ class VoiceEvolution:
         }
         self.vocabulary_growth: List[str] = []
         self.signature_phrases: List[str] = []
+        self._frozen_preferences: Optional[MappingProxyType] = None
+    
+    def fork(self) -> 'VoiceEvolution':
+        """
+        Child voice that starts from this one's current style preferences
+
+        Preferences are a ChainMap: the child writes only its own changes,
+        reads fall through to a read-only snapshot shared by all forks.
+        Topics and interaction counts start fresh.
+        """
+        prefs = dict(self.style_preferences)
+        if self._frozen_preferences is None or self._frozen_preferences != prefs:
+            self._frozen_preferences = MappingProxyType(prefs)
+        child = VoiceEvolution()
+        child.style_preferences = ChainMap({}, self._frozen_preferences)
+        child.signature_phrases = list(self.signature_phrases)
+        return child
     
     def record_interaction(self, topic: str, user_feedback: Optional[str] = None):
         """Record an interaction and adapt"""
@@ -373,21 +635,21 @@ class VoiceEvolution:
         
         # Evolve style based on feedback (simplified)
         if user_feedback:
-            if 'more detail' in user_feedback.lower():
-                self.style_preferences['conciseness'] -= 0.02
-            elif 'too long' in user_feedback.lower():
-                self.style_preferences['conciseness'] += 0.02
+            feedback_lower = user_feedback.lower()
+            if 'more detail' in feedback_lower:
+                self._nudge('conciseness', -0.02)
+            elif 'too long' in feedback_lower:
+                self._nudge('conciseness', 0.02)
             
-            if 'simpler' in user_feedback.lower():
-                self.style_preferences['technicality'] -= 0.02
-            elif 'more technical' in user_feedback.lower():
-                self.style_preferences['technicality'] += 0.02
-        
-        # Keep preferences in bounds
-        for key in self.style_preferences:
-            self.style_preferences[key] = np.clip(
-                self.style_preferences[key], 0.0, 1.0
-            )
+            if 'simpler' in feedback_lower:
+                self._nudge('technicality', -0.02)
+            elif 'more technical' in feedback_lower:
+                self._nudge('technicality', 0.02)
+    
+    def _nudge(self, preference: str, delta: float):
+        """Shift a style preference, keeping it in bounds"""
+        value = self.style_preferences[preference] + delta
+        self.style_preferences[preference] = min(max(value, 0.0), 1.0)
     
     def develop_signature_phrase(self, phrase: str):
         """Add a signature phrase to the brain's vocabulary"""
@@ -398,13 +660,13 @@ class VoiceEvolution:
     
     def get_preferred_style(self) -> Dict[str, float]:
         """Get current style preferences"""
-        return self.style_preferences.copy()
+        return dict(self.style_preferences)
     
     def get_stats(self) -> Dict[str, Any]:
         """Get voice evolution statistics"""
         return {
             'interaction_count': self.interaction_count,
-            'style_preferences': self.style_preferences,
+            'style_preferences': dict(self.style_preferences),
             'signature_phrases': self.signature_phrases,
             'top_topics': sorted(
                 self.topic_preferences.items(),
@@ -414,10 +676,30 @@ class VoiceEvolution:
         }
 
 
+_STOP_WORDS = frozenset({'the', 'a', 'an', 'and', 'or', 'but', 'in', 'on', 'at', 'to', 'for'})
+
+# Feedback keyword groups -> trait they reinforce
+FEEDBACK_TRAIT_KEYWORDS: Tuple[Tuple[str, Tuple[str, ...]], ...] = (
+    ('creativity', ('creative', 'innovative')),
+    ('caution', ('careful', 'thorough')),
+    ('humor', ('funny', 'humor')),
+    ('empathy', ('understanding', 'empathetic')),
+)
+FEEDBACK_IMPACT = 0.05
+_FEEDBACK_KEYWORDS = re.compile('(?=(?:' + '|'.join(
+    '(' + '|'.join(map(re.escape, words)) + ')' for _, words in FEEDBACK_TRAIT_KEYWORDS
+) + '))')
+
+
 class PersonalityEngine:
     """
     Main orchestrator for personality development.
     Combines all personality components into a unified system.
+
+    Per-request work is a keyword scan of the query, a few table lookups
+    and one vector update when feedback is given; replies can be styled
+    whole (process_interaction) or chunk by chunk (begin_stream /
+    stream_interaction).
     """
     
     def __init__(self, traits: Optional[PersonalityTraits] = None):
@@ -433,19 +715,42 @@ class PersonalityEngine:
         self.personality_id = self._generate_personality_id()
         self.created_at = datetime.now().timestamp()
     
+    def fork(self, history_size: int = 100) -> 'PersonalityEngine':
+        """
+        Copy-on-write child engine (e.g. one per user or tenant)
+
+        Same character and personality_id; traits and style preferences
+        are shared with this engine until the child evolves its own.
+        Emotional state and interaction history start fresh.
+
+        Args:
+            history_size: Emotion transitions the child keeps
+        """
+        child = PersonalityEngine(self.traits.fork())
+        child.emotional_state.emotion_history = deque(maxlen=history_size)
+        child.voice_evolution = self.voice_evolution.fork()
+        child.personality_id = self.personality_id
+        return child
+    
     def _generate_unique_personality(self) -> PersonalityTraits:
         """Generate a unique, balanced personality"""
-        # Random but within reasonable ranges
-        return PersonalityTraits(
-            curiosity=np.clip(np.random.normal(0.7, 0.15), 0.3, 1.0),
-            creativity=np.clip(np.random.normal(0.7, 0.15), 0.3, 1.0),
-            caution=np.clip(np.random.normal(0.5, 0.15), 0.2, 0.9),
-            empathy=np.clip(np.random.normal(0.6, 0.15), 0.3, 1.0),
-            humor=np.clip(np.random.normal(0.5, 0.2), 0.2, 0.9),
-            confidence=np.clip(np.random.normal(0.7, 0.15), 0.4, 1.0),
-            analytical=np.clip(np.random.normal(0.75, 0.15), 0.4, 1.0),
-            expressiveness=np.clip(np.random.normal(0.6, 0.15), 0.3, 0.9)
+        # Random but within reasonable ranges: (mean, std, low, high) per trait
+        ranges = (
+            (0.7, 0.15, 0.3, 1.0),   # curiosity
+            (0.7, 0.15, 0.3, 1.0),   # creativity
+            (0.5, 0.15, 0.2, 0.9),   # caution
+            (0.6, 0.15, 0.3, 1.0),   # empathy
+            (0.5, 0.2, 0.2, 0.9),    # humor
+            (0.7, 0.15, 0.4, 1.0),   # confidence
+            (0.75, 0.15, 0.4, 1.0),  # analytical
+            (0.6, 0.15, 0.3, 0.9),   # expressiveness
         )
+        if HAS_NUMPY:
+            means, stds, lows, highs = (np.array(column) for column in zip(*ranges))
+            return PersonalityTraits.from_vector(np.clip(np.random.normal(means, stds), lows, highs))
+        return PersonalityTraits.from_vector([
+            min(max(random.gauss(mean, std), low), high) for mean, std, low, high in ranges
+        ])
     
     def _generate_personality_id(self) -> str:
         """Generate unique ID for this personality"""
@@ -465,74 +770,79 @@ class PersonalityEngine:
         4. Return personality-infused response
         """
         
-        # Infer and set emotional state
-        emotion = self.emotional_state.infer_emotion_from_context(query, self.traits)
-        intensity = self._calculate_emotion_intensity(query)
-        self.emotional_state.set_emotion(emotion, intensity)
-        
-        # Style the response
+        # Infer emotion, style the response, apply voice preferences
+        self._set_emotion_from_query(query)
         styled_response = self.response_styler.style_response(raw_response)
-        
-        # Apply voice preferences
-        style_prefs = self.voice_evolution.get_preferred_style()
         styled_response = self.response_styler.adjust_formality(
             styled_response,
-            style_prefs['formality']
+            self.voice_evolution.style_preferences['formality']
         )
         
-        # Record interaction
-        topic = self._extract_topic(query)
-        self.voice_evolution.record_interaction(topic, feedback)
+        # Record interaction and evolve personality
+        self._record_interaction(query, feedback)
         
-        # Evolve personality based on interaction
+        return styled_response
+    
+    def begin_stream(self, query: str, feedback: Optional[str] = None) -> StyledStream:
+        """
+        Start styling a streamed reply to query
+
+        Emotion, prefix and suffix are decided now; feed() each generated
+        chunk and send what it returns, then send close().
+        """
+        self._set_emotion_from_query(query)
+        stream = self.response_styler.stream(self.voice_evolution.style_preferences['formality'])
+        self._record_interaction(query, feedback)
+        return stream
+    
+    def stream_interaction(self, query: str, chunks: Iterable[str],
+                           feedback: Optional[str] = None) -> Iterator[str]:
+        """process_interaction() for a reply produced as a stream of chunks"""
+        stream = self.begin_stream(query, feedback)
+        for chunk in chunks:
+            styled = stream.feed(chunk)
+            if styled:
+                yield styled
+        tail = stream.close()
+        if tail:
+            yield tail
+    
+    def _set_emotion_from_query(self, query: str):
+        emotion = self.emotional_state.infer_emotion_from_context(query, self.traits)
+        self.emotional_state.set_emotion(emotion, self._calculate_emotion_intensity(query))
+    
+    def _record_interaction(self, query: str, feedback: Optional[str]):
+        self.voice_evolution.record_interaction(self._extract_topic(query), feedback)
         if feedback:
             self._evolve_from_feedback(feedback)
-        
-        return styled_response
     
     def _calculate_emotion_intensity(self, text: str) -> float:
         """Calculate emotional intensity from text"""
         # Simple heuristic: punctuation and capitalization
         exclamations = text.count('!')
         questions = text.count('?')
-        caps_ratio = sum(1 for c in text if c.isupper()) / max(len(text), 1)
+        caps_ratio = sum(map(str.isupper, text)) / max(len(text), 1)
         
         intensity = 0.5  # Base
         intensity += min(exclamations * 0.1, 0.3)
         intensity += min(questions * 0.05, 0.2)
         intensity += min(caps_ratio * 0.5, 0.3)
         
-        return np.clip(intensity, 0.0, 1.0)
+        return min(max(intensity, 0.0), 1.0)
     
     def _extract_topic(self, text: str) -> str:
         """Extract main topic from text (simplified)"""
         # In production, use NLP/topic modeling
-        words = text.lower().split()
-        # Filter common words
-        stop_words = {'the', 'a', 'an', 'and', 'or', 'but', 'in', 'on', 'at', 'to', 'for'}
-        keywords = [w for w in words if w not in stop_words and len(w) > 3]
-        return keywords[0] if keywords else 'general'
+        return next(
+            (w for w in text.lower().split() if len(w) > 3 and w not in _STOP_WORDS),
+            'general'
+        )
     
     def _evolve_from_feedback(self, feedback: str):
         """Evolve personality traits based on feedback"""
-        feedback_lower = feedback.lower()
-        
-        experience_impact = {}
-        
-        if 'creative' in feedback_lower or 'innovative' in feedback_lower:
-            experience_impact['creativity'] = 0.05
-        
-        if 'careful' in feedback_lower or 'thorough' in feedback_lower:
-            experience_impact['caution'] = 0.05
-        
-        if 'funny' in feedback_lower or 'humor' in feedback_lower:
-            experience_impact['humor'] = 0.05
-        
-        if 'understanding' in feedback_lower or 'empathetic' in feedback_lower:
-            experience_impact['empathy'] = 0.05
-        
-        if experience_impact:
-            self.traits.evolve(experience_impact)
+        matched = {match.lastindex - 1 for match in _FEEDBACK_KEYWORDS.finditer(feedback.lower())}
+        if matched:
+            self.traits.evolve({FEEDBACK_TRAIT_KEYWORDS[group][0]: FEEDBACK_IMPACT for group in matched})
     
     def get_personality_summary(self) -> Dict[str, Any]:
         """Get comprehensive personality summary"""
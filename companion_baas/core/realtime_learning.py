@@ -11,15 +11,25 @@ Enables continuous learning from user interactions:
 - Behavioral adaptation
 """
 
+import os
+import copy
 import logging
 import json
 import time
+import queue
+import itertools
+import threading
 from typing import Dict, List, Optional, Any, Tuple
-from dataclasses import dataclass, field
+from dataclasses import dataclass, field, asdict
 from enum import Enum
-from collections import defaultdict, Counter
+from collections import defaultdict, deque, Counter
 import statistics
 
+try:
+    from companion_baas.optimization.sketches import CountMinSketch, SpaceSaving
+except ImportError:
+    from optimization.sketches import CountMinSketch, SpaceSaving
+
 logger = logging.getLogger(__name__)
 
 
@@ -106,11 +116,41 @@ class UserPreference:
 
 
 class FeedbackCollector:
-    """Collect and store user feedback"""
+    """
+    Collect and store user feedback
+
+    Features:
+    - Per-user index and FIFO of unprocessed entries (no full scans)
+    - Bounded history: oldest entries dropped beyond max_entries
+    """
     
-    def __init__(self):
+    def __init__(self, max_entries: int = 100000):
         self.feedback: Dict[str, FeedbackEntry] = {}
         self.feedback_counter = 0
+        self.max_entries = max_entries
+        self._ids = itertools.count(1)
+        self._by_user: Dict[str, deque] = defaultdict(deque)
+        self._unprocessed: deque = deque()
+        self._lock = threading.RLock()
+    
+    def new_entry(
+        self,
+        user_id: str,
+        interaction_id: str,
+        feedback_type: FeedbackType,
+        value: Any,
+        context: Optional[Dict[str, Any]] = None
+    ) -> FeedbackEntry:
+        """Build an entry with a fresh id without storing it (thread-safe)"""
+        return FeedbackEntry(
+            id=f"feedback_{next(self._ids)}_{int(time.time())}",
+            user_id=user_id,
+            interaction_id=interaction_id,
+            feedback_type=feedback_type,
+            value=value,
+            context=context or {},
+            timestamp=time.time()
+        )
     
     def add_feedback(
         self,
@@ -133,33 +173,52 @@ class FeedbackCollector:
         Returns:
             Created FeedbackEntry
         """
-        self.feedback_counter += 1
-        feedback_id = f"feedback_{self.feedback_counter}_{int(time.time())}"
-        
-        entry = FeedbackEntry(
-            id=feedback_id,
-            user_id=user_id,
-            interaction_id=interaction_id,
-            feedback_type=feedback_type,
-            value=value,
-            context=context or {},
-            timestamp=time.time()
-        )
-        
-        self.feedback[feedback_id] = entry
+        entry = self.new_entry(user_id, interaction_id, feedback_type, value, context)
+        self.store(entry)
         logger.info(f"Feedback collected: {feedback_type.value} from {user_id}")
         return entry
     
+    def store(self, entry: FeedbackEntry):
+        """Index an entry built by new_entry() (queued for processing unless already processed)"""
+        with self._lock:
+            self.feedback[entry.id] = entry
+            self.feedback_counter += 1
+            self._by_user[entry.user_id].append(entry)
+            if not entry.processed:
+                self._unprocessed.append(entry)
+            
+            while len(self.feedback) > self.max_entries:
+                oldest = self.feedback.pop(next(iter(self.feedback)))
+                user_entries = self._by_user[oldest.user_id]
+                user_entries.popleft()
+                if not user_entries:
+                    del self._by_user[oldest.user_id]
+                self._trim_unprocessed()
+                if self._unprocessed and self._unprocessed[0] is oldest:
+                    self._unprocessed.popleft()  # evicted before anyone processed it
+    
+    def _trim_unprocessed(self):
+        while self._unprocessed and self._unprocessed[0].processed:
+            self._unprocessed.popleft()
+    
+    def entries(self) -> List[FeedbackEntry]:
+        """Stored entries, oldest first (a copy of the list, not of the entries)"""
+        with self._lock:
+            return list(self.feedback.values())
+    
     def get_unprocessed(self, limit: int = 100) -> List[FeedbackEntry]:
-        """Get unprocessed feedback"""
-        unprocessed = [f for f in self.feedback.values() if not f.processed]
-        unprocessed.sort(key=lambda f: f.timestamp)
-        return unprocessed[:limit]
+        """Get unprocessed feedback (oldest first)"""
+        with self._lock:
+            self._trim_unprocessed()
+            return list(itertools.islice((f for f in self._unprocessed if not f.processed), limit))
     
     def mark_processed(self, feedback_id: str):
         """Mark feedback as processed"""
-        if feedback_id in self.feedback:
-            self.feedback[feedback_id].processed = True
+        with self._lock:
+            entry = self.feedback.get(feedback_id)
+            if entry is not None:
+                entry.processed = True
+                self._trim_unprocessed()
     
     def get_user_feedback(
         self,
@@ -167,26 +226,71 @@ class FeedbackCollector:
         feedback_type: Optional[FeedbackType] = None,
         limit: int = 50
     ) -> List[FeedbackEntry]:
-        """Get feedback for specific user"""
-        user_feedback = [f for f in self.feedback.values() if f.user_id == user_id]
-        
-        if feedback_type:
-            user_feedback = [f for f in user_feedback if f.feedback_type == feedback_type]
-        
-        user_feedback.sort(key=lambda f: f.timestamp, reverse=True)
-        return user_feedback[:limit]
+        """Get feedback for specific user (newest first)"""
+        with self._lock:
+            entries = reversed(self._by_user.get(user_id, ()))
+            if feedback_type:
+                entries = (f for f in entries if f.feedback_type == feedback_type)
+            return list(itertools.islice(entries, limit))
+    
+    def to_dicts(self) -> List[Dict[str, Any]]:
+        """All stored entries (for snapshots)"""
+        return [entry.to_dict() for entry in self.entries()]
+    
+    def load_dicts(self, records: List[Dict[str, Any]]):
+        """Restore entries written by to_dicts()"""
+        for record in records:
+            self.store(FeedbackEntry(**{**record, "feedback_type": FeedbackType(record["feedback_type"])}))
+        self._ids = itertools.count(self.feedback_counter + 1)
 
 
 class PatternRecognizer:
-    """Recognize patterns in user interactions"""
+    """
+    Recognize patterns in user interactions
+
+    Counting is streaming: each tracked interaction updates a count-min
+    sketch and a space-saving heavy-hitter list for queries and for each
+    user's query 2- and 3-grams, in bounded memory with time decay.
+    detect_patterns() just reads the current heavy hitters. Recognized
+    patterns are capped at max_patterns, least recently seen evicted first.
+    """
     
-    def __init__(self):
-        self.patterns: Dict[str, Pattern] = {}
+    SEQUENCE_LENGTHS = (2, 3)
+    
+    def __init__(
+        self,
+        half_life_seconds: float = 7 * 24 * 3600,
+        max_tracked: int = 1000,
+        sketch_width: int = 4096,
+        max_patterns: int = 1000
+    ):
+        """
+        Initialize recognizer
+
+        Args:
+            half_life_seconds: Time for an occurrence to count half as much
+            max_tracked: Heavy hitters kept for queries and for sequences
+            sketch_width: Count-min width (memory ~ 4 x width counters each)
+            max_patterns: Recognized patterns kept (least recently seen evicted)
+        """
+        self.patterns: Dict[str, Pattern] = {}  # least recently seen first
         self.pattern_counter = 0
+        self.max_patterns = max_patterns
+        self._pattern_index: Dict[Tuple[str, str], Pattern] = {}
+        self._lock = threading.Lock()
         
-        # Track sequences
-        self.user_sequences: Dict[str, List[str]] = defaultdict(list)
-        self.query_frequency: Dict[str, int] = Counter()
+        # Last few queries per user, enough to form the longest n-gram
+        self.user_sequences: Dict[str, deque] = defaultdict(
+            lambda: deque(maxlen=max(self.SEQUENCE_LENGTHS))
+        )
+        self.query_counts = CountMinSketch(sketch_width, half_life_seconds=half_life_seconds)
+        self.top_queries = SpaceSaving(max_tracked, half_life_seconds=half_life_seconds)
+        self.top_sequences = SpaceSaving(max_tracked, half_life_seconds=half_life_seconds)
+    
+    @property
+    def query_frequency(self) -> Dict[str, float]:
+        """Decayed counts of the most frequent queries"""
+        return {query: count for query, count, _ in self.top_queries.top()}
     
     def track_interaction(
         self,
@@ -198,56 +302,45 @@ class PatternRecognizer:
         """Track interaction for pattern recognition"""
         # Track query frequency
         query_lower = query.lower().strip()
-        self.query_frequency[query_lower] += 1
-        
-        # Track user sequences
-        self.user_sequences[user_id].append(query_lower)
-        
-        # Keep sequences manageable
-        if len(self.user_sequences[user_id]) > 100:
-            self.user_sequences[user_id].pop(0)
-        
-        # Check for repeated questions
-        if self.query_frequency[query_lower] >= 3:
+        count = self.query_counts.add(query_lower)
+        self.top_queries.add(query_lower)
+        
+        # Track user sequences (n-grams ending at this query)
+        sequence = self.user_sequences[user_id]
+        sequence.append(query_lower)
+        for length in self.SEQUENCE_LENGTHS:
+            if len(sequence) >= length:
+                self.top_sequences.add((user_id, tuple(sequence)[-length:]))
+        
+        # Check for repeated questions (space-saving's guaranteed count:
+        # a fresh key inherits the evicted key's count, and count-min
+        # collisions only ever overestimate)
+        if self.top_queries.guaranteed(query_lower) >= 3:
             self._create_pattern(
                 pattern_type="repeated_query",
                 description=f"Frequently asked: {query}",
-                confidence=min(self.query_frequency[query_lower] / 10.0, 1.0),
-                metadata={"query": query, "count": self.query_frequency[query_lower]}
+                confidence=min(count / 10.0, 1.0),
+                metadata={"query": query, "count": round(count)}
             )
     
-    def detect_patterns(self) -> List[Pattern]:
-        """Detect patterns from tracked data"""
+    def detect_patterns(self, min_occurrences: float = 2.0) -> List[Pattern]:
+        """Detect patterns from tracked data (reads the sequence heavy hitters)"""
         detected = []
         
-        # Find common sequences
-        for user_id, sequence in self.user_sequences.items():
-            if len(sequence) < 3:
-                continue
-            
-            # Look for repeating patterns
-            for length in [2, 3]:
-                for i in range(len(sequence) - length):
-                    subseq = tuple(sequence[i:i+length])
-                    
-                    # Count occurrences
-                    count = 0
-                    for j in range(len(sequence) - length):
-                        if tuple(sequence[j:j+length]) == subseq:
-                            count += 1
-                    
-                    if count >= 2:
-                        pattern = self._create_pattern(
-                            pattern_type="query_sequence",
-                            description=f"Common sequence: {' → '.join(subseq)}",
-                            confidence=min(count / 5.0, 1.0),
-                            metadata={
-                                "sequence": list(subseq),
-                                "user_id": user_id,
-                                "occurrences": count
-                            }
-                        )
-                        detected.append(pattern)
+        for (user_id, subseq), count, error in self.top_sequences.top(min_count=min_occurrences):
+            if count - error < min_occurrences:
+                continue  # count mostly inherited from an evicted key
+            pattern = self._create_pattern(
+                pattern_type="query_sequence",
+                description=f"Common sequence: {' → '.join(subseq)}",
+                confidence=min(count / 5.0, 1.0),
+                metadata={
+                    "sequence": list(subseq),
+                    "user_id": user_id,
+                    "occurrences": round(count)
+                }
+            )
+            detected.append(pattern)
         
         return detected
     
@@ -259,30 +352,36 @@ class PatternRecognizer:
         metadata: Dict[str, Any]
     ) -> Pattern:
         """Create or update pattern"""
-        # Check if pattern already exists
-        for pattern in self.patterns.values():
-            if pattern.pattern_type == pattern_type and pattern.description == description:
+        with self._lock:
+            # Check if pattern already exists
+            pattern = self._pattern_index.get((pattern_type, description))
+            if pattern is not None:
                 pattern.occurrences += 1
                 pattern.confidence = min(pattern.confidence + 0.1, 1.0)
                 pattern.last_seen = time.time()
+                self.patterns[pattern.id] = self.patterns.pop(pattern.id)  # most recently seen last
                 return pattern
-        
-        # Create new pattern
-        self.pattern_counter += 1
-        pattern_id = f"pattern_{self.pattern_counter}"
-        
-        pattern = Pattern(
-            id=pattern_id,
-            pattern_type=pattern_type,
-            description=description,
-            occurrences=1,
-            confidence=confidence,
-            first_seen=time.time(),
-            last_seen=time.time(),
-            metadata=metadata
-        )
-        
-        self.patterns[pattern_id] = pattern
+            
+            # Create new pattern
+            self.pattern_counter += 1
+            pattern_id = f"pattern_{self.pattern_counter}"
+            
+            pattern = Pattern(
+                id=pattern_id,
+                pattern_type=pattern_type,
+                description=description,
+                occurrences=1,
+                confidence=confidence,
+                first_seen=time.time(),
+                last_seen=time.time(),
+                metadata=metadata
+            )
+            
+            self.patterns[pattern_id] = pattern
+            self._pattern_index[(pattern_type, description)] = pattern
+            while len(self.patterns) > self.max_patterns:
+                stale = self.patterns.pop(next(iter(self.patterns)))
+                del self._pattern_index[(stale.pattern_type, stale.description)]
         logger.info(f"Pattern detected: {description}")
         return pattern
     
@@ -292,7 +391,8 @@ class PatternRecognizer:
         min_confidence: float = 0.5
     ) -> List[Pattern]:
         """Get recognized patterns"""
-        patterns = list(self.patterns.values())
+        with self._lock:
+            patterns = list(self.patterns.values())
         
         if pattern_type:
             patterns = [p for p in patterns if p.pattern_type == pattern_type]
@@ -515,13 +615,44 @@ class RealtimeLearningSystem:
     Continuously learns and adapts from interactions
     """
     
-    def __init__(self):
+    def __init__(
+        self,
+        snapshot_path: Optional[str] = None,
+        snapshot_interval: float = 60.0,
+        batch_size: int = 256
+    ):
+        """
+        Initialize learning system
+
+        Args:
+            snapshot_path: JSON snapshot of feedback, preferences and quality
+                scores (defaults to COMPANION_LEARNING_SNAPSHOT; unset = none)
+            snapshot_interval: Seconds between snapshots while feedback flows
+            batch_size: Feedback entries processed per worker batch
+        """
         self.feedback_collector = FeedbackCollector()
         self.pattern_recognizer = PatternRecognizer()
         self.preference_tracker = PreferenceTracker()
         self.quality_analyzer = QualityAnalyzer()
         self.adaptation_engine = AdaptationEngine()
         
+        # provide_feedback only enqueues; one worker applies feedback in
+        # micro-batches under _state_lock
+        self.batch_size = batch_size
+        self._feedback_queue: "queue.SimpleQueue[Optional[FeedbackEntry]]" = queue.SimpleQueue()
+        self._state_lock = threading.RLock()
+        self._worker: Optional[threading.Thread] = None
+        self._worker_lock = threading.Lock()
+        self._enqueued = 0
+        self._processed = 0
+        self._idle = threading.Condition()
+        
+        self.snapshot_path = snapshot_path or os.getenv('COMPANION_LEARNING_SNAPSHOT')
+        self.snapshot_interval = snapshot_interval
+        self._last_snapshot = time.monotonic()
+        if self.snapshot_path and os.path.exists(self.snapshot_path):
+            self._load_snapshot()
+        
         self.enabled = True
         logger.info("✅ Real-time Learning System initialized")
     
@@ -534,7 +665,7 @@ class RealtimeLearningSystem:
         context: Optional[Dict[str, Any]] = None
     ) -> FeedbackEntry:
         """
-        Submit user feedback
+        Submit user feedback (enqueued; applied by the background worker)
         
         Args:
             user_id: User identifier
@@ -547,15 +678,138 @@ class RealtimeLearningSystem:
             FeedbackEntry
         """
         fb_type = FeedbackType(feedback_type)
-        entry = self.feedback_collector.add_feedback(
+        entry = self.feedback_collector.new_entry(
             user_id, interaction_id, fb_type, value, context
         )
-        
-        # Process feedback immediately
-        self._process_feedback(entry)
-        
+        with self._idle:
+            self._enqueued += 1
+        self._feedback_queue.put(entry)
+        if self._worker is None or not self._worker.is_alive():
+            self._start_worker()
         return entry
     
+    # ------------------------------------------------------------------
+    # Background feedback pipeline
+    # ------------------------------------------------------------------
+    def _start_worker(self):
+        with self._worker_lock:
+            if self._worker is None or not self._worker.is_alive():
+                if self._worker is not None:
+                    logger.warning("⚠️ Feedback worker was not running, restarting it")
+                self._worker = threading.Thread(target=self._feedback_loop, name="feedback_worker", daemon=True)
+                self._worker.start()
+    
+    def _feedback_loop(self):
+        """Drain the queue in micro-batches; snapshot periodically"""
+        while True:
+            stop = False
+            try:
+                try:
+                    entry = self._feedback_queue.get(timeout=self.snapshot_interval)
+                except queue.Empty:
+                    entry = None
+                    batch = []
+                else:
+                    batch = [entry]
+                    while len(batch) < self.batch_size:
+                        try:
+                            batch.append(self._feedback_queue.get_nowait())
+                        except queue.Empty:
+                            break
+                
+                stop = None in batch
+                batch = [e for e in batch if e is not None]
+                if batch:
+                    self._process_batch(batch)
+                
+                if self.snapshot_path and (stop or time.monotonic() - self._last_snapshot >= self.snapshot_interval):
+                    self.save_snapshot()
+            except Exception as e:
+                # Keep draining: a dead worker would silently drop all later feedback
+                logger.error(f"❌ Feedback worker error: {e}")
+            if stop:
+                return
+    
+    def _process_batch(self, batch: List[FeedbackEntry]):
+        try:
+            with self._state_lock:
+                for entry in batch:
+                    try:
+                        self._process_feedback(entry)
+                    except Exception as e:
+                        logger.warning(f"⚠️ Failed to process feedback {entry.id}: {e}")
+                    # Stored after processing: only failed entries join the unprocessed FIFO
+                    self.feedback_collector.store(entry)
+            logger.debug(f"Processed {len(batch)} feedback entries")
+        finally:
+            # Counted even if the batch failed, so flush() never waits on it
+            with self._idle:
+                self._processed += len(batch)
+                self._idle.notify_all()
+    
+    def flush(self, timeout: Optional[float] = None) -> bool:
+        """Wait until every enqueued feedback entry has been applied"""
+        with self._idle:
+            target = self._enqueued
+            return self._idle.wait_for(lambda: self._processed >= target, timeout=timeout)
+    
+    def close(self):
+        """Apply pending feedback, write a final snapshot and stop the worker"""
+        if self._worker is not None:
+            self._feedback_queue.put(None)
+            self._worker.join()
+            self._worker = None
+        elif self.snapshot_path:
+            self.save_snapshot()
+    
+    def save_snapshot(self):
+        """Write feedback, preferences and quality scores to snapshot_path"""
+        if not self.snapshot_path:
+            return
+        # Copy under the lock; build dicts and serialize outside it so
+        # request-path writers are not blocked by JSON encoding
+        with self._state_lock:
+            entries = self.feedback_collector.entries()
+            preferences = [
+                copy.copy(pref)
+                for user_prefs in self.preference_tracker.preferences.values()
+                for pref in user_prefs.values()
+            ]
+            quality_scores = {k: list(v) for k, v in self.quality_analyzer.response_scores.items()}
+            errors = dict(self.quality_analyzer.error_tracking)
+        payload = {
+            "feedback": [entry.to_dict() for entry in entries],
+            "preferences": [asdict(pref) for pref in preferences],
+            "quality_scores": quality_scores,
+            "errors": errors,
+            "saved_at": time.time()
+        }
+        tmp_path = f"{self.snapshot_path}.tmp"
+        try:
+            with open(tmp_path, 'w') as f:
+                json.dump(payload, f, default=str)
+            os.replace(tmp_path, self.snapshot_path)
+        except OSError as e:
+            logger.warning(f"⚠️ Failed to write learning snapshot: {e}")
+        self._last_snapshot = time.monotonic()
+    
+    def _load_snapshot(self):
+        try:
+            with open(self.snapshot_path) as f:
+                payload = json.load(f)
+        except (OSError, json.JSONDecodeError) as e:
+            logger.warning(f"⚠️ Failed to read learning snapshot {self.snapshot_path}: {e}")
+            return
+        self.feedback_collector.load_dicts(payload.get("feedback", []))
+        for record in payload.get("preferences", []):
+            pref = UserPreference(**record)
+            self.preference_tracker.preferences[pref.user_id][f"{pref.category}:{pref.preference}"] = pref
+        for category, scores in payload.get("quality_scores", {}).items():
+            self.quality_analyzer.response_scores[category] = scores
+        self.quality_analyzer.error_tracking.update(payload.get("errors", {}))
+        logger.info(f"📚 Learning state restored from {self.snapshot_path} "
+                    f"({len(self.feedback_collector.feedback)} feedback entries)")
+    
     def track_interaction(
         self,
         user_id: str,
@@ -577,17 +831,18 @@ class RealtimeLearningSystem:
         # Pattern recognition
         self.pattern_recognizer.track_interaction(user_id, query, response, metadata)
         
-        # Quality tracking
-        if score is not None:
-            interaction_id = f"int_{int(time.time())}"
-            self.quality_analyzer.record_score(interaction_id, score)
-        
-        # Learn preferences from metadata
-        if metadata:
-            if "preferred_style" in metadata:
-                self.preference_tracker.record_preference(
-                    user_id, "response_style", metadata["preferred_style"]
-                )
+        with self._state_lock:
+            # Quality tracking
+            if score is not None:
+                interaction_id = f"int_{int(time.time())}"
+                self.quality_analyzer.record_score(interaction_id, score)
+            
+            # Learn preferences from metadata
+            if metadata:
+                if "preferred_style" in metadata:
+                    self.preference_tracker.record_preference(
+                        user_id, "response_style", metadata["preferred_style"]
+                    )
     
     def learn_preference(
         self,
@@ -605,9 +860,10 @@ class RealtimeLearningSystem:
             preference: Preference value
             strength: Preference strength
         """
-        self.preference_tracker.record_preference(
-            user_id, category, preference, strength
-        )
+        with self._state_lock:
+            self.preference_tracker.record_preference(
+                user_id, category, preference, strength
+            )
     
     def get_user_profile(self, user_id: str) -> Dict[str, Any]:
         """
@@ -619,14 +875,16 @@ class RealtimeLearningSystem:
         Returns:
             User profile with preferences and patterns
         """
-        preferences = self.preference_tracker.get_all_preferences(user_id)
-        feedback_stats = self._calculate_feedback_stats(user_id)
+        with self._state_lock:
+            preferences = self.preference_tracker.get_all_preferences(user_id)
+            feedback_stats = self._calculate_feedback_stats(user_id)
+            quality_trend = self.quality_analyzer.get_trend()
         
         return {
             "user_id": user_id,
             "preferences": preferences,
             "feedback_stats": feedback_stats,
-            "quality_trend": self.quality_analyzer.get_trend()
+            "quality_trend": quality_trend
         }
     
     def get_adaptations(self) -> List[str]:
@@ -637,7 +895,8 @@ class RealtimeLearningSystem:
             List of adaptation suggestions
         """
         patterns = self.pattern_recognizer.get_patterns(min_confidence=0.6)
-        quality_trend = self.quality_analyzer.get_trend()
+        with self._state_lock:
+            quality_trend = self.quality_analyzer.get_trend()
         
         # Get preferences (aggregate across users for now)
         all_prefs = {}
@@ -672,7 +931,7 @@ class RealtimeLearningSystem:
             # Learn from corrections
             logger.info(f"User correction received: {feedback.value}")
         
-        self.feedback_collector.mark_processed(feedback.id)
+        feedback.processed = True
     
     def _calculate_feedback_stats(self, user_id: str) -> Dict[str, Any]:
         """Calculate feedback statistics for user"""
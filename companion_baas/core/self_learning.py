@@ -13,12 +13,28 @@ The brain becomes a continuously evolving learning system.
 """
 
 import numpy as np
-from typing import Dict, Any, List, Optional, Set, Tuple
-from dataclasses import dataclass, field
+from typing import ClassVar, Dict, Any, FrozenSet, Iterable, List, Optional, Sequence, Set, Tuple
+from dataclasses import dataclass, field, asdict
 from datetime import datetime
-from collections import defaultdict
+from collections import Counter, defaultdict, deque
+from itertools import islice
+import os
 import json
+import heapq
 import pickle
+import logging
+import sqlite3
+import threading
+import time
+
+try:
+    from companion_baas.core.query_analyzer import hashed_embedding
+    from companion_baas.core.graph_store import GraphStore
+except ImportError:
+    from core.query_analyzer import hashed_embedding
+    from core.graph_store import GraphStore
+
+logger = logging.getLogger(__name__)
 
 
 @dataclass
@@ -50,104 +66,322 @@ class Episode:
         }
 
 
+class _EpisodeView(Sequence):
+    """Read-only, chronological view of the episodes held in the ring buffer"""
+
+    def __init__(self, memory: 'EpisodicMemory'):
+        self._memory = memory
+
+    def __len__(self) -> int:
+        return self._memory._next_seq - self._memory._oldest_seq
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return [self[i] for i in range(*index.indices(len(self)))]
+        size = len(self)
+        if index < 0:
+            index += size
+        if not 0 <= index < size:
+            raise IndexError("episode index out of range")
+        return self._memory._entry(self._memory._oldest_seq + index).episode
+
+
+@dataclass
+class _IndexedEpisode:
+    """Ring-buffer slot: an episode plus its precomputed recall features"""
+    episode: Episode
+    tokens: FrozenSet[str]
+    embedding: Dict[int, float]
+    task_type: Optional[str]
+    success: Optional[bool]  # None when the outcome has no 'success' key
+
+
 class EpisodicMemory:
     """
     Stores every interaction as episodes.
     Enables learning from past experiences.
+
+    Features:
+    - Ring buffer of max_episodes with O(1) eviction of the oldest episode
+    - Token sets and hashed embeddings computed once, at store time
+    - Inverted index (token -> episodes) for candidate recall, reranked by
+      embedding cosine; very common tokens are capped to their most recent
+      postings so recall cost does not grow with memory size
+    - Secondary indexes on outcome and task_type
+    - Optional SQLite persistence (db_path) reloaded on startup, with
+      writes committed in batches
     """
-    
-    def __init__(self, max_episodes: int = 10000):
+
+    def __init__(self, max_episodes: int = 10000, db_path: Optional[str] = None,
+                 max_postings: int = 1000, commit_batch: int = 64,
+                 commit_interval: float = 1.0):
+        """
+        Initialize episodic memory
+
+        Args:
+            max_episodes: Episodes kept (oldest evicted first)
+            db_path: SQLite file to persist episodes to (None = memory only)
+            max_postings: Most recent postings scanned per query token
+            commit_batch: Episode writes grouped into one commit
+            commit_interval: Max seconds a write waits for its commit
+        """
         self.max_episodes = max_episodes
-        self.episodes: List[Episode] = []
+        self.max_postings = max_postings
         self.episode_count = 0
-    
+
+        self._ring: List[Optional[_IndexedEpisode]] = [None] * max_episodes
+        self._oldest_seq = 0
+        self._next_seq = 0
+        self.episodes = _EpisodeView(self)
+
+        # Postings hold sequence numbers in store order, so the evicted
+        # (oldest) episode is always at the left of every deque it is in
+        self._inverted: Dict[str, deque] = defaultdict(deque)
+        self._successes: deque = deque()
+        self._failures: deque = deque()
+        self._successes_by_task: Dict[str, deque] = defaultdict(deque)
+        self._success_count = 0
+        self._lock = threading.RLock()
+
+        self.db_path = db_path
+        self._db: Optional[sqlite3.Connection] = None
+        self.commit_batch = commit_batch
+        self.commit_interval = commit_interval
+        self._uncommitted = 0
+        self._last_commit = time.monotonic()
+        if db_path:
+            self._open_db(db_path)
+
+    # ------------------------------------------------------------------
+    # Ring buffer and indexes
+    # ------------------------------------------------------------------
+    def _entry(self, seq: int) -> _IndexedEpisode:
+        return self._ring[seq % self.max_episodes]
+
+    def _index(self, episode: Episode) -> int:
+        """Add an episode to the ring and indexes; returns its sequence number"""
+        if self._next_seq - self._oldest_seq >= self.max_episodes:
+            self._evict_oldest()
+
+        seq = self._next_seq
+        success = episode.outcome.get('success')
+        entry = _IndexedEpisode(
+            episode=episode,
+            tokens=frozenset(episode.query.lower().split()),
+            embedding=hashed_embedding(episode.query.lower()),
+            task_type=episode.context.get('task_type'),
+            success=None if success is None else bool(success)
+        )
+        self._ring[seq % self.max_episodes] = entry
+        self._next_seq += 1
+
+        for token in entry.tokens:
+            self._inverted[token].append(seq)
+        if entry.success:
+            self._success_count += 1
+            self._successes.append(seq)
+            if entry.task_type is not None:
+                self._successes_by_task[entry.task_type].append(seq)
+        elif entry.success is False:
+            self._failures.append(seq)
+        return seq
+
+    def _evict_oldest(self):
+        """Drop the oldest episode from the ring and every index (O(tokens))"""
+        seq = self._oldest_seq
+        entry = self._entry(seq)
+        self._ring[seq % self.max_episodes] = None
+        self._oldest_seq += 1
+
+        for token in entry.tokens:
+            postings = self._inverted[token]
+            postings.popleft()
+            if not postings:
+                del self._inverted[token]
+        if entry.success:
+            self._success_count -= 1
+            self._successes.popleft()
+            if entry.task_type is not None:
+                by_task = self._successes_by_task[entry.task_type]
+                by_task.popleft()
+                if not by_task:
+                    del self._successes_by_task[entry.task_type]
+        elif entry.success is False:
+            self._failures.popleft()
+        if self._db is not None:
+            self._db.execute("DELETE FROM episodes WHERE seq = ?", (seq,))
+
+    def _recent(self, seqs: deque, top_k: int) -> List[Episode]:
+        """Last top_k episodes of an index, oldest first"""
+        if top_k <= 0:
+            return []
+        recent = list(islice(reversed(seqs), top_k))
+        return [self._entry(seq).episode for seq in reversed(recent)]
+
+    # ------------------------------------------------------------------
+    # Persistence
+    # ------------------------------------------------------------------
+    def _open_db(self, db_path: str):
+        """Open (or create) the episode store and reload the newest episodes"""
+        self._db = sqlite3.connect(db_path, check_same_thread=False)
+        self._db.execute("PRAGMA journal_mode=WAL")
+        self._db.execute("PRAGMA synchronous=NORMAL")
+        self._db.execute("CREATE TABLE IF NOT EXISTS episodes (seq INTEGER PRIMARY KEY, data TEXT NOT NULL)")
+
+        rows = self._db.execute(
+            "SELECT seq, data FROM episodes ORDER BY seq DESC LIMIT ?", (self.max_episodes,)
+        ).fetchall()
+        rows.reverse()
+        if rows:
+            # Ring slots must be contiguous; failed writes or restore() leave
+            # gaps in the stored seqs, so renumber the window if needed
+            base = rows[0][0]
+            with self._db:
+                self._db.execute("DELETE FROM episodes WHERE seq < ?", (base,))
+                if rows[-1][0] - base != len(rows) - 1:
+                    self._db.execute("DELETE FROM episodes")
+                    self._db.executemany(
+                        "INSERT INTO episodes (seq, data) VALUES (?, ?)",
+                        ((base + i, data) for i, (_, data) in enumerate(rows))
+                    )
+            # Continue ids and sequence numbers from the stored history
+            self._oldest_seq = self._next_seq = base
+            for _, data in rows:
+                self._index(Episode(**json.loads(data)))
+            self.episode_count = self._next_seq
+        logger.info(f"📚 Episodic memory: {len(rows)} episodes loaded from {db_path}")
+
+    def _persist(self, seq: int, episode: Episode):
+        record = asdict(episode)
+        self._db.execute(
+            "INSERT OR REPLACE INTO episodes (seq, data) VALUES (?, ?)",
+            (seq, json.dumps(record, default=str))
+        )
+        # Group commits: one fsync per batch instead of per episode
+        self._uncommitted += 1
+        now = time.monotonic()
+        if self._uncommitted >= self.commit_batch or now - self._last_commit >= self.commit_interval:
+            self.flush()
+
+    def flush(self):
+        """Commit pending episode writes"""
+        with self._lock:
+            if self._db is not None and self._uncommitted:
+                self._db.commit()
+            self._uncommitted = 0
+            self._last_commit = time.monotonic()
+
+    def close(self):
+        """Commit pending writes and close the episode store"""
+        with self._lock:
+            if self._db is not None:
+                self.flush()
+                self._db.close()
+                self._db = None
+
+    # ------------------------------------------------------------------
+    # Public API
+    # ------------------------------------------------------------------
     def store_episode(self, query: str, response: str, 
                      context: Dict[str, Any], outcome: Dict[str, Any],
                      emotions: str = "neutral") -> Episode:
         """Store a new episode"""
-        episode = Episode(
-            episode_id=f"ep_{self.episode_count:06d}",
-            timestamp=datetime.now().timestamp(),
-            query=query,
-            response=response,
-            context=context,
-            outcome=outcome,
-            emotions=emotions
-        )
-        
-        self.episodes.append(episode)
-        self.episode_count += 1
-        
-        # Remove oldest if exceeding limit
-        if len(self.episodes) > self.max_episodes:
-            self.episodes.pop(0)
-        
+        with self._lock:
+            episode = Episode(
+                episode_id=f"ep_{self.episode_count:06d}",
+                timestamp=datetime.now().timestamp(),
+                query=query,
+                response=response,
+                context=context,
+                outcome=outcome,
+                emotions=emotions
+            )
+            seq = self._index(episode)
+            self.episode_count += 1
+            if self._db is not None:
+                try:
+                    self._persist(seq, episode)
+                except sqlite3.Error as e:
+                    logger.warning(f"⚠️ Failed to persist episode {episode.episode_id}: {e}")
         return episode
     
     def recall_similar(self, query: str, top_k: int = 5) -> List[Episode]:
         """
         Recall similar past episodes.
-        Simple keyword-based similarity for now.
+
+        Candidates share at least one query word (inverted index); the
+        best by word overlap are reranked by hashed-embedding cosine.
         """
-        query_words = set(query.lower().split())
-        
-        # Score episodes by word overlap
-        scored_episodes = []
-        for episode in self.episodes:
-            episode_words = set(episode.query.lower().split())
-            overlap = len(query_words.intersection(episode_words))
-            if overlap > 0:
-                scored_episodes.append((episode, overlap))
-        
-        # Sort by score
-        scored_episodes.sort(key=lambda x: x[1], reverse=True)
-        
-        return [ep for ep, _ in scored_episodes[:top_k]]
+        query_lower = query.lower()
+        query_words = set(query_lower.split())
+        query_vector = hashed_embedding(query_lower)
+
+        with self._lock:
+            overlap: Counter = Counter()
+            for word in query_words:
+                postings = self._inverted.get(word)
+                if postings:
+                    overlap.update(islice(reversed(postings), self.max_postings))
+            if not overlap:
+                return []
+
+            shortlist = overlap.most_common(max(top_k * 10, 50))
+            scored = []
+            for seq, count in shortlist:
+                entry = self._entry(seq)
+                similarity = sum(
+                    weight * entry.embedding.get(index, 0.0) for index, weight in query_vector.items()
+                )
+                scored.append((count, similarity, seq, entry.episode))
+
+        scored.sort(key=lambda item: (item[0], item[1], item[2]), reverse=True)
+        return [episode for _, _, _, episode in scored[:top_k]]
     
     def recall_successful(self, task_type: Optional[str] = None, 
                          top_k: int = 10) -> List[Episode]:
-        """Recall successful episodes"""
-        successful = [
-            ep for ep in self.episodes
-            if ep.outcome.get('success', False)
-        ]
-        
-        # Filter by task type if specified
-        if task_type:
-            successful = [
-                ep for ep in successful
-                if ep.context.get('task_type') == task_type
-            ]
-        
-        # Return most recent
-        return successful[-top_k:]
+        """Recall successful episodes (most recent, oldest first)"""
+        with self._lock:
+            if task_type:
+                return self._recent(self._successes_by_task.get(task_type, deque()), top_k)
+            return self._recent(self._successes, top_k)
     
     def recall_failures(self, top_k: int = 10) -> List[Episode]:
         """Recall failed episodes to learn from mistakes"""
-        failures = [
-            ep for ep in self.episodes
-            if not ep.outcome.get('success', True)
-        ]
-        return failures[-top_k:]
-    
+        with self._lock:
+            return self._recent(self._failures, top_k)
+
+    def export(self) -> List[Dict[str, Any]]:
+        """All held episodes as plain dicts, oldest first (see restore())"""
+        with self._lock:
+            return [asdict(episode) for episode in self.episodes]
+
+    def restore(self, records: Iterable[Dict[str, Any]]):
+        """Index episodes produced by export() (oldest first) without re-persisting them"""
+        with self._lock:
+            for record in records:
+                self._index(Episode(**record))
+                self.episode_count += 1
+
     def get_stats(self) -> Dict[str, Any]:
         """Get episodic memory statistics"""
-        if not self.episodes:
+        with self._lock:
+            total = len(self.episodes)
+            if not total:
+                return {
+                    'total_episodes': 0,
+                    'success_rate': 0.0,
+                    'memory_usage': 0
+                }
+
             return {
-                'total_episodes': 0,
-                'success_rate': 0.0,
-                'memory_usage': 0
+                'total_episodes': total,
+                'success_rate': self._success_count / total,
+                'memory_usage': total,
+                'oldest_episode': self.episodes[0].timestamp,
+                'newest_episode': self.episodes[-1].timestamp,
+                'indexed_terms': len(self._inverted),
+                'persistent': self._db is not None
             }
-        
-        successes = sum(1 for ep in self.episodes if ep.outcome.get('success', False))
-        
-        return {
-            'total_episodes': len(self.episodes),
-            'success_rate': successes / len(self.episodes) if self.episodes else 0.0,
-            'memory_usage': len(self.episodes),
-            'oldest_episode': self.episodes[0].timestamp if self.episodes else None,
-            'newest_episode': self.episodes[-1].timestamp if self.episodes else None
-        }
 
 
 @dataclass
@@ -185,11 +419,16 @@ class SemanticMemory:
     """
     Knowledge graph of concepts and relationships.
     Builds understanding over time.
+
+    Concepts are indexed by lower-cased name in a GraphStore, so lookups
+    and neighbor expansion cost O(1) / O(degree) instead of scanning
+    every concept or relation.
     """
     
     def __init__(self):
         self.concepts: Dict[str, ConceptNode] = {}
         self.relations: List[ConceptRelation] = []
+        self.graph = GraphStore(normalize=str.lower)  # name -> concept_id
         self.concept_count = 0
         self.relation_count = 0
     
@@ -206,6 +445,7 @@ class SemanticMemory:
         )
         
         self.concepts[concept_id] = concept
+        self.graph.add_node(name, concept_id)  # first concept with a name wins
         self.concept_count += 1
         
         return concept
@@ -226,44 +466,29 @@ class SemanticMemory:
         )
         
         self.relations.append(relation)
+        self.graph.add_edge(source.name, relation_type, target.name)
         self.relation_count += 1
         
         return relation
     
     def _find_or_create_concept(self, name: str) -> ConceptNode:
         """Find existing concept or create new one"""
-        # Try to find existing
-        for concept in self.concepts.values():
-            if concept.name.lower() == name.lower():
-                concept.access_count += 1
-                return concept
+        concept_id = self.graph.get(name)
+        if concept_id is not None:
+            concept = self.concepts[concept_id]
+            concept.access_count += 1
+            return concept
         
         # Create new
         return self.add_concept(name)
     
     def get_related_concepts(self, concept_name: str, 
-                           max_depth: int = 2) -> List[ConceptNode]:
-        """Get concepts related to given concept"""
+                           max_depth: int = 2,
+                           limit: Optional[int] = None) -> List[ConceptNode]:
+        """Get concepts related to given concept (nearest first)"""
         concept = self._find_or_create_concept(concept_name)
-        
-        related_ids = set()
-        current_ids = {concept.concept_id}
-        
-        # BFS traversal
-        for _ in range(max_depth):
-            next_ids = set()
-            for rel in self.relations:
-                if rel.source_id in current_ids:
-                    next_ids.add(rel.target_id)
-                    related_ids.add(rel.target_id)
-                elif rel.target_id in current_ids:
-                    next_ids.add(rel.source_id)
-                    related_ids.add(rel.source_id)
-            current_ids = next_ids
-            if not current_ids:
-                break
-        
-        return [self.concepts[cid] for cid in related_ids if cid in self.concepts]
+        related_ids = self.graph.k_hop(concept.name, max_depth, direction='both', limit=limit)
+        return [self.concepts[self.graph.data(node)] for node in related_ids]
     
     def learn_from_text(self, text: str):
         """
@@ -278,17 +503,53 @@ class SemanticMemory:
         for concept_name in potential_concepts:
             self._find_or_create_concept(concept_name)
     
+    def learn_from_corpus(self, texts: Iterable[str]):
+        """Ingest many texts, then pack the graph for read-mostly use"""
+        for text in texts:
+            self.learn_from_text(text)
+        self.graph.freeze()
+    
+    def save(self, path: str):
+        """Persist concepts and relations to a JSON file"""
+        payload = {
+            'concepts': [asdict(c) for c in self.concepts.values()],
+            'relations': [asdict(r) for r in self.relations],
+            'concept_count': self.concept_count,
+            'relation_count': self.relation_count
+        }
+        tmp_path = f"{path}.tmp"
+        with open(tmp_path, 'w') as f:
+            json.dump(payload, f, default=str)
+        os.replace(tmp_path, path)
+    
+    def load(self, path: str):
+        """Replace contents with a file written by save() (bulk-loaded graph)"""
+        with open(path) as f:
+            payload = json.load(f)
+        self.concepts = {c['concept_id']: ConceptNode(**c) for c in payload.get('concepts', [])}
+        self.relations = [ConceptRelation(**r) for r in payload.get('relations', [])]
+        self.concept_count = payload.get('concept_count', len(self.concepts))
+        self.relation_count = payload.get('relation_count', len(self.relations))
+        
+        names = {cid: c.name for cid, c in self.concepts.items()}
+        self.graph = GraphStore(normalize=str.lower)
+        self.graph.bulk_load(
+            ((c.name, c.concept_id) for c in self.concepts.values()),
+            ((names[r.source_id], r.relation_type, names[r.target_id]) for r in self.relations
+             if r.source_id in names and r.target_id in names)
+        )
+    
     def get_stats(self) -> Dict[str, Any]:
         """Get semantic memory statistics"""
         return {
             'total_concepts': len(self.concepts),
             'total_relations': len(self.relations),
             'avg_connections_per_concept': len(self.relations) / len(self.concepts) if self.concepts else 0,
-            'most_accessed_concepts': sorted(
-                [(c.name, c.access_count) for c in self.concepts.values()],
-                key=lambda x: x[1],
-                reverse=True
-            )[:5]
+            'most_accessed_concepts': heapq.nlargest(
+                5,
+                ((c.name, c.access_count) for c in self.concepts.values()),
+                key=lambda x: x[1]
+            )
         }
 
 
@@ -302,7 +563,9 @@ class Skill:
     practice_count: int = 0
     success_count: int = 0
     last_practiced: float = field(default_factory=lambda: datetime.now().timestamp())
-    learning_curve: List[float] = field(default_factory=list)
+    learning_curve: List[float] = field(default_factory=list)  # most recent proficiencies
+    
+    MAX_CURVE_POINTS: ClassVar[int] = 100
     
     def practice(self, success: bool):
         """Practice the skill"""
@@ -314,6 +577,8 @@ class Skill:
         success_rate = self.success_count / self.practice_count
         self.proficiency = 0.7 * self.proficiency + 0.3 * success_rate
         self.learning_curve.append(self.proficiency)
+        if len(self.learning_curve) > self.MAX_CURVE_POINTS:
+            del self.learning_curve[:-self.MAX_CURVE_POINTS]
         self.last_practiced = datetime.now().timestamp()
     
     def to_dict(self) -> Dict[str, Any]:
@@ -529,14 +794,25 @@ class SelfLearningSystem:
     Integrates all memory systems and meta-learning.
     """
     
-    def __init__(self):
-        self.episodic = EpisodicMemory()
+    def __init__(self, episodic_db: Optional[str] = None):
+        """
+        Initialize self-learning
+
+        Args:
+            episodic_db: SQLite file for episodic memory (defaults to
+                COMPANION_EPISODIC_DB; unset keeps episodes in memory only)
+        """
+        self.episodic = EpisodicMemory(db_path=episodic_db or os.getenv('COMPANION_EPISODIC_DB'))
         self.semantic = SemanticMemory()
         self.procedural = ProceduralMemory()
         self.meta_learner = MetaLearner()
         
         self.total_learning_cycles = 0
     
+    def close(self):
+        """Commit pending episode writes and close the store"""
+        self.episodic.close()
+    
     def learn_from_interaction(self, query: str, response: str,
                                context: Dict[str, Any], 
                                outcome: Dict[str, Any],
@@ -637,6 +913,6 @@ class SelfLearningSystem:
 
 
 # Convenience function
-def create_self_learning_system() -> SelfLearningSystem:
+def create_self_learning_system(episodic_db: Optional[str] = None) -> SelfLearningSystem:
     """Create self-learning system"""
-    return SelfLearningSystem()
+    return SelfLearningSystem(episodic_db)
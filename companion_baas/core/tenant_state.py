@@ -0,0 +1,396 @@
+"""
+Tenant State
+============
+
+Per-user / per-tenant personality and learning state for a process that
+serves many tenants from one CompanionBrain.
+
+- One shared, read-only base: a copy-on-write fork of the brain's
+  personality and its SelfLearningSystem (semantic memory, skills,
+  strategies), never mutated by tenant traffic
+- Each tenant gets a lightweight overlay on first use: personality traits
+  and style preferences shared with the base until the tenant evolves
+  its own, a small private episodic memory, and skill copies made on
+  first practice
+- Hot tenants stay in an LRU; evicted tenants with changes are written to
+  disk in the background (lazy persistence) and reloaded on next use.
+  Tenants with an operation in progress are pinned and never evicted, so
+  no change lands after its tenant was saved
+- Each tenant has its own lock; the manager lock only guards the LRU
+"""
+
+import os
+import json
+import time
+import hashlib
+import logging
+import threading
+from collections import OrderedDict
+from concurrent.futures import ThreadPoolExecutor
+from contextlib import contextmanager
+from dataclasses import asdict, replace
+from typing import Any, Dict, Optional
+
+try:
+    from companion_baas.core.personality import PersonalityEngine, StyledStream
+    from companion_baas.core.self_learning import EpisodicMemory, SelfLearningSystem, Skill
+except ImportError:
+    from core.personality import PersonalityEngine, StyledStream
+    from core.self_learning import EpisodicMemory, SelfLearningSystem, Skill
+
+logger = logging.getLogger(__name__)
+
+
+class TenantLearning:
+    """
+    A tenant's learning overlay on a shared SelfLearningSystem
+
+    Features:
+    - Private episodic memory (small ring, so thousands of tenants fit)
+    - Skills copied from the base on first practice, then tenant-owned
+    - Semantic memory and learning strategies read from the base;
+      episodes are only ever recalled from the tenant's own memory
+    """
+
+    def __init__(self, base: Optional[SelfLearningSystem] = None, max_episodes: int = 256):
+        self.base = base
+        self.episodic = EpisodicMemory(max_episodes=max_episodes)
+        self.skills: Dict[str, Skill] = {}  # lowercased name -> tenant copy
+        self.learning_cycles = 0
+
+    def learn_from_interaction(self, query: str, response: str,
+                               context: Dict[str, Any],
+                               outcome: Dict[str, Any],
+                               emotions: str = "neutral"):
+        """Record an interaction for this tenant only"""
+        self.episodic.store_episode(query, response, context, outcome, emotions)
+        if 'success' in outcome:  # no outcome yet is not a failure
+            self._own_skill(context.get('task_type', 'general')).practice(bool(outcome['success']))
+        self.learning_cycles += 1
+
+    def _own_skill(self, name: str) -> Skill:
+        skill = self.skills.get(name.lower())
+        if skill is None:
+            base_skill = self.base.procedural._find_skill(name) if self.base else None
+            if base_skill is not None:
+                skill = replace(base_skill, learning_curve=[])
+            else:
+                skill = Skill(skill_id=f"skill_t{len(self.skills):06d}", name=name, description="")
+            self.skills[name.lower()] = skill
+        return skill
+
+    def get_proficiency(self, skill_name: str) -> float:
+        """Tenant's proficiency, or the base's for skills it never practiced"""
+        skill = self.skills.get(skill_name.lower())
+        if skill is not None:
+            return skill.proficiency
+        return self.base.procedural.get_proficiency(skill_name) if self.base else 0.0
+
+    def recall_relevant_knowledge(self, query: str) -> Dict[str, Any]:
+        """Base concepts and strategy with the tenant's own episodes and skills"""
+        own_episodes = [ep.to_dict() for ep in self.episodic.recall_similar(query, top_k=3)]
+        if self.base is None:
+            return {'similar_episodes': own_episodes, 'related_concepts': [],
+                    'skill_proficiency': 0.0, 'recommended_strategy': None}
+
+        knowledge = self.base.recall_relevant_knowledge(query)
+        # Episodes in the shared store belong to other conversations: never shown to a tenant
+        knowledge['similar_episodes'] = own_episodes
+        knowledge['skill_proficiency'] = self.get_proficiency(self.base._infer_task_type(query))
+        return knowledge
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            'episodes': self.episodic.export(),
+            'skills': [asdict(skill) for skill in self.skills.values()],
+            'learning_cycles': self.learning_cycles
+        }
+
+    def load_dict(self, data: Dict[str, Any]):
+        self.episodic.restore(data.get('episodes', []))
+        for record in data.get('skills', []):
+            skill = Skill(**record)
+            self.skills[skill.name.lower()] = skill
+        self.learning_cycles = data.get('learning_cycles', 0)
+
+
+class TenantState:
+    """Personality and learning overlay of one tenant"""
+
+    def __init__(self, tenant_id: str, personality: Optional[PersonalityEngine],
+                 learning: TenantLearning):
+        self.tenant_id = tenant_id
+        self.personality = personality
+        self.learning = learning
+        self.lock = threading.RLock()
+        self.dirty = False
+        self.last_access = time.time()
+        self.pins = 0  # operations in progress (manager lock); pinned states are not evicted
+
+    def to_dict(self) -> Dict[str, Any]:
+        """Only what differs from the base"""
+        data: Dict[str, Any] = {'tenant_id': self.tenant_id, 'learning': self.learning.to_dict()}
+        if self.personality is not None:
+            voice = self.personality.voice_evolution
+            traits = self.personality.traits
+            data['personality'] = {
+                'traits': None if traits.shared else traits.to_dict(),
+                'style_preferences': dict(voice.style_preferences.maps[0]),
+                'topic_preferences': voice.topic_preferences,
+                'interaction_count': voice.interaction_count
+            }
+        return data
+
+    def load_dict(self, data: Dict[str, Any]):
+        self.learning.load_dict(data.get('learning', {}))
+        personality = data.get('personality')
+        if personality and self.personality is not None:
+            for name, value in (personality.get('traits') or {}).items():
+                setattr(self.personality.traits, name, value)
+            voice = self.personality.voice_evolution
+            voice.style_preferences.update(personality.get('style_preferences', {}))
+            voice.topic_preferences = dict(personality.get('topic_preferences', {}))
+            voice.interaction_count = personality.get('interaction_count', 0)
+
+
+class TenantStateManager:
+    """
+    LRU of per-tenant state over one shared base
+
+    Features:
+    - get(tenant_id) creates, reloads or returns a tenant's overlay
+    - process_interaction / begin_stream / learn_from_interaction /
+      recall_relevant_knowledge scoped to a tenant
+    - Evicted tenants with changes are saved by a background writer;
+      flush() saves every hot tenant, close() also stops the writer
+    """
+
+    def __init__(
+        self,
+        personality_base: Optional[PersonalityEngine] = None,
+        learning_base: Optional[SelfLearningSystem] = None,
+        max_hot: int = 1024,
+        state_dir: Optional[str] = None,
+        tenant_episodes: int = 256
+    ):
+        """
+        Initialize manager
+
+        Args:
+            personality_base: Engine tenants start from (forked, so later
+                changes to it do not reach tenants); None = no personality
+            learning_base: Shared learning system tenants read from
+            max_hot: Tenants kept in memory
+            state_dir: Directory for tenant files (defaults to
+                COMPANION_TENANT_STATE_DIR; unset keeps state in memory only)
+            tenant_episodes: Episodes kept per tenant
+        """
+        self._base_personality = personality_base.fork() if personality_base is not None else None
+        self.learning_base = learning_base
+        self.max_hot = max_hot
+        self.tenant_episodes = tenant_episodes
+        self.state_dir = state_dir or os.getenv('COMPANION_TENANT_STATE_DIR')
+        if self.state_dir:
+            os.makedirs(self.state_dir, exist_ok=True)
+
+        self._hot: "OrderedDict[str, TenantState]" = OrderedDict()
+        self._writing: Dict[str, TenantState] = {}  # evicted, save pending
+        self._lock = threading.Lock()
+        self._writer: Optional[ThreadPoolExecutor] = None
+
+        self.stats = {
+            'hits': 0,
+            'misses': 0,
+            'loaded': 0,
+            'evicted': 0,
+            'saved': 0
+        }
+
+    # ------------------------------------------------------------------
+    # LRU
+    # ------------------------------------------------------------------
+    def get(self, tenant_id: str) -> TenantState:
+        """
+        A tenant's state, for reading (hold state.lock)
+
+        Mutate through using() or the tenant-scoped operations below: a
+        state fetched here may be evicted and saved before a change to it.
+        """
+        return self._acquire(tenant_id, pin=False)
+
+    @contextmanager
+    def using(self, tenant_id: str):
+        """Pin a tenant's state for an update (hold state.lock while changing it)"""
+        state = self._acquire(tenant_id, pin=True)
+        try:
+            yield state
+        finally:
+            with self._lock:
+                state.pins -= 1
+
+    def _acquire(self, tenant_id: str, pin: bool) -> TenantState:
+        with self._lock:
+            state = self._hot.get(tenant_id)
+            if state is not None:
+                self._hot.move_to_end(tenant_id)
+                self.stats['hits'] += 1
+                state.last_access = time.time()
+                state.pins += pin
+                return state
+            # Evicted but not written yet: take it back as is
+            state = self._writing.pop(tenant_id, None)
+            self.stats['misses'] += 1
+
+        if state is None:
+            state = self._load_or_create(tenant_id)
+
+        with self._lock:
+            existing = self._hot.get(tenant_id)
+            if existing is not None:  # another thread created it meanwhile
+                existing.pins += pin
+                return existing
+            self._hot[tenant_id] = state
+            state.pins += pin
+            evicted = []
+            while len(self._hot) > self.max_hot:
+                victim = next((old for old in self._hot.values() if not old.pins and old is not state), None)
+                if victim is None:
+                    break  # everything else is in use; shrink on a later get()
+                del self._hot[victim.tenant_id]
+                evicted.append(victim)
+            for old in evicted:
+                self.stats['evicted'] += 1
+                if old.dirty and self.state_dir:
+                    self._writing[old.tenant_id] = old
+        for old in evicted:
+            if old.dirty and self.state_dir:
+                self._background_save(old)
+        return state
+
+    def _new_state(self, tenant_id: str) -> TenantState:
+        personality = self._base_personality.fork() if self._base_personality is not None else None
+        return TenantState(tenant_id, personality, TenantLearning(self.learning_base, self.tenant_episodes))
+
+    def _load_or_create(self, tenant_id: str) -> TenantState:
+        state = self._new_state(tenant_id)
+        path = self._path(tenant_id)
+        if path and os.path.exists(path):
+            try:
+                with open(path) as f:
+                    state.load_dict(json.load(f))
+                self.stats['loaded'] += 1
+            except (OSError, ValueError, TypeError) as e:
+                logger.warning(f"⚠️ Failed to load tenant state {tenant_id}: {e}")
+                state = self._new_state(tenant_id)
+        return state
+
+    # ------------------------------------------------------------------
+    # Persistence
+    # ------------------------------------------------------------------
+    def _path(self, tenant_id: str) -> Optional[str]:
+        if not self.state_dir:
+            return None
+        digest = hashlib.sha1(tenant_id.encode('utf-8')).hexdigest()
+        return os.path.join(self.state_dir, f"{digest}.json")
+
+    def _save(self, state: TenantState):
+        with state.lock:
+            payload = state.to_dict()
+            state.dirty = False
+        path = self._path(state.tenant_id)
+        tmp_path = f"{path}.{threading.get_ident()}.tmp"
+        try:
+            with open(tmp_path, 'w') as f:
+                json.dump(payload, f, default=str)
+            os.replace(tmp_path, path)
+            self.stats['saved'] += 1
+        except OSError as e:
+            state.dirty = True
+            logger.warning(f"⚠️ Failed to save tenant state {state.tenant_id}: {e}")
+
+    def _background_save(self, state: TenantState):
+        if self._writer is None:
+            with self._lock:
+                if self._writer is None:
+                    self._writer = ThreadPoolExecutor(max_workers=1, thread_name_prefix="tenant_state_writer")
+        self._writer.submit(self._save_evicted, state)
+
+    def _save_evicted(self, state: TenantState):
+        try:
+            self._save(state)
+        finally:
+            with self._lock:
+                if self._writing.get(state.tenant_id) is state:
+                    del self._writing[state.tenant_id]
+
+    def flush(self):
+        """Save every tenant with unsaved changes and wait for pending writes"""
+        if not self.state_dir:
+            return
+        with self._lock:
+            dirty = [state for state in self._hot.values() if state.dirty]
+            writer = self._writer
+        for state in dirty:
+            self._save(state)
+        if writer is not None:
+            writer.submit(lambda: None).result()
+
+    def close(self):
+        """Flush and stop the background writer"""
+        self.flush()
+        if self._writer is not None:
+            self._writer.shutdown(wait=True)
+            self._writer = None
+
+    # ------------------------------------------------------------------
+    # Tenant-scoped operations
+    # ------------------------------------------------------------------
+    def process_interaction(self, tenant_id: str, query: str, raw_response: str,
+                            feedback: Optional[str] = None) -> str:
+        """Style a reply with the tenant's personality"""
+        with self.using(tenant_id) as state, state.lock:
+            if state.personality is None:
+                return raw_response
+            state.dirty = True
+            return state.personality.process_interaction(query, raw_response, feedback)
+
+    def begin_stream(self, tenant_id: str, query: str,
+                     feedback: Optional[str] = None) -> Optional[StyledStream]:
+        """Start styling a streamed reply with the tenant's personality (None = no personality)"""
+        with self.using(tenant_id) as state, state.lock:
+            if state.personality is None:
+                return None
+            state.dirty = True
+            return state.personality.begin_stream(query, feedback)
+
+    def learn_from_interaction(self, tenant_id: str, query: str, response: str,
+                               context: Dict[str, Any], outcome: Dict[str, Any],
+                               emotions: str = "neutral"):
+        """Record an interaction in the tenant's learning overlay"""
+        with self.using(tenant_id) as state, state.lock:
+            state.dirty = True
+            state.learning.learn_from_interaction(query, response, context, outcome, emotions)
+
+    def recall_relevant_knowledge(self, tenant_id: str, query: str) -> Dict[str, Any]:
+        """Shared knowledge plus the tenant's own experience"""
+        with self.using(tenant_id) as state, state.lock:
+            return state.learning.recall_relevant_knowledge(query)
+
+    def get_stats(self) -> Dict[str, Any]:
+        """LRU occupancy and copy-on-write sharing"""
+        with self._lock:
+            states = list(self._hot.values())
+            stats = dict(self.stats)
+            stats['pending_writes'] = len(self._writing)
+        lookups = stats['hits'] + stats['misses']
+        stats.update({
+            'hot_tenants': len(states),
+            'max_hot': self.max_hot,
+            'hit_rate': stats['hits'] / lookups if lookups else 0.0,
+            'dirty_tenants': sum(1 for state in states if state.dirty),
+            'tenants_sharing_base_traits': sum(
+                1 for state in states if state.personality is not None and state.personality.traits.shared
+            ),
+            'persistent': bool(self.state_dir)
+        })
+        return stats
@@ -0,0 +1,761 @@
+"""
+Training Store
+==============
+
+Append-only columnar store of training examples for ModelFinetuningSystem,
+sized for millions of logged conversations.
+
+- Rows are buffered and written as immutable segments (Parquet via
+  pyarrow when installed, otherwise a built-in layout: fixed-width column
+  arrays for the filter columns plus a row file for the text); the buffer
+  is flushed on a row, byte or age threshold
+- Dedup by content hash of (input, output), checked before buffering:
+  a Bloom filter in memory (sized from the stored row count and rebuilt
+  as the store doubles), confirmed against each segment's sorted hash
+  file, so memory stays a few bits per row
+- Small segments (age/byte flushes of a slow trickle) are merged into
+  full ones once enough accumulate, or on compact()
+- Manifest keeps per-segment zone maps (quality min/max, dataset types)
+  so scans skip whole segments; inside a segment only the filter columns
+  are read until a row matches (predicate pushdown)
+- scan() / export_jsonl() stream rows, so memory stays bounded by the
+  write buffer and one read batch; a capped export keeps the
+  highest-quality rows in insertion order (two passes, scores only held)
+"""
+
+import os
+import json
+import math
+import time
+import mmap
+import heapq
+import bisect
+import hashlib
+import logging
+import threading
+from array import array
+from contextlib import contextmanager
+from typing import Any, Callable, Dict, Iterable, Iterator, List, Optional
+
+logger = logging.getLogger(__name__)
+
+try:
+    import pyarrow as pa
+    import pyarrow.dataset as pads
+    import pyarrow.parquet as pq
+    PYARROW_AVAILABLE = True
+except ImportError:
+    pa = pads = pq = None
+    PYARROW_AVAILABLE = False
+
+MANIFEST = 'manifest.json'
+SEGMENT_FILES = ('.rows', '.cols', '.parquet', '.hash')
+MIN_FILTER_ROWS = 1 << 20  # smallest auto-sized dedup filter (~1.2 MB)
+COLUMNS = ('id', 'content_hash', 'input', 'output', 'quality_score',
+           'dataset_type', 'metadata', 'created_at')
+
+
+def content_hash(input_text: str, output_text: str) -> int:
+    """Signed 64-bit hash of an example's content (dedup key)"""
+    digest = hashlib.blake2b(f"{input_text}\x00{output_text}".encode('utf-8'), digest_size=8).digest()
+    return int.from_bytes(digest, 'big', signed=True)
+
+
+def take_best(items: Iterable[Any], qualities: Iterable[float], limit: int,
+              quality: Callable[[Any], float]) -> Iterator[Any]:
+    """
+    The `limit` items with the highest quality, in their original order
+
+    qualities holds the same items' scores in the same order (a cheap
+    first pass); only `limit` scores are kept in memory. Items tied at
+    the cutoff are taken first come, first served.
+    """
+    if limit <= 0:
+        return
+    heap: List[float] = []
+    total = 0
+    for score in qualities:
+        total += 1
+        if len(heap) < limit:
+            heapq.heappush(heap, score)
+        elif score > heap[0]:
+            heapq.heapreplace(heap, score)
+    threshold = heap[0] if total > limit else None
+    ties = sum(1 for score in heap if score == threshold)
+
+    taken = 0
+    for item in items:
+        if taken >= limit:
+            return
+        score = quality(item)
+        if threshold is not None and score <= threshold:
+            if score < threshold or not ties:
+                continue
+            ties -= 1
+        taken += 1
+        yield item
+
+
+class HashFilter:
+    """
+    Fixed-size Bloom filter over 64-bit content hashes
+
+    Never reports a stored hash as missing; a false positive only costs
+    the store a lookup in the segment hash files. for_capacity() sizes
+    one for an expected number of keys.
+    """
+
+    def __init__(self, bits: int = 1 << 24, probes: int = 7):
+        self.bits = bits
+        self.probes = probes
+        self.capacity: Optional[int] = None  # keys it was sized for (None = fixed size)
+        self._array = bytearray((bits + 7) // 8)
+
+    @classmethod
+    def for_capacity(cls, capacity: int, error_rate: float = 0.01) -> 'HashFilter':
+        """Filter holding `capacity` keys at about `error_rate` false positives"""
+        capacity = max(capacity, 1)
+        bits = max(8, math.ceil(-capacity * math.log(error_rate) / math.log(2) ** 2))
+        hash_filter = cls(bits, max(1, round(bits / capacity * math.log(2))))
+        hash_filter.capacity = capacity
+        return hash_filter
+
+    def _positions(self, key: int) -> Iterator[int]:
+        key &= 0xFFFFFFFFFFFFFFFF
+        first, step = key & 0xFFFFFFFF, (key >> 32) | 1
+        for i in range(self.probes):
+            yield (first + i * step) % self.bits
+
+    def add(self, key: int):
+        for position in self._positions(key):
+            self._array[position >> 3] |= 1 << (position & 7)
+
+    def __contains__(self, key: int) -> bool:
+        return all(self._array[position >> 3] & (1 << (position & 7)) for position in self._positions(key))
+
+
+def format_example(row: Dict[str, Any], format_type: str = "openai") -> Dict[str, Any]:
+    """Stored row -> training record (same formats as TrainingExample.to_training_format)"""
+    if format_type == "openai":
+        return {
+            "messages": [
+                {"role": "user", "content": row['input']},
+                {"role": "assistant", "content": row['output']}
+            ]
+        }
+    elif format_type == "alpaca":
+        return {
+            "instruction": row['input'],
+            "output": row['output']
+        }
+    return {
+        "id": row['id'],
+        "input": row['input'],
+        "output": row['output'],
+        "metadata": row['metadata'],
+        "quality_score": row['quality_score'],
+        "dataset_type": row['dataset_type'],
+        "created_at": row['created_at']
+    }
+
+
+class TrainingStore:
+    """
+    Segmented columnar training-data store
+
+    Features:
+    - append() with content-hash dedup (bounded memory)
+    - scan(min_quality, dataset_types) streaming rows that match
+    - scan_best() for the highest-quality rows, in insertion order
+    - count() / stats from the manifest without reading rows
+    - export_jsonl() in OpenAI, Alpaca or raw format
+    - compact() merging small segments
+    """
+
+    def __init__(self, path: str, segment_rows: int = 10000, use_pyarrow: Optional[bool] = None,
+                 flush_bytes: int = 8 * 1024 * 1024, flush_interval: float = 30.0,
+                 filter_bits: Optional[int] = None, compact_segments: Optional[int] = 8):
+        """
+        Open (or create) a store
+
+        Args:
+            path: Store directory
+            segment_rows: Rows buffered before a segment is written
+            use_pyarrow: Parquet segments (default: when pyarrow is installed);
+                existing segments are read in whatever format they were written
+            flush_bytes: Also flush once buffered input/output text reaches this size
+            flush_interval: Also flush on append once the oldest buffered row is
+                this many seconds old (None = rows/bytes only)
+            filter_bits: Fixed size of the in-memory dedup filter (None = sized
+                for twice the stored rows and rebuilt when they outgrow it)
+            compact_segments: Merge small segments once this many have
+                accumulated (None = only on compact())
+        """
+        self.path = path
+        self.segment_rows = segment_rows
+        self.flush_bytes = flush_bytes
+        self.flush_interval = flush_interval
+        self.filter_bits = filter_bits
+        self.compact_segments = compact_segments
+        self.use_pyarrow = PYARROW_AVAILABLE if use_pyarrow is None else (use_pyarrow and PYARROW_AVAILABLE)
+        os.makedirs(path, exist_ok=True)
+
+        self._lock = threading.RLock()
+        self._buffer: List[Dict[str, Any]] = []
+        self._buffer_hashes = set()
+        self._buffer_bytes = 0
+        self._buffer_since = 0.0
+        self._hash_maps: Dict[str, Any] = {}
+        self._readers = 0  # scans in progress; compacted files are removed when none are
+        self._retired: List[str] = []
+        self.duplicates_skipped = 0
+        self.segments_compacted = 0
+
+        self._manifest: Dict[str, Any] = {'segments': [], 'next_segment': 1}
+        manifest_path = os.path.join(path, MANIFEST)
+        if os.path.exists(manifest_path):
+            with open(manifest_path) as f:
+                self._manifest = json.load(f)
+        self._remove_orphans()
+        for segment in self._manifest['segments']:
+            if not os.path.exists(self._hash_path(segment['name'])):
+                self._write_hash_file(segment['name'], self._read_hashes(segment))
+        self._rebuild_filter()
+        if self._manifest['segments']:
+            logger.info(f"📚 Training store opened: {self.total_rows} examples in "
+                        f"{len(self._manifest['segments'])} segments ({path})")
+
+    def __len__(self) -> int:
+        return self.total_rows
+
+    @property
+    def total_rows(self) -> int:
+        return sum(segment['rows'] for segment in self._manifest['segments']) + len(self._buffer)
+
+    # ------------------------------------------------------------------
+    # Writing
+    # ------------------------------------------------------------------
+    def append(self, input_text: str, output_text: str, quality_score: float = 0.8,
+               dataset_type: str = "instruction", metadata: Optional[Dict[str, Any]] = None,
+               created_at: Optional[float] = None) -> Optional[str]:
+        """
+        Add an example unless the same (input, output) is already stored
+
+        Returns:
+            Example id, or None for a duplicate
+        """
+        key = content_hash(input_text, output_text)
+        with self._lock:
+            if key in self._buffer_hashes or (key in self._filter and self._is_stored(key)):
+                self.duplicates_skipped += 1
+                return None
+            self._filter.add(key)
+            self._buffer_hashes.add(key)
+            if not self._buffer:
+                self._buffer_since = time.monotonic()
+            self._buffer_bytes += len(input_text) + len(output_text)
+            example_id = f"{key & 0xFFFFFFFFFFFFFFFF:016x}"
+            self._buffer.append({
+                'id': example_id,
+                'content_hash': key,
+                'input': input_text,
+                'output': output_text,
+                'quality_score': float(quality_score),
+                'dataset_type': dataset_type,
+                'metadata': json.dumps(metadata or {}, default=str),
+                'created_at': time.time() if created_at is None else created_at
+            })
+            if (len(self._buffer) >= self.segment_rows or self._buffer_bytes >= self.flush_bytes or
+                    (self.flush_interval is not None and
+                     time.monotonic() - self._buffer_since >= self.flush_interval)):
+                self.flush()
+        return example_id
+
+    def flush(self):
+        """Write buffered rows as a new segment"""
+        with self._lock:
+            if not self._buffer:
+                return
+            rows = self._buffer
+            name = f"seg_{self._manifest['next_segment']:06d}"
+            if self.use_pyarrow:
+                self._write_parquet(name, rows)
+                segment_format = 'parquet'
+            else:
+                self._write_columns(name, rows)
+                segment_format = 'columns'
+            self._write_hash_file(name, self._buffer_hashes)
+
+            self._manifest['segments'].append(self._segment_entry(name, segment_format, rows))
+            self._manifest['next_segment'] += 1
+            self._write_manifest()
+            self._buffer = []
+            self._buffer_hashes = set()
+            self._buffer_bytes = 0
+
+            if self._filter.capacity is not None and self.stored_rows > self._filter.capacity:
+                self._rebuild_filter()
+            if self.compact_segments is not None and sum(
+                    1 for segment in self._manifest['segments']
+                    if segment['rows'] < self.segment_rows // 2) >= self.compact_segments:
+                self.compact()
+
+    def compact(self) -> int:
+        """
+        Merge runs of adjacent segments under half of segment_rows into
+        segments of up to segment_rows rows (insertion order is kept)
+
+        Returns:
+            Segments removed
+        """
+        with self._lock:
+            groups, run = [], []
+            for segment in self._manifest['segments'] + [None]:
+                small = segment is not None and segment['rows'] < self.segment_rows // 2 and (
+                    segment['format'] != 'parquet' or PYARROW_AVAILABLE)
+                if small and sum(s['rows'] for s in run) + segment['rows'] <= self.segment_rows:
+                    run.append(segment)
+                    continue
+                if len(run) > 1:
+                    groups.append(run)
+                run = [segment] if small else []
+            if not groups:
+                return 0
+
+            merged_into = {}
+            for group in groups:
+                rows = [row for segment in group for row in self._segment_rows(segment)]
+                name = f"seg_{self._manifest['next_segment']:06d}"
+                self._manifest['next_segment'] += 1
+                if self.use_pyarrow:
+                    self._write_parquet(name, rows)
+                    segment_format = 'parquet'
+                else:
+                    self._write_columns(name, rows)
+                    segment_format = 'columns'
+                self._write_hash_file(name, (row['content_hash'] for row in rows))
+                merged_into[group[0]['name']] = self._segment_entry(name, segment_format, rows)
+
+            removed = {segment['name'] for group in groups for segment in group}
+            self._manifest['segments'] = [
+                merged_into.get(segment['name'], segment) for segment in self._manifest['segments']
+                if segment['name'] in merged_into or segment['name'] not in removed
+            ]
+            self._write_manifest()
+            for name in removed:
+                self._release_hashes(name)
+            self._retired.extend(removed)
+            if not self._readers:
+                self._remove_retired()
+
+            count = len(removed) - len(groups)
+            self.segments_compacted += count
+            logger.info(f"🗜️ Compacted {len(removed)} training store segments into {len(groups)}")
+            return count
+
+    def close(self):
+        """Flush the write buffer and release the segment hash files"""
+        with self._lock:
+            self.flush()
+            for name in list(self._hash_maps):
+                self._release_hashes(name)
+
+    @staticmethod
+    def _segment_entry(name: str, segment_format: str, rows: List[Dict[str, Any]]) -> Dict[str, Any]:
+        """Manifest entry: row count, zone maps and totals for stats"""
+        qualities = [row['quality_score'] for row in rows]
+        return {
+            'name': name,
+            'format': segment_format,
+            'rows': len(rows),
+            'min_quality': min(qualities),
+            'max_quality': max(qualities),
+            'dataset_types': sorted({row['dataset_type'] for row in rows}),
+            'sum_quality': sum(qualities),
+            'sum_input_chars': sum(len(row['input']) for row in rows),
+            'sum_output_chars': sum(len(row['output']) for row in rows)
+        }
+
+    @property
+    def stored_rows(self) -> int:
+        return sum(segment['rows'] for segment in self._manifest['segments'])
+
+    def _rebuild_filter(self):
+        """Fresh dedup filter sized for the stored rows, filled from the segment hash files"""
+        if self.filter_bits is not None:
+            self._filter = HashFilter(self.filter_bits)
+        else:
+            self._filter = HashFilter.for_capacity(max(2 * self.stored_rows, MIN_FILTER_ROWS))
+        for segment in self._manifest['segments']:
+            for key in self._stored_hashes(segment['name']):
+                self._filter.add(key)
+        for key in self._buffer_hashes:
+            self._filter.add(key)
+
+    def _release_hashes(self, name: str):
+        view, mapped = self._hash_maps.pop(name, (None, None))
+        if view is not None:
+            view.release()
+            mapped.close()
+
+    def _remove_retired(self):
+        for name in self._retired:
+            for suffix in SEGMENT_FILES:
+                try:
+                    os.remove(os.path.join(self.path, name + suffix))
+                except FileNotFoundError:
+                    pass
+        self._retired = []
+
+    def _remove_orphans(self):
+        """Files of segments missing from the manifest (an interrupted flush or compaction)"""
+        names = {segment['name'] for segment in self._manifest['segments']}
+        for filename in os.listdir(self.path):
+            if filename.startswith('seg_') and filename.split('.', 1)[0] not in names:
+                os.remove(os.path.join(self.path, filename))
+
+    def _write_manifest(self):
+        manifest_path = os.path.join(self.path, MANIFEST)
+        tmp_path = f"{manifest_path}.tmp"
+        with open(tmp_path, 'w') as f:
+            json.dump(self._manifest, f)
+        os.replace(tmp_path, manifest_path)
+
+    def _hash_path(self, name: str) -> str:
+        return os.path.join(self.path, f"{name}.hash")
+
+    def _write_hash_file(self, name: str, hashes: Iterable[int]):
+        """<name>.hash: the segment's content hashes, sorted, for dedup lookups"""
+        path = self._hash_path(name)
+        with open(f"{path}.tmp", 'wb') as f:
+            array('q', sorted(hashes)).tofile(f)
+        os.replace(f"{path}.tmp", path)
+
+    def _stored_hashes(self, name: str):
+        """Sorted hashes of a segment, memory-mapped (paged by the OS, not held on the heap)"""
+        if name not in self._hash_maps:
+            with open(self._hash_path(name), 'rb') as f:
+                mapped = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+            self._hash_maps[name] = (memoryview(mapped).cast('q'), mapped)
+        return self._hash_maps[name][0]
+
+    def _is_stored(self, key: int) -> bool:
+        for segment in self._manifest['segments']:
+            hashes = self._stored_hashes(segment['name'])
+            i = bisect.bisect_left(hashes, key)
+            if i < len(hashes) and hashes[i] == key:
+                return True
+        return False
+
+    def _write_parquet(self, name: str, rows: List[Dict[str, Any]]):
+        table = pa.Table.from_pylist(rows, schema=_parquet_schema())
+        path = os.path.join(self.path, f"{name}.parquet")
+        pq.write_table(table, f"{path}.tmp", compression='zstd')
+        os.replace(f"{path}.tmp", path)
+
+    def _write_columns(self, name: str, rows: List[Dict[str, Any]]):
+        """
+        Built-in layout: <name>.rows holds one JSON row per line;
+        <name>.cols holds the filter columns as packed arrays
+        (content_hash, quality, type code, row offset, row length)
+        """
+        types = sorted({row['dataset_type'] for row in rows})
+        type_codes = {dataset_type: code for code, dataset_type in enumerate(types)}
+        hashes, qualities, codes = array('q'), array('d'), array('H')
+        offsets, lengths = array('Q'), array('Q')
+
+        rows_path = os.path.join(self.path, f"{name}.rows")
+        offset = 0
+        with open(f"{rows_path}.tmp", 'wb') as f:
+            for row in rows:
+                line = (json.dumps(row) + "\n").encode('utf-8')
+                f.write(line)
+                hashes.append(row['content_hash'])
+                qualities.append(row['quality_score'])
+                codes.append(type_codes[row['dataset_type']])
+                offsets.append(offset)
+                lengths.append(len(line))
+                offset += len(line)
+
+        cols_path = os.path.join(self.path, f"{name}.cols")
+        with open(f"{cols_path}.tmp", 'wb') as f:
+            header = json.dumps({'rows': len(rows), 'types': types}).encode('utf-8')
+            f.write(len(header).to_bytes(4, 'little'))
+            f.write(header)
+            for column in (hashes, qualities, codes, offsets, lengths):
+                column.tofile(f)
+        os.replace(f"{rows_path}.tmp", rows_path)
+        os.replace(f"{cols_path}.tmp", cols_path)
+
+    # ------------------------------------------------------------------
+    # Reading
+    # ------------------------------------------------------------------
+    def _read_columns(self, name: str):
+        """(types, hashes, qualities, type codes, offsets, lengths) of a built-in segment"""
+        with open(os.path.join(self.path, f"{name}.cols"), 'rb') as f:
+            header = json.loads(f.read(int.from_bytes(f.read(4), 'little')))
+            rows = header['rows']
+            columns = []
+            for typecode in ('q', 'd', 'H', 'Q', 'Q'):
+                column = array(typecode)
+                column.fromfile(f, rows)
+                columns.append(column)
+        return (header['types'], *columns)
+
+    @contextmanager
+    def _reading(self):
+        """Snapshot of (segments, buffered rows) whose files stay on disk until released"""
+        with self._lock:
+            self._readers += 1
+            segments = list(self._manifest['segments'])
+            buffered = list(self._buffer)
+        try:
+            yield segments, buffered
+        finally:
+            with self._lock:
+                self._readers -= 1
+                if not self._readers and self._retired:
+                    self._remove_retired()
+
+    def _segment_rows(self, segment: Dict[str, Any]) -> Iterator[Dict[str, Any]]:
+        """Every row of a segment"""
+        if segment['format'] == 'parquet':
+            return iter(pq.read_table(os.path.join(self.path, f"{segment['name']}.parquet"),
+                                      columns=list(COLUMNS)).to_pylist())
+        return self._scan_columns(segment['name'], float('-inf'), None)
+
+    def _read_hashes(self, segment: Dict[str, Any]) -> Iterable[int]:
+        if segment['format'] == 'parquet':
+            if not PYARROW_AVAILABLE:
+                raise RuntimeError(f"pyarrow is required to read segment {segment['name']}")
+            table = pq.read_table(os.path.join(self.path, f"{segment['name']}.parquet"), columns=['content_hash'])
+            return table.column('content_hash').to_pylist()
+        return self._read_columns(segment['name'])[1]
+
+    @staticmethod
+    def _segment_matches(segment: Dict[str, Any], min_quality: float, types: Optional[frozenset]) -> bool:
+        if segment['max_quality'] < min_quality:
+            return False
+        return types is None or not types.isdisjoint(segment['dataset_types'])
+
+    def scan(self, min_quality: float = 0.0, dataset_types: Optional[Iterable[str]] = None,
+             batch_size: int = 4096) -> Iterator[Dict[str, Any]]:
+        """
+        Stream stored rows with quality_score >= min_quality and (optionally)
+        a dataset_type in dataset_types, in insertion order
+
+        Rows are dicts with the COLUMNS keys (metadata as a JSON string).
+        """
+        types = frozenset(dataset_types) if dataset_types is not None else None
+        with self._reading() as (segments, buffered):
+            for segment in segments:
+                if not self._segment_matches(segment, min_quality, types):
+                    continue
+                if segment['format'] == 'parquet':
+                    yield from self._scan_parquet(segment['name'], min_quality, types, batch_size)
+                else:
+                    yield from self._scan_columns(segment['name'], min_quality, types)
+
+            for row in buffered:
+                if row['quality_score'] >= min_quality and (types is None or row['dataset_type'] in types):
+                    yield row
+
+    def scan_best(self, limit: int, min_quality: float = 0.0,
+                  dataset_types: Optional[Iterable[str]] = None) -> Iterator[Dict[str, Any]]:
+        """
+        Stream the `limit` highest-quality matching rows, in insertion order
+
+        A first pass reads only the quality column; ties at the cutoff
+        go to the earliest rows.
+        """
+        types = frozenset(dataset_types) if dataset_types is not None else None
+        return take_best(self.scan(min_quality, types), self._scan_qualities(min_quality, types),
+                         limit, lambda row: row['quality_score'])
+
+    def _scan_qualities(self, min_quality: float, types: Optional[frozenset]) -> Iterator[float]:
+        """quality_score of every row scan() would yield, in the same order"""
+        with self._reading() as (segments, buffered):
+            for segment in segments:
+                if not self._segment_matches(segment, min_quality, types):
+                    continue
+                if segment['format'] == 'parquet':
+                    expression = pads.field('quality_score') >= min_quality
+                    if types is not None:
+                        expression = expression & pads.field('dataset_type').isin(sorted(types))
+                    dataset = pads.dataset(os.path.join(self.path, f"{segment['name']}.parquet"), format='parquet')
+                    for batch in dataset.to_batches(columns=['quality_score'], filter=expression):
+                        yield from batch.column(0).to_pylist()
+                    continue
+                segment_types, _, qualities, codes, _, _ = self._read_columns(segment['name'])
+                wanted = None if types is None else {
+                    code for code, dataset_type in enumerate(segment_types) if dataset_type in types
+                }
+                for i, quality in enumerate(qualities):
+                    if quality >= min_quality and (wanted is None or codes[i] in wanted):
+                        yield quality
+            for row in buffered:
+                if row['quality_score'] >= min_quality and (types is None or row['dataset_type'] in types):
+                    yield row['quality_score']
+
+    def _scan_parquet(self, name: str, min_quality: float, types: Optional[frozenset],
+                      batch_size: int) -> Iterator[Dict[str, Any]]:
+        if not PYARROW_AVAILABLE:
+            raise RuntimeError(f"pyarrow is required to read segment {name}")
+        expression = pads.field('quality_score') >= min_quality
+        if types is not None:
+            expression = expression & pads.field('dataset_type').isin(sorted(types))
+        dataset = pads.dataset(os.path.join(self.path, f"{name}.parquet"), format='parquet')
+        for batch in dataset.to_batches(columns=list(COLUMNS), filter=expression, batch_size=batch_size):
+            yield from batch.to_pylist()
+
+    def _scan_columns(self, name: str, min_quality: float,
+                      types: Optional[frozenset]) -> Iterator[Dict[str, Any]]:
+        segment_types, _, qualities, codes, offsets, lengths = self._read_columns(name)
+        codes_wanted = None
+        if types is not None:
+            codes_wanted = {code for code, dataset_type in enumerate(segment_types) if dataset_type in types}
+        with open(os.path.join(self.path, f"{name}.rows"), 'rb') as f:
+            for i, quality in enumerate(qualities):
+                if quality < min_quality or (codes_wanted is not None and codes[i] not in codes_wanted):
+                    continue
+                f.seek(offsets[i])
+                yield json.loads(f.read(lengths[i]))
+
+    def count(self, min_quality: float = 0.0, dataset_types: Optional[Iterable[str]] = None) -> int:
+        """Rows matching the predicate (reads only filter columns)"""
+        types = frozenset(dataset_types) if dataset_types is not None else None
+        with self._reading() as (segments, buffered):
+            return self._count(segments, buffered, min_quality, types)
+
+    def _count(self, segments: List[Dict[str, Any]], buffered: List[Dict[str, Any]],
+               min_quality: float, types: Optional[frozenset]) -> int:
+        total = 0
+        for segment in segments:
+            if not self._segment_matches(segment, min_quality, types):
+                continue
+            if segment['min_quality'] >= min_quality and (
+                    types is None or types.issuperset(segment['dataset_types'])):
+                total += segment['rows']  # whole segment matches
+            elif segment['format'] == 'parquet':
+                expression = pads.field('quality_score') >= min_quality
+                if types is not None:
+                    expression = expression & pads.field('dataset_type').isin(sorted(types))
+                dataset = pads.dataset(os.path.join(self.path, f"{segment['name']}.parquet"), format='parquet')
+                total += dataset.count_rows(filter=expression)
+            else:
+                segment_types, _, qualities, codes, _, _ = self._read_columns(segment['name'])
+                wanted = None if types is None else {
+                    code for code, dataset_type in enumerate(segment_types) if dataset_type in types
+                }
+                total += sum(1 for i, quality in enumerate(qualities)
+                             if quality >= min_quality and (wanted is None or codes[i] in wanted))
+
+        total += sum(1 for row in buffered if row['quality_score'] >= min_quality and
+                     (types is None or row['dataset_type'] in types))
+        return total
+
+    # ------------------------------------------------------------------
+    # Export and stats
+    # ------------------------------------------------------------------
+    def export_jsonl(self, output_path: str, format_type: str = "openai", min_quality: float = 0.7,
+                     dataset_types: Optional[Iterable[str]] = None,
+                     max_examples: Optional[int] = None) -> int:
+        """
+        Stream matching rows to a JSONL file
+
+        Args:
+            output_path: Destination file
+            format_type: 'openai', 'alpaca' or 'raw'
+            min_quality: Minimum quality score
+            dataset_types: Only these dataset types (None = all)
+            max_examples: Only this many highest-quality rows (still in
+                insertion order; see scan_best())
+
+        Returns:
+            Rows written
+        """
+        if max_examples is None:
+            rows = self.scan(min_quality, dataset_types)
+        else:
+            rows = self.scan_best(max_examples, min_quality, dataset_types)
+        written = 0
+        tmp_path = f"{output_path}.tmp"
+        with open(tmp_path, 'w', encoding='utf-8') as f:
+            for row in rows:
+                if format_type not in ("openai", "alpaca"):
+                    row = dict(row, metadata=json.loads(row['metadata']))
+                f.write(json.dumps(format_example(row, format_type), ensure_ascii=False))
+                f.write("\n")
+                written += 1
+        os.replace(tmp_path, output_path)
+        logger.info(f"📤 Exported {written} examples ({format_type}) to {output_path}")
+        return written
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Totals from the manifest and write buffer (no row reads)"""
+        with self._lock:
+            segments = list(self._manifest['segments'])
+            buffered = list(self._buffer)
+        rows = sum(segment['rows'] for segment in segments) + len(buffered)
+        sum_quality = sum(segment['sum_quality'] for segment in segments) + sum(
+            row['quality_score'] for row in buffered)
+        sum_input = sum(segment['sum_input_chars'] for segment in segments) + sum(
+            len(row['input']) for row in buffered)
+        sum_output = sum(segment['sum_output_chars'] for segment in segments) + sum(
+            len(row['output']) for row in buffered)
+        return {
+            'rows': rows,
+            'segments': len(segments),
+            'buffered_rows': len(buffered),
+            'duplicates_skipped': self.duplicates_skipped,
+            'segments_compacted': self.segments_compacted,
+            'filter_bits': self._filter.bits,
+            'avg_quality_score': sum_quality / rows if rows else 0.0,
+            'avg_input_length': sum_input / rows if rows else 0.0,
+            'avg_output_length': sum_output / rows if rows else 0.0,
+            'format': 'parquet' if self.use_pyarrow else 'columns'
+        }
+
+
+def _parquet_schema():
+    return pa.schema([
+        ('id', pa.string()),
+        ('content_hash', pa.int64()),
+        ('input', pa.string()),
+        ('output', pa.string()),
+        ('quality_score', pa.float64()),
+        ('dataset_type', pa.string()),
+        ('metadata', pa.string()),
+        ('created_at', pa.float64())
+    ])
+
+
+# Example usage
+if __name__ == "__main__":
+    import tempfile
+
+    print("=" * 70)
+    print("TRAINING STORE - Columnar, Deduplicated, Streaming Export")
+    print("=" * 70)
+
+    directory = tempfile.mkdtemp(prefix="training_store_")
+    store = TrainingStore(directory, segment_rows=20000)
+    start = time.perf_counter()
+    for i in range(100000):
+        store.append(f"Question {i % 60000}?", f"Answer {i % 60000}.",
+                     quality_score=(i % 10) / 10, dataset_type="qa" if i % 3 else "conversation")
+    store.flush()
+    print(f"\nAppended 100,000 rows in {time.perf_counter() - start:.2f}s "
+          f"({store.duplicates_skipped} duplicates skipped)")
+    print(f"Stats: {store.get_stats()}")
+
+    start = time.perf_counter()
+    print(f"\nquality >= 0.8 and type 'qa': {store.count(0.8, ['qa'])} rows "
+          f"({(time.perf_counter() - start) * 1000:.1f} ms)")
+
+    output = os.path.join(directory, "train.jsonl")
+    start = time.perf_counter()
+    written = store.export_jsonl(output, "alpaca", min_quality=0.8, dataset_types=["qa"])
+    print(f"Exported {written} alpaca rows in {time.perf_counter() - start:.2f}s")
+
+    print("\n" + "=" * 70)
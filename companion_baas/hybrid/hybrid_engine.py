@@ -25,6 +25,13 @@ import time
 from collections import defaultdict
 import pickle
 import os
+import sys
+
+try:
+    from companion_baas.core.graph_store import GraphStore
+except ImportError:
+    sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    from core.graph_store import GraphStore
 
 
 # ============================================================================
@@ -370,55 +377,34 @@ class KnowledgeGraph:
     Graph-based knowledge representation
     
     Stores relationships and enables graph traversal
+    (backed by the shared GraphStore: hashed node lookup, typed adjacency)
     """
     
     def __init__(self):
-        self.nodes = {}  # entity_id -> properties
-        self.edges = defaultdict(list)  # (from_id, relation) -> [to_ids]
+        self.graph = GraphStore()
+    
+    @property
+    def nodes(self) -> Dict:
+        """entity_id -> properties"""
+        return {self.graph.key(i): self.graph.data(i) for i in range(len(self.graph))}
     
     def add_node(self, entity_id: str, properties: Dict):
         """Add entity node"""
-        self.nodes[entity_id] = properties
+        self.graph.add_node(entity_id, properties, replace=True)
     
     def add_edge(self, from_id: str, relation: str, to_id: str):
         """Add relationship edge"""
-        self.edges[(from_id, relation)].append(to_id)
+        self.graph.add_edge(from_id, relation, to_id)
     
     def get_neighbors(self, entity_id: str, relation: Optional[str] = None) -> List:
         """Get related entities"""
-        if relation:
-            return self.edges.get((entity_id, relation), [])
-        else:
-            # Get all neighbors
-            neighbors = []
-            for (eid, rel), targets in self.edges.items():
-                if eid == entity_id:
-                    neighbors.extend(targets)
-            return neighbors
+        return self.graph.neighbors(entity_id, relation)
     
     def query_path(self, start: str, end: str, max_depth: int = 3) -> Optional[List]:
-        """Find path between entities"""
-        # BFS to find shortest path
-        from collections import deque
-        
-        queue = deque([(start, [start])])
-        visited = {start}
-        
-        while queue:
-            current, path = queue.popleft()
-            
-            if len(path) > max_depth:
-                continue
-            
-            if current == end:
-                return path
-            
-            for neighbor in self.get_neighbors(current):
-                if neighbor not in visited:
-                    visited.add(neighbor)
-                    queue.append((neighbor, path + [neighbor]))
-        
-        return None
+        """Find path between entities (at most max_depth entities long)"""
+        if start == end:
+            return [start]
+        return self.graph.shortest_path(start, end, max_hops=max_depth - 1)
 
 
 # ============================================================================
@@ -7,20 +7,18 @@ import logging
 from typing import List, Optional, Union
 import numpy as np
 
-try:
-    from sentence_transformers import SentenceTransformer
-    SENTENCE_TRANSFORMERS_AVAILABLE = True
-except ImportError:
-    SENTENCE_TRANSFORMERS_AVAILABLE = False
-
 # Try relative import first, fallback to absolute
 try:
     from ..config import get_config
+    from companion_baas.optimization.embedding_service import (
+        get_embedding_service, SENTENCE_TRANSFORMERS_AVAILABLE
+    )
 except ImportError:
     import sys
     import os
     sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
     from config import get_config
+    from optimization.embedding_service import get_embedding_service, SENTENCE_TRANSFORMERS_AVAILABLE
 
 logger = logging.getLogger(__name__)
 
@@ -44,18 +42,16 @@ class VectorStore:
             self.enabled = False
             return
         
-        try:
-            # Load embedding model
-            logger.info(f"Loading embedding model: {config.embedding_model}")
-            self.model = SentenceTransformer(config.embedding_model)
-            self.vector_dim = config.vector_dim
-            self.enabled = True
+        # Shared embedding service: the model is loaded once per process
+        logger.info(f"Loading embedding model: {config.embedding_model}")
+        self.embedder = get_embedding_service(config.embedding_model)
+        self.model = self.embedder.load()
+        self.vector_dim = config.vector_dim
+        self.enabled = self.model is not None
+        if self.enabled:
             logger.info(f"✅ Vector store initialized (dim={self.vector_dim})")
-            
-        except Exception as e:
-            logger.error(f"❌ Failed to load embedding model: {e}")
-            self.model = None
-            self.enabled = False
+        else:
+            logger.error(f"❌ Failed to load embedding model: {config.embedding_model}")
     
     def encode_text(self, text: str) -> Optional[List[float]]:
         """
@@ -71,8 +67,10 @@ class VectorStore:
             return None
         
         try:
-            # Generate embedding
-            embedding = self.model.encode(text, convert_to_numpy=True)
+            # Generate embedding (cached, micro-batched with concurrent callers)
+            embedding = self.embedder.encode(text)
+            if embedding is None:
+                return None
             
             # Convert to list
             embedding_list = embedding.tolist()
@@ -109,8 +107,10 @@ class VectorStore:
             return None
         
         try:
-            # Batch encode for efficiency
-            embeddings = self.model.encode(texts, convert_to_numpy=True, show_progress_bar=False)
+            # Batch encode for efficiency (cache hits skip the model)
+            embeddings = self.embedder.encode_many(texts)
+            if embeddings is None:
+                return None
             
             # Convert to list of lists
             embeddings_list = [emb.tolist() for emb in embeddings]
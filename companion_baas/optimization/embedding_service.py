@@ -0,0 +1,323 @@
+"""
+Embedding Service - Phase 5: Optimization
+
+One sentence-transformer per model name per process, shared by every
+embedding consumer (semantic cache, vector store, thought space,
+consensus scoring) instead of each loading its own copy.
+
+- Lazy, thread-safe model load; optional CPU backends via
+  COMPANION_EMBEDDING_BACKEND: 'onnx' (ONNX Runtime through
+  sentence-transformers' backend support) or 'int8' (dynamic int8
+  quantization of the Linear layers). Falls back to the default backend
+  if the optional one cannot load.
+- Micro-batching: concurrent encode() calls arriving within a few
+  milliseconds are encoded in one model call.
+- LRU of recent text -> vector results (vectors are read-only arrays).
+"""
+
+import os
+import sys
+import time
+import logging
+import threading
+from collections import OrderedDict
+from concurrent.futures import Future
+from typing import Any, Dict, List, Optional
+
+logger = logging.getLogger(__name__)
+
+try:
+    import numpy as np
+    HAS_NUMPY = True
+except ImportError:
+    np = None
+    HAS_NUMPY = False
+
+try:
+    from sentence_transformers import SentenceTransformer
+    SENTENCE_TRANSFORMERS_AVAILABLE = True
+except ImportError:
+    SentenceTransformer = None
+    SENTENCE_TRANSFORMERS_AVAILABLE = False
+
+DEFAULT_EMBEDDING_MODEL = 'all-MiniLM-L6-v2'
+
+
+class EmbeddingService:
+    """
+    Shared, micro-batched, cached text embedder
+
+    Features:
+    - Model loaded once (optionally ONNX or int8-quantized)
+    - Concurrent single-text requests coalesced into one batch
+    - LRU cache of recent embeddings
+    """
+
+    def __init__(
+        self,
+        model_name: str = DEFAULT_EMBEDDING_MODEL,
+        backend: Optional[str] = None,
+        cache_size: int = 4096,
+        batch_window_ms: float = 5.0,
+        max_batch: int = 64
+    ):
+        """
+        Initialize service (the model loads on first use)
+
+        Args:
+            model_name: Sentence-transformer model name
+            backend: 'torch' (default), 'onnx' or 'int8'
+            cache_size: Embeddings kept in the LRU
+            batch_window_ms: How long the batcher waits for more requests
+            max_batch: Largest batch sent to the model
+        """
+        self.model_name = model_name
+        self.backend = (backend or os.getenv('COMPANION_EMBEDDING_BACKEND', 'torch')).lower()
+        self.cache_size = cache_size
+        self.batch_window = batch_window_ms / 1000.0
+        self.max_batch = max_batch
+
+        self.model = None
+        self._load_failed = False
+        self._load_lock = threading.Lock()
+
+        self._cache: "OrderedDict[str, Any]" = OrderedDict()
+        self._cache_lock = threading.Lock()
+
+        self._pending: List[tuple] = []  # (text, Future)
+        self._pending_cond = threading.Condition()
+        self._worker: Optional[threading.Thread] = None
+
+        self.stats = {
+            'requests': 0,
+            'cache_hits': 0,
+            'texts_encoded': 0,
+            'batches': 0,
+            'encode_seconds': 0.0
+        }
+
+    # ------------------------------------------------------------------
+    # Model loading
+    # ------------------------------------------------------------------
+    @property
+    def available(self) -> bool:
+        """Whether embeddings can be produced (deps installed, model loadable)"""
+        return self.load() is not None
+
+    def load(self):
+        """Load the model once; returns it, or None when unavailable"""
+        if self.model is not None or self._load_failed:
+            return self.model
+        if not (HAS_NUMPY and SENTENCE_TRANSFORMERS_AVAILABLE):
+            self._load_failed = True
+            return None
+        with self._load_lock:
+            if self.model is None and not self._load_failed:
+                try:
+                    self.model = self._load_backend()
+                    logger.info(f"✅ Embedding model loaded: {self.model_name} (backend={self.backend})")
+                except Exception as e:
+                    logger.warning(f"⚠️ Failed to load embedding model {self.model_name}: {e}")
+                    self._load_failed = True
+        return self.model
+
+    def _load_backend(self):
+        """Instantiate the model for the configured backend"""
+        if self.backend == 'onnx':
+            try:
+                return SentenceTransformer(self.model_name, backend='onnx')
+            except Exception as e:
+                logger.warning(f"⚠️ ONNX embedding backend unavailable ({e}), using default")
+        model = SentenceTransformer(self.model_name)
+        if self.backend == 'int8':
+            try:
+                import torch
+                model = torch.quantization.quantize_dynamic(model, {torch.nn.Linear}, dtype=torch.qint8)
+            except Exception as e:
+                logger.warning(f"⚠️ int8 quantization unavailable ({e}), using float model")
+        return model
+
+    # ------------------------------------------------------------------
+    # Cache
+    # ------------------------------------------------------------------
+    def _cache_get(self, text: str):
+        with self._cache_lock:
+            vector = self._cache.get(text)
+            if vector is not None:
+                self._cache.move_to_end(text)
+                self.stats['cache_hits'] += 1
+            return vector
+
+    def _cache_put(self, text: str, vector):
+        vector.setflags(write=False)  # shared between callers
+        with self._cache_lock:
+            self._cache[text] = vector
+            self._cache.move_to_end(text)
+            while len(self._cache) > self.cache_size:
+                self._cache.popitem(last=False)
+
+    # ------------------------------------------------------------------
+    # Encoding
+    # ------------------------------------------------------------------
+    def _encode_batch(self, texts: List[str]) -> List[Any]:
+        """One model call for a list of texts"""
+        start = time.perf_counter()
+        vectors = self.model.encode(texts, convert_to_numpy=True, show_progress_bar=False)
+        self.stats['encode_seconds'] += time.perf_counter() - start
+        self.stats['batches'] += 1
+        self.stats['texts_encoded'] += len(texts)
+        return [np.asarray(v, dtype=np.float32) for v in vectors]
+
+    def encode(self, text: str):
+        """
+        Embed one text (cached; coalesced with concurrent callers)
+
+        Returns:
+            numpy vector, or None when embeddings are unavailable
+        """
+        self.stats['requests'] += 1
+        vector = self._cache_get(text)
+        if vector is not None:
+            return vector
+        if self.load() is None:
+            return None
+
+        future: Future = Future()
+        with self._pending_cond:
+            self._pending.append((text, future))
+            if self._worker is None or not self._worker.is_alive():
+                self._worker = threading.Thread(target=self._batch_loop, name="embedding_batcher", daemon=True)
+                self._worker.start()
+            self._pending_cond.notify()
+        try:
+            return future.result()
+        except Exception as e:
+            logger.warning(f"Embedding computation failed: {e}")
+            return None
+
+    def encode_many(self, texts: List[str]) -> Optional[List[Any]]:
+        """
+        Embed several texts: cache hits plus one batched call for the rest
+
+        Returns:
+            List of numpy vectors (input order), or None when unavailable
+        """
+        self.stats['requests'] += len(texts)
+        results: List[Any] = [self._cache_get(text) for text in texts]
+        missing = sorted({text for text, vector in zip(texts, results) if vector is None})
+        if missing:
+            if self.load() is None:
+                return None
+            try:
+                encoded = dict(zip(missing, self._encode_batch(missing)))
+            except Exception as e:
+                logger.warning(f"Batch embedding failed: {e}")
+                return None
+            for text, vector in encoded.items():
+                self._cache_put(text, vector)
+            results = [vector if vector is not None else encoded[text] for text, vector in zip(texts, results)]
+        return results
+
+    def _batch_loop(self):
+        """Collect requests for batch_window, encode them together, repeat"""
+        while True:
+            with self._pending_cond:
+                if not self._pending:
+                    # Idle: exit after a while, encode() restarts the worker
+                    self._pending_cond.wait(timeout=30.0)
+                    if not self._pending:
+                        self._worker = None
+                        return
+                deadline = time.monotonic() + self.batch_window
+                while len(self._pending) < self.max_batch:
+                    remaining = deadline - time.monotonic()
+                    if remaining <= 0:
+                        break
+                    self._pending_cond.wait(timeout=remaining)
+                batch, self._pending = self._pending[:self.max_batch], self._pending[self.max_batch:]
+
+            texts = list(dict.fromkeys(text for text, _ in batch))
+            try:
+                encoded = dict(zip(texts, self._encode_batch(texts)))
+                for text, vector in encoded.items():
+                    self._cache_put(text, vector)
+                for text, future in batch:
+                    future.set_result(encoded[text])
+            except Exception as e:
+                for _, future in batch:
+                    if not future.done():
+                        future.set_exception(e)
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Load state, cache and batching efficiency"""
+        stats = dict(self.stats)
+        requests = stats['requests']
+        stats.update({
+            'model': self.model_name,
+            'backend': self.backend,
+            'loaded': self.model is not None,
+            'cache_size': len(self._cache),
+            'cache_hit_rate': stats['cache_hits'] / requests if requests else 0.0,
+            'avg_batch_size': stats['texts_encoded'] / stats['batches'] if stats['batches'] else 0.0,
+            'avg_encode_ms_per_text': (
+                stats['encode_seconds'] / stats['texts_encoded'] * 1000 if stats['texts_encoded'] else 0.0
+            )
+        })
+        return stats
+
+
+def _shared_services() -> Dict[str, EmbeddingService]:
+    """
+    Reuse the service registry if this module was already imported under
+    its other name (companion_baas.optimization.* vs optimization.*), so
+    the model is loaded once per process either way.
+    """
+    for alias in ("companion_baas.optimization.embedding_service", "optimization.embedding_service"):
+        module = sys.modules.get(alias)
+        if module is not None and module is not sys.modules.get(__name__):
+            existing = getattr(module, "_services", None)
+            if existing is not None:
+                return existing
+    return {}
+
+
+_services = _shared_services()
+_services_lock = threading.Lock()
+
+
+def get_embedding_service(model_name: str = DEFAULT_EMBEDDING_MODEL) -> EmbeddingService:
+    """Process-wide embedding service for a model name"""
+    service = _services.get(model_name)
+    if service is None:
+        with _services_lock:
+            service = _services.get(model_name)
+            if service is None:
+                service = _services[model_name] = EmbeddingService(model_name)
+    return service
+
+
+# Example usage
+if __name__ == "__main__":
+    from concurrent.futures import ThreadPoolExecutor
+
+    print("=" * 70)
+    print("EMBEDDING SERVICE - Shared, Micro-Batched, Cached")
+    print("=" * 70)
+
+    service = get_embedding_service()
+    if not service.available:
+        print("\n⚠️ numpy / sentence-transformers not installed - service reports unavailable")
+        print(f"   encode() -> {service.encode('hello')}")
+    else:
+        texts = [f"query number {i % 50}" for i in range(400)]
+        start = time.perf_counter()
+        with ThreadPoolExecutor(max_workers=16) as pool:
+            list(pool.map(service.encode, texts))
+        elapsed = time.perf_counter() - start
+        stats = service.get_stats()
+        print(f"\n{len(texts)} concurrent encodes in {elapsed:.2f}s")
+        print(f"  batches: {stats['batches']}, avg batch size: {stats['avg_batch_size']:.1f}")
+        print(f"  cache hit rate: {stats['cache_hit_rate']:.0%}")
+        print(f"  same instance for every consumer: {get_embedding_service() is service}")
+
+    print("\n" + "=" * 70)
@@ -0,0 +1,282 @@
+"""
+Hedged Requests - Phase 5: Optimization
+
+Tail-latency reduction by racing a backup request against a slow primary.
+
+The primary call starts immediately. If it has not produced a usable
+answer `hedge_delay` after a worker picked it up (normally the primary
+model's observed p90 latency; time spent queued for a worker does not
+count), a second call goes to an alternate provider/model. The first
+usable answer wins and the loser is cancelled: a queued loser never
+starts, a running loser gets its cancel event set so it stops retrying
+(an HTTP call already in flight finishes in the background and its
+result is discarded).
+
+HedgeBudget caps the extra spend per tenant with a token bucket: each
+primary request earns `ratio` hedge tokens (up to `burst`), each hedge
+spends one, so at most ~ratio extra calls are made on top of normal
+traffic no matter how slow a provider gets.
+"""
+
+import time
+import logging
+import threading
+from concurrent.futures import ThreadPoolExecutor, FIRST_COMPLETED, wait
+from dataclasses import dataclass
+from typing import Any, Callable, Dict, Optional
+
+logger = logging.getLogger(__name__)
+
+# A hedged call receives the cancel event it must honour between attempts
+HedgeCall = Callable[[threading.Event], Any]
+
+
+class HedgeBudget:
+    """
+    Per-tenant hedge budget (token bucket)
+
+    Features:
+    - Hedges limited to `ratio` of each tenant's primary requests
+    - Short bursts allowed up to `burst` hedges
+    - Per-tenant counters for requests, hedges and denials
+    """
+
+    def __init__(self, ratio: float = 0.1, burst: float = 5.0):
+        """
+        Initialize budget
+
+        Args:
+            ratio: Hedge tokens earned per primary request (0.1 = 10% extra calls)
+            burst: Maximum tokens a tenant can bank
+        """
+        self.ratio = ratio
+        self.burst = burst
+        self._tokens: Dict[str, float] = {}
+        self._stats: Dict[str, Dict[str, int]] = {}
+        self._lock = threading.Lock()
+
+    def _tenant_stats(self, tenant: str) -> Dict[str, int]:
+        stats = self._stats.get(tenant)
+        if stats is None:
+            stats = self._stats[tenant] = {'requests': 0, 'hedges': 0, 'denied': 0}
+        return stats
+
+    def record_request(self, tenant: str):
+        """Credit a tenant for one primary request"""
+        with self._lock:
+            self._tokens[tenant] = min(self.burst, self._tokens.get(tenant, self.burst) + self.ratio)
+            self._tenant_stats(tenant)['requests'] += 1
+
+    def try_acquire(self, tenant: str) -> bool:
+        """Spend one hedge token; False when the tenant is over budget"""
+        with self._lock:
+            tokens = self._tokens.get(tenant, self.burst)
+            stats = self._tenant_stats(tenant)
+            if tokens < 1.0:
+                stats['denied'] += 1
+                return False
+            self._tokens[tenant] = tokens - 1.0
+            stats['hedges'] += 1
+            return True
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Per-tenant usage and remaining tokens"""
+        with self._lock:
+            return {
+                tenant: {
+                    **stats,
+                    'hedge_rate': stats['hedges'] / stats['requests'] if stats['requests'] else 0.0,
+                    'tokens': round(self._tokens.get(tenant, self.burst), 2)
+                }
+                for tenant, stats in self._stats.items()
+            }
+
+
+@dataclass
+class HedgeOutcome:
+    """Result of a hedged call"""
+    result: Any
+    winner: str            # 'primary' or 'hedge'
+    hedged: bool           # a backup request was sent
+    latency: float         # seconds until the winning answer
+
+
+class HedgedExecutor:
+    """
+    Runs a primary call with an optional delayed backup call
+
+    Features:
+    - Backup fires hedge_delay after the primary starts running, or at once
+      if the primary fails early
+    - First usable answer wins; the loser is cancelled
+    - Backups gated by a per-tenant HedgeBudget
+    """
+
+    def __init__(
+        self,
+        budget: Optional[HedgeBudget] = None,
+        max_workers: int = 32,
+        min_delay: float = 0.05
+    ):
+        """
+        Initialize executor
+
+        Args:
+            budget: Hedge budget (shared process-wide by default)
+            max_workers: Threads for in-flight primary and backup calls
+            min_delay: Lower bound on the hedge delay (seconds)
+        """
+        self.budget = budget or hedge_budget
+        self.min_delay = min_delay
+        self._pool = ThreadPoolExecutor(max_workers=max_workers, thread_name_prefix="hedge")
+        self.stats = {'calls': 0, 'hedged': 0, 'hedge_wins': 0, 'denied': 0, 'failures': 0}
+        self._lock = threading.Lock()
+
+    def _count(self, key: str):
+        with self._lock:
+            self.stats[key] += 1
+
+    def call(
+        self,
+        primary: HedgeCall,
+        alternate: Optional[HedgeCall],
+        hedge_delay: float,
+        tenant: str = 'default',
+        is_usable: Callable[[Any], bool] = lambda result: result is not None,
+        on_hedge: Optional[Callable[[str], None]] = None
+    ) -> HedgeOutcome:
+        """
+        Run primary, hedging to alternate when it is slow or fails
+
+        Args:
+            primary: Primary call, given its cancel event
+            alternate: Backup call (None disables hedging for this request)
+            hedge_delay: Seconds the primary may run before hedging
+            tenant: Budget bucket to charge
+            is_usable: Whether a result counts as an answer
+            on_hedge: Callback with the outcome ('fired', 'won', 'lost', 'denied')
+
+        Returns:
+            HedgeOutcome with the winning result
+
+        Raises:
+            The primary's exception (or the backup's, if it ran last) when
+            no call produced a usable answer
+        """
+        self._count('calls')
+        self.budget.record_request(tenant)
+        notify = on_hedge or (lambda outcome: None)
+        start = time.perf_counter()
+
+        delay = max(hedge_delay, self.min_delay)
+        primary_started = []  # perf_counter() when a worker picked the primary up
+
+        def run_primary(cancel_event: threading.Event) -> Any:
+            primary_started.append(time.perf_counter())
+            return primary(cancel_event)
+
+        cancels = {'primary': threading.Event(), 'hedge': threading.Event()}
+        futures = {self._pool.submit(run_primary, cancels['primary']): 'primary'}
+        hedged = False
+        last_error: Optional[BaseException] = None
+        last_result: Any = None
+
+        while futures:
+            timeout = None
+            if not hedged and alternate is not None:
+                # A queued primary has not used any of its delay yet
+                started = primary_started[0] if primary_started else time.perf_counter()
+                timeout = max(0.0, started + delay - time.perf_counter())
+            done, _ = wait(list(futures), timeout=timeout, return_when=FIRST_COMPLETED)
+
+            for future in done:
+                name = futures.pop(future)
+                try:
+                    result = future.result()
+                except Exception as e:
+                    last_error = e
+                    continue
+                if is_usable(result):
+                    for loser, loser_name in futures.items():
+                        cancels[loser_name].set()
+                        loser.cancel()
+                    if hedged:
+                        notify('won' if name == 'hedge' else 'lost')
+                        if name == 'hedge':
+                            self._count('hedge_wins')
+                    return HedgeOutcome(result, name, hedged, time.perf_counter() - start)
+                last_result = result
+
+            # Hedge when the primary has run too long or has already failed
+            slow = not done and primary_started and time.perf_counter() >= primary_started[0] + delay
+            if not hedged and alternate is not None and (slow or not futures):
+                hedged = True
+                if self.budget.try_acquire(tenant):
+                    self._count('hedged')
+                    notify('fired')
+                    logger.debug(f"🏁 Hedging request for tenant '{tenant}' after {time.perf_counter() - start:.2f}s")
+                    futures[self._pool.submit(alternate, cancels['hedge'])] = 'hedge'
+                else:
+                    self._count('denied')
+                    notify('denied')
+
+        self._count('failures')
+        if last_error is not None and last_result is None:
+            raise last_error
+        return HedgeOutcome(last_result, 'primary', hedged, time.perf_counter() - start)
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Executor counters plus per-tenant budget usage"""
+        with self._lock:
+            stats = dict(self.stats)
+        stats['hedge_win_rate'] = stats['hedge_wins'] / stats['hedged'] if stats['hedged'] else 0.0
+        stats['tenants'] = self.budget.get_stats()
+        return stats
+
+    def shutdown(self):
+        """Stop worker threads (in-flight calls finish)"""
+        self._pool.shutdown(wait=False)
+
+
+# Global hedge budget (one bucket per tenant, shared by every brain)
+hedge_budget = HedgeBudget()
+
+
+# Example usage
+if __name__ == "__main__":
+    import random
+
+    print("=" * 70)
+    print("HEDGED REQUESTS - Tail Latency Reduction")
+    print("=" * 70)
+
+    def slow_provider(cancel: threading.Event) -> str:
+        # 10% of calls hit a 2s stall
+        time.sleep(2.0 if random.random() < 0.1 else 0.05)
+        return "primary answer"
+
+    def backup_provider(cancel: threading.Event) -> str:
+        time.sleep(0.08)
+        return "backup answer"
+
+    def p99(samples):
+        ordered = sorted(samples)
+        return ordered[int(0.99 * (len(ordered) - 1))]
+
+    random.seed(7)
+    executor = HedgedExecutor(HedgeBudget(ratio=0.2))
+    plain, hedged = [], []
+    for _ in range(100):
+        start = time.perf_counter()
+        slow_provider(threading.Event())
+        plain.append(time.perf_counter() - start)
+        hedged.append(executor.call(slow_provider, backup_provider, hedge_delay=0.1, tenant='demo').latency)
+
+    print(f"\nWithout hedging: p99={p99(plain):.2f}s")
+    print(f"With hedging:    p99={p99(hedged):.2f}s")
+    stats = executor.get_stats()
+    print(f"Hedges sent: {stats['hedged']} / {stats['calls']} calls, win rate {stats['hedge_win_rate']:.0%}")
+    print(f"Tenant budget: {stats['tenants']['demo']}")
+    executor.shutdown()
+
+    print("\n" + "=" * 70)
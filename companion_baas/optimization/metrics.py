@@ -0,0 +1,592 @@
+"""
+Metrics - Phase 5: Optimization
+
+Prometheus-compatible metrics with lock-free hot-path updates.
+
+Every metric child keeps one preallocated slot array per writer thread,
+so inc()/observe() never take a lock and never allocate after the first
+call from a thread. Scrapes sum the per-thread shards; shards of threads
+that have exited are folded into a base value, so short-lived threads
+do not accumulate.
+
+Usage:
+    from optimization.metrics import metrics
+
+    metrics.llm_latency.labels('groq', 'llama3-8b-8192').observe(0.42)
+    metrics.cache_events.labels('semantic', 'hit').inc()
+
+    # Serve /metrics on a web app
+    instrument_fastapi(app)   # or instrument_flask(app)
+"""
+
+import sys
+import math
+import time
+import weakref
+import threading
+from bisect import bisect_left
+from typing import Dict, List, Optional, Sequence, Tuple
+
+# Prometheus text exposition format version 0.0.4
+CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8"
+
+# Default latency buckets in seconds (LLM calls run up to tens of seconds)
+DEFAULT_BUCKETS = (0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0)
+
+
+def _escape_label_value(value: str) -> str:
+    """Escape a label value for the text format"""
+    return value.replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+
+
+def _format_value(value: float) -> str:
+    """Format a sample value (integers without trailing .0, NaN / +Inf / -Inf spelled out)"""
+    if math.isnan(value):
+        return "NaN"
+    if math.isinf(value):
+        return "+Inf" if value > 0 else "-Inf"
+    if value == int(value) and abs(value) < 1e15:
+        return str(int(value))
+    return repr(float(value))
+
+
+class _ShardedChild:
+    """
+    One labelled time series backed by per-thread slot arrays
+
+    Writers only touch their own thread's array (plain list item
+    assignment), so updates are lock-free. The lock is only taken the
+    first time a thread writes to this child, and on scrape. Arrays of
+    exited threads are folded into _base (nothing writes to them anymore),
+    so the shard list stays bounded by the number of live writer threads.
+    """
+
+    __slots__ = ("_size", "_local", "_shards", "_base", "_lock")
+
+    def __init__(self, size: int):
+        self._size = size
+        self._local = threading.local()
+        # (owner thread ref, slot array)
+        self._shards: List[Tuple[weakref.ref, List[float]]] = []
+        self._base = [0.0] * size
+        self._lock = threading.Lock()
+
+    def _shard(self) -> List[float]:
+        """Get (or allocate once) this thread's slot array"""
+        try:
+            return self._local.values
+        except AttributeError:
+            values = [0.0] * self._size
+            self._local.values = values
+            with self._lock:
+                if len(self._shards) >= threading.active_count():
+                    self._fold_dead()
+                self._shards.append((weakref.ref(threading.current_thread()), values))
+            return values
+
+    def _fold_dead(self):
+        """Merge shards of exited threads into the base (lock held)"""
+        live = []
+        base = self._base
+        for owner, shard in self._shards:
+            thread = owner()
+            if thread is not None and thread.is_alive():
+                live.append((owner, shard))
+            else:
+                for i, value in enumerate(shard):
+                    base[i] += value
+        self._shards = live
+
+    def _collect(self) -> List[float]:
+        """Sum all shards (scrape side)"""
+        with self._lock:
+            self._fold_dead()
+            totals = list(self._base)
+            shards = [shard for _, shard in self._shards]
+        for shard in shards:
+            for i, value in enumerate(shard):
+                totals[i] += value
+        return totals
+
+
+class CounterChild(_ShardedChild):
+    """Monotonically increasing counter series"""
+
+    __slots__ = ()
+
+    def __init__(self):
+        super().__init__(1)
+
+    def inc(self, amount: float = 1.0):
+        """Increment the counter"""
+        try:
+            values = self._local.values
+        except AttributeError:
+            values = self._shard()
+        values[0] += amount
+
+    def get(self) -> float:
+        """Current counter value"""
+        return self._collect()[0]
+
+
+class GaugeChild(_ShardedChild):
+    """Point-in-time value series (set or inc/dec)"""
+
+    __slots__ = ("_offset",)
+
+    def __init__(self):
+        super().__init__(1)
+        self._offset = 0.0
+
+    def inc(self, amount: float = 1.0):
+        """Increase the gauge"""
+        try:
+            values = self._local.values
+        except AttributeError:
+            values = self._shard()
+        values[0] += amount
+
+    def dec(self, amount: float = 1.0):
+        """Decrease the gauge"""
+        self.inc(-amount)
+
+    def set(self, value: float):
+        """Set the gauge to an absolute value"""
+        # Rebase against the shard sum so later inc/dec stay relative
+        self._offset = value - self._collect()[0]
+
+    def get(self) -> float:
+        """Current gauge value"""
+        return self._offset + self._collect()[0]
+
+
+class HistogramChild(_ShardedChild):
+    """Fixed-bucket histogram series"""
+
+    __slots__ = ("_bounds", "_sum_index", "_count_index")
+
+    def __init__(self, bounds: Tuple[float, ...]):
+        # Slots: one per finite bucket, +Inf bucket, sum, count
+        super().__init__(len(bounds) + 3)
+        self._bounds = bounds
+        self._sum_index = len(bounds) + 1
+        self._count_index = len(bounds) + 2
+
+    def observe(self, value: float):
+        """Record one observation"""
+        try:
+            values = self._local.values
+        except AttributeError:
+            values = self._shard()
+        values[bisect_left(self._bounds, value)] += 1
+        values[self._sum_index] += value
+        values[self._count_index] += 1
+
+    def time(self) -> "_Timer":
+        """Context manager that observes elapsed seconds"""
+        return _Timer(self)
+
+    def snapshot(self) -> Dict[str, object]:
+        """Cumulative bucket counts, sum and count"""
+        totals = self._collect()
+        cumulative = []
+        running = 0.0
+        for i in range(len(self._bounds) + 1):
+            running += totals[i]
+            cumulative.append(running)
+        return {
+            'buckets': list(zip(self._bounds + (float("inf"),), cumulative)),
+            'sum': totals[self._sum_index],
+            'count': totals[self._count_index]
+        }
+
+
+class _Timer:
+    """Times a block into a histogram"""
+
+    __slots__ = ("_child", "_start")
+
+    def __init__(self, child: HistogramChild):
+        self._child = child
+
+    def __enter__(self):
+        self._start = time.perf_counter()
+        return self
+
+    def __exit__(self, *exc):
+        self._child.observe(time.perf_counter() - self._start)
+        return False
+
+
+class MetricFamily:
+    """
+    A named metric with a fixed set of label names
+
+    Children are created once per label-value tuple and cached; hot paths
+    can hold on to the child returned by labels() to skip the lookup.
+    """
+
+    metric_type = "untyped"
+
+    def __init__(self, name: str, documentation: str, labelnames: Sequence[str] = ()):
+        self.name = name
+        self.documentation = documentation
+        self.labelnames = tuple(labelnames)
+        self._children: Dict[Tuple[str, ...], _ShardedChild] = {}
+        self._lock = threading.Lock()
+        if not self.labelnames:
+            self._children[()] = self._new_child()
+
+    def _new_child(self) -> _ShardedChild:
+        raise NotImplementedError
+
+    def labels(self, *values, **kwargs) -> _ShardedChild:
+        """Get the child series for a label-value tuple"""
+        if kwargs:
+            values = tuple(kwargs[name] for name in self.labelnames)
+        key = tuple(str(v) for v in values)
+        child = self._children.get(key)
+        if child is None:
+            if len(key) != len(self.labelnames):
+                raise ValueError(
+                    f"Metric '{self.name}' expects labels {self.labelnames}, got {key}"
+                )
+            with self._lock:
+                child = self._children.get(key)
+                if child is None:
+                    child = self._new_child()
+                    self._children[key] = child
+        return child
+
+    def _label_str(self, key: Tuple[str, ...], extra: Optional[Tuple[str, str]] = None) -> str:
+        pairs = [f'{name}="{_escape_label_value(value)}"' for name, value in zip(self.labelnames, key)]
+        if extra:
+            pairs.append(f'{extra[0]}="{extra[1]}"')
+        return "{" + ",".join(pairs) + "}" if pairs else ""
+
+    def _children_snapshot(self) -> List[Tuple[Tuple[str, ...], _ShardedChild]]:
+        with self._lock:
+            return list(self._children.items())
+
+    def render(self) -> List[str]:
+        """Render this family in the text exposition format"""
+        lines = [
+            f"# HELP {self.name} {self.documentation}",
+            f"# TYPE {self.name} {self.metric_type}"
+        ]
+        for key, child in self._children_snapshot():
+            lines.extend(self._render_child(key, child))
+        return lines
+
+    def _render_child(self, key: Tuple[str, ...], child: _ShardedChild) -> List[str]:
+        return [f"{self.name}{self._label_str(key)} {_format_value(child.get())}"]
+
+
+class Counter(MetricFamily):
+    """Counter metric family"""
+
+    metric_type = "counter"
+
+    def _new_child(self) -> CounterChild:
+        return CounterChild()
+
+    def inc(self, amount: float = 1.0):
+        """Increment the unlabelled counter"""
+        self._children[()].inc(amount)
+
+
+class Gauge(MetricFamily):
+    """Gauge metric family"""
+
+    metric_type = "gauge"
+
+    def _new_child(self) -> GaugeChild:
+        return GaugeChild()
+
+    def set(self, value: float):
+        """Set the unlabelled gauge"""
+        self._children[()].set(value)
+
+    def inc(self, amount: float = 1.0):
+        """Increase the unlabelled gauge"""
+        self._children[()].inc(amount)
+
+    def dec(self, amount: float = 1.0):
+        """Decrease the unlabelled gauge"""
+        self._children[()].dec(amount)
+
+
+class Histogram(MetricFamily):
+    """Fixed-bucket histogram metric family"""
+
+    metric_type = "histogram"
+
+    def __init__(
+        self,
+        name: str,
+        documentation: str,
+        labelnames: Sequence[str] = (),
+        buckets: Sequence[float] = DEFAULT_BUCKETS
+    ):
+        self.buckets = tuple(sorted(float(b) for b in buckets if b != float("inf")))
+        super().__init__(name, documentation, labelnames)
+
+    def _new_child(self) -> HistogramChild:
+        return HistogramChild(self.buckets)
+
+    def observe(self, value: float):
+        """Observe into the unlabelled histogram"""
+        self._children[()].observe(value)
+
+    def _render_child(self, key: Tuple[str, ...], child: HistogramChild) -> List[str]:
+        snapshot = child.snapshot()
+        lines = []
+        for bound, count in snapshot['buckets']:
+            le = ("le", _format_value(bound))
+            lines.append(f"{self.name}_bucket{self._label_str(key, le)} {_format_value(count)}")
+        lines.append(f"{self.name}_sum{self._label_str(key)} {_format_value(snapshot['sum'])}")
+        lines.append(f"{self.name}_count{self._label_str(key)} {_format_value(snapshot['count'])}")
+        return lines
+
+
+class MetricsRegistry:
+    """
+    Registry of metric families
+
+    Factories are idempotent: asking for an existing name returns the
+    already-registered family, so modules can declare what they use.
+    """
+
+    def __init__(self):
+        self._families: Dict[str, MetricFamily] = {}
+        self._lock = threading.Lock()
+
+    def _register(self, cls, name: str, *args, **kwargs) -> MetricFamily:
+        with self._lock:
+            family = self._families.get(name)
+            if family is None:
+                family = cls(name, *args, **kwargs)
+                self._families[name] = family
+            elif not isinstance(family, cls):
+                raise ValueError(f"Metric '{name}' already registered as {family.metric_type}")
+            return family
+
+    def counter(self, name: str, documentation: str, labelnames: Sequence[str] = ()) -> Counter:
+        """Get or create a counter family"""
+        return self._register(Counter, name, documentation, labelnames)
+
+    def gauge(self, name: str, documentation: str, labelnames: Sequence[str] = ()) -> Gauge:
+        """Get or create a gauge family"""
+        return self._register(Gauge, name, documentation, labelnames)
+
+    def histogram(
+        self,
+        name: str,
+        documentation: str,
+        labelnames: Sequence[str] = (),
+        buckets: Sequence[float] = DEFAULT_BUCKETS
+    ) -> Histogram:
+        """Get or create a histogram family"""
+        return self._register(Histogram, name, documentation, labelnames, buckets=buckets)
+
+    def get(self, name: str) -> Optional[MetricFamily]:
+        """Look up a family by name"""
+        return self._families.get(name)
+
+    def render(self) -> str:
+        """Render all families in the Prometheus text format"""
+        with self._lock:
+            families = list(self._families.values())
+        lines: List[str] = []
+        for family in families:
+            lines.extend(family.render())
+        return "\n".join(lines) + "\n"
+
+
+class CompanionMetrics:
+    """Standard Companion metric families (provider, model, route, cache labels)"""
+
+    def __init__(self, registry: MetricsRegistry):
+        self.registry = registry
+
+        # HTTP layer
+        self.http_requests = registry.counter(
+            "companion_http_requests_total",
+            "HTTP requests by route, method and status",
+            ("route", "method", "status")
+        )
+        self.http_latency = registry.histogram(
+            "companion_http_request_duration_seconds",
+            "HTTP request latency by route",
+            ("route", "method")
+        )
+        self.http_in_flight = registry.gauge(
+            "companion_http_requests_in_flight",
+            "HTTP requests currently being served"
+        )
+
+        # Brain / LLM providers
+        self.think_latency = registry.histogram(
+            "companion_think_duration_seconds",
+            "End-to-end think() latency by path",
+            ("path",)
+        )
+        self.llm_requests = registry.counter(
+            "companion_llm_requests_total",
+            "LLM provider calls by provider, model and status",
+            ("provider", "model", "status")
+        )
+        self.llm_latency = registry.histogram(
+            "companion_llm_request_duration_seconds",
+            "LLM provider call latency by provider and model",
+            ("provider", "model")
+        )
+        self.llm_hedges = registry.counter(
+            "companion_llm_hedges_total",
+            "Hedged LLM requests by tenant and outcome (fired/won/lost/denied)",
+            ("tenant", "outcome")
+        )
+
+        # Caches
+        self.cache_events = registry.counter(
+            "companion_cache_events_total",
+            "Cache lookups by cache and result (hit/miss)",
+            ("cache", "result")
+        )
+
+
+def _shared_registry() -> MetricsRegistry:
+    """
+    Reuse the registry if this module was already imported under its
+    other name (the codebase imports both companion_baas.optimization.*
+    and optimization.*), so one /metrics endpoint sees every series.
+    """
+    for alias in ("companion_baas.optimization.metrics", "optimization.metrics"):
+        module = sys.modules.get(alias)
+        if module is not None and module is not sys.modules.get(__name__):
+            existing = getattr(module, "registry", None)
+            if existing is not None:
+                return existing
+    return MetricsRegistry()
+
+
+# Global registry and standard metric families
+registry = _shared_registry()
+metrics = CompanionMetrics(registry)
+
+
+# ============================================================================
+# WEB FRAMEWORK INTEGRATION
+# ============================================================================
+
+def instrument_fastapi(app, path: str = "/metrics", metrics_registry: Optional[MetricsRegistry] = None):
+    """
+    Add request metrics middleware and a /metrics endpoint to a FastAPI app
+
+    The route label is the matched route template (e.g.
+    /v1/conversations/{conversation_id}) to keep cardinality bounded.
+    """
+    from fastapi import Request
+    from fastapi.responses import Response
+
+    target = metrics_registry or registry
+
+    @app.middleware("http")
+    async def _metrics_middleware(request: Request, call_next):
+        if request.url.path == path:
+            return await call_next(request)
+
+        metrics.http_in_flight.inc()
+        start = time.perf_counter()
+        status = "500"
+        try:
+            response = await call_next(request)
+            status = str(response.status_code)
+            return response
+        finally:
+            elapsed = time.perf_counter() - start
+            metrics.http_in_flight.dec()
+            route = request.scope.get("route")
+            route_label = getattr(route, "path", None) or "unmatched"
+            metrics.http_requests.labels(route_label, request.method, status).inc()
+            metrics.http_latency.labels(route_label, request.method).observe(elapsed)
+
+    async def _metrics_endpoint():
+        return Response(content=target.render(), media_type=CONTENT_TYPE)
+
+    app.add_api_route(path, _metrics_endpoint, methods=["GET"], include_in_schema=False)
+    # Move ahead of catch-all routes (e.g. /{path:path}) registered earlier
+    app.router.routes.insert(0, app.router.routes.pop())
+    return app
+
+
+def instrument_flask(app, path: str = "/metrics", metrics_registry: Optional[MetricsRegistry] = None):
+    """Add request metrics hooks and a /metrics endpoint to a Flask app"""
+    from flask import Response, g, request
+
+    target = metrics_registry or registry
+
+    def _record(status: str):
+        start = g.pop("_metrics_start", None)
+        if start is not None:
+            route_label = request.url_rule.rule if request.url_rule else "unmatched"
+            metrics.http_requests.labels(route_label, request.method, status).inc()
+            metrics.http_latency.labels(route_label, request.method).observe(time.perf_counter() - start)
+
+    @app.before_request
+    def _metrics_before():
+        if request.path != path:
+            g._metrics_start = time.perf_counter()
+            g._metrics_in_flight = True
+            metrics.http_in_flight.inc()
+
+    @app.after_request
+    def _metrics_after(response):
+        _record(str(response.status_code))
+        return response
+
+    @app.teardown_request
+    def _metrics_teardown(exc):
+        # Runs even when the handler raised (after_request may not)
+        if g.pop("_metrics_in_flight", False):
+            metrics.http_in_flight.dec()
+            _record("500")
+
+    @app.route(path, methods=["GET"], endpoint="prometheus_metrics")
+    def _metrics_endpoint():
+        return Response(target.render(), mimetype=CONTENT_TYPE.split(";")[0],
+                        headers={"Content-Type": CONTENT_TYPE})
+
+    return app
+
+
+# Example usage
+if __name__ == "__main__":
+    print("=" * 70)
+    print("METRICS - Prometheus Exposition")
+    print("=" * 70)
+
+    child = metrics.llm_latency.labels("groq", "llama3-8b-8192")
+    for latency in (0.12, 0.3, 0.8, 2.4):
+        child.observe(latency)
+    metrics.llm_requests.labels("groq", "llama3-8b-8192", "success").inc(4)
+    metrics.cache_events.labels("semantic", "hit").inc()
+    metrics.cache_events.labels("semantic", "miss").inc(3)
+
+    # Hot-path cost
+    counter = metrics.cache_events.labels("bench", "hit")
+    iterations = 200_000
+    start = time.perf_counter()
+    for _ in range(iterations):
+        counter.inc()
+    per_op = (time.perf_counter() - start) / iterations
+    print(f"\nCounter.inc(): {per_op * 1e9:.0f}ns/op")
+
+    start = time.perf_counter()
+    for _ in range(iterations):
+        child.observe(0.25)
+    per_op = (time.perf_counter() - start) / iterations
+    print(f"Histogram.observe(): {per_op * 1e9:.0f}ns/op\n")
+
+    print(registry.render())
@@ -6,13 +6,18 @@ Real-time performance monitoring with metrics collection and alerting.
 
 import time
 import logging
-from typing import Dict, List, Optional, Any, Callable
+from typing import Dict, List, Optional, Any, Callable, Tuple
 from dataclasses import dataclass, field
 from collections import deque
 from datetime import datetime, timedelta
 from enum import Enum
 import statistics
 
+try:
+    from .metrics import metrics as prom_metrics
+except ImportError:
+    from metrics import metrics as prom_metrics
+
 logger = logging.getLogger(__name__)
 
 
@@ -230,6 +235,14 @@ class PerformanceMonitor:
         
         # Health check functions
         self.health_checks: Dict[str, Callable[[], bool]] = {}
+        
+        # Prometheus gauges for system metrics
+        self._memory_gauge = prom_metrics.registry.gauge(
+            "companion_memory_usage_mb", "Process memory usage in MB"
+        )
+        self._cpu_gauge = prom_metrics.registry.gauge(
+            "companion_cpu_usage_percent", "Process CPU usage percent"
+        )
     
     # === Metric Recording ===
     
@@ -257,6 +270,7 @@ class PerformanceMonitor:
             "cache_hits",
             labels={"cache": cache_name}
         )
+        prom_metrics.cache_events.labels(cache_name, "hit").inc()
     
     def record_cache_miss(self, cache_name: str):
         """Record a cache miss"""
@@ -264,6 +278,7 @@ class PerformanceMonitor:
             "cache_misses",
             labels={"cache": cache_name}
         )
+        prom_metrics.cache_events.labels(cache_name, "miss").inc()
     
     def record_error(self, error_type: str, message: str):
         """Record an error"""
@@ -285,11 +300,13 @@ class PerformanceMonitor:
         """Record memory usage"""
         mb_used = bytes_used / (1024 * 1024)
         self.collector.record_gauge("memory_usage_mb", mb_used)
+        self._memory_gauge.set(mb_used)
         self._check_threshold("memory_usage_mb", mb_used)
     
     def record_cpu(self, percent: float):
         """Record CPU usage"""
         self.collector.record_gauge("cpu_usage_percent", percent)
+        self._cpu_gauge.set(percent)
         self._check_threshold("cpu_usage_percent", percent)
     
     # === Threshold Management ===
@@ -0,0 +1,225 @@
+"""
+Prompt Prefix Cache - Phase 5: Optimization
+
+Prompts are assembled as a stable prefix (instructions, system text,
+pre-rendered once and cached) followed by a dynamic suffix (the user's
+query, retrieved context). Keeping the static part first and byte-identical
+across calls is what lets providers reuse work:
+
+- Ollama / llama.cpp keep the KV cache of the last prompt while the model
+  stays loaded (keep_alive) and only prefill tokens after the longest
+  common prefix.
+- Hosted APIs with automatic prompt caching bill and prefill a repeated
+  prefix at a discount.
+
+PrefixCache stores pre-rendered prefixes and also accounts for reuse per
+target (provider:model): every prompt is compared with the previous one
+sent to the same target, and the shared leading text is counted as
+prefill that can be served from the provider's cache.
+"""
+
+import os
+import time
+import string
+import threading
+from collections import OrderedDict
+from dataclasses import dataclass
+from typing import Any, Callable, Dict, Hashable, Optional, Tuple
+
+
+@dataclass(frozen=True)
+class PromptSegments:
+    """A prompt split into a cacheable static prefix and a per-call suffix"""
+    prefix: str
+    suffix: str
+
+    @property
+    def text(self) -> str:
+        """Full prompt text"""
+        return self.prefix + self.suffix
+
+
+class PromptTemplate:
+    """
+    str.format template pre-split into static prefix and dynamic suffix
+
+    The template is parsed once: everything before the first placeholder
+    is the static prefix, returned as-is on every render; only the
+    remainder is formatted per call.
+    """
+
+    def __init__(self, template: str):
+        self.template = template
+        prefix_parts = []
+        self.fields = []
+        for literal, field_name, _, _ in string.Formatter().parse(template):
+            if not self.fields:
+                prefix_parts.append(literal)
+            if field_name is not None:
+                self.fields.append(field_name)
+
+        # Literal '{{' / '}}' escapes were already unescaped by parse()
+        self.prefix = ''.join(prefix_parts)
+        self._suffix_template = template[self._raw_prefix_length(template):]
+
+    @staticmethod
+    def _raw_prefix_length(template: str) -> int:
+        """Length of the template source up to its first placeholder"""
+        i = 0
+        while i < len(template):
+            if template.startswith('{{', i) or template.startswith('}}', i):
+                i += 2
+            elif template[i] == '{':
+                return i
+            else:
+                i += 1
+        return len(template)
+
+    def render(self, **params) -> PromptSegments:
+        """Fill the dynamic part (raises KeyError like str.format)"""
+        return PromptSegments(self.prefix, self._suffix_template.format(**params))
+
+
+class PrefixCache:
+    """
+    Pre-rendered prompt prefixes plus per-target prefix reuse accounting
+
+    Features:
+    - LRU of rendered static prefixes (render once, reuse by key)
+    - Tracks the longest common prefix with the last prompt per provider:model
+    - Estimates prefill tokens served from provider KV/prompt caches
+    """
+
+    def __init__(self, max_entries: int = 256, keep_alive_seconds: float = 1800.0,
+                 clock: Callable[[], float] = time.monotonic):
+        """
+        Initialize cache
+
+        Args:
+            max_entries: Rendered prefixes kept (LRU)
+            keep_alive_seconds: How long a target is assumed to keep its KV cache
+            clock: Time source (injectable for tests)
+        """
+        self.max_entries = max_entries
+        self.keep_alive_seconds = keep_alive_seconds
+        self._clock = clock
+        self._prefixes: "OrderedDict[Hashable, str]" = OrderedDict()
+        self._last_prompt: Dict[str, Tuple[str, float]] = {}
+        self._lock = threading.Lock()
+        self.stats = {
+            'prefix_hits': 0,
+            'prefix_misses': 0,
+            'prompts_tracked': 0,
+            'prefill_tokens': 0,
+            'prefill_tokens_reused': 0
+        }
+
+    def get(self, key: Hashable, render: Callable[[], str]) -> str:
+        """Rendered prefix for key, rendering (once) on a miss"""
+        with self._lock:
+            prefix = self._prefixes.get(key)
+            if prefix is not None:
+                self._prefixes.move_to_end(key)
+                self.stats['prefix_hits'] += 1
+                return prefix
+
+        # Render outside the lock; a concurrent miss on the same key renders twice (harmless)
+        prefix = render()
+        with self._lock:
+            self.stats['prefix_misses'] += 1
+            self._prefixes[key] = prefix
+            self._prefixes.move_to_end(key)
+            if len(self._prefixes) > self.max_entries:
+                self._prefixes.popitem(last=False)
+        return prefix
+
+    def track(self, target: str, prompt: str) -> int:
+        """
+        Record a prompt sent to a target and estimate its reusable prefill
+
+        Args:
+            target: Cache domain, e.g. 'ollama:llama3.2:3b'
+            prompt: Full prompt as sent (system text first)
+
+        Returns:
+            Estimated tokens (~4 chars each) shared with the target's previous prompt
+        """
+        now = self._clock()
+        with self._lock:
+            previous = self._last_prompt.get(target)
+            self._last_prompt[target] = (prompt, now)
+            reused_chars = 0
+            if previous is not None and now - previous[1] <= self.keep_alive_seconds:
+                reused_chars = len(os.path.commonprefix((previous[0], prompt)))
+            reused_tokens = reused_chars // 4
+            self.stats['prompts_tracked'] += 1
+            self.stats['prefill_tokens'] += len(prompt) // 4
+            self.stats['prefill_tokens_reused'] += reused_tokens
+        return reused_tokens
+
+    def clear(self):
+        """Drop rendered prefixes and reuse history"""
+        with self._lock:
+            self._prefixes.clear()
+            self._last_prompt.clear()
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Prefix hit rate and prefill reuse"""
+        with self._lock:
+            stats = dict(self.stats)
+            stats['cached_prefixes'] = len(self._prefixes)
+            stats['targets'] = len(self._last_prompt)
+        lookups = stats['prefix_hits'] + stats['prefix_misses']
+        stats['prefix_hit_rate'] = stats['prefix_hits'] / lookups if lookups else 0.0
+        stats['prefill_reuse_rate'] = (
+            stats['prefill_tokens_reused'] / stats['prefill_tokens'] if stats['prefill_tokens'] else 0.0
+        )
+        return stats
+
+
+# Global prefix cache (shared by prompt builders and provider clients)
+prompt_cache = PrefixCache()
+
+
+# Example usage
+if __name__ == "__main__":
+    print("=" * 70)
+    print("PROMPT PREFIX CACHE - Stable Prefix + Dynamic Suffix")
+    print("=" * 70)
+
+    template = PromptTemplate(
+        "Generate clean, well-documented code. Include comments, error handling "
+        "and follow best practices.\n\nTask:\n{task}"
+    )
+    segments = template.render(task="sort an array")
+    print(f"\nStatic prefix ({len(segments.prefix)} chars): {segments.prefix[:50]}...")
+    print(f"Dynamic suffix: {segments.suffix!r}")
+
+    def build_system_prompt(tools):
+        prompt = "You are Companion AI, an advanced and helpful AI assistant."
+        if 'think' in tools:
+            prompt += " You should think through problems step by step and show your reasoning process."
+        if 'code' in tools:
+            prompt += " You should focus on providing code examples, explanations, and programming assistance."
+        return prompt + " Always be helpful, accurate, and engaging in your responses."
+
+    cache = PrefixCache()
+    tools = ['think', 'code']
+    for _ in range(1000):
+        cache.get(tuple(tools), lambda: build_system_prompt(tools))
+    print(f"\nSystem prompt: rendered once, {cache.get_stats()['prefix_hits']} cache hits")
+
+    # A chain-of-thought grows its context: each step shares the previous prefix
+    system = build_system_prompt(tools) + "\n\n"
+    steps = []
+    for i in range(1, 6):
+        prompt = system + "\n".join(steps) + f"\n\nStep {i}: reason about the next sub-problem."
+        reused = cache.track("ollama:llama3.2:3b", prompt)
+        steps.append(f"Step {i}: intermediate conclusion number {i} " + "detail " * 30)
+        print(f"  step {i}: {len(prompt) // 4:4d} prompt tokens, {reused:4d} reusable from KV cache")
+
+    stats = cache.get_stats()
+    print(f"\nPrefill reuse: {stats['prefill_tokens_reused']}/{stats['prefill_tokens']} tokens "
+          f"({stats['prefill_reuse_rate']:.0%})")
+
+    print("\n" + "=" * 70)
@@ -0,0 +1,538 @@
+"""
+Quantile Sketches - Phase 5: Optimization
+
+Mergeable streaming quantile sketches for latency percentiles.
+
+QuantileSketch is a log-bucketed histogram (DDSketch-style): every value
+lands in a preallocated bucket whose width is a fixed fraction of its
+magnitude, so any quantile is reported within `relative_accuracy` of the
+true value. Recording is O(1), memory is fixed, and two sketches with the
+same parameters merge by adding bucket counts - across threads, workers
+or processes (via to_dict/from_dict).
+
+DecayingSketch keeps a ring of sketches over a sliding time window so
+percentiles reflect recent traffic without storing raw samples.
+
+CountMinSketch (frequencies of arbitrary keys) and SpaceSaving (top-k
+heavy hitters) count event streams in fixed memory, with optional
+exponential time decay.
+"""
+
+import math
+import time
+import heapq
+import threading
+from array import array
+from typing import Any, Dict, Hashable, List, Optional, Tuple
+
+
+class QuantileSketch:
+    """
+    Log-bucketed quantile sketch with bounded relative error
+
+    Features:
+    - O(1) add, fixed memory (preallocated buckets)
+    - Quantiles within relative_accuracy of the exact value
+    - Mergeable and serializable
+    """
+
+    def __init__(
+        self,
+        relative_accuracy: float = 0.01,
+        min_value: float = 1e-6,
+        max_value: float = 3600.0
+    ):
+        """
+        Initialize sketch
+
+        Args:
+            relative_accuracy: Max relative error of reported quantiles
+            min_value: Smallest distinguishable positive value (seconds)
+            max_value: Largest tracked value; larger values clamp to the top bucket
+        """
+        self.relative_accuracy = relative_accuracy
+        self.min_value = min_value
+        self.max_value = max_value
+
+        self._gamma = (1 + relative_accuracy) / (1 - relative_accuracy)
+        self._inv_log_gamma = 1.0 / math.log(self._gamma)
+        self._offset = math.ceil(math.log(min_value) * self._inv_log_gamma)
+        size = math.ceil(math.log(max_value) * self._inv_log_gamma) - self._offset + 1
+
+        self.bins: List[int] = [0] * size
+        self.zero_count = 0
+        self.count = 0
+        self.sum = 0.0
+        self.min = math.inf
+        self.max = -math.inf
+
+    def _index(self, value: float) -> int:
+        """Bucket index for a positive value"""
+        if value <= self.min_value:
+            return 0
+        index = math.ceil(math.log(value) * self._inv_log_gamma) - self._offset
+        last = len(self.bins) - 1
+        return index if index < last else last
+
+    def _bucket_value(self, index: int) -> float:
+        """Representative value of a bucket (relative-error midpoint)"""
+        upper = self._gamma ** (index + self._offset)
+        return 2.0 * upper / (self._gamma + 1.0)
+
+    def add(self, value: float, count: int = 1):
+        """Record a value"""
+        if value > 0:
+            self.bins[self._index(value)] += count
+        else:
+            self.zero_count += count
+        self.count += count
+        self.sum += value * count
+        if value < self.min:
+            self.min = value
+        if value > self.max:
+            self.max = value
+
+    def quantile(self, q: float) -> float:
+        """
+        Estimate a quantile
+
+        Args:
+            q: Quantile in [0, 1]
+
+        Returns:
+            Estimated value (0.0 when empty)
+        """
+        if self.count == 0:
+            return 0.0
+        if q <= 0:
+            return self.min
+        if q >= 1:
+            return self.max
+
+        # Nearest rank (0-based) of the requested quantile
+        rank = int(q * (self.count - 1) + 0.5)
+        seen = self.zero_count
+        if seen > rank:
+            return 0.0
+        for index, bucket_count in enumerate(self.bins):
+            if bucket_count:
+                seen += bucket_count
+                if seen > rank:
+                    # Clamp to observed range so small samples stay exact at the edges
+                    return min(max(self._bucket_value(index), self.min), self.max)
+        return self.max
+
+    def mean(self) -> float:
+        """Mean of recorded values"""
+        return self.sum / self.count if self.count else 0.0
+
+    def merge(self, other: "QuantileSketch"):
+        """Add another sketch's counts into this one (same parameters required)"""
+        if len(other.bins) != len(self.bins) or other._offset != self._offset:
+            raise ValueError("Cannot merge sketches with different parameters")
+        bins = self.bins
+        for index, bucket_count in enumerate(other.bins):
+            if bucket_count:
+                bins[index] += bucket_count
+        self.zero_count += other.zero_count
+        self.count += other.count
+        self.sum += other.sum
+        if other.min < self.min:
+            self.min = other.min
+        if other.max > self.max:
+            self.max = other.max
+
+    def clear(self):
+        """Reset in place (keeps the preallocated buckets)"""
+        bins = self.bins
+        for index in range(len(bins)):
+            bins[index] = 0
+        self.zero_count = 0
+        self.count = 0
+        self.sum = 0.0
+        self.min = math.inf
+        self.max = -math.inf
+
+    def empty_like(self) -> "QuantileSketch":
+        """New empty sketch with the same parameters"""
+        return QuantileSketch(self.relative_accuracy, self.min_value, self.max_value)
+
+    def iter_buckets(self) -> List[Tuple[float, int]]:
+        """Non-empty buckets as (representative value, count), ascending"""
+        buckets = [(0.0, self.zero_count)] if self.zero_count else []
+        for index, bucket_count in enumerate(self.bins):
+            if bucket_count:
+                buckets.append((self._bucket_value(index), bucket_count))
+        return buckets
+
+    def to_dict(self) -> Dict[str, Any]:
+        """Serialize (sparse) for cross-process merging"""
+        return {
+            'relative_accuracy': self.relative_accuracy,
+            'min_value': self.min_value,
+            'max_value': self.max_value,
+            'bins': {str(i): c for i, c in enumerate(self.bins) if c},
+            'zero_count': self.zero_count,
+            'count': self.count,
+            'sum': self.sum,
+            'min': self.min if self.count else None,
+            'max': self.max if self.count else None
+        }
+
+    @classmethod
+    def from_dict(cls, data: Dict[str, Any]) -> "QuantileSketch":
+        """Deserialize a sketch produced by to_dict()"""
+        sketch = cls(data['relative_accuracy'], data['min_value'], data['max_value'])
+        for index, bucket_count in data.get('bins', {}).items():
+            sketch.bins[int(index)] = bucket_count
+        sketch.zero_count = data.get('zero_count', 0)
+        sketch.count = data.get('count', 0)
+        sketch.sum = data.get('sum', 0.0)
+        if data.get('min') is not None:
+            sketch.min = data['min']
+        if data.get('max') is not None:
+            sketch.max = data['max']
+        return sketch
+
+
+class DecayingSketch:
+    """
+    Sliding-window quantile sketch
+
+    The window is split into `slices` sub-sketches; each add goes to the
+    current slice and slices older than the window are recycled in place.
+    Reads merge the live slices, so old samples age out without a scan.
+    """
+
+    def __init__(
+        self,
+        window_seconds: float = 300.0,
+        slices: int = 10,
+        relative_accuracy: float = 0.01,
+        clock=time.monotonic
+    ):
+        """
+        Initialize decaying sketch
+
+        Args:
+            window_seconds: Length of the sliding window
+            slices: Number of sub-windows (granularity of decay)
+            relative_accuracy: Sketch accuracy
+            clock: Time source (injectable for tests)
+        """
+        self.window_seconds = window_seconds
+        self.slices = slices
+        self._slice_seconds = window_seconds / slices
+        self._clock = clock
+        self._ring = [QuantileSketch(relative_accuracy) for _ in range(slices)]
+        self._ring_epochs = [-1] * slices
+        self._lock = threading.Lock()
+
+    def _current(self, epoch: int) -> QuantileSketch:
+        """Slice for an epoch, recycling it if it holds an older epoch"""
+        slot = epoch % self.slices
+        sketch = self._ring[slot]
+        if self._ring_epochs[slot] != epoch:
+            sketch.clear()
+            self._ring_epochs[slot] = epoch
+        return sketch
+
+    def add(self, value: float):
+        """Record a value into the current slice"""
+        epoch = int(self._clock() // self._slice_seconds)
+        with self._lock:
+            self._current(epoch).add(value)
+
+    def merge_sketch(self, other: QuantileSketch):
+        """Merge an external sketch (e.g. from another process) into the current slice"""
+        epoch = int(self._clock() // self._slice_seconds)
+        with self._lock:
+            self._current(epoch).merge(other)
+
+    def snapshot(self) -> QuantileSketch:
+        """Merged sketch of every slice inside the window"""
+        epoch = int(self._clock() // self._slice_seconds)
+        oldest = epoch - self.slices + 1
+        with self._lock:
+            merged = self._ring[0].empty_like()
+            for slot, slice_epoch in enumerate(self._ring_epochs):
+                if oldest <= slice_epoch <= epoch:
+                    merged.merge(self._ring[slot])
+        return merged
+
+    def clear(self):
+        """Drop all samples"""
+        with self._lock:
+            for sketch in self._ring:
+                sketch.clear()
+            self._ring_epochs = [-1] * self.slices
+
+
+class _ForwardDecay:
+    """
+    Exponential time decay by forward weighting
+
+    Instead of shrinking every counter as time passes, each new item is
+    weighted by exp(rate * (t - landmark)) and reads divide by the
+    current weight. Counters are rescaled (and the landmark moved) only
+    when weights grow large, so decay costs nothing per update. Time is
+    quantized to 1/1024 of the half-life so counts recorded close
+    together stay whole numbers.
+    """
+
+    _MAX_WEIGHT = 1e12
+
+    def __init__(self, half_life_seconds: Optional[float], clock):
+        self._rate = math.log(2) / half_life_seconds if half_life_seconds else 0.0
+        self._tick = half_life_seconds / 1024 if half_life_seconds else 1.0
+        self._clock = clock
+        self._landmark = self._quantize(clock())
+
+    def _quantize(self, now: float) -> float:
+        return now - now % self._tick
+
+    def _weight(self, now: float) -> float:
+        if not self._rate:
+            return 1.0
+        now = self._quantize(now)
+        weight = math.exp(self._rate * (now - self._landmark))
+        if weight > self._MAX_WEIGHT:
+            self._rescale(1.0 / weight)
+            self._landmark = now
+            weight = 1.0
+        return weight
+
+    def _rescale(self, factor: float):
+        raise NotImplementedError
+
+
+class CountMinSketch(_ForwardDecay):
+    """
+    Count-min sketch with conservative update and optional time decay
+
+    Features:
+    - O(depth) add / estimate, fixed memory (depth x width counters)
+    - Never underestimates; overestimates by at most ~e/width of the total
+    - Optional half-life so old occurrences fade out
+    """
+
+    def __init__(
+        self,
+        width: int = 2048,
+        depth: int = 4,
+        half_life_seconds: Optional[float] = None,
+        clock=time.time
+    ):
+        """
+        Initialize sketch
+
+        Args:
+            width: Counters per row (error ~ e / width of the total count)
+            depth: Rows (failure probability ~ e^-depth)
+            half_life_seconds: Decay half-life (None = no decay)
+            clock: Time source (injectable for tests)
+        """
+        super().__init__(half_life_seconds, clock)
+        self.width = width
+        self.depth = depth
+        self._rows = [array('d', bytes(8 * width)) for _ in range(depth)]
+        self._total = 0.0
+        self._lock = threading.Lock()
+
+    def _slots(self, key: str) -> List[int]:
+        # Double hashing: depth indexes from one 64-bit hash
+        h = hash(key) & 0xFFFFFFFFFFFFFFFF
+        h1, h2 = h & 0xFFFFFFFF, (h >> 32) | 1
+        return [(h1 + i * h2) % self.width for i in range(self.depth)]
+
+    def add(self, key: str, count: float = 1.0) -> float:
+        """Count an occurrence; returns the key's (decayed) estimate"""
+        slots = self._slots(key)
+        with self._lock:
+            weight = self._weight(self._clock())
+            increment = count * weight
+            rows = self._rows
+            estimate = min(rows[i][slot] for i, slot in enumerate(slots)) + increment
+            for i, slot in enumerate(slots):
+                if rows[i][slot] < estimate:
+                    rows[i][slot] = estimate
+            self._total += increment
+        return estimate / weight
+
+    def estimate(self, key: str) -> float:
+        """Decayed occurrence count of a key (upper bound)"""
+        slots = self._slots(key)
+        with self._lock:
+            weight = self._weight(self._clock())
+            return min(self._rows[i][slot] for i, slot in enumerate(slots)) / weight
+
+    def total(self) -> float:
+        """Decayed count of everything added"""
+        with self._lock:
+            return self._total / self._weight(self._clock())
+
+    def _rescale(self, factor: float):
+        for row in self._rows:
+            for i in range(self.width):
+                row[i] *= factor
+        self._total *= factor
+
+
+class SpaceSaving(_ForwardDecay):
+    """
+    Heavy-hitter tracking (Space-Saving) with optional time decay
+
+    Keeps at most `capacity` keys. A new key replaces the smallest one and
+    inherits its count as error, so any key whose true count exceeds
+    total / capacity is guaranteed to be tracked.
+
+    Features:
+    - Bounded memory, O(log capacity) amortized add
+    - top(n) is a cheap read of the tracked keys
+    - Optional half-life so old heavy hitters fade out
+    """
+
+    def __init__(
+        self,
+        capacity: int = 1000,
+        half_life_seconds: Optional[float] = None,
+        clock=time.time
+    ):
+        """
+        Initialize tracker
+
+        Args:
+            capacity: Keys tracked
+            half_life_seconds: Decay half-life (None = no decay)
+            clock: Time source (injectable for tests)
+        """
+        super().__init__(half_life_seconds, clock)
+        self.capacity = capacity
+        self._counts: Dict[Hashable, List[float]] = {}  # key -> [count, error]
+        # Min-heap of (count when pushed, key); entries may be stale (lower
+        # than the live count) and are refreshed lazily when they surface
+        self._heap: List[Tuple[float, Hashable]] = []
+        self._lock = threading.Lock()
+
+    def add(self, key: Hashable, count: float = 1.0) -> float:
+        """Count an occurrence; returns the key's (decayed) estimate"""
+        with self._lock:
+            weight = self._weight(self._clock())
+            increment = count * weight
+            entry = self._counts.get(key)
+            if entry is not None:
+                entry[0] += increment
+                return entry[0] / weight
+
+            if len(self._counts) < self.capacity:
+                entry = self._counts[key] = [increment, 0.0]
+            else:
+                floor = self._pop_min()
+                entry = self._counts[key] = [floor + increment, floor]
+            heapq.heappush(self._heap, (entry[0], key))
+            return entry[0] / weight
+
+    def _pop_min(self) -> float:
+        """Evict the smallest tracked key; returns its count"""
+        while True:
+            stored, key = heapq.heappop(self._heap)
+            live = self._counts[key][0]
+            if live == stored:
+                del self._counts[key]
+                return live
+            heapq.heappush(self._heap, (live, key))
+
+    def estimate(self, key: Hashable) -> float:
+        """Decayed count of a tracked key (0.0 if not tracked)"""
+        with self._lock:
+            entry = self._counts.get(key)
+            return entry[0] / self._weight(self._clock()) if entry else 0.0
+
+    def guaranteed(self, key: Hashable) -> float:
+        """Decayed count the key certainly has (estimate minus inherited error)"""
+        with self._lock:
+            entry = self._counts.get(key)
+            return (entry[0] - entry[1]) / self._weight(self._clock()) if entry else 0.0
+
+    def top(self, n: Optional[int] = None, min_count: float = 0.0) -> List[Tuple[Hashable, float, float]]:
+        """
+        Heaviest keys, largest first
+
+        Returns:
+            (key, estimated count, max overestimate) tuples
+        """
+        with self._lock:
+            weight = self._weight(self._clock())
+            threshold = min_count * weight
+            items = [(key, entry) for key, entry in self._counts.items() if entry[0] >= threshold]
+        items = heapq.nlargest(n, items, key=lambda item: item[1][0]) if n else \
+            sorted(items, key=lambda item: item[1][0], reverse=True)
+        return [(key, count / weight, error / weight) for key, (count, error) in items]
+
+    def __len__(self) -> int:
+        return len(self._counts)
+
+    def _rescale(self, factor: float):
+        for entry in self._counts.values():
+            entry[0] *= factor
+            entry[1] *= factor
+        self._heap = [(entry[0], key) for key, entry in self._counts.items()]
+        heapq.heapify(self._heap)
+
+
+def merge_sketches(sketches: List[QuantileSketch]) -> Optional[QuantileSketch]:
+    """Merge several sketches into a new one (None if the list is empty)"""
+    if not sketches:
+        return None
+    merged = sketches[0].empty_like()
+    for sketch in sketches:
+        merged.merge(sketch)
+    return merged
+
+
+# Example usage
+if __name__ == "__main__":
+    import random
+
+    print("=" * 70)
+    print("QUANTILE SKETCHES - Streaming Percentiles")
+    print("=" * 70)
+
+    values = [random.lognormvariate(-1.5, 0.8) for _ in range(100_000)]
+
+    sketch = QuantileSketch()
+    start = time.perf_counter()
+    for v in values:
+        sketch.add(v)
+    per_add = (time.perf_counter() - start) / len(values)
+
+    exact = sorted(values)
+    print(f"\nadd(): {per_add * 1e9:.0f}ns/op, {len(sketch.bins)} buckets")
+    for q in (0.5, 0.95, 0.99):
+        true_value = exact[int(q * (len(exact) - 1))]
+        estimate = sketch.quantile(q)
+        print(f"  p{int(q * 100)}: sketch={estimate:.4f}s exact={true_value:.4f}s "
+              f"error={abs(estimate - true_value) / true_value * 100:.2f}%")
+
+    # Merge across "workers"
+    a, b = QuantileSketch(), QuantileSketch()
+    for i, v in enumerate(values):
+        (a if i % 2 else b).add(v)
+    merged = QuantileSketch.from_dict(a.to_dict())
+    merged.merge(QuantileSketch.from_dict(b.to_dict()))
+    print(f"\nMerged p99 from two workers: {merged.quantile(0.99):.4f}s (count={merged.count})")
+
+    # Heavy hitters in a Zipf-like stream
+    stream = [f"query {int(random.paretovariate(1.2))}" for _ in range(100_000)]
+    exact_counts: Dict[str, int] = {}
+    for key in stream:
+        exact_counts[key] = exact_counts.get(key, 0) + 1
+    cms, heavy = CountMinSketch(width=1024), SpaceSaving(capacity=100)
+    for key in stream:
+        cms.add(key)
+        heavy.add(key)
+    print(f"\n{len(exact_counts)} distinct keys, tracking 100 heavy hitters:")
+    for key, count, error in heavy.top(3):
+        print(f"  {key!r}: space-saving={count:.0f} count-min={cms.estimate(key):.0f} exact={exact_counts[key]}")
+
+    print("\n" + "=" * 70)
@@ -0,0 +1,630 @@
+"""
+Request Tracing - Phase 5: Optimization
+
+End-to-end request tracing for the brain's think() pipelines.
+
+Spans are tracked with contextvars, so nesting follows the call stack and
+propagates into asyncio tasks automatically (and into worker threads via
+Tracer.wrap). A trace is opened when its root span starts and finished
+spans are buffered on it; when the root span ends the whole trace is kept
+or dropped at once (tail-based sampling). Spans that end after their
+root (fire-and-forget work) are dropped rather than reopening the trace.
+
+- every slow trace is kept: slower than a fixed `slow_threshold_ms`, or
+  by default slower than the `slow_quantile` (p99) of recent root
+  latencies, so the slow bucket stays ~1% of traffic whatever the
+  typical LLM latency is
+- every trace containing an error span is kept
+- a small random fraction of the remaining fast traces is kept
+
+Kept traces are written as OTLP/JSON (one ExportTraceServiceRequest per
+line) by a background thread, so an OpenTelemetry collector's
+`otlpjsonfile` receiver can pick them up (see monitoring/otel-collector.yml).
+
+Configuration (environment):
+    COMPANION_TRACING             "0" disables tracing entirely
+    COMPANION_TRACE_DIR           output directory (default: <config logs_path>/traces,
+                                  i.e. companion_baas/logs/traces)
+    COMPANION_TRACE_SLOW_MS       fixed slow-trace threshold in ms (default: adaptive)
+    COMPANION_TRACE_SLOW_QUANTILE latency quantile of the adaptive threshold (default: 0.99)
+    COMPANION_TRACE_SAMPLE_RATE   fraction of fast traces kept (default: 0.01)
+"""
+
+import os
+import sys
+import json
+import time
+import random
+import socket
+import asyncio
+import logging
+import threading
+import functools
+import contextvars
+from queue import SimpleQueue, Empty
+from collections import deque
+from contextlib import contextmanager
+from datetime import datetime, timezone
+from typing import Any, Callable, Dict, Iterator, List, Optional
+
+try:
+    from .sketches import DecayingSketch
+except ImportError:
+    from sketches import DecayingSketch
+
+logger = logging.getLogger(__name__)
+
+
+# OTLP span kinds / status codes
+SPAN_KIND_INTERNAL = 1
+SPAN_KIND_SERVER = 2
+SPAN_KIND_CLIENT = 3
+
+STATUS_UNSET = 0
+STATUS_OK = 1
+STATUS_ERROR = 2
+
+
+class Span:
+    """
+    A timed operation within a trace
+
+    Features:
+    - Attributes and timestamped events
+    - Error status via record_exception()
+    - Context-manager friendly (ended by Tracer.span)
+    """
+
+    __slots__ = (
+        'name', 'trace_id', 'span_id', 'parent_id', 'kind',
+        'start_ns', 'end_ns', 'attributes', 'events',
+        'status', 'status_message', '_tracer'
+    )
+
+    def __init__(
+        self,
+        tracer: "Tracer",
+        name: str,
+        trace_id: str,
+        parent_id: Optional[str],
+        kind: int = SPAN_KIND_INTERNAL,
+        attributes: Optional[Dict[str, Any]] = None
+    ):
+        self._tracer = tracer
+        self.name = name
+        self.trace_id = trace_id
+        self.span_id = '%016x' % random.getrandbits(64)
+        self.parent_id = parent_id
+        self.kind = kind
+        self.start_ns = time.time_ns()
+        self.end_ns = 0
+        self.attributes: Dict[str, Any] = dict(attributes) if attributes else {}
+        self.events: List[tuple] = []
+        self.status = STATUS_UNSET
+        self.status_message = ''
+
+    @property
+    def duration_ms(self) -> float:
+        """Span duration in milliseconds (so far, if still open)"""
+        end = self.end_ns or time.time_ns()
+        return (end - self.start_ns) / 1e6
+
+    def set_attribute(self, key: str, value: Any):
+        """Attach a key/value attribute"""
+        self.attributes[key] = value
+
+    def add_event(self, name: str, attributes: Optional[Dict[str, Any]] = None):
+        """Record a timestamped event"""
+        self.events.append((time.time_ns(), name, attributes or {}))
+
+    def record_exception(self, exc: BaseException):
+        """Mark the span as failed and attach the exception"""
+        self.status = STATUS_ERROR
+        self.status_message = f"{type(exc).__name__}: {exc}"
+        self.add_event('exception', {
+            'exception.type': type(exc).__name__,
+            'exception.message': str(exc)
+        })
+
+    def end(self):
+        """Finish the span (idempotent)"""
+        if not self.end_ns:
+            self.end_ns = time.time_ns()
+            self._tracer._on_end(self)
+
+
+class _NoopSpan:
+    """Stand-in returned when tracing is disabled or no span is active"""
+
+    __slots__ = ()
+    name = ''
+    trace_id = ''
+    span_id = ''
+    duration_ms = 0.0
+
+    def set_attribute(self, key: str, value: Any):
+        pass
+
+    def add_event(self, name: str, attributes: Optional[Dict[str, Any]] = None):
+        pass
+
+    def record_exception(self, exc: BaseException):
+        pass
+
+    def end(self):
+        pass
+
+
+NOOP_SPAN = _NoopSpan()
+
+_current_span: contextvars.ContextVar = contextvars.ContextVar('companion_current_span', default=None)
+
+
+# ============================================================================
+# OTLP/JSON EXPORT
+# ============================================================================
+
+def _otlp_value(value: Any) -> Dict[str, Any]:
+    """Encode an attribute value as an OTLP AnyValue"""
+    if isinstance(value, bool):
+        return {'boolValue': value}
+    if isinstance(value, int):
+        return {'intValue': str(value)}
+    if isinstance(value, float):
+        return {'doubleValue': value}
+    if isinstance(value, (list, tuple)):
+        return {'arrayValue': {'values': [_otlp_value(v) for v in value]}}
+    return {'stringValue': str(value)}
+
+
+def _otlp_attributes(attributes: Dict[str, Any]) -> List[Dict[str, Any]]:
+    return [{'key': key, 'value': _otlp_value(value)} for key, value in attributes.items()]
+
+
+def span_to_otlp(span: Span) -> Dict[str, Any]:
+    """Encode a finished span as an OTLP/JSON span object"""
+    encoded = {
+        'traceId': span.trace_id,
+        'spanId': span.span_id,
+        'name': span.name,
+        'kind': span.kind,
+        'startTimeUnixNano': str(span.start_ns),
+        'endTimeUnixNano': str(span.end_ns),
+        'attributes': _otlp_attributes(span.attributes),
+        'status': {'code': span.status}
+    }
+    if span.parent_id:
+        encoded['parentSpanId'] = span.parent_id
+    if span.status_message:
+        encoded['status']['message'] = span.status_message
+    if span.events:
+        encoded['events'] = [
+            {'timeUnixNano': str(ts), 'name': name, 'attributes': _otlp_attributes(attrs)}
+            for ts, name, attrs in span.events
+        ]
+    return encoded
+
+
+class OTLPJsonFileExporter:
+    """
+    Writes traces as OTLP/JSON lines in a background thread
+
+    Features:
+    - One ExportTraceServiceRequest per line (collector `otlpjsonfile` format)
+    - Daily files: traces-YYYYMMDD.jsonl
+    - Request threads only enqueue; file I/O happens off the hot path
+    """
+
+    def __init__(self, directory: str, resource: Optional[Dict[str, Any]] = None):
+        """
+        Initialize exporter
+
+        Args:
+            directory: Output directory (created on first write)
+            resource: Resource attributes (service.name etc.)
+        """
+        self.directory = directory
+        self.resource = resource or {}
+        self.exported_traces = 0
+        self._queue: SimpleQueue = SimpleQueue()
+        self._thread: Optional[threading.Thread] = None
+        self._thread_lock = threading.Lock()
+        self._idle = threading.Event()
+        self._idle.set()
+
+    def export(self, spans: List[Span]):
+        """Queue a finished trace for writing"""
+        self._idle.clear()
+        self._queue.put(spans)
+        if self._thread is None:
+            with self._thread_lock:
+                if self._thread is None:
+                    self._thread = threading.Thread(
+                        target=self._run, name="trace-exporter", daemon=True
+                    )
+                    self._thread.start()
+
+    def encode(self, spans: List[Span]) -> Dict[str, Any]:
+        """Build the OTLP/JSON request body for one trace"""
+        return {
+            'resourceSpans': [{
+                'resource': {'attributes': _otlp_attributes(self.resource)},
+                'scopeSpans': [{
+                    'scope': {'name': 'companion_baas'},
+                    'spans': [span_to_otlp(span) for span in spans]
+                }]
+            }]
+        }
+
+    def _path(self) -> str:
+        day = datetime.now(timezone.utc).strftime('%Y%m%d')
+        return os.path.join(self.directory, f"traces-{day}.jsonl")
+
+    def _run(self):
+        while True:
+            try:
+                batch = [self._queue.get(timeout=1.0)]
+            except Empty:
+                self._idle.set()
+                continue
+            # Drain whatever else is waiting so one open() covers many traces
+            while True:
+                try:
+                    batch.append(self._queue.get_nowait())
+                except Empty:
+                    break
+            try:
+                os.makedirs(self.directory, exist_ok=True)
+                with open(self._path(), 'a', encoding='utf-8') as f:
+                    for spans in batch:
+                        f.write(json.dumps(self.encode(spans), separators=(',', ':')))
+                        f.write('\n')
+                self.exported_traces += len(batch)
+            except Exception as e:
+                logger.warning(f"⚠️ Trace export failed: {e}")
+            if self._queue.empty():
+                self._idle.set()
+
+    def flush(self, timeout: float = 5.0) -> bool:
+        """Block until queued traces are written"""
+        return self._idle.wait(timeout)
+
+
+# ============================================================================
+# TRACER
+# ============================================================================
+
+class Tracer:
+    """
+    Span factory with tail-based trace retention
+
+    Features:
+    - Context-propagated parent/child spans (threads via wrap())
+    - Per-trace buffering; keep/drop decided when the root span ends
+    - Slow and failed traces always kept, fast ones sampled
+    - Slow threshold fixed, or tracking a quantile of recent root latency
+    - Bounded memory: caps on open traces and spans per trace
+    """
+
+    # Adaptive threshold: root latencies needed before the quantile is
+    # trusted, and completions between threshold refreshes
+    ADAPTIVE_MIN_SAMPLES = 200
+    ADAPTIVE_REFRESH_EVERY = 100
+
+    def __init__(
+        self,
+        service_name: str = "companion-brain",
+        exporter: Optional[OTLPJsonFileExporter] = None,
+        slow_threshold_ms: Optional[float] = None,
+        slow_quantile: float = 0.99,
+        initial_slow_threshold_ms: float = 10000.0,
+        sample_rate: float = 0.01,
+        max_spans_per_trace: int = 1000,
+        max_open_traces: int = 10000,
+        keep_recent: int = 50,
+        enabled: bool = True
+    ):
+        """
+        Initialize tracer
+
+        Args:
+            service_name: service.name resource attribute
+            exporter: Destination for kept traces (None keeps them in memory only)
+            slow_threshold_ms: Traces at least this slow are always kept
+                (None = adaptive, see slow_quantile)
+            slow_quantile: Adaptive mode: root-latency quantile over the
+                last 10 minutes above which traces count as slow
+            initial_slow_threshold_ms: Adaptive mode: threshold used until
+                ADAPTIVE_MIN_SAMPLES traces have completed
+            sample_rate: Fraction of fast, successful traces kept
+            max_spans_per_trace: Spans beyond this are dropped (and counted)
+            max_open_traces: Unfinished traces tracked at once
+            keep_recent: Kept traces retained in memory for inspection
+            enabled: Master switch; disabled tracers cost one attribute check
+        """
+        self.service_name = service_name
+        self.exporter = exporter
+        self.adaptive = slow_threshold_ms is None
+        self.slow_threshold_ms = initial_slow_threshold_ms if self.adaptive else slow_threshold_ms
+        self.slow_quantile = slow_quantile
+        self._root_latency = DecayingSketch(window_seconds=600.0) if self.adaptive else None
+        self._roots_seen = 0
+        self.sample_rate = sample_rate
+        self.max_spans_per_trace = max_spans_per_trace
+        self.max_open_traces = max_open_traces
+        self.enabled = enabled
+
+        self._open: Dict[str, List[Span]] = {}
+        self._lock = threading.Lock()
+        self.recent_traces: deque = deque(maxlen=keep_recent)
+
+        self.stats = {
+            'traces_completed': 0,
+            'traces_kept': 0,
+            'kept_slow': 0,
+            'kept_error': 0,
+            'kept_sampled': 0,
+            'spans_dropped': 0,
+            'spans_late': 0
+        }
+
+    # ------------------------------------------------------------------
+    # Span creation
+    # ------------------------------------------------------------------
+    def start_span(
+        self,
+        name: str,
+        attributes: Optional[Dict[str, Any]] = None,
+        kind: int = SPAN_KIND_INTERNAL
+    ) -> Span:
+        """Start a span as a child of the current one (or a new trace root)"""
+        parent = _current_span.get()
+        if parent is None:
+            trace_id = '%032x' % random.getrandbits(128)
+            parent_id = None
+            with self._lock:
+                # Untracked when full: the root is still sampled on its own
+                if len(self._open) < self.max_open_traces:
+                    self._open[trace_id] = []
+        else:
+            trace_id = parent.trace_id
+            parent_id = parent.span_id
+        return Span(self, name, trace_id, parent_id, kind, attributes)
+
+    @contextmanager
+    def span(
+        self,
+        name: str,
+        attributes: Optional[Dict[str, Any]] = None,
+        kind: int = SPAN_KIND_INTERNAL
+    ) -> Iterator[Any]:
+        """
+        Context manager that opens a span and makes it current
+
+        Exceptions escaping the block mark the span as failed and re-raise.
+        """
+        if not self.enabled:
+            yield NOOP_SPAN
+            return
+        span = self.start_span(name, attributes, kind)
+        token = _current_span.set(span)
+        try:
+            yield span
+        except BaseException as e:
+            span.record_exception(e)
+            raise
+        finally:
+            _current_span.reset(token)
+            span.end()
+
+    def traced(
+        self,
+        name: Optional[str] = None,
+        attributes: Optional[Dict[str, Any]] = None,
+        kind: int = SPAN_KIND_INTERNAL
+    ) -> Callable:
+        """Decorator form of span() for sync and async functions"""
+
+        def decorator(func: Callable) -> Callable:
+            span_name = name or func.__qualname__
+
+            if asyncio.iscoroutinefunction(func):
+                @functools.wraps(func)
+                async def async_wrapper(*args, **kwargs):
+                    if not self.enabled:
+                        return await func(*args, **kwargs)
+                    with self.span(span_name, attributes, kind):
+                        return await func(*args, **kwargs)
+                return async_wrapper
+
+            @functools.wraps(func)
+            def wrapper(*args, **kwargs):
+                if not self.enabled:
+                    return func(*args, **kwargs)
+                with self.span(span_name, attributes, kind):
+                    return func(*args, **kwargs)
+            return wrapper
+
+        return decorator
+
+    def wrap(self, func: Callable) -> Callable:
+        """
+        Bind a callable to the current context so spans it opens in another
+        thread (run_in_executor, thread pools) nest under the caller's span
+        """
+        ctx = contextvars.copy_context()
+        return functools.partial(ctx.run, func)
+
+    # ------------------------------------------------------------------
+    # Trace completion and tail sampling
+    # ------------------------------------------------------------------
+    def _on_end(self, span: Span):
+        """Buffer a finished span; decide the trace's fate when its root ends"""
+        with self._lock:
+            spans = self._open.get(span.trace_id)
+            if span.parent_id is not None:
+                if spans is None:
+                    # Root already finished (or trace untracked): never reopen it
+                    self.stats['spans_late'] += 1
+                elif len(spans) < self.max_spans_per_trace:
+                    spans.append(span)
+                else:
+                    self.stats['spans_dropped'] += 1
+                return
+            if spans is None:
+                spans = [span]
+            else:
+                del self._open[span.trace_id]
+                spans.append(span)
+            self.stats['traces_completed'] += 1
+            if self.adaptive:
+                self._observe_root(span)
+            reason = self._retention_reason(span, spans)
+            if reason is None:
+                return
+            self.stats['traces_kept'] += 1
+            self.stats[f'kept_{reason}'] += 1
+
+        # Root span last keeps parents after children; export outside the lock
+        self.recent_traces.append(spans)
+        if self.exporter is not None:
+            self.exporter.export(spans)
+
+    def _observe_root(self, root: Span):
+        """Feed the adaptive slow threshold (lock held)"""
+        self._root_latency.add(root.duration_ms / 1000.0)
+        self._roots_seen += 1
+        if self._roots_seen >= self.ADAPTIVE_MIN_SAMPLES and \
+                self._roots_seen % self.ADAPTIVE_REFRESH_EVERY == 0:
+            window = self._root_latency.snapshot()
+            if window.count >= self.ADAPTIVE_MIN_SAMPLES:
+                self.slow_threshold_ms = window.quantile(self.slow_quantile) * 1000.0
+
+    def _retention_reason(self, root: Span, spans: List[Span]) -> Optional[str]:
+        """Why a completed trace is kept ('slow', 'error', 'sampled') or None"""
+        if root.duration_ms >= self.slow_threshold_ms:
+            return 'slow'
+        for span in spans:
+            if span.status == STATUS_ERROR:
+                return 'error'
+        if self.sample_rate > 0 and random.random() < self.sample_rate:
+            return 'sampled'
+        return None
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Tracer counters plus the number of in-flight traces"""
+        with self._lock:
+            open_traces = len(self._open)
+        return {
+            **self.stats,
+            'open_traces': open_traces,
+            'slow_threshold_ms': self.slow_threshold_ms,
+            'slow_threshold_mode': f"p{self.slow_quantile * 100:g}" if self.adaptive else 'fixed',
+            'sample_rate': self.sample_rate,
+            'enabled': self.enabled
+        }
+
+    def flush(self, timeout: float = 5.0) -> bool:
+        """Wait for queued traces to reach the exporter's files"""
+        if self.exporter is None:
+            return True
+        return self.exporter.flush(timeout)
+
+
+def current_span() -> Any:
+    """The active span, or a no-op span outside any trace"""
+    span = _current_span.get()
+    return span if span is not None else NOOP_SPAN
+
+
+def _tracer_from_env() -> Tracer:
+    """
+    Build the process tracer, reusing it if this module was already
+    imported under its other name (companion_baas.optimization.* vs
+    optimization.*) so every span lands in the same traces.
+    """
+    for alias in ("companion_baas.optimization.tracing", "optimization.tracing"):
+        module = sys.modules.get(alias)
+        if module is not None and module is not sys.modules.get(__name__):
+            existing = getattr(module, "tracer", None)
+            if existing is not None:
+                return existing
+
+    service_name = "companion-brain"
+    # Absolute default next to the other logs (config.BrainConfig.logs_path),
+    # independent of the working directory
+    default_dir = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), "logs", "traces")
+    slow_ms = os.environ.get("COMPANION_TRACE_SLOW_MS")
+    exporter = OTLPJsonFileExporter(
+        os.path.abspath(os.environ.get("COMPANION_TRACE_DIR", default_dir)),
+        resource={
+            'service.name': service_name,
+            'host.name': socket.gethostname(),
+            'process.pid': os.getpid()
+        }
+    )
+    return Tracer(
+        service_name=service_name,
+        exporter=exporter,
+        slow_threshold_ms=float(slow_ms) if slow_ms else None,
+        slow_quantile=float(os.environ.get("COMPANION_TRACE_SLOW_QUANTILE", "0.99")),
+        sample_rate=float(os.environ.get("COMPANION_TRACE_SAMPLE_RATE", "0.01")),
+        enabled=os.environ.get("COMPANION_TRACING", "1") != "0"
+    )
+
+
+# Global tracer
+tracer = _tracer_from_env()
+traced = tracer.traced
+
+
+# Example usage
+if __name__ == "__main__":
+    import tempfile
+
+    print("=" * 70)
+    print("REQUEST TRACING - Tail-Sampled OTLP/JSON Export")
+    print("=" * 70)
+
+    out_dir = tempfile.mkdtemp(prefix="traces-")
+    demo = Tracer(
+        exporter=OTLPJsonFileExporter(out_dir, resource={'service.name': 'tracing-demo'}),
+        slow_threshold_ms=50,
+        sample_rate=0.0
+    )
+
+    @demo.traced("demo.retrieve")
+    def retrieve(delay: float):
+        time.sleep(delay)
+
+    async def fetch(i: int, delay: float):
+        with demo.span("demo.web_fetch", {'fetch.index': i}):
+            await asyncio.sleep(delay)
+
+    async def handle(delay: float):
+        with demo.span("demo.think", {'delay_s': delay}, kind=SPAN_KIND_SERVER):
+            retrieve(delay)
+            await asyncio.gather(*(fetch(i, delay) for i in range(3)))
+            loop = asyncio.get_running_loop()
+            await loop.run_in_executor(None, demo.wrap(lambda: retrieve(delay)))
+
+    for delay in (0.001, 0.001, 0.03):
+        asyncio.run(handle(delay))
+
+    try:
+        with demo.span("demo.think"):
+            raise ValueError("boom")
+    except ValueError:
+        pass
+
+    demo.flush()
+    print(f"\nStats: {demo.get_stats()}")
+    for trace in demo.recent_traces:
+        root = trace[-1]
+        print(f"\nTrace {root.trace_id[:8]} ({root.duration_ms:.1f}ms)")
+        for span in trace:
+            indent = "  " if span is root else "    "
+            print(f"{indent}{span.name}: {span.duration_ms:.1f}ms")
+    print(f"\nOTLP/JSON written to {out_dir}: {os.listdir(out_dir)}")
+
+    print("\n" + "=" * 70)
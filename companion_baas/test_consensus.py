@@ -0,0 +1,107 @@
+"""
+Test Multi-Model Consensus
+Tests that answers are always compared with embeddings from one encoder
+"""
+
+import asyncio
+import sys
+import os
+import time
+import types
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core import brain as brain_module
+from companion_baas.core.brain import MultiModelConsensus
+
+
+class Vector(list):
+    """Just enough of a numpy vector for the consensus code"""
+    def __truediv__(self, scale):
+        return Vector(value / scale for value in self)
+
+
+fake_numpy = types.SimpleNamespace(
+    dot=lambda a, b: sum(x * y for x, y in zip(a, b)),
+    linalg=types.SimpleNamespace(norm=lambda v: sum(x * x for x in v) ** 0.5)
+)
+
+
+class FlakyEmbedder:
+    """Dense embedder that stops working after `working_calls` calls"""
+    def __init__(self, working_calls):
+        self.working_calls = working_calls
+
+    def encode_many(self, texts):
+        self.working_calls -= 1
+        if self.working_calls < 0:
+            return [None for _ in texts]
+        return [Vector([1.0, float(len(text) % 3), 0.5]) for text in texts]
+
+
+def make_brain(answers, embedder):
+    """Brain stand-in: one Bytez provider answering per model after a delay"""
+    def generate(messages, model):
+        delay, text = answers[model]
+        time.sleep(delay)
+        return {'success': True, 'response': text, 'confidence': 0.8}
+    return types.SimpleNamespace(
+        providers={'bytez': types.SimpleNamespace(generate=generate)},
+        semantic_cache=types.SimpleNamespace(embedder=embedder)
+    )
+
+
+def test_consensus_embeddings():
+    """Test consistent embeddings when the dense embedder fails"""
+
+    print("=" * 60)
+    print("Testing Consensus Embeddings")
+    print("=" * 60)
+
+    saved = brain_module.HAS_NUMPY, brain_module.np
+    brain_module.HAS_NUMPY, brain_module.np = True, fake_numpy
+    try:
+        # Test 1: A partially encoded batch falls back as a whole
+        print("\n[Test 1] Embedder returns None for one text...")
+
+        class PartialEmbedder:
+            def encode_many(self, texts):
+                return [Vector([1.0, 0.0]), None]
+
+        consensus = MultiModelConsensus(make_brain({}, PartialEmbedder()))
+        vectors, dense = consensus._embed(["first answer", "second answer"])
+        assert not dense and all(isinstance(vector, dict) for vector in vectors)
+        print("✅ PASS - Whole batch uses the hashed fallback")
+
+        # Test 2: Incomparable vectors never agree
+        print("\n[Test 2] Mixed vector kinds...")
+        assert MultiModelConsensus._cosine(Vector([1.0, 0.0]), {3: 1.0}) == 0.0
+        assert MultiModelConsensus._cosine({3: 1.0}, Vector([1.0, 0.0])) == 0.0
+        assert MultiModelConsensus._cosine(Vector([1.0, 0.0]), Vector([1.0, 0.0, 0.0])) == 0.0
+        print("✅ PASS - Dimension or kind mismatch scores 0")
+
+        # Test 3: Dense embedder fails after the first answer arrived
+        print("\n[Test 3] Embedder fails mid-query...")
+        answers = {
+            'fast': (0.0, "The capital of France is Paris."),
+            'slow-1': (0.2, "Paris is the capital of France."),
+            'slow-2': (0.2, "The capital city of France is Paris.")
+        }
+        consensus = MultiModelConsensus(make_brain(answers, FlakyEmbedder(working_calls=1)))
+        result = asyncio.run(consensus.query_with_consensus("Capital of France?", models=list(answers)))
+        metadata = result['metadata']
+        print(f"Consensus: {metadata['consensus_type']}, agreement {metadata['agreement_score']:.2f}, "
+              f"threshold {metadata['agreement_threshold']}")
+        assert result['success'] and result['models_used'] >= 2
+        assert metadata['agreement_threshold'] == MultiModelConsensus.HASHED_MIN_AGREEMENT
+        assert metadata['consensus_type'] == 'quorum_consensus'
+        print("✅ PASS - Earlier answers re-embedded with the fallback")
+    finally:
+        brain_module.HAS_NUMPY, brain_module.np = saved
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_consensus_embeddings()
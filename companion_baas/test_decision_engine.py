@@ -0,0 +1,121 @@
+"""
+Test AGI Decision Engine
+Tests step scheduling in the decision engine without a live brain
+"""
+
+import sys
+import os
+import threading
+import time
+import types
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.agi_decision_engine import AGIDecisionEngine
+
+
+def test_step_pool_recycling():
+    """Test that recycling a stuck step pool never rejects a new step"""
+
+    print("=" * 60)
+    print("Testing Step Pool Recycling")
+    print("=" * 60)
+
+    engine = AGIDecisionEngine(types.SimpleNamespace(), max_parallel_steps=2)
+    errors = []
+    stop = threading.Event()
+
+    def submit_steps():
+        while not stop.is_set():
+            try:
+                engine._submit_step(lambda: None).result(timeout=5)
+            except Exception as e:
+                errors.append(e)
+                return
+
+    print("\n[Test 1] Submitting steps while stuck steps force pool swaps...")
+    submitters = [threading.Thread(target=submit_steps) for _ in range(4)]
+    for thread in submitters:
+        thread.start()
+    for _ in range(500):
+        stuck = engine._submit_step(time.sleep, 0.001)
+        while not stuck.running() and not stuck.done():
+            time.sleep(0)
+        engine._abandon_step(stuck)
+    stop.set()
+    for thread in submitters:
+        thread.join()
+
+    recycles = engine.stats['executor_recycles']
+    print(f"Pool recycles: {recycles}, submit errors: {errors[:1]}")
+    assert recycles > 0
+    assert errors == []
+    print("✅ PASS - Submits never land on a retired pool")
+
+    print("\n" + "=" * 60)
+
+
+def make_brain(**modules):
+    """Brain stand-in exposing only the module attributes the engine probes"""
+    attributes = dict(self_learning=None, autonomous_system=None, code_executor=None,
+                      knowledge_retriever=None, neural_reasoning=None, personality_engine=None,
+                      search_engine=None)
+    attributes.update(modules)
+    return types.SimpleNamespace(**attributes)
+
+
+def test_plan_cache():
+    """Test plan reuse by query signature and bounded decision history"""
+
+    print("=" * 60)
+    print("Testing Plan Cache")
+    print("=" * 60)
+
+    brain = make_brain()
+    engine = AGIDecisionEngine(brain, history_size=5, plan_cache_size=2)
+
+    # Test 1: A repeated query shape reuses its plan
+    print("\n[Test 1] Same query twice...")
+    first = engine.analyze_and_decide("What is machine learning?")
+    second = engine.analyze_and_decide("What is machine learning?")
+    print(f"Cached: {first.metadata['plan_cached']} -> {second.metadata['plan_cached']}")
+    assert not first.metadata['plan_cached'] and second.metadata['plan_cached']
+    assert first.decision_id != second.decision_id
+    assert first.execution_order == second.execution_order
+    print("✅ PASS - Second decision served from the plan cache")
+
+    # Test 2: Callers cannot corrupt the cached template
+    print("\n[Test 2] Mutating a returned plan...")
+    second.execution_order.append("tampered")
+    second.modules_to_use.clear()
+    third = engine.analyze_and_decide("What is machine learning?")
+    assert "tampered" not in third.execution_order
+    assert third.modules_to_use == first.modules_to_use
+    print("✅ PASS - Plans are copies of the template")
+
+    # Test 3: Module availability change drops cached plans
+    print("\n[Test 3] A module comes online...")
+    brain.search_engine = object()
+    fourth = engine.analyze_and_decide("What is machine learning?")
+    stats = engine.get_decision_stats()['plan_cache']
+    print(f"Plan cache: {stats}")
+    assert not fourth.metadata['plan_cached']
+    assert stats['invalidations'] == 1
+    print("✅ PASS - Cache invalidated when modules change")
+
+    # Test 4: Bounded cache and history
+    print("\n[Test 4] Many query shapes...")
+    for query in ("Write a python function to sort a list", "Tell me a story about dragons",
+                  "Search the latest news on batteries", "Hello!", "Compare Rust and Go in depth"):
+        engine.analyze_and_decide(query)
+    assert len(engine._plan_cache) <= 2
+    assert len(engine.decision_history) == 5
+    print("✅ PASS - Plan cache and history stay within their limits")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_step_pool_recycling()
+    test_plan_cache()
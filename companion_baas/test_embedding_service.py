@@ -0,0 +1,115 @@
+"""
+Test Embedding Service
+Tests micro-batching, the LRU cache and the shared service registry
+(with a stand-in model, so sentence-transformers is not needed)
+"""
+
+import sys
+import os
+import threading
+import types
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.optimization import embedding_service
+from companion_baas.optimization.embedding_service import EmbeddingService, get_embedding_service
+
+
+class Vector(list):
+    """Just enough of a numpy array for the service"""
+    def setflags(self, write):
+        self.writeable = write
+
+
+class FakeModel:
+    """Records every batch it is asked to encode"""
+    def __init__(self):
+        self.batches = []
+        self.lock = threading.Lock()
+
+    def encode(self, texts, convert_to_numpy=True, show_progress_bar=False):
+        with self.lock:
+            self.batches.append(list(texts))
+        return [[float(len(text)), float(sum(map(ord, text)) % 97)] for text in texts]
+
+
+def make_service(**kwargs):
+    service = EmbeddingService(**kwargs)
+    service.model = FakeModel()
+    return service
+
+
+def test_embedding_service():
+    """Test the shared embedding service"""
+
+    print("=" * 60)
+    print("Testing Embedding Service")
+    print("=" * 60)
+
+    saved_np = embedding_service.np
+    embedding_service.np = types.SimpleNamespace(asarray=lambda v, dtype=None: Vector(v), float32=float)
+    try:
+        # Test 1: Concurrent single-text requests share model calls
+        print("\n[Test 1] 32 concurrent encode() calls...")
+        service = make_service(batch_window_ms=20.0)
+        texts = [f"query {i}" for i in range(32)]
+        results = {}
+        start = threading.Barrier(len(texts))
+
+        def encode(text):
+            start.wait()
+            results[text] = service.encode(text)
+
+        threads = [threading.Thread(target=encode, args=(text,)) for text in texts]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join(timeout=5)
+        batches = service.model.batches
+        print(f"Model calls: {len(batches)}, largest batch: {max(map(len, batches))}")
+        assert all(results[text] == [float(len(text)), float(sum(map(ord, text)) % 97)] for text in texts)
+        assert len(batches) < len(texts) and sum(map(len, batches)) == len(texts)
+        print("✅ PASS - Requests coalesced into batches")
+
+        # Test 2: Repeated texts come from the LRU
+        print("\n[Test 2] Cache hits and eviction...")
+        service = make_service(cache_size=2)
+        first = service.encode("alpha")
+        assert service.encode("alpha") is first and len(service.model.batches) == 1
+        assert first.writeable is False
+        service.encode("beta")
+        service.encode("gamma")
+        service.encode("alpha")
+        stats = service.get_stats()
+        print(f"Cache: size={stats['cache_size']} hit rate={stats['cache_hit_rate']:.0%}")
+        assert stats['cache_size'] == 2 and stats['cache_hits'] == 1
+        assert len(service.model.batches) == 4  # alpha was evicted by gamma
+        print("✅ PASS - Shared read-only vectors, bounded LRU")
+
+        # Test 3: encode_many encodes only the misses, once each
+        print("\n[Test 3] encode_many...")
+        service.model.batches.clear()
+        vectors = service.encode_many(["gamma", "delta", "delta", "epsilon"])
+        print(f"Batches: {service.model.batches}")
+        assert service.model.batches == [["delta", "epsilon"]]
+        assert vectors[1] is vectors[2] and vectors[0] == [5.0, float(sum(map(ord, "gamma")) % 97)]
+        print("✅ PASS - One model call for the cache misses")
+    finally:
+        embedding_service.np = saved_np
+
+    # Test 4: One service per model name; unavailable models encode to None
+    print("\n[Test 4] Shared registry...")
+    assert get_embedding_service("registry-test") is get_embedding_service("registry-test")
+    assert get_embedding_service("registry-test") is not get_embedding_service("registry-test-2")
+    unavailable = EmbeddingService("unloadable")
+    unavailable._load_failed = True
+    assert unavailable.encode("text") is None and unavailable.encode_many(["text"]) is None
+    assert not unavailable.available
+    print("✅ PASS - Consumers share a service; missing model degrades to None")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_embedding_service()
@@ -0,0 +1,83 @@
+"""
+Test Episodic Memory
+Tests SQLite-backed episode persistence, batched commits and reload
+"""
+
+import sys
+import os
+import json
+import sqlite3
+import tempfile
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.self_learning import EpisodicMemory
+
+
+def stored_episode(i):
+    """Row payload as EpisodicMemory writes it"""
+    return json.dumps({
+        'episode_id': f"ep_{i:06d}", 'timestamp': float(i), 'query': f"question {i}",
+        'response': f"answer {i}", 'context': {}, 'outcome': {'success': True}
+    })
+
+
+def test_episodic_memory():
+    """Test episode persistence"""
+
+    print("=" * 60)
+    print("Testing Episodic Memory Persistence")
+    print("=" * 60)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 1: Reload survives gaps in stored sequence numbers
+        print("\n[Test 1] Reloading a database with seq gaps...")
+        path = os.path.join(tmp, "gaps.db")
+        db = sqlite3.connect(path)
+        db.execute("CREATE TABLE episodes (seq INTEGER PRIMARY KEY, data TEXT NOT NULL)")
+        db.executemany("INSERT INTO episodes VALUES (?, ?)",
+                       [(0, stored_episode(0)), (1, stored_episode(1)), (5, stored_episode(5))])
+        db.commit()
+        db.close()
+
+        memory = EpisodicMemory(max_episodes=3, db_path=path)
+        assert [e.query for e in memory.episodes] == ["question 0", "question 1", "question 5"]
+        for i in range(6, 10):
+            memory.store_episode(f"question {i}", "answer", {}, {'success': True})
+        print(f"In memory: {[e.query for e in memory.episodes]}")
+        assert [e.query for e in memory.episodes] == ["question 7", "question 8", "question 9"]
+        memory.close()
+        print("✅ PASS - Oldest episodes evicted despite the gap")
+
+        # Test 2: What was evicted stays evicted after a restart
+        print("\n[Test 2] Reopening the database...")
+        reloaded = EpisodicMemory(max_episodes=3, db_path=path)
+        assert [e.query for e in reloaded.episodes] == ["question 7", "question 8", "question 9"]
+        assert reloaded.recall_successful(top_k=1)[0].query == "question 9"
+        reloaded.close()
+        print("✅ PASS - Reload matches the evicted state")
+
+        # Test 3: Writes are grouped into commits; close() flushes the rest
+        print("\n[Test 3] Batched commits...")
+        path = os.path.join(tmp, "batched.db")
+        memory = EpisodicMemory(db_path=path, commit_batch=4, commit_interval=3600)
+        reader = sqlite3.connect(path)
+
+        def committed():
+            return reader.execute("SELECT COUNT(*) FROM episodes").fetchone()[0]
+
+        for i in range(6):
+            memory.store_episode(f"question {i}", "answer", {}, {'success': True})
+        print(f"Committed before close: {committed()}")
+        assert committed() == 4
+        memory.close()
+        assert committed() == 6
+        reader.close()
+        print("✅ PASS - One commit per batch, remainder committed on close")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_episodic_memory()
@@ -0,0 +1,113 @@
+"""
+Test Eval Harness
+Tests offline replay of models and routing policies
+"""
+
+import sys
+import os
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.eval_harness import (
+    Candidate, OfflineEvalHarness, RecordedRequest, RoutedCandidate, StubProvider
+)
+from companion_baas.core.model_router import ModelRouter
+
+ROUTES = {'math': [('strong', 'stub', 0.5), ('weak', 'stub', 0.1)]}
+
+
+def make_corpus(size=300):
+    """Math questions with their exact answers"""
+    return [RecordedRequest(str(i), f"What is {i} + {i}?", str(2 * i), context="math") for i in range(size)]
+
+
+def make_routed(name, corpus, seed=3):
+    """Routing policy over a strong and a weak stub model"""
+    router = ModelRouter(routes=ROUTES, seed=seed, latency_slo=1.0, clock=lambda: 0.0)
+    # Real (slept) jitter so worker threads finish out of order
+    models = {
+        'strong': StubProvider.for_corpus(corpus, accuracy=0.9, latency_ms=2, jitter_ms=2, sleep=True, model='strong'),
+        'weak': StubProvider.for_corpus(corpus, accuracy=0.5, latency_ms=2, jitter_ms=2, sleep=True, model='weak')
+    }
+    return RoutedCandidate(name, router, lambda model, prompt: models[model](prompt))
+
+
+def without_timing(report):
+    """Report minus wall-clock fields"""
+    return {key: value for key, value in report.items() if key != 'duration_seconds'}
+
+
+def test_eval_harness():
+    """Test offline replay and A/A comparisons"""
+
+    print("=" * 60)
+    print("Testing Eval Harness")
+    print("=" * 60)
+
+    # Test 1: Two candidates with the same accuracy never come out significantly different
+    print("\n[Test 1] A/A with one provider...")
+    corpus = make_corpus(1000)
+    harness = OfflineEvalHarness(
+        [Candidate("a", StubProvider.for_corpus(corpus, accuracy=0.8, seed=1)),
+         Candidate("b", StubProvider.for_corpus(corpus, accuracy=0.8, seed=2))],
+        concurrency=8
+    )
+    report = harness.run(corpus)
+    verdict = report['comparisons']['b']['quality']['verdict']
+    print(f"Requests: {report['requests']}, quality verdict: {verdict}")
+    assert report['requests'] == 1000
+    assert verdict == 'inconclusive'
+    print("✅ PASS - No false difference")
+
+    # Test 2: Identically seeded routing policies pick the same models at any thread timing
+    print("\n[Test 2] A/A with routed policies, replayed twice...")
+    corpus = make_corpus()
+    reports = [
+        OfflineEvalHarness([make_routed("a", corpus), make_routed("b", corpus)], concurrency=8).run(corpus)
+        for _ in range(2)
+    ]
+    assert without_timing(reports[0]) == without_timing(reports[1])
+    comparison = reports[0]['comparisons']['b']
+    assert all(result['mean_difference'] == 0 and not result['significant'] for result in comparison.values())
+    assert reports[0]['candidates']['a'] == reports[0]['candidates']['b']
+    print("✅ PASS - Replays identical, candidates identical")
+
+    print("\n" + "=" * 60)
+
+
+def test_routed_candidates():
+    """Test routing policies as replay candidates"""
+
+    print("=" * 60)
+    print("Testing Routed Candidates")
+    print("=" * 60)
+
+    # Test 1: Every replayed request feeds its outcome back into the router
+    print("\n[Test 1] Recording outcomes...")
+    corpus = make_corpus(100)
+    candidate = make_routed("routed", corpus)
+    OfflineEvalHarness([candidate], concurrency=4).run(corpus)
+    arms = candidate.router.arms
+    print(f"Strong: {arms['strong'].requests}, weak: {arms['weak'].requests}")
+    assert arms['strong'].requests + arms['weak'].requests == 100
+    assert candidate.router.get_stats()['selections'] == 100
+    print("✅ PASS - One outcome per request")
+
+    # Test 2: A router with no model for the context yields error outcomes, not a call with None
+    print("\n[Test 2] No model for the context...")
+    corpus = make_corpus(10)
+    calls = []
+    candidate = RoutedCandidate("routed", ModelRouter(routes={'code': ROUTES['math']}, seed=0),
+                                lambda model, prompt: calls.append(model) or "answer")
+    report = OfflineEvalHarness([candidate], concurrency=2).run(corpus)
+    assert calls == []
+    assert report['candidates']['routed']['errors'] == 10
+    print("✅ PASS - Counted as errors")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_eval_harness()
+    test_routed_candidates()
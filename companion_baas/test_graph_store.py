@@ -0,0 +1,88 @@
+"""
+Test Graph Store
+Tests the hash-indexed adjacency-list graph behind the knowledge graphs
+"""
+
+import sys
+import os
+import tempfile
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.graph_store import GraphStore
+
+EDGES = [
+    ("Python", "is_a", "Language"),
+    ("Rust", "is_a", "Language"),
+    ("Python", "used_for", "Data Science"),
+    ("Data Science", "uses", "Statistics"),
+    ("Statistics", "part_of", "Mathematics"),
+]
+
+
+def test_graph_store():
+    """Test lookups, traversal, CSR freezing and persistence"""
+
+    print("=" * 60)
+    print("Testing Graph Store")
+    print("=" * 60)
+
+    # Test 1: Normalized hash index
+    print("\n[Test 1] Node lookup...")
+    store = GraphStore(normalize=str.lower)
+    store.add_node("Python", "concept_1")
+    assert store.add_node("PYTHON", "concept_2") == store.node_id("python")
+    assert store.get("pYtHoN") == "concept_1" and store.key(store.node_id("python")) == "Python"
+    assert "python" in store and "Java" not in store and len(store) == 1
+    print("✅ PASS - Case-insensitive keys, first spelling and data kept")
+
+    # Test 2: Typed adjacency in both directions
+    print("\n[Test 2] Neighbor queries...")
+    store.bulk_load(edges=EDGES, freeze=False)
+    assert sorted(store.neighbors("Python")) == ["Data Science", "Language"]
+    assert store.neighbors("Python", relation="is_a") == ["Language"]
+    assert sorted(store.neighbors("Language", direction="in")) == ["Python", "Rust"]
+    assert store.neighbors("Python", relation="unknown") == [] and store.neighbors("Java") == []
+    print("✅ PASS - Neighbors by relation and direction")
+
+    # Test 3: Bounded traversal
+    print("\n[Test 3] k-hop and shortest path...")
+    two_hops = [store.key(node) for node in store.k_hop("Python", max_depth=2)]
+    print(f"Within 2 hops of Python: {two_hops}")
+    assert set(two_hops) == {"Language", "Data Science", "Rust", "Statistics"}
+    assert set(two_hops[:2]) == {"Language", "Data Science"}  # nearest first
+    assert len(store.k_hop("Python", max_depth=5, limit=3)) == 3
+    assert store.shortest_path("Python", "Mathematics") == ["Python", "Data Science", "Statistics", "Mathematics"]
+    assert store.shortest_path("Python", "Mathematics", max_hops=2) is None
+    print("✅ PASS - Depth and result limits respected")
+
+    # Test 4: Frozen CSR layout answers the same, and thaws on mutation
+    print("\n[Test 4] freeze() and thaw...")
+    expected = {key: sorted(store.neighbors(key, direction="both")) for key, _, _ in EDGES}
+    store.freeze()
+    assert store.frozen
+    assert {key: sorted(store.neighbors(key, direction="both")) for key, _, _ in EDGES} == expected
+    assert store.neighbors("Python", relation="used_for") == ["Data Science"]
+    store.add_edge("Rust", "used_for", "Systems")
+    assert not store.frozen and store.neighbors("Rust", relation="used_for") == ["Systems"]
+    assert store.get_stats()['edges'] == len(EDGES) + 1
+    print("✅ PASS - CSR matches adjacency lists; mutation thaws")
+
+    # Test 5: Persistence round trip
+    print("\n[Test 5] save() / load()...")
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "graph.json")
+        store.save(path)
+        loaded = GraphStore.load(path, normalize=str.lower)
+    assert loaded.frozen and len(loaded) == len(store)
+    assert sorted(loaded.edges()) == sorted(store.edges())
+    assert loaded.get("python") == "concept_1"
+    print(f"Loaded: {loaded.get_stats()}")
+    print("✅ PASS - Nodes, data and edges restored")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_graph_store()
@@ -0,0 +1,122 @@
+"""
+Test Hedged Requests
+Tests when backups fire and which tenant pays for them
+"""
+
+import sys
+import os
+import threading
+import time
+import types
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.optimization.hedging import HedgeBudget, HedgedExecutor
+from companion_baas.core import brain as brain_module
+
+
+def test_hedge_timing():
+    """Test that the hedge delay counts from when the primary starts running"""
+
+    print("=" * 60)
+    print("Testing Hedge Timing")
+    print("=" * 60)
+
+    def answer_after(seconds, text):
+        def call(cancel_event):
+            cancel_event.wait(seconds)
+            return None if cancel_event.is_set() else text
+        return call
+
+    # Test 1: Waiting for a worker does not trigger a hedge
+    print("\n[Test 1] Primary queued behind busy workers...")
+    executor = HedgedExecutor(HedgeBudget(), max_workers=2, min_delay=0.0)
+    for _ in range(2):
+        executor._pool.submit(time.sleep, 0.3)
+    outcome = executor.call(answer_after(0.05, "primary"), answer_after(0.0, "backup"),
+                            hedge_delay=0.15, tenant='queued')
+    print(f"Winner: {outcome.winner}, hedged: {outcome.hedged}, latency: {outcome.latency:.2f}s")
+    assert outcome.result == "primary" and not outcome.hedged
+    assert outcome.latency >= 0.3
+    print("✅ PASS - Queue time is not charged against the hedge delay")
+
+    # Test 2: A primary that runs too long is still hedged
+    print("\n[Test 2] Slow running primary...")
+    outcome = executor.call(answer_after(2.0, "primary"), answer_after(0.0, "backup"),
+                            hedge_delay=0.05, tenant='slow')
+    print(f"Winner: {outcome.winner}, hedged: {outcome.hedged}, latency: {outcome.latency:.2f}s")
+    assert outcome.winner == 'hedge' and outcome.latency < 1.0
+    print("✅ PASS - Backup answers for a stalled primary")
+
+    # Test 3: A primary that fails early hedges at once
+    print("\n[Test 3] Failing primary...")
+
+    def broken(cancel_event):
+        raise RuntimeError("provider down")
+
+    outcome = executor.call(broken, answer_after(0.0, "backup"), hedge_delay=5.0, tenant='slow')
+    assert outcome.winner == 'hedge' and outcome.latency < 1.0
+    print("✅ PASS - Early failure hedges without waiting for the delay")
+
+    executor.shutdown()
+    print("\n" + "=" * 60)
+
+
+def test_hedge_tenants():
+    """Test that hedges are charged to the caller's tenant"""
+
+    print("=" * 60)
+    print("Testing Hedge Budget Tenants")
+    print("=" * 60)
+
+    executor = HedgedExecutor(HedgeBudget(ratio=0.0, burst=1.0), min_delay=0.0)
+    router = types.SimpleNamespace(
+        select=lambda context, estimated_tokens, exclude: 'backup-model',
+        latency_quantile=lambda model, q, default: 0.01,
+        latency_slo=1.0
+    )
+
+    def call_with_retry(func, max_retries=3, provider=None, model=None, cancel_event=None):
+        if model == 'slow-model':
+            cancel_event.wait(1.0)
+        return func()
+
+    # Brain stand-in with only what _call_hedged uses
+    brain = types.SimpleNamespace(
+        hedging_enabled=True, app_type='chatbot', model_router=router, hedged_executor=executor,
+        _estimate_tokens=lambda message: 10, _routing_context=lambda message, task, tokens: 'chat',
+        _call_with_retry=call_with_retry, _is_usable_response=lambda result: bool(result)
+    )
+
+    @brain_module._tenant_scoped
+    def think(message, user_id=None):
+        return brain_module.CompanionBrain._call_hedged(
+            brain, lambda model: (lambda: f"{model} answer"), 'slow-model', message)
+
+    # Test 1: Each user spends their own budget
+    print("\n[Test 1] Two users on the same brain...")
+    assert think("hi", user_id="alice") == "backup-model answer"
+    assert think("hi", user_id="bob") == "backup-model answer"
+    assert think("hi", user_id="alice") == "slow-model answer"  # alice's single token is spent
+    tenants = executor.get_stats()['tenants']
+    print(f"Tenants: { {name: stats['hedges'] for name, stats in tenants.items()} }")
+    assert tenants['alice']['hedges'] == 1 and tenants['alice']['denied'] == 1
+    assert tenants['bob']['hedges'] == 1
+    assert 'chatbot' not in tenants
+    print("✅ PASS - Budget keyed by user, not by app type")
+
+    # Test 2: Anonymous requests share the app's bucket; the binding does not leak
+    print("\n[Test 2] Anonymous request after scoped ones...")
+    think("hi")
+    assert brain_module._request_tenant.get() is None
+    assert executor.get_stats()['tenants']['chatbot']['requests'] == 1
+    print("✅ PASS - Anonymous calls charged to the app type")
+
+    executor.shutdown()
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_hedge_timing()
+    test_hedge_tenants()
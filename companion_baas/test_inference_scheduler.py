@@ -0,0 +1,251 @@
+"""
+Test Inference Scheduler
+Regression tests for the local continuous-batching scheduler and
+speculative local/cloud inference (no Ollama server needed)
+"""
+
+import sys
+import os
+import time
+import types
+import asyncio
+import threading
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+# The scheduler never talks HTTP here; allow running without httpx installed
+sys.modules.setdefault('httpx', types.ModuleType('httpx'))
+
+from companion_baas.core.local_intelligence import LocalInferenceScheduler, HybridInferenceEngine
+
+
+def run_in_threads(*workers, timeout=10):
+    """Run each coroutine function in its own thread with its own event loop"""
+    results = [None] * len(workers)
+
+    def run(index):
+        results[index] = asyncio.run(workers[index]())
+
+    threads = [threading.Thread(target=run, args=(index,)) for index in range(len(workers))]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join(timeout=timeout)
+    assert not any(thread.is_alive() for thread in threads), "an event loop hung"
+    return results
+
+
+def test_inference_scheduler():
+    """Test slots, cancellation and expiry with one and several event loops"""
+
+    print("=" * 60)
+    print("Testing Inference Scheduler")
+    print("=" * 60)
+
+    # Test 1: A caller that gave up never occupies a slot
+    print("\n[Test 1] Cancelled while queued...")
+    scheduler = LocalInferenceScheduler(num_parallel=1)
+    ran = []
+
+    async def request(tag):
+        ran.append(tag)
+        await asyncio.sleep(0.05)
+        return tag
+
+    async def cancel_queued():
+        first = asyncio.ensure_future(scheduler.submit('m', lambda: request('first')))
+        abandoned = asyncio.ensure_future(scheduler.submit('m', lambda: request('abandoned')))
+        await asyncio.sleep(0)
+        abandoned.cancel()
+        assert await first == 'first'
+        await asyncio.sleep(0.01)
+
+    asyncio.run(cancel_queued())
+    stats = scheduler.get_stats()
+    assert ran == ['first'] and stats['cancelled'] == 1 and stats['in_flight'] == 0
+    print("✅ PASS - Abandoned request skipped")
+
+    # Test 2: Cancelling a running request frees its slot
+    print("\n[Test 2] Cancelled while running...")
+    scheduler = LocalInferenceScheduler(num_parallel=1)
+
+    async def cancel_running():
+        slow = asyncio.ensure_future(scheduler.submit('m', lambda: asyncio.sleep(5, 'slow')))
+        await asyncio.sleep(0.01)
+        slow.cancel()
+        return await asyncio.wait_for(scheduler.submit('m', lambda: asyncio.sleep(0.01, 'next')), timeout=1)
+
+    assert asyncio.run(cancel_running()) == 'next'
+    stats = scheduler.get_stats()
+    assert stats['cancelled'] == 1 and stats['completed'] == 1 and stats['in_flight'] == 0
+    print("✅ PASS - Slot reused by the next request")
+
+    # Test 3: Two loops keep their own queues and share one slot budget
+    print("\n[Test 3] Two threads, one model, num_parallel=2...")
+    scheduler = LocalInferenceScheduler(num_parallel=2)
+    running, peak = [0], [0]
+
+    def worker(name):
+        async def run():
+            async def tracked():
+                running[0] += 1
+                peak[0] = max(peak[0], running[0])
+                await asyncio.sleep(0.02)
+                running[0] -= 1
+                return name
+            calls = [scheduler.submit('m', tracked) for _ in range(4)]
+            return await asyncio.wait_for(asyncio.gather(*calls), timeout=5)
+        return run
+
+    results = run_in_threads(worker('a'), worker('b'))
+    stats = scheduler.get_stats()
+    print(f"Peak concurrency: {peak[0]}, completed: {stats['completed']}")
+    assert results == [['a'] * 4, ['b'] * 4]
+    assert peak[0] <= 2
+    assert stats['completed'] == 8 and stats['in_flight'] == 0 and stats['queued'] == 0
+    print("✅ PASS - num_parallel holds across event loops")
+
+    # Test 4: A model blocked by another loop's busy model starts once it frees up
+    print("\n[Test 4] Eviction waits on another loop...")
+    scheduler = LocalInferenceScheduler(num_parallel=1, memory_budget_gb=4.0, max_wait=5.0)
+    big_started = threading.Event()
+
+    async def hold_big():
+        async def run():
+            big_started.set()
+            await asyncio.sleep(0.2)
+            return 'big'
+        return await scheduler.submit('big', run)
+
+    async def want_other():
+        await asyncio.get_running_loop().run_in_executor(None, big_started.wait)
+        return await asyncio.wait_for(scheduler.submit('other', lambda: asyncio.sleep(0.01, 'other')), timeout=2)
+
+    assert run_in_threads(hold_big, want_other) == ['big', 'other']
+    stats = scheduler.get_stats()
+    print(f"Resident: {stats['resident_models']}, evictions: {stats['evictions']}")
+    assert stats['resident_models'] == ['other'] and stats['evictions'] == 1
+    print("✅ PASS - Freed slot wakes the waiting loop")
+
+    # Test 5: Requests stuck behind busy slots still expire on time
+    print("\n[Test 5] max_wait while every slot is busy...")
+    scheduler = LocalInferenceScheduler(num_parallel=1, max_wait=0.1)
+
+    async def expire_waiting():
+        busy = asyncio.ensure_future(scheduler.submit('m', lambda: asyncio.sleep(1.0, 'busy')))
+        await asyncio.sleep(0)
+        start = time.monotonic()
+        waiting = await scheduler.submit('m', lambda: asyncio.sleep(0, 'late'))
+        elapsed = time.monotonic() - start
+        busy.cancel()
+        return waiting, elapsed
+
+    waiting, elapsed = asyncio.run(expire_waiting())
+    print(f"Waiting request: {waiting!r} after {elapsed:.2f}s")
+    assert waiting is None and elapsed < 0.5
+    assert scheduler.get_stats()['expired'] == 1
+    print("✅ PASS - Expired without waiting for the busy request")
+
+    print("\n" + "=" * 60)
+
+
+class FakeOllama:
+    """Local model whose draft and check samples take configurable time"""
+
+    def __init__(self, draft_delay, check_delay, answer="Paris is the capital of France", installed=True):
+        self.delays = {0.2: draft_delay, 0.9: check_delay}
+        self.answer = answer
+        self.installed = installed
+        self.cancelled = []
+        self.pulls = []
+        self.queries = 0
+
+    def installed_models(self, task_type):
+        return ['local'] if self.installed else []
+
+    async def auto_select_models(self, task_type):
+        self.pulls.append(task_type)
+        return ['local']
+
+    async def query_local(self, model, prompt, temperature=0.7, system=None):
+        self.queries += 1
+        try:
+            await asyncio.sleep(self.delays[temperature])
+        except asyncio.CancelledError:
+            self.cancelled.append(temperature)
+            raise
+        return {'response': self.answer, 'model': model}
+
+
+class FakeCloud:
+    async def query(self, prompt, task_type):
+        return "cloud answer"
+
+
+def test_speculative_inference():
+    """Test local drafts, their accounting and escalation to the cloud"""
+
+    print("=" * 60)
+    print("Testing Speculative Inference")
+    print("=" * 60)
+
+    # Test 1: The draft streams before the check sample finishes
+    print("\n[Test 1] Draft arrival...")
+    ollama = FakeOllama(draft_delay=0.01, check_delay=0.3)
+    engine = HybridInferenceEngine(ollama, FakeCloud(), local_timeout=1.0)
+    drafts = []
+
+    async def stream():
+        loop = asyncio.get_running_loop()
+        start = loop.time()
+        return await engine.infer("capital of France?", speculative=True,
+                                  on_draft=lambda text: drafts.append(loop.time() - start))
+
+    result = asyncio.run(stream())
+    stats = engine.get_stats()
+    print(f"Draft after {drafts[0]:.2f}s, round took {result['latency']:.2f}s")
+    assert drafts[0] < 0.2 and result['escalated'] is False
+    print("✅ PASS - on_draft fired on arrival")
+
+    # Test 2: One speculative round is one local call with its wall time
+    print("\n[Test 2] Local call accounting...")
+    print(f"Local calls: {stats['local_calls']}, avg latency: {stats['avg_latency_local']:.2f}s")
+    assert ollama.queries == 2 and stats['local_calls'] == 1
+    assert abs(stats['avg_latency_local'] - result['latency']) < 0.05
+    print("✅ PASS - Draft and check counted as one round")
+
+    # Test 3: Samples still running at local_timeout are cancelled
+    print("\n[Test 3] Local timeout...")
+    ollama = FakeOllama(draft_delay=0.01, check_delay=5.0)
+    engine = HybridInferenceEngine(ollama, FakeCloud(), local_timeout=0.1)
+
+    async def time_out():
+        result = await engine.infer("capital of France?", speculative=True)
+        await asyncio.sleep(0)
+        return result
+
+    result = asyncio.run(time_out())
+    stats = engine.get_stats()
+    assert ollama.cancelled == [0.9]
+    assert result['escalated'] is True and result['response'] == "cloud answer"
+    assert stats['local_calls'] == 1 and stats['cloud_calls'] == 1
+    print("✅ PASS - Late check cancelled, request escalated")
+
+    # Test 4: Without an installed model, speculation stays on the cloud path
+    print("\n[Test 4] No local model installed...")
+    ollama = FakeOllama(draft_delay=0.01, check_delay=0.01, installed=False)
+    engine = HybridInferenceEngine(ollama, FakeCloud())
+    result = asyncio.run(engine.infer("capital of France?", speculative=True))
+    stats = engine.get_stats()
+    assert result['response'] == "cloud answer"
+    assert ollama.pulls == [] and ollama.queries == 0
+    assert stats['speculative_requests'] == 0 and stats['cloud_calls'] == 1
+    print("✅ PASS - No model pull on the request path")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_inference_scheduler()
+    test_speculative_inference()
@@ -0,0 +1,126 @@
+"""
+Test LLM Calls
+Regression tests for provider-call accounting, prompt prefix caching and
+multi-model consensus
+"""
+
+import sys
+import os
+import asyncio
+import threading
+from types import SimpleNamespace
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.brain import CompanionBrain, MultiModelConsensus
+from companion_baas.optimization.prompt_cache import PrefixCache
+
+
+def _tokens(result):
+    stub = SimpleNamespace(_estimate_tokens=lambda text: len(text) // 4 if text else 0)
+    return CompanionBrain._result_tokens(stub, result)
+
+
+def test_result_tokens_from_dict_results():
+    """Bytez-style dict results must feed token counts to the router"""
+    assert _tokens("x" * 400) == 100
+    assert _tokens({'success': True, 'response': "x" * 400, 'model': 'm'}) == 100
+    assert _tokens({'success': True, 'response': "x", 'metadata': {'tokens': 77}}) == 77
+    assert _tokens({'success': True, 'usage': {'completion_tokens': 12, 'total_tokens': 40}}) == 12
+    assert _tokens({'success': False, 'response': None, 'error': 'boom'}) == 0
+
+    completion = SimpleNamespace(usage=SimpleNamespace(completion_tokens=33, total_tokens=50))
+    assert _tokens(completion) == 33
+
+
+def test_prefix_cache_counts_concurrent_lookups():
+    """Every lookup is counted exactly once, hits included"""
+    cache = PrefixCache(max_entries=8)
+
+    def lookups():
+        for i in range(2000):
+            cache.get(('system_prompt', i % 16), lambda: "prefix")
+
+    threads = [threading.Thread(target=lookups) for _ in range(8)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    stats = cache.get_stats()
+    assert stats['prefix_hits'] + stats['prefix_misses'] == 8 * 2000
+    assert stats['cached_prefixes'] <= 8
+
+
+def test_prefix_cache_keeps_recent_keys():
+    """Request-derived keys are bounded by LRU eviction, not by refusing to cache"""
+    cache = PrefixCache(max_entries=4)
+    renders = []
+    for key in range(10):
+        cache.get(key, lambda: renders.append(key) or f"p{key}")
+    assert cache.get(9, lambda: renders.append('again') or "x") == "p9"
+    assert 'again' not in renders and cache.get_stats()['cached_prefixes'] == 4
+
+
+class _Bytez:
+    def __init__(self, answers):
+        self.answers = answers
+
+    def generate(self, messages, model):
+        return {'success': True, 'response': self.answers[model], 'confidence': 0.8}
+
+
+def _consensus(answers):
+    brain = SimpleNamespace(providers={'bytez': _Bytez(answers)}, semantic_cache=None)
+    return MultiModelConsensus(brain)
+
+
+def test_consensus_embeds_off_the_event_loop():
+    """Embedding (model inference) must not run on the event loop thread"""
+    consensus = _consensus({'a': "Paris is the capital of France.",
+                            'b': "The capital of France is Paris."})
+    threads = []
+    embed = consensus._embed
+
+    def recording_embed(texts):
+        threads.append(threading.current_thread())
+        return embed(texts)
+
+    consensus._embed = recording_embed
+
+    async def run():
+        result = await consensus.query_with_consensus("capital of France?", models=['a', 'b'])
+        return result, threading.current_thread()
+
+    result, loop_thread = asyncio.run(run())
+    assert result['success'] and threads
+    assert all(thread is not loop_thread for thread in threads)
+
+
+def test_consensus_threshold_matches_embedder():
+    """Hashed-embedding agreement uses its own calibrated threshold"""
+    agree = _consensus({
+        'a': "Python's GIL prevents multiple threads from executing Python bytecode at once.",
+        'b': "The GIL in Python means only one thread executes Python bytecode at a time."
+    })
+    result = asyncio.run(agree.query_with_consensus("What is the GIL?", models=['a', 'b'], quorum=2))
+    assert result['metadata']['agreement_threshold'] == MultiModelConsensus.HASHED_MIN_AGREEMENT
+    assert result['metadata']['consensus_type'] == 'quorum_consensus'
+
+    differ = _consensus({
+        'a': "Python's GIL prevents multiple threads from executing Python bytecode at once.",
+        'b': "Python is a popular programming language created by Guido van Rossum."
+    })
+    result = asyncio.run(differ.query_with_consensus("What is the GIL?", models=['a', 'b'], quorum=2))
+    assert result['metadata']['consensus_type'] == 'combined_diverse'
+
+
+if __name__ == "__main__":
+    print("=" * 60)
+    print("Testing LLM Calls")
+    print("=" * 60)
+    for name, test in list(globals().items()):
+        if name.startswith("test_") and callable(test):
+            test()
+            print(f"✅ PASS - {name}")
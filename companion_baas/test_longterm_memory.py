@@ -0,0 +1,170 @@
+"""
+Test Longterm Memory
+Tests the hierarchical memory indexes, the node log and shutdown
+"""
+
+import sys
+import os
+import tempfile
+import threading
+import time
+import types
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.longterm_memory import (
+    CompressionStrategy, ContextCompressor, HierarchicalMemory, LongtermMemorySystem, MemoryLevel, TokenCounter
+)
+from companion_baas.core.advanced_brain_wrapper import AdvancedBrainWrapper
+
+
+def test_longterm_memory():
+    """Test hierarchical memory persistence and indexes"""
+
+    print("=" * 60)
+    print("Testing Longterm Memory")
+    print("=" * 60)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 1: Access order survives a restart
+        print("\n[Test 1] Replaying the node log...")
+        path = os.path.join(tmp, "memory.jsonl")
+        memory = HierarchicalMemory(log_path=path)
+        nodes = [memory.create_node(f"fact {i}", MemoryLevel.SHORT_TERM) for i in range(5)]
+        memory.get_node(nodes[0].id)
+        assert memory.top_by_level(MemoryLevel.SHORT_TERM, limit=1)[0].id == nodes[0].id
+        memory.close()
+
+        reloaded = HierarchicalMemory(log_path=path)
+        assert list(reloaded._by_level[MemoryLevel.SHORT_TERM])[-1] == nodes[0].id
+        assert reloaded.top_by_level(MemoryLevel.SHORT_TERM, limit=1)[0].id == nodes[0].id
+        assert [n.id for n in reloaded.created_since(0, limit=5)] == [n.id for n in reversed(nodes)]
+        reloaded.close()
+        print("✅ PASS - Recently accessed node still found first")
+
+    # Test 2: Indexed fields cannot be changed behind the index's back
+    print("\n[Test 2] update_node on an indexed field...")
+    memory = HierarchicalMemory()
+    node = memory.create_node("fact", MemoryLevel.WORKING)
+    try:
+        memory.update_node(node.id, level=MemoryLevel.CORE)
+    except ValueError:
+        pass
+    else:
+        raise AssertionError("level change accepted")
+    assert node.level == MemoryLevel.WORKING
+    assert memory.count(MemoryLevel.WORKING) == 1 and memory.count(MemoryLevel.CORE) == 0
+    memory.update_node(node.id, summary="short", importance=0.9)
+    assert memory.top_by_importance(limit=1)[0].summary == "short"
+    print("✅ PASS - Level change rejected, other fields updated")
+
+    print("\n" + "=" * 60)
+
+
+def test_longterm_memory_close():
+    """Test that closing the memory system stops its worker and keeps its log"""
+
+    print("=" * 60)
+    print("Testing Longterm Memory Shutdown")
+    print("=" * 60)
+
+    def slow_llm(prompt):
+        time.sleep(0.2)
+        return "summary of earlier messages"
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 1: close() waits for the running summary, then stops the worker
+        print("\n[Test 1] Closing with a summary in flight...")
+        path = os.path.join(tmp, "memory.jsonl")
+        system = LongtermMemorySystem(slow_llm, max_context_tokens=200, log_path=path)
+        for i in range(40):
+            system.add_to_working_memory(f"message number {i} with a few extra words", importance=0.5)
+        assert system._summary_future is not None
+        system.close()
+        print(f"Summary: {system._running_summary!r}")
+        assert system._running_summary == "summary of earlier messages"
+        assert system._summarizer._shutdown
+        assert system.hierarchical_memory._log is None
+        assert len(HierarchicalMemory(log_path=path).nodes) == 40
+        print("✅ PASS - Summary kept, worker stopped, node log closed")
+
+    # Test 2: The advanced brain closes long-term memory with its other systems
+    print("\n[Test 2] AdvancedBrainWrapper.close()...")
+    closed = []
+    wrapper = types.SimpleNamespace(**{
+        name: types.SimpleNamespace(close=lambda name=name: closed.append(name))
+        for name in ('learning', 'finetuning', 'longterm_memory')
+    })
+    AdvancedBrainWrapper.close(wrapper)
+    assert closed == ['learning', 'finetuning', 'longterm_memory']
+    print("✅ PASS - Long-term memory closed on shutdown")
+
+    print("\n" + "=" * 60)
+
+
+def test_context_compressor():
+    """Test cached span summaries and the non-blocking write path"""
+
+    print("=" * 60)
+    print("Testing Context Compressor")
+    print("=" * 60)
+
+    prompts = []
+
+    def llm(prompt):
+        prompts.append(prompt)
+        return f"summary {len(prompts)}"
+
+    messages = [{"role": "user", "content": f"message {i} about the project plan"} for i in range(16)]
+
+    # Test 1: Spans are summarized once, then merged
+    print("\n[Test 1] Summarizing 16 messages in spans of 8...")
+    compressor = ContextCompressor(llm, span_size=8)
+    first = compressor.summarize(messages)
+    print(f"LLM calls: {compressor.stats['llm_calls']}")
+    assert compressor.stats['llm_calls'] == 3  # two spans + one merge
+    assert compressor.summarize(messages) == first and compressor.stats['llm_calls'] == 3
+    print("✅ PASS - Repeat served from the content-hash cache")
+
+    # Test 2: Extending a summary only pays for the new span
+    print("\n[Test 2] Extending with 8 new messages...")
+    more = [{"role": "assistant", "content": f"reply {i}"} for i in range(8)]
+    compressor.summarize(more, previous=first)
+    assert compressor.stats['llm_calls'] == 5  # one new span + one merge
+    print("✅ PASS - Old spans not re-summarized")
+
+    # Test 3: Zero-LLM fast path under load
+    print("\n[Test 3] compress_messages(allow_llm=False)...")
+    calls = compressor.stats['llm_calls']
+    kept = compressor.compress_messages(messages, 60, CompressionStrategy.SUMMARIZATION, allow_llm=False)
+    tokens = sum(TokenCounter.count_message_tokens(m) for m in kept)
+    print(f"Kept {len(kept)} messages, {tokens} tokens")
+    assert compressor.stats['llm_calls'] == calls and tokens <= 60
+    assert kept == messages[-len(kept):]
+    print("✅ PASS - Chunked to the budget without an LLM call")
+
+    # Test 4: A full window never makes the writer wait for the LLM
+    print("\n[Test 4] Writes while the summarizer is stuck...")
+    release = threading.Event()
+    system = LongtermMemorySystem(lambda prompt: release.wait(5) and "late summary", max_context_tokens=200)
+    slowest = 0.0
+    for i in range(40):
+        start = time.perf_counter()
+        system.add_to_working_memory(f"message number {i} with a few extra words")
+        slowest = max(slowest, time.perf_counter() - start)
+    print(f"Slowest write: {slowest * 1000:.1f}ms")
+    assert slowest < 0.5
+    assert system.context_window.current_tokens <= 200
+    release.set()
+    system.close()
+    assert system._running_summary == "late summary"
+    print("✅ PASS - Summaries folded in after the writes returned")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_longterm_memory()
+    test_context_compressor()
+    test_longterm_memory_close()
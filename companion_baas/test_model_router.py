@@ -0,0 +1,67 @@
+"""
+Test Model Router
+Tests traffic shares of adaptive routing under healthy and degraded providers
+"""
+
+import random
+import sys
+import os
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.model_router import ModelRouter, DEFAULT_ROUTES
+
+
+def route(router, context, rounds, degraded=None, rng=random.Random(0)):
+    """Send `rounds` requests through the router; `degraded` fails slowly"""
+    picks = {}
+    for _ in range(rounds):
+        model = router.select(context, estimated_tokens=300)
+        picks[model] = picks.get(model, 0) + 1
+        if model == degraded:
+            router.record(model, rng.uniform(12.0, 20.0), rng.random() > 0.3, tokens=200)
+        else:
+            router.record(model, rng.uniform(0.5, 1.5), True, tokens=200)
+    return picks
+
+
+def test_model_router():
+    """Test that healthy preferred models keep their traffic"""
+
+    print("=" * 60)
+    print("Testing Model Router")
+    print("=" * 60)
+
+    # Test 1: Healthy preferred models keep nearly all traffic
+    print("\n[Test 1] Healthy providers...")
+    for context in ('code', 'reasoning', 'chat'):
+        router = ModelRouter(seed=11, clock=lambda: 0.0)
+        preferred = DEFAULT_ROUTES[context][0][0]
+        picks = route(router, context, 5000)
+        share = picks.get(preferred, 0) / 5000
+        print(f"  {context}: {picks} (preferred share {share:.1%})")
+        assert share >= 0.96
+        assert len(picks) == 2  # alternates are still probed
+    print("✅ PASS - Preferred share stays within the exploration budget")
+
+    # Test 2: A degraded preferred model loses its traffic, then wins it back
+    print("\n[Test 2] Degraded then recovered provider...")
+    now = [0.0]
+    router = ModelRouter(seed=5, clock=lambda: now[0])
+    degraded = route(router, 'code', 500, degraded='deepseek-coder')
+    print(f"  Degraded:  {degraded}")
+    assert degraded.get('qwen-4b', 0) > 400
+    now[0] += 3600  # the bad evidence ages out
+    recovered = route(router, 'code', 500)
+    print(f"  Recovered: {recovered}")
+    assert recovered.get('deepseek-coder', 0) >= 475
+    stats = router.get_stats()
+    assert stats['degraded_selections'] > 0 and stats['explorations'] > 0
+    print("✅ PASS - Traffic shifts away from and back to the preferred model")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_model_router()
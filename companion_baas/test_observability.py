@@ -0,0 +1,171 @@
+"""
+Test Observability - Phase 5
+Regression tests for Prometheus metrics, request tracing and the AGI
+step executor's interaction with traces
+"""
+
+import sys
+import os
+import time
+import threading
+from types import SimpleNamespace
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.optimization.metrics import MetricsRegistry, _format_value
+from companion_baas.optimization.tracing import Span, Tracer, tracer as process_tracer
+from companion_baas.core import agi_decision_engine
+from companion_baas.core.agi_decision_engine import AGIDecisionEngine, DecisionPlan, QueryType
+
+
+def test_short_lived_threads_fold_into_base():
+    """Shards of exited writer threads must not pile up"""
+    registry = MetricsRegistry()
+    counter = registry.counter("test_thread_churn_total", "churn").labels()
+
+    for _ in range(200):
+        thread = threading.Thread(target=counter.inc)
+        thread.start()
+        thread.join()
+
+    assert counter.get() == 200
+    assert len(counter._shards) <= threading.active_count()
+
+
+def test_special_values_render():
+    """NaN and infinities use the exposition spellings instead of raising"""
+    assert _format_value(float("nan")) == "NaN"
+    assert _format_value(float("inf")) == "+Inf"
+    assert _format_value(float("-inf")) == "-Inf"
+    assert _format_value(3.0) == "3"
+
+    registry = MetricsRegistry()
+    registry.gauge("test_bad_gauge", "nan gauge").set(float("nan"))
+    registry.gauge("test_neg_gauge", "-inf gauge").set(float("-inf"))
+    text = registry.render()
+    assert "test_bad_gauge NaN" in text
+    assert "test_neg_gauge -Inf" in text
+
+
+def _finish_root(tracer: Tracer, duration_ms: float) -> Span:
+    span = tracer.start_span("root")
+    span.end_ns = span.start_ns + int(duration_ms * 1e6)
+    tracer._on_end(span)
+    return span
+
+
+def test_trace_dir_is_absolute():
+    """The default export directory must not depend on the working directory"""
+    assert os.path.isabs(process_tracer.exporter.directory)
+
+
+def test_adaptive_slow_threshold_tracks_latency():
+    """By default 'slow' means the p99 of recent traces, not a fixed 2s"""
+    tracer = Tracer(sample_rate=0.0)
+    assert tracer.adaptive
+
+    # Typical LLM traffic: 2.5-4.5s per trace; a fixed 2s cut would keep all of it
+    for i in range(2000):
+        _finish_root(tracer, 2500 + (i * 7919) % 2000)
+    assert 4300 <= tracer.slow_threshold_ms <= 4600
+    kept_before = tracer.stats['kept_slow']
+    for i in range(1000):
+        _finish_root(tracer, 2500 + (i * 7919) % 2000)
+    assert tracer.stats['kept_slow'] - kept_before < 50
+
+    fixed = Tracer(slow_threshold_ms=2000, sample_rate=0.0)
+    assert not fixed.adaptive
+    _finish_root(fixed, 2500)
+    assert fixed.stats['kept_slow'] == 1
+
+
+
+def test_late_child_span_does_not_reopen_trace():
+    """A span ending after its root is dropped, not parked as an open trace"""
+    tracer = Tracer(sample_rate=0.0, max_open_traces=10)
+    with tracer.span("request"):
+        late = tracer.start_span("fire_and_forget")
+    late.end()
+    assert tracer.get_stats()['open_traces'] == 0
+    assert tracer.stats['spans_late'] == 1
+
+    # Children of later traces are still collected
+    with tracer.span("request"):
+        with tracer.span("child"):
+            pass
+    assert tracer.stats['traces_completed'] == 2
+    assert tracer.stats['spans_dropped'] == 0
+
+
+def _fake_brain(llm_delay: float = 0.0):
+    def call_llm(prompt):
+        time.sleep(llm_delay)
+        return "answer"
+
+    return SimpleNamespace(
+        knowledge_retriever=None, search_engine=None, neural_reasoning=None,
+        code_executor=None, personality_engine=None, query_analyzer=None,
+        self_learning=SimpleNamespace(episodic=SimpleNamespace(store_episode=lambda *a, **k: time.sleep(0.05))),
+        _call_llm=call_llm
+    )
+
+
+def _plan(*steps) -> DecisionPlan:
+    return DecisionPlan(
+        decision_id="test", query_type=QueryType.CONVERSATIONAL, confidence=1.0,
+        modules_to_use=[], execution_order=list(steps), expected_outcome="",
+        reasoning="", estimated_time=0.0, priority=1
+    )
+
+
+def test_background_steps_leave_no_open_traces():
+    """Fire-and-forget learning must not leave orphan traces behind"""
+    engine = AGIDecisionEngine(_fake_brain())
+    tracer = agi_decision_engine.tracer
+    with tracer._lock:
+        open_before = len(tracer._open)
+    late_before = tracer.stats['spans_late']
+
+    for _ in range(20):
+        with tracer.span("brain.think"):
+            result = engine.execute_decision(_plan("generate_response", "learn_from_interaction"), "hi")
+        assert result.background_steps == ['learn_from_interaction']
+    engine.step_executor.shutdown(wait=True)
+
+    with tracer._lock:
+        assert len(tracer._open) == open_before
+    assert tracer.stats['spans_late'] == late_before
+
+
+def test_timed_out_steps_release_the_pool():
+    """Steps stuck past their deadline must not starve later requests"""
+    original = dict(agi_decision_engine.STEP_DEADLINES)
+    agi_decision_engine.STEP_DEADLINES['generate_response'] = 0.05
+    try:
+        engine = AGIDecisionEngine(_fake_brain(llm_delay=1.0), max_parallel_steps=2)
+        first = engine.step_executor
+        result = engine.execute_decision(_plan("generate_response"), "hi")
+        assert result.errors and 'deadline' in result.errors[0]
+        assert engine.stats['steps_timed_out'] == 1
+        assert engine.step_executor is not first
+
+        # The fresh pool serves the next request immediately
+        agi_decision_engine.STEP_DEADLINES['generate_response'] = 5.0
+        engine.brain._call_llm = lambda prompt: "fast"
+        start = time.monotonic()
+        result = engine.execute_decision(_plan("generate_response"), "hi")
+        assert not result.errors and time.monotonic() - start < 0.5
+    finally:
+        agi_decision_engine.STEP_DEADLINES.clear()
+        agi_decision_engine.STEP_DEADLINES.update(original)
+
+
+if __name__ == "__main__":
+    print("=" * 60)
+    print("Testing Observability (Phase 5)")
+    print("=" * 60)
+    for name, test in list(globals().items()):
+        if name.startswith("test_") and callable(test):
+            test()
+            print(f"✅ PASS - {name}")
@@ -5,6 +5,7 @@ Tests personality traits, emotional states, response styling, and voice evolutio
 
 import sys
 import os
+import random
 
 # Add parent directory to path
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
@@ -233,5 +234,78 @@ def test_personality():
     print(f"   Total interactions: {engine.voice_evolution.interaction_count}")
 
 
+STREAM_QUERIES = ["Wow, this is AMAZING!!! How does it work?", "I'm confused and worried", "hello"]
+STREAM_REPLIES = [
+    "Short answer.",
+    "You do not need a lock here because the GIL will not switch mid-bytecode.",
+    "It cannot be done in one pass, so we do not try; instead we will not stop until "
+    "every node is visited and you cannot see a partial state. " * 3,
+]
+STREAM_TRAITS = dict(curiosity=0.95, creativity=0.9, empathy=0.9, humor=0.9, caution=0.9)
+
+
+def chunkings(text):
+    """Fixed-size and random splits of text"""
+    for size in (1, 2, 3, 5, 7, 16, len(text) or 1):
+        yield [text[i:i + size] for i in range(0, len(text), size)]
+    rng = random.Random(7)
+    for _ in range(5):
+        cuts = sorted(rng.sample(range(1, len(text)), min(6, len(text) - 1)))
+        yield [text[a:b] for a, b in zip([0] + cuts, cuts + [len(text)])]
+
+
+def stream_mismatches(formality):
+    """Style every query/reply/chunking both ways; return (cases, mismatching chunkings)"""
+    cases, mismatches = 0, []
+    for query in STREAM_QUERIES:
+        for reply in STREAM_REPLIES:
+            for seed, chunks in enumerate(chunkings(reply)):
+                batch_engine = PersonalityEngine(PersonalityTraits(**STREAM_TRAITS))
+                stream_engine = PersonalityEngine(PersonalityTraits(**STREAM_TRAITS))
+                for engine in (batch_engine, stream_engine):
+                    engine.voice_evolution.style_preferences['formality'] = formality
+
+                random.seed(seed)
+                expected = batch_engine.process_interaction(query, reply)
+                random.seed(seed)
+                streamed = "".join(stream_engine.stream_interaction(query, chunks))
+                cases += 1
+                if streamed != expected:
+                    mismatches.append((query, chunks))
+    return cases, mismatches
+
+
+def test_personality_streaming():
+    """Test that streamed styling matches styling the whole reply"""
+
+    print("=" * 60)
+    print("Testing Streamed Personality Styling")
+    print("=" * 60)
+
+    # Test 1: Casual voice keeps contractions as written
+    print("\n[Test 1] Casual voice (formality 0.1)...")
+    cases, mismatches = stream_mismatches(0.1)
+    print(f"Cases: {cases}, mismatches: {len(mismatches)}")
+    assert not mismatches, mismatches[:1]
+    print("✅ PASS - Joined chunks equal process_interaction()")
+
+    # Test 2: Neutral voice
+    print("\n[Test 2] Neutral voice (formality 0.5)...")
+    cases, mismatches = stream_mismatches(0.5)
+    print(f"Cases: {cases}, mismatches: {len(mismatches)}")
+    assert not mismatches, mismatches[:1]
+    print("✅ PASS - Joined chunks equal process_interaction()")
+
+    # Test 3: Formal voice rewrites phrases that chunks may split, e.g. 'do not'
+    print("\n[Test 3] Formal voice (formality 0.9)...")
+    cases, mismatches = stream_mismatches(0.9)
+    print(f"Cases: {cases}, mismatches: {len(mismatches)}")
+    assert not mismatches, mismatches[:1]
+    print("✅ PASS - Rewrites split across chunks styled the same")
+
+    print("\n" + "=" * 60)
+
+
 if __name__ == "__main__":
     test_personality()
+    test_personality_streaming()
@@ -0,0 +1,73 @@
+"""
+Test Query Analyzer
+Regression tests for memoized analysis and background classifier refits
+"""
+
+import sys
+import os
+import time
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.query_analyzer import QueryAnalyzer
+from companion_baas.core.agi_decision_engine import AGIDecisionEngine
+
+
+def test_cached_analysis_is_read_only():
+    """Memoized analyses are shared, so their score mapping must be immutable"""
+    analyzer = QueryAnalyzer()
+    first = analyzer.analyze("Write a python function to sort a list")
+    try:
+        first.type_scores['coding'] = 99
+    except TypeError:
+        pass
+    else:
+        raise AssertionError("type_scores is mutable")
+    assert analyzer.analyze("write a python function to sort a list").type_scores == first.type_scores
+
+
+def test_retrain_keeps_keyword_entries():
+    """Refitting the classifier drops only classifier-dependent memo entries"""
+    analyzer = QueryAnalyzer()
+    keyword = analyzer.analyze("Write a python function to sort a list")
+    fallback = analyzer.analyze("tell me about penguins")
+    assert keyword.source == 'keywords' and fallback.source != 'keywords'
+
+    analyzer.train_classifier([("sort a list in python", "coding")] * 3)
+    cache = analyzer._cache
+    assert analyzer.normalize("Write a python function to sort a list") in cache
+    assert analyzer.normalize("tell me about penguins") not in cache
+
+
+class _NoModulesBrain:
+    """Brain stand-in with every optional module missing"""
+
+    def __getattr__(self, name):
+        return None
+
+
+def test_retrain_runs_off_the_request_path():
+    """analyze_and_decide must not block on a classifier refit"""
+    engine = AGIDecisionEngine(_NoModulesBrain())
+    engine.classifier_retrain_interval = 1
+
+    def slow_refit():
+        time.sleep(0.5)
+        return 0
+
+    engine.train_query_classifier = slow_refit
+    start = time.monotonic()
+    engine.analyze_and_decide("hello there")
+    assert time.monotonic() - start < 0.3
+    assert engine._retrain_pending
+
+
+if __name__ == "__main__":
+    print("=" * 60)
+    print("Testing Query Analyzer")
+    print("=" * 60)
+    for name, test in list(globals().items()):
+        if name.startswith("test_") and callable(test):
+            test()
+            print(f"✅ PASS - {name}")
@@ -0,0 +1,161 @@
+"""
+Test Realtime Learning
+Regression tests for streaming pattern recognition and the feedback pipeline
+"""
+
+import sys
+import os
+import json
+import tempfile
+import threading
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.realtime_learning import (
+    FeedbackCollector, FeedbackType, PatternRecognizer, RealtimeLearningSystem
+)
+
+
+def repeated_queries(recognizer):
+    """Queries recognized as repeated_query patterns"""
+    return {p.metadata['query'] for p in recognizer.get_patterns("repeated_query", min_confidence=0.0)}
+
+
+def test_pattern_recognizer():
+    """Test streaming pattern recognition"""
+
+    print("=" * 60)
+    print("Testing Pattern Recognizer")
+    print("=" * 60)
+
+    # Test 1: Sketch over-counting alone never makes a query frequent
+    print("\n[Test 1] Inflated sketch estimates...")
+    # One-column count-min and two heavy-hitter slots: every estimate is inflated
+    recognizer = PatternRecognizer(max_tracked=2, sketch_width=1, half_life_seconds=None)
+    for query in ("alpha", "beta"):
+        for _ in range(5):
+            recognizer.track_interaction("u1", query, "answer")
+    recognizer.track_interaction("u1", "gamma", "answer")
+    print(f"Repeated queries: {sorted(repeated_queries(recognizer))}")
+    assert repeated_queries(recognizer) == {"alpha", "beta"}
+    print("✅ PASS - A query seen once is not reported")
+
+    # Test 2: Patterns and their index stay bounded
+    print("\n[Test 2] More patterns than max_patterns...")
+    recognizer = PatternRecognizer(max_patterns=3, half_life_seconds=None)
+    for i in range(10):
+        for _ in range(3):
+            recognizer.track_interaction("u1", f"question {i}", "answer")
+    assert len(recognizer.patterns) == 3 and len(recognizer._pattern_index) == 3
+    assert repeated_queries(recognizer) == {"question 7", "question 8", "question 9"}
+    print("✅ PASS - Oldest patterns evicted")
+
+    print("\n" + "=" * 60)
+
+
+def test_feedback_pipeline():
+    """Test the background feedback worker and snapshots"""
+
+    print("=" * 60)
+    print("Testing Feedback Pipeline")
+    print("=" * 60)
+
+    # Test 1: Entries the worker already applied never sit in the unprocessed FIFO
+    print("\n[Test 1] 500 ratings through the worker...")
+    system = RealtimeLearningSystem(snapshot_path=None)
+    for i in range(500):
+        system.provide_feedback("u1", f"int_{i}", "rating", 4)
+    assert system.flush(timeout=5)
+    assert len(system.feedback_collector._unprocessed) == 0
+    assert system.feedback_collector.get_unprocessed() == []
+    system.close()
+    print("✅ PASS - Unprocessed FIFO empty after flush")
+
+    # Test 2: Unprocessed entries dropped by the history bound leave the FIFO too
+    print("\n[Test 2] Evicting unprocessed entries...")
+    collector = FeedbackCollector(max_entries=10)
+    for i in range(100):
+        collector.add_feedback("u1", f"int_{i}", FeedbackType.RATING, 3)
+    assert len(collector._unprocessed) == 10
+    assert [e.interaction_id for e in collector.get_unprocessed(limit=2)] == ["int_90", "int_91"]
+    print("✅ PASS - FIFO bounded with the history")
+
+    # Test 3: flush() waits for every entry even with many producer threads
+    print("\n[Test 3] 8 producer threads...")
+    system = RealtimeLearningSystem(snapshot_path=None)
+
+    def produce():
+        for i in range(200):
+            system.provide_feedback("u1", f"int_{i}", "rating", 5)
+
+    threads = [threading.Thread(target=produce) for _ in range(8)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert system.flush(timeout=10)
+    print(f"Enqueued: {system._enqueued}, processed: {system._processed}")
+    assert system._enqueued == system._processed == 1600
+    system.close()
+    print("✅ PASS - Every entry flushed")
+
+    # Test 4: An error outside the per-entry handler does not kill the worker
+    print("\n[Test 4] Storage fails once...")
+    system = RealtimeLearningSystem(snapshot_path=None)
+    store = system.feedback_collector.store
+    failures = []
+
+    def failing_store(entry):
+        if not failures:
+            failures.append(entry)
+            raise OSError("disk full")
+        store(entry)
+
+    system.feedback_collector.store = failing_store
+    system.provide_feedback("u1", "int_0", "rating", 5)
+    assert system.flush(timeout=2)
+    for i in range(1, 4):
+        system.provide_feedback("u1", f"int_{i}", "rating", 5)
+    assert system.flush(timeout=2)
+    assert failures and system._worker.is_alive()
+    assert len(system.feedback_collector.feedback) == 3
+    system.close()
+    print("✅ PASS - Worker kept draining after the error")
+
+    # Test 5: A dead worker is restarted by the next submission
+    print("\n[Test 5] Worker thread gone...")
+    system = RealtimeLearningSystem(snapshot_path=None)
+    dead = threading.Thread(target=lambda: None)
+    dead.start()
+    dead.join()
+    system._worker = dead
+    system.provide_feedback("u1", "int_1", "rating", 5)
+    assert system._worker is not dead and system._worker.is_alive()
+    assert system.flush(timeout=2)
+    system.close()
+    print("✅ PASS - New worker started")
+
+    # Test 6: Snapshots are built from copies and restore the same state
+    print("\n[Test 6] Snapshot round trip...")
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "learning.json")
+        system = RealtimeLearningSystem(snapshot_path=path)
+        system.provide_feedback("u1", "int_1", "rating", 5)
+        system.learn_preference("u1", "response_style", "concise", 0.8)
+        system.close()
+
+        with open(path) as f:
+            payload = json.load(f)
+        assert len(payload["feedback"]) == 1 and payload["feedback"][0]["processed"]
+        restored = RealtimeLearningSystem(snapshot_path=path)
+        assert restored.get_user_profile("u1")["preferences"]
+        restored.close()
+    print("✅ PASS - Feedback and preferences restored")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_pattern_recognizer()
+    test_feedback_pipeline()
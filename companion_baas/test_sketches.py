@@ -0,0 +1,89 @@
+"""
+Test Quantile Sketches
+Tests sketch accuracy, merging, serialization and the sliding window
+behind PerformanceMonitor percentiles
+"""
+
+import random
+import sys
+import os
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.optimization.sketches import QuantileSketch, DecayingSketch
+
+
+def exact_quantile(values, q):
+    """Nearest-rank quantile of a list (what the sketch approximates)"""
+    ordered = sorted(values)
+    return ordered[int(q * (len(ordered) - 1) + 0.5)]
+
+
+def test_sketches():
+    """Test the quantile sketches"""
+
+    print("=" * 60)
+    print("Testing Quantile Sketches")
+    print("=" * 60)
+
+    rng = random.Random(42)
+    latencies = [rng.lognormvariate(-2.0, 1.0) for _ in range(20000)]
+
+    # Test 1: Quantiles within the relative accuracy
+    print("\n[Test 1] Accuracy against exact percentiles...")
+    sketch = QuantileSketch(relative_accuracy=0.01)
+    for value in latencies:
+        sketch.add(value)
+    for q in (0.5, 0.9, 0.95, 0.99):
+        exact = exact_quantile(latencies, q)
+        estimate = sketch.quantile(q)
+        print(f"  p{int(q * 100)}: exact={exact:.5f} sketch={estimate:.5f}")
+        assert abs(estimate - exact) <= 0.01 * exact + 1e-12
+    assert sketch.count == len(latencies)
+    assert sketch.quantile(0) == min(latencies) and sketch.quantile(1) == max(latencies)
+    print("✅ PASS - Percentiles within 1% relative error")
+
+    # Test 2: Merging halves equals sketching everything
+    print("\n[Test 2] Merging two workers' sketches...")
+    first, second = QuantileSketch(), QuantileSketch()
+    for i, value in enumerate(latencies):
+        (first if i % 2 else second).add(value)
+    first.merge(second)
+    assert first.bins == sketch.bins and first.count == sketch.count
+    try:
+        first.merge(QuantileSketch(relative_accuracy=0.05))
+    except ValueError:
+        pass
+    else:
+        raise AssertionError("merged sketches with different parameters")
+    print("✅ PASS - Merge is exact; mismatched parameters rejected")
+
+    # Test 3: Serialization round trip
+    print("\n[Test 3] to_dict / from_dict...")
+    restored = QuantileSketch.from_dict(sketch.to_dict())
+    assert restored.bins == sketch.bins
+    assert restored.quantile(0.99) == sketch.quantile(0.99)
+    assert QuantileSketch.from_dict(QuantileSketch().to_dict()).quantile(0.5) == 0.0
+    print("✅ PASS - Round trip preserves every bucket")
+
+    # Test 4: Sliding window ages samples out
+    print("\n[Test 4] DecayingSketch window...")
+    now = [0.0]
+    window = DecayingSketch(window_seconds=10.0, slices=5, clock=lambda: now[0])
+    for _ in range(100):
+        window.add(5.0)
+    now[0] = 6.0
+    window.add(0.1)
+    assert window.snapshot().count == 101
+    now[0] = 10.5  # first slice (t=0..2) has left the window
+    snapshot = window.snapshot()
+    print(f"  After the window moved: count={snapshot.count} p50={snapshot.quantile(0.5):.3f}")
+    assert snapshot.count == 1 and snapshot.max == 0.1
+    print("✅ PASS - Old slices drop out of percentiles")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_sketches()
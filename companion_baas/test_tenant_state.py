@@ -0,0 +1,103 @@
+"""
+Test Tenant State
+Tests per-tenant personality and learning overlays
+"""
+
+import sys
+import os
+import tempfile
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.personality import PersonalityEngine, PersonalityTraits
+from companion_baas.core.self_learning import SelfLearningSystem, Skill
+from companion_baas.core.tenant_state import TenantLearning, TenantStateManager
+
+
+def test_tenant_learning():
+    """Test a tenant's learning overlay on the shared base"""
+
+    print("=" * 60)
+    print("Testing Tenant Learning")
+    print("=" * 60)
+
+    # Test 1: Interactions without a 'success' outcome leave skill proficiency alone
+    print("\n[Test 1] Missing outcome...")
+    learning = TenantLearning()
+    learning.learn_from_interaction("hi", "hello", {'task_type': 'chat'}, {})
+    assert learning.skills == {}
+    assert len(learning.episodic.episodes) == 1
+    learning.learn_from_interaction("hi", "hello", {'task_type': 'chat'}, {'success': True})
+    assert learning.skills['chat'].practice_count == 1
+    print("✅ PASS - Only real outcomes practice a skill")
+
+    # Test 2: Recall never returns episodes from the shared store
+    print("\n[Test 2] Recall with a populated base...")
+    base = SelfLearningSystem()
+    base.learn_from_interaction("how do I reset my password", "other user's answer",
+                                {'task_type': 'general'}, {'success': True})
+    learning = TenantLearning(base)
+    assert learning.recall_relevant_knowledge("reset my password")['similar_episodes'] == []
+    learning.learn_from_interaction("how do I reset my password", "tenant answer",
+                                    {'task_type': 'general'}, {'success': True})
+    episodes = learning.recall_relevant_knowledge("reset my password")['similar_episodes']
+    print(f"Recalled responses: {[e['response'] for e in episodes]}")
+    assert [e['response'] for e in episodes] == ["tenant answer"]
+    print("✅ PASS - Only the tenant's own episodes recalled")
+
+    # Test 3: A long-practiced skill keeps a bounded learning curve
+    print("\n[Test 3] Practicing a skill many times...")
+    for _ in range(Skill.MAX_CURVE_POINTS * 3):
+        learning.learn_from_interaction("q", "r", {'task_type': 'coding'}, {'success': True})
+    skill = learning.skills['coding']
+    print(f"Practice count: {skill.practice_count}, curve points: {len(skill.learning_curve)}")
+    assert len(skill.learning_curve) == Skill.MAX_CURVE_POINTS
+    assert skill.learning_curve[-1] == skill.proficiency
+    print("✅ PASS - Only the most recent proficiencies kept")
+
+    print("\n" + "=" * 60)
+
+
+def test_tenant_state_manager():
+    """Test the tenant LRU and lazy persistence"""
+
+    print("=" * 60)
+    print("Testing Tenant State Manager")
+    print("=" * 60)
+
+    # Test 1: A pinned tenant survives LRU pressure until its operation finishes
+    print("\n[Test 1] Eviction while a tenant is in use...")
+    manager = TenantStateManager(max_hot=1)
+    with manager.using("a") as state:
+        manager.get("b")
+        assert manager.get_stats()['hot_tenants'] == 2
+        assert manager.get("a") is state
+    manager.get("c")
+    assert manager.get_stats()['hot_tenants'] == 1
+    print("✅ PASS - Pinned tenant kept, LRU shrinks afterwards")
+
+    # Test 2: Mutations made while other tenants churn the LRU reach disk
+    print("\n[Test 2] Changes under eviction pressure...")
+    with tempfile.TemporaryDirectory() as tmp:
+        base = PersonalityEngine(PersonalityTraits())
+        manager = TenantStateManager(base, max_hot=1, state_dir=tmp)
+        with manager.using("a") as state:
+            manager.get("b")  # would have evicted and saved "a" mid-update
+            with state.lock:
+                state.dirty = True
+                state.learning.learn_from_interaction("q", "r", {}, {'success': True})
+        manager.get("c")
+        manager.close()
+
+        reloaded = TenantStateManager(base, max_hot=1, state_dir=tmp)
+        assert len(reloaded.get("a").learning.episodic.episodes) == 1
+        reloaded.close()
+    print("✅ PASS - Change saved and reloaded")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_tenant_learning()
+    test_tenant_state_manager()
@@ -0,0 +1,115 @@
+"""
+Test Tool Executor
+Tests deadlines and async tools on the synchronous execute() path
+"""
+
+import asyncio
+import sys
+import os
+import time
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.tools.tool_registry import ToolRegistry, tool
+from companion_baas.tools.tool_executor import ToolExecutor
+
+
+def test_tool_executor():
+    """Test sync execution against the executor and per-tool deadlines"""
+
+    print("=" * 60)
+    print("Testing Tool Executor")
+    print("=" * 60)
+
+    registry = ToolRegistry()
+    executor = ToolExecutor(registry, cache_enabled=False, timeout=0.2)
+
+    @tool(name="sleepy")
+    def sleepy(duration: float) -> float:
+        """Block for a while"""
+        time.sleep(duration)
+        return duration
+
+    @tool(name="strict", timeout=0.1)
+    def strict(duration: float) -> float:
+        """Block for a while under a tighter deadline"""
+        time.sleep(duration)
+        return duration
+
+    @tool(name="async_echo")
+    async def async_echo(text: str) -> str:
+        """Echo from the event loop"""
+        await asyncio.sleep(0.01)
+        return text
+
+    for function in (sleepy, strict, async_echo):
+        registry.register(function)
+
+    # Test 1: Executor-wide deadline applies to sync tools
+    print("\n[Test 1] Sync tool over the executor timeout...")
+    start = time.time()
+    result = executor.execute("sleepy", 1.0)
+    print(f"Result: success={result.success} error={result.error}")
+    assert not result.success and time.time() - start < 0.8
+    assert "exceeded 0.2s deadline" in result.error
+    assert executor.execute("sleepy", 0.01).result == 0.01
+    print("✅ PASS - Executor timeout enforced for sync tools")
+
+    # Test 2: The configured deadline is reported, not the elapsed time
+    print("\n[Test 2] Per-tool deadline in the error...")
+    result = executor.execute("strict", 0.5)
+    print(f"Error: {result.error}")
+    assert "exceeded 0.1s deadline" in result.error
+    print("✅ PASS - Timeout error names the configured deadline")
+
+    # Test 3: Async tool from sync code, with and without a running loop
+    print("\n[Test 3] Async tool through execute()...")
+    assert executor.execute("async_echo", "plain").result == "plain"
+
+    async def inside_loop():
+        return executor.execute("async_echo", "nested")
+
+    result = asyncio.run(inside_loop())
+    print(f"From a running loop: success={result.success} result={result.result}")
+    assert result.success and result.result == "nested"
+    print("✅ PASS - Async tools run from inside a running loop")
+
+    executor.shutdown(wait=False)
+    print("\n" + "=" * 60)
+
+
+def test_forward_reference_tools():
+    """Test tools whose annotations cannot be resolved at registration"""
+
+    print("=" * 60)
+    print("Testing Tools With Unresolved Annotations")
+    print("=" * 60)
+
+    registry = ToolRegistry()
+    executor = ToolExecutor(registry, cache_enabled=False)
+
+    @tool(name="describe")
+    def describe(item: "NotDefinedYet", times: int = 1) -> str:
+        """Describe an item"""
+        return f"{item}" * times
+
+    print("\n[Test 1] Registering a tool with a forward reference...")
+    registry.register(describe)
+    assert registry.get_tool("describe") is not None
+    print("✅ PASS - Registration tolerates unresolved forward references")
+
+    print("\n[Test 2] Calling it (resolvable parameters are still checked)...")
+    assert executor.execute("describe", "ab", 2).result == "abab"
+    result = executor.execute("describe", "ab", "2")
+    print(f"Bad int: success={result.success} error={result.error}")
+    assert not result.success
+    print("✅ PASS - Unresolved parameters accepted, others validated")
+
+    executor.shutdown(wait=False)
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_tool_executor()
+    test_forward_reference_tools()
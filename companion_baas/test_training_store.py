@@ -0,0 +1,199 @@
+"""
+Test Training Store
+Tests the columnar training store and fine-tuning data export
+"""
+
+import sys
+import os
+import json
+import tempfile
+import types
+
+# Add parent directory to path
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+from companion_baas.core.training_store import HashFilter, MIN_FILTER_ROWS, TrainingStore
+from companion_baas.core.model_finetuning import ModelFinetuningSystem, TrainingDataPreparator
+
+
+def segment_files(path):
+    """Names of the segment files in a store directory"""
+    return sorted(name for name in os.listdir(path) if name.startswith("seg_"))
+
+
+def test_training_store():
+    """Test persistence, flushing and dedup"""
+
+    print("=" * 60)
+    print("Testing Training Store")
+    print("=" * 60)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 1: Examples below the segment threshold survive a restart once closed
+        print("\n[Test 1] Closing with buffered examples...")
+        system = ModelFinetuningSystem(training_store=tmp)
+        for i in range(50):
+            system.data_preparator.add_example(f"question {i}", f"answer {i}")
+        system.close()
+        restarted = ModelFinetuningSystem(training_store=tmp)
+        assert restarted.data_preparator.count() == 50
+        restarted.close()
+        print("✅ PASS - Buffered examples written on close")
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 2: A slow trickle of rows still reaches disk without waiting for segment_rows
+        print("\n[Test 2] Flushing on age and size...")
+        by_age = TrainingStore(os.path.join(tmp, "age"), flush_interval=0)
+        by_age.append("q", "a")
+        assert by_age.get_stats()['buffered_rows'] == 0
+        assert len(TrainingStore(os.path.join(tmp, "age"))) == 1
+
+        by_size = TrainingStore(os.path.join(tmp, "size"), flush_bytes=10, flush_interval=None)
+        by_size.append("q", "a")
+        assert by_size.get_stats()['buffered_rows'] == 1
+        by_size.append("longer question", "longer answer")
+        stats = by_size.get_stats()
+        assert stats['buffered_rows'] == 0 and stats['segments'] == 1
+        print("✅ PASS - Age and byte thresholds flush the buffer")
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 3: Filter false positives fall back to the segment hash files
+        print("\n[Test 3] Dedup across reopen with a tiny filter...")
+        store = TrainingStore(tmp, segment_rows=10, filter_bits=8)
+        for i in range(25):
+            assert store.append(f"q{i}", f"a{i}") is not None
+        store.close()
+
+        reopened = TrainingStore(tmp, segment_rows=10, filter_bits=8)
+        assert not hasattr(reopened, '_hashes')
+        assert reopened.append("q3", "a3") is None
+        assert reopened.append("q24", "a24") is None
+        assert reopened.append("q25", "a25") is not None
+        assert reopened.append("q25", "a25") is None
+        assert len(reopened) == 26 and reopened.duplicates_skipped == 3
+        reopened.close()
+        print("✅ PASS - Duplicates caught, new rows accepted")
+
+    # Test 4: The dedup filter is sized from the stored rows and grows with them
+    print("\n[Test 4] Dedup filter sizing...")
+    sized = HashFilter.for_capacity(2_000_000)
+    print(f"2M keys: {sized.bits} bits, {sized.probes} probes")
+    assert sized.bits > 1 << 24 and sized.probes == 7
+    with tempfile.TemporaryDirectory() as tmp:
+        store = TrainingStore(tmp, segment_rows=100, compact_segments=None)
+        assert store._filter.capacity == MIN_FILTER_ROWS
+        store._filter = HashFilter.for_capacity(150)  # as if sized for a small store
+        for i in range(400):
+            store.append(f"q{i}", f"a{i}")
+        store.flush()
+        print(f"Filter capacity after 400 rows: {store._filter.capacity}")
+        assert store._filter.capacity >= 2 * 150
+        assert all(store.append(f"q{i}", f"a{i}") is None for i in range(400))
+        store.close()
+    print("✅ PASS - Filter rebuilt once the store outgrew it")
+
+    print("\n" + "=" * 60)
+
+
+def test_training_store_compaction():
+    """Test merging the small segments left by age and byte flushes"""
+
+    print("=" * 60)
+    print("Testing Training Store Compaction")
+    print("=" * 60)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # Test 1: Enough small segments are merged automatically
+        print("\n[Test 1] Age flushes of a slow trickle...")
+        store = TrainingStore(tmp, segment_rows=10, flush_interval=0, compact_segments=4)
+        for i in range(12):
+            store.append(f"q{i}", f"a{i}", quality_score=i / 20, dataset_type="qa" if i % 2 else "chat")
+        stats = store.get_stats()
+        print(f"Segments: {stats['segments']}, compacted away: {stats['segments_compacted']}")
+        assert stats['segments'] < 12 and stats['segments_compacted'] > 0
+        assert [row['input'] for row in store.scan()] == [f"q{i}" for i in range(12)]
+        assert store.count(0.3, ["qa"]) == 3
+        print("✅ PASS - Segments merged, rows and order unchanged")
+
+        # Test 2: compact() merges what is left; old files are removed; reopening agrees
+        print("\n[Test 2] compact() and reopen...")
+        store.compact_segments = None
+        for i in range(12, 15):
+            store.append(f"q{i}", f"a{i}")
+        store.compact()
+        names = {segment['name'] for segment in store._manifest['segments']}
+        assert {name.split('.')[0] for name in segment_files(tmp)} == names
+        store.close()
+        reopened = TrainingStore(tmp, segment_rows=10)
+        assert [row['input'] for row in reopened.scan()] == [f"q{i}" for i in range(15)]
+        assert reopened.append("q7", "a7") is None and reopened.duplicates_skipped == 1
+        reopened.close()
+        print(f"Segment files: {segment_files(tmp)}")
+        print("✅ PASS - Only the merged segments remain on disk")
+
+        # Test 3: A scan in progress keeps reading the segments it started with
+        print("\n[Test 3] Compaction during a scan...")
+        store = TrainingStore(tmp, segment_rows=100, flush_interval=0, compact_segments=None)
+        rows = store.scan()
+        first = next(rows)
+        assert store.compact() > 0
+        assert [first['input']] + [row['input'] for row in rows] == [f"q{i}" for i in range(15)]
+        store.close()
+        print("✅ PASS - Retired files removed only after the scan finished")
+
+    print("\n" + "=" * 60)
+
+
+def test_training_export():
+    """Test that every capped export picks the same rows"""
+
+    print("=" * 60)
+    print("Testing Training Data Export")
+    print("=" * 60)
+
+    qualities = [0.9, 0.7, 0.95, 0.8, 0.9, 0.75]
+    expected = ["q0", "q2", "q3", "q4"]  # the 4 best, in insertion order
+
+    # Test 1: export_dataset streams; a cap keeps the best in insertion order
+    print("\n[Test 1] In-memory export_dataset...")
+    preparator = TrainingDataPreparator()
+    for i, quality in enumerate(qualities):
+        preparator.add_example(f"q{i}", f"a{i}", quality_score=quality)
+    exported = preparator.export_dataset("alpaca", min_quality=0.0)
+    assert isinstance(exported, types.GeneratorType)
+    assert len(list(exported)) == len(qualities)
+    best = [ex['instruction'] for ex in preparator.export_dataset("alpaca", min_quality=0.0, max_examples=4)]
+    print(f"Best 4: {best}")
+    assert best == expected
+    print("✅ PASS - Highest-quality examples selected")
+
+    # Test 2: export_jsonl selects the same rows, in memory and from the store
+    print("\n[Test 2] export_jsonl with and without a store...")
+    with tempfile.TemporaryDirectory() as tmp:
+        stored = TrainingDataPreparator(os.path.join(tmp, "store"))
+        for i, quality in enumerate(qualities):
+            stored.add_example(f"q{i}", f"a{i}", quality_score=quality)
+        stored.store.flush()
+        for source in (preparator, stored):
+            path = os.path.join(tmp, "train.jsonl")
+            assert source.export_jsonl(path, "alpaca", min_quality=0.0, max_examples=4) == 4
+            with open(path) as f:
+                assert [json.loads(line)['instruction'] for line in f] == expected
+        assert [ex['instruction'] for ex in stored.export_dataset("alpaca", 0.0, max_examples=4)] == expected
+        stored.close()
+    print("✅ PASS - Same selection everywhere")
+
+    # Test 3: Ties at the cutoff go to the earliest rows
+    print("\n[Test 3] Ties at the cutoff...")
+    best = [ex['instruction'] for ex in preparator.export_dataset("alpaca", min_quality=0.0, max_examples=2)]
+    print(f"Best 2: {best}")
+    assert best == ["q0", "q2"]
+    print("✅ PASS - Earliest of the tied rows kept")
+
+    print("\n" + "=" * 60)
+
+
+if __name__ == "__main__":
+    test_training_store()
+    test_training_store_compaction()
+    test_training_export()
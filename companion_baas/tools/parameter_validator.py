@@ -4,10 +4,31 @@ Parameter Validator - Validates tool parameters
 Ensures type safety and validates parameters before tool execution.
 """
 
+import types
 import inspect
-from typing import Any, Dict, Optional, get_type_hints, get_args, get_origin
+import weakref
+from typing import Any, Callable, Dict, Optional, Union, get_type_hints, get_args, get_origin
 from dataclasses import is_dataclass
 
+# PEP 604 unions (X | None) have their own origin type on 3.10+
+_UNION_TYPES = (Union, getattr(types, 'UnionType', Union))
+
+# Compiled validators keyed by function (see ParameterValidator.compile)
+_compiled_validators = weakref.WeakKeyDictionary()
+
+
+def _type_hints(func: Callable) -> Dict[str, Any]:
+    """
+    Resolved annotations of func; raw annotations when a forward reference
+    cannot be resolved yet (those parameters are left unchecked)
+    """
+    if not hasattr(func, '__annotations__'):
+        return {}
+    try:
+        return get_type_hints(func)
+    except NameError:
+        return dict(func.__annotations__)
+
 
 class ValidationError(Exception):
     """Raised when parameter validation fails"""
@@ -23,8 +44,210 @@ class ParameterValidator:
     - Required parameter validation
     - Default value handling
     - Complex type support (List, Dict, Optional)
+    - Validators compiled once per function (see compile())
     """
     
+    @staticmethod
+    def compile(func: callable) -> Callable[[tuple, dict], tuple]:
+        """
+        Compile a validator for a function signature
+        
+        Signature and type hints are inspected once; the returned closure
+        only binds and type-checks. Plain positional-or-keyword signatures
+        (the common case for tools) bind without inspect.Signature.bind.
+        
+        Args:
+            func: Function to validate against
+        
+        Returns:
+            validate(args, kwargs) -> (validated_args, validated_kwargs)
+        """
+        try:
+            return _compiled_validators[func]
+        except (KeyError, TypeError):
+            pass
+        
+        sig = inspect.signature(func)
+        type_hints = _type_hints(func)
+        
+        checkers = {
+            name: ParameterValidator._compile_type(name, type_hints[name])
+            for name in sig.parameters
+            if name in type_hints and not isinstance(type_hints[name], str)
+        }
+        checkers = {name: check for name, check in checkers.items() if check is not None}
+        
+        params = list(sig.parameters.values())
+        simple = all(p.kind is inspect.Parameter.POSITIONAL_OR_KEYWORD for p in params)
+        
+        if simple:
+            validator = ParameterValidator._compile_simple(params, checkers)
+        else:
+            validator = ParameterValidator._compile_generic(sig, checkers)
+        
+        try:
+            _compiled_validators[func] = validator
+        except TypeError:
+            pass  # Not weak-referenceable; caller keeps its own reference
+        return validator
+    
+    @staticmethod
+    def _compile_simple(params: list, checkers: Dict[str, Callable]) -> Callable:
+        """Fast binder for signatures made only of positional-or-keyword params"""
+        empty = inspect.Parameter.empty
+        names = tuple(p.name for p in params)
+        defaults = tuple(p.default for p in params)
+        index = {name: i for i, name in enumerate(names)}
+        count = len(names)
+        # (position, checker) pairs so the hot loop avoids dict lookups
+        checks = tuple(
+            (index[name], check) for name, check in checkers.items()
+        )
+        
+        def validate(args: tuple = None, kwargs: dict = None) -> tuple:
+            args = args or ()
+            if len(args) > count:
+                raise ValidationError(
+                    f"Parameter binding failed: too many positional arguments"
+                )
+            
+            if kwargs:
+                values = list(args) + [empty] * (count - len(args))
+                for key, value in kwargs.items():
+                    i = index.get(key)
+                    if i is None:
+                        raise ValidationError(
+                            f"Parameter binding failed: got an unexpected keyword argument '{key}'"
+                        )
+                    if values[i] is not empty:
+                        raise ValidationError(
+                            f"Parameter binding failed: multiple values for argument '{key}'"
+                        )
+                    values[i] = value
+            elif len(args) == count:
+                values = args
+            else:
+                values = list(args) + [empty] * (count - len(args))
+            
+            if values is not args:
+                for i in range(len(args), count):
+                    if values[i] is empty:
+                        if defaults[i] is empty:
+                            raise ValidationError(
+                                f"Parameter binding failed: missing a required argument: '{names[i]}'"
+                            )
+                        values[i] = defaults[i]
+            
+            for i, check in checks:
+                check(values[i])
+            
+            return tuple(values), {}
+        
+        return validate
+    
+    @staticmethod
+    def _compile_generic(sig: inspect.Signature, checkers: Dict[str, Callable]) -> Callable:
+        """Binder for signatures with *args, **kwargs or keyword-only params"""
+        
+        def validate(args: tuple = None, kwargs: dict = None) -> tuple:
+            try:
+                bound_args = sig.bind(*(args or ()), **(kwargs or {}))
+                bound_args.apply_defaults()
+            except TypeError as e:
+                raise ValidationError(f"Parameter binding failed: {str(e)}")
+            
+            for param_name, param_value in bound_args.arguments.items():
+                check = checkers.get(param_name)
+                if check is not None:
+                    check(param_value)
+            
+            return bound_args.args, bound_args.kwargs
+        
+        return validate
+    
+    @staticmethod
+    def _compile_type(param_name: str, expected_type: Any) -> Optional[Callable[[Any], None]]:
+        """
+        Compile a type check into a closure (None means accept anything)
+        
+        Mirrors _validate_type: ints are accepted for floats, list items
+        are not enforced, and None is only accepted for Optional types.
+        """
+        if expected_type is Any or str(expected_type) == 'typing.Any':
+            return None
+        
+        origin = get_origin(expected_type)
+        args = get_args(expected_type)
+        
+        if origin in _UNION_TYPES:
+            allows_none = type(None) in args
+            members = [
+                ParameterValidator._compile_type(param_name, arg)
+                for arg in args if arg is not type(None)
+            ]
+            if any(member is None for member in members):
+                # Union with Any: only None-ness matters
+                members = []
+            type_names = [t.__name__ if hasattr(t, '__name__') else str(t) for t in args]
+            
+            def check_union(value):
+                if value is None:
+                    if not allows_none:
+                        raise ValidationError(f"Parameter '{param_name}' cannot be None")
+                    return
+                if not members:
+                    return
+                for member in members:
+                    try:
+                        member(value)
+                        return
+                    except ValidationError:
+                        continue
+                raise ValidationError(
+                    f"Parameter '{param_name}' must be one of {type_names}, "
+                    f"got {type(value).__name__}"
+                )
+            
+            return check_union
+        
+        if origin is not None:
+            # Generic containers: only the container type is enforced
+            container = {list: 'a list', dict: 'a dict', tuple: 'a tuple'}.get(origin)
+            if container is None:
+                def check_not_none(value):
+                    if value is None:
+                        raise ValidationError(f"Parameter '{param_name}' cannot be None")
+                return check_not_none
+            
+            def check_container(value):
+                if value.__class__ is not origin and not isinstance(value, origin):
+                    if value is None:
+                        raise ValidationError(f"Parameter '{param_name}' cannot be None")
+                    raise ValidationError(
+                        f"Parameter '{param_name}' must be {container}, got {type(value).__name__}"
+                    )
+            
+            return check_container
+        
+        if not isinstance(expected_type, type):
+            return None
+        
+        # Scalar fast path: exact class match first, isinstance only on miss
+        accepted = (int, float) if expected_type is float else expected_type
+        type_name = expected_type.__name__
+        
+        def check_scalar(value):
+            if value.__class__ is expected_type or isinstance(value, accepted):
+                return
+            if value is None:
+                raise ValidationError(f"Parameter '{param_name}' cannot be None")
+            raise ValidationError(
+                f"Parameter '{param_name}' must be {type_name}, "
+                f"got {type(value).__name__}"
+            )
+        
+        return check_scalar
+    
     @staticmethod
     def validate_parameters(
         func: callable,
@@ -45,27 +268,7 @@ class ParameterValidator:
         Raises:
             ValidationError: If validation fails
         """
-        args = args or ()
-        kwargs = kwargs or {}
-        
-        # Get function signature
-        sig = inspect.signature(func)
-        type_hints = get_type_hints(func) if hasattr(func, '__annotations__') else {}
-        
-        # Bind arguments to signature
-        try:
-            bound_args = sig.bind(*args, **kwargs)
-            bound_args.apply_defaults()
-        except TypeError as e:
-            raise ValidationError(f"Parameter binding failed: {str(e)}")
-        
-        # Validate types
-        for param_name, param_value in bound_args.arguments.items():
-            if param_name in type_hints:
-                expected_type = type_hints[param_name]
-                ParameterValidator._validate_type(param_name, param_value, expected_type)
-        
-        return bound_args.args, bound_args.kwargs
+        return ParameterValidator.compile(func)(args, kwargs)
     
     @staticmethod
     def _validate_type(param_name: str, value: Any, expected_type: Any):
@@ -169,7 +372,7 @@ class ParameterValidator:
             Dictionary with parameter information
         """
         sig = inspect.signature(func)
-        type_hints = get_type_hints(func) if hasattr(func, '__annotations__') else {}
+        type_hints = _type_hints(func)
         
         params_info = {}
         
@@ -4,17 +4,29 @@ Tool Executor - Async execution and caching for tools
 Provides async execution capabilities and result caching.
 """
 
+import os
 import asyncio
 import time
 import hashlib
 import json
+import weakref
+from functools import partial
 from typing import Any, Optional, Dict
 from dataclasses import dataclass
-from concurrent.futures import ThreadPoolExecutor
+from concurrent.futures import ThreadPoolExecutor, TimeoutError as FutureTimeoutError
 
 from .tool_registry import ToolRegistry
 
 
+def _loop_running() -> bool:
+    """True when called from a thread that is running an event loop"""
+    try:
+        asyncio.get_running_loop()
+    except RuntimeError:
+        return False
+    return True
+
+
 @dataclass
 class ExecutionResult:
     """Result of tool execution"""
@@ -30,9 +42,10 @@ class ToolExecutor:
     Execute tools with async support and caching
     
     Features:
-    - Async execution
+    - Async execution (async tools run natively on the event loop)
+    - Blocking tools isolated on a sized thread pool
+    - Per-tool concurrency limits and deadlines
     - Result caching
-    - Timeout handling
     - Error recovery
     """
     
@@ -41,7 +54,8 @@ class ToolExecutor:
         registry: ToolRegistry,
         cache_enabled: bool = True,
         cache_ttl: int = 300,
-        timeout: int = 30
+        timeout: int = 30,
+        max_workers: Optional[int] = None
     ):
         """
         Initialize tool executor
@@ -50,18 +64,51 @@ class ToolExecutor:
             registry: Tool registry
             cache_enabled: Enable result caching
             cache_ttl: Cache time-to-live in seconds
-            timeout: Execution timeout in seconds
+            timeout: Default execution timeout in seconds (per-tool timeout wins)
+            max_workers: Thread pool size for blocking tools
+                         (defaults to min(32, cpu_count + 4))
         """
         self.registry = registry
         self.cache_enabled = cache_enabled
         self.cache_ttl = cache_ttl
         self.timeout = timeout
+        self.max_workers = max_workers or min(32, (os.cpu_count() or 1) + 4)
         
         # Cache: {cache_key: (result, timestamp)}
         self._cache: Dict[str, tuple] = {}
         
-        # Thread pool for async execution
-        self._executor = ThreadPoolExecutor(max_workers=10)
+        # Thread pool for blocking (sync) tools only
+        self._executor = ThreadPoolExecutor(
+            max_workers=self.max_workers,
+            thread_name_prefix="tool"
+        )
+        
+        # Per-loop, per-tool semaphores: {loop: {tool_name: Semaphore}}
+        # asyncio primitives bind to a loop, so keep one set per loop
+        self._semaphores = weakref.WeakKeyDictionary()
+    
+    def _get_timeout(self, tool) -> Optional[float]:
+        """Resolve the deadline for a tool call"""
+        if tool is not None and tool.timeout:
+            return tool.timeout
+        return self.timeout or None
+    
+    def _get_semaphore(self, tool) -> Optional[asyncio.Semaphore]:
+        """Get the concurrency limiter for a tool on the running loop"""
+        if tool is None or not tool.max_concurrency:
+            return None
+        
+        loop = asyncio.get_running_loop()
+        loop_semaphores = self._semaphores.get(loop)
+        if loop_semaphores is None:
+            loop_semaphores = {}
+            self._semaphores[loop] = loop_semaphores
+        
+        semaphore = loop_semaphores.get(tool.name)
+        if semaphore is None:
+            semaphore = asyncio.Semaphore(tool.max_concurrency)
+            loop_semaphores[tool.name] = semaphore
+        return semaphore
     
     def _generate_cache_key(self, tool_name: str, args: tuple, kwargs: dict) -> str:
         """Generate cache key for tool execution"""
@@ -131,8 +178,22 @@ class ToolExecutor:
         # Execute tool
         start_time = time.time()
         
+        tool = self.registry.get_tool(tool_name)
+        timeout = self._get_timeout(tool)
+        
         try:
-            result = self.registry.execute(tool_name, *args, **kwargs)
+            if tool is not None and tool.is_async:
+                # Async tool from sync code: run on a private loop with deadline
+                # (on the pool when this thread already runs a loop)
+                tool, v_args, v_kwargs = self.registry.bind(tool_name, args, kwargs)
+                run = partial(self._run_coroutine, tool.function, v_args, v_kwargs, timeout)
+                result = self._executor.submit(run).result() if _loop_running() else run()
+            elif timeout:
+                # Deadline: run on the pool so the caller can give up
+                future = self._executor.submit(self.registry.execute, tool_name, *args, **kwargs)
+                result = future.result(timeout=timeout)
+            else:
+                result = self.registry.execute(tool_name, *args, **kwargs)
             execution_time = time.time() - start_time
             
             # Cache result
@@ -145,6 +206,8 @@ class ToolExecutor:
                 cached=False
             )
             
+        except (asyncio.TimeoutError, FutureTimeoutError):
+            return self._timeout_result(tool_name, start_time, timeout)
         except Exception as e:
             execution_time = time.time() - start_time
             return ExecutionResult(
@@ -154,6 +217,21 @@ class ToolExecutor:
                 execution_time=execution_time
             )
     
+    @staticmethod
+    def _run_coroutine(function, args: tuple, kwargs: dict, timeout: Optional[float]) -> Any:
+        """Run an async tool to completion on a private event loop"""
+        return asyncio.run(asyncio.wait_for(function(*args, **kwargs), timeout=timeout))
+    
+    def _timeout_result(self, tool_name: str, start_time: float, timeout: Optional[float]) -> ExecutionResult:
+        """Build the result for a call that missed its deadline"""
+        execution_time = time.time() - start_time
+        return ExecutionResult(
+            success=False,
+            result=None,
+            error=f"TimeoutError: Tool '{tool_name}' exceeded {timeout}s deadline",
+            execution_time=execution_time
+        )
+    
     async def execute_async(
         self,
         tool_name: str,
@@ -164,6 +242,10 @@ class ToolExecutor:
         """
         Execute a tool asynchronously
         
+        Async tools are awaited directly on the running loop; blocking
+        tools are offloaded to the thread pool. Both honour the tool's
+        concurrency limit and deadline.
+        
         Args:
             tool_name: Name of tool to execute
             *args: Positional arguments
@@ -173,33 +255,104 @@ class ToolExecutor:
         Returns:
             ExecutionResult with output
         """
-        # Run in thread pool
-        loop = asyncio.get_event_loop()
-        result = await loop.run_in_executor(
-            self._executor,
-            lambda: self.execute(tool_name, *args, use_cache=use_cache, **kwargs)
-        )
-        return result
+        cache_key = self._generate_cache_key(tool_name, args, kwargs)
+        
+        if use_cache:
+            cached_result = self._get_cached_result(cache_key)
+            if cached_result is not None:
+                return ExecutionResult(
+                    success=True,
+                    result=cached_result,
+                    cached=True,
+                    execution_time=0.0
+                )
+        
+        tool = self.registry.get_tool(tool_name)
+        semaphore = self._get_semaphore(tool)
+        
+        if semaphore is not None:
+            async with semaphore:
+                return await self._run_async(tool_name, tool, args, kwargs, cache_key)
+        return await self._run_async(tool_name, tool, args, kwargs, cache_key)
+    
+    async def _run_async(
+        self,
+        tool_name: str,
+        tool,
+        args: tuple,
+        kwargs: dict,
+        cache_key: str
+    ) -> ExecutionResult:
+        """Run one tool call under its deadline (concurrency slot already held)"""
+        start_time = time.time()
+        timeout = self._get_timeout(tool)
+        
+        try:
+            tool, v_args, v_kwargs = self.registry.bind(tool_name, args, kwargs)
+            
+            if tool.is_async:
+                awaitable = tool.function(*v_args, **v_kwargs)
+            else:
+                loop = asyncio.get_running_loop()
+                awaitable = loop.run_in_executor(
+                    self._executor,
+                    partial(tool.function, *v_args, **v_kwargs)
+                )
+            
+            result = await asyncio.wait_for(awaitable, timeout=timeout)
+            execution_time = time.time() - start_time
+            
+            self._cache_result(cache_key, result)
+            
+            return ExecutionResult(
+                success=True,
+                result=result,
+                execution_time=execution_time,
+                cached=False
+            )
+            
+        except asyncio.TimeoutError:
+            return self._timeout_result(tool_name, start_time, timeout)
+        except Exception as e:
+            execution_time = time.time() - start_time
+            return ExecutionResult(
+                success=False,
+                result=None,
+                error=f"{type(e).__name__}: {str(e)}",
+                execution_time=execution_time
+            )
     
     async def execute_batch(
         self,
         executions: list,
-        use_cache: bool = True
+        use_cache: bool = True,
+        max_concurrency: Optional[int] = None
     ) -> list:
         """
         Execute multiple tools in parallel
         
+        Per-tool concurrency limits and deadlines apply to every call.
+        
         Args:
             executions: List of (tool_name, args, kwargs) tuples
             use_cache: Whether to use cached results
+            max_concurrency: Optional cap on in-flight calls for this batch
         
         Returns:
-            List of ExecutionResult objects
+            List of ExecutionResult objects (same order as executions)
         """
-        tasks = []
-        for tool_name, args, kwargs in executions:
-            task = self.execute_async(tool_name, *args, use_cache=use_cache, **kwargs)
-            tasks.append(task)
+        batch_semaphore = asyncio.Semaphore(max_concurrency) if max_concurrency else None
+        
+        async def run_one(tool_name, args, kwargs):
+            if batch_semaphore is None:
+                return await self.execute_async(tool_name, *args, use_cache=use_cache, **kwargs)
+            async with batch_semaphore:
+                return await self.execute_async(tool_name, *args, use_cache=use_cache, **kwargs)
+        
+        tasks = [
+            run_one(tool_name, args, kwargs)
+            for tool_name, args, kwargs in executions
+        ]
         
         results = await asyncio.gather(*tasks)
         return results
@@ -208,6 +361,10 @@ class ToolExecutor:
         """Clear all cached results"""
         self._cache.clear()
     
+    def shutdown(self, wait: bool = True):
+        """Shut down the blocking-tool thread pool"""
+        self._executor.shutdown(wait=wait)
+    
     def get_cache_stats(self) -> dict:
         """Get cache statistics"""
         total_entries = len(self._cache)
@@ -324,4 +481,28 @@ if __name__ == "__main__":
     for i, result in enumerate(batch_results):
         print(f"  Result {i+1}: {result.result} (time: {result.execution_time:.4f}s, cached: {result.cached})")
     
+    # Test 6: Native async tools with concurrency cap and deadline
+    print("\nTest 6: Async Tools (max_concurrency=2, timeout=0.2s)")
+    print("-" * 70)
+    
+    @tool(name="async_sleep", max_concurrency=2, timeout=0.2)
+    async def async_sleep(duration: float = 0.05) -> float:
+        """Sleep on the event loop"""
+        await asyncio.sleep(duration)
+        return duration
+    
+    registry.register(async_sleep)
+    
+    async def test_async_tools():
+        executions = [("async_sleep", (0.05,), {}) for _ in range(4)]
+        executions.append(("async_sleep", (1.0,), {}))
+        start = time.time()
+        results = await executor.execute_batch(executions, use_cache=False)
+        return results, time.time() - start
+    
+    async_results, async_time = asyncio.run(test_async_tools())
+    print(f"✓ Total time: {async_time:.4f}s")
+    for i, result in enumerate(async_results):
+        print(f"  Result {i+1}: success={result.success} {result.result or result.error}")
+    
     print("\n" + "=" * 70)
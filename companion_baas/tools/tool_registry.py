@@ -4,6 +4,7 @@ Tool Registry - Registers and manages tools/functions
 Provides a decorator-based system for registering tools.
 """
 
+import asyncio
 import inspect
 import functools
 from typing import Any, Callable, Dict, List, Optional
@@ -23,9 +24,21 @@ class Tool:
     category: str = "general"
     tags: List[str] = field(default_factory=list)
     examples: List[str] = field(default_factory=list)
+    is_async: Optional[bool] = None
+    max_concurrency: Optional[int] = None
+    timeout: Optional[float] = None
+    validator: Optional[Callable] = field(default=None, repr=False, compare=False)
     
     def __post_init__(self):
         """Extract parameter information after initialization"""
+        if self.is_async is None:
+            # Coroutine functions run natively on the event loop
+            self.is_async = inspect.iscoroutinefunction(self.function)
+        
+        if self.validator is None:
+            # Compile parameter checks once instead of per call
+            self.validator = ParameterValidator.compile(self.function)
+        
         if not self.parameters:
             self.parameters = ParameterValidator.get_parameter_info(self.function)
         
@@ -50,7 +63,10 @@ class Tool:
                 for name, info in self.parameters.items()
             },
             'return_type': self.return_type.__name__ if hasattr(self.return_type, '__name__') else str(self.return_type),
-            'examples': self.examples
+            'examples': self.examples,
+            'is_async': self.is_async,
+            'max_concurrency': self.max_concurrency,
+            'timeout': self.timeout
         }
 
 
@@ -59,7 +75,10 @@ def tool(
     description: Optional[str] = None,
     category: str = "general",
     tags: Optional[List[str]] = None,
-    examples: Optional[List[str]] = None
+    examples: Optional[List[str]] = None,
+    is_async: Optional[bool] = None,
+    max_concurrency: Optional[int] = None,
+    timeout: Optional[float] = None
 ):
     """
     Decorator to register a function as a tool
@@ -68,6 +87,10 @@ def tool(
         @tool(name="my_tool", description="Does something cool")
         def my_function(x: int, y: str) -> str:
             return f"{y}: {x}"
+        
+        @tool(name="fetch", max_concurrency=4, timeout=10)
+        async def fetch(url: str) -> str:
+            ...
     
     Args:
         name: Tool name (defaults to function name)
@@ -75,6 +98,9 @@ def tool(
         category: Tool category for organization
         tags: Tags for discovery
         examples: Usage examples
+        is_async: Run natively on the event loop (auto-detected for coroutines)
+        max_concurrency: Max concurrent executions of this tool (None = unlimited)
+        timeout: Per-call deadline in seconds (None = executor default)
     """
     def decorator(func: Callable) -> Callable:
         tool_name = name or func.__name__
@@ -88,12 +114,20 @@ def tool(
             'description': tool_description,
             'category': category,
             'tags': tool_tags,
-            'examples': tool_examples
+            'examples': tool_examples,
+            'is_async': is_async,
+            'max_concurrency': max_concurrency,
+            'timeout': timeout
         }
         
-        @functools.wraps(func)
-        def wrapper(*args, **kwargs):
-            return func(*args, **kwargs)
+        if inspect.iscoroutinefunction(func):
+            @functools.wraps(func)
+            async def wrapper(*args, **kwargs):
+                return await func(*args, **kwargs)
+        else:
+            @functools.wraps(func)
+            def wrapper(*args, **kwargs):
+                return func(*args, **kwargs)
         
         wrapper._tool_metadata = func._tool_metadata
         
@@ -126,7 +160,10 @@ class ToolRegistry:
         description: Optional[str] = None,
         category: str = "general",
         tags: Optional[List[str]] = None,
-        examples: Optional[List[str]] = None
+        examples: Optional[List[str]] = None,
+        is_async: Optional[bool] = None,
+        max_concurrency: Optional[int] = None,
+        timeout: Optional[float] = None
     ) -> Tool:
         """
         Register a function as a tool
@@ -138,6 +175,9 @@ class ToolRegistry:
             category: Tool category
             tags: Search tags
             examples: Usage examples
+            is_async: Run natively on the event loop (auto-detected for coroutines)
+            max_concurrency: Max concurrent executions of this tool
+            timeout: Per-call deadline in seconds
         
         Returns:
             Registered Tool object
@@ -150,6 +190,9 @@ class ToolRegistry:
             category = metadata.get('category', category)
             tags = tags or metadata.get('tags', [])
             examples = examples or metadata.get('examples', [])
+            is_async = is_async if is_async is not None else metadata.get('is_async')
+            max_concurrency = max_concurrency or metadata.get('max_concurrency')
+            timeout = timeout or metadata.get('timeout')
         
         tool_name = name or func.__name__
         tool_description = description or (inspect.getdoc(func) or "No description")
@@ -161,7 +204,10 @@ class ToolRegistry:
             description=tool_description,
             category=category,
             tags=tags or [],
-            examples=examples or []
+            examples=examples or [],
+            is_async=is_async,
+            max_concurrency=max_concurrency,
+            timeout=timeout
         )
         
         # Register tool
@@ -215,6 +261,43 @@ class ToolRegistry:
         Returns:
             Tool execution result
         
+        Raises:
+            KeyError: If tool not found
+            ValidationError: If parameters invalid
+        """
+        tool, validated_args, validated_kwargs = self.bind(name, args, kwargs)
+        
+        # Execute tool
+        if tool.is_async:
+            # Async tools called from sync code get their own loop
+            return asyncio.run(tool.function(*validated_args, **validated_kwargs))
+        return tool.function(*validated_args, **validated_kwargs)
+    
+    async def execute_async(
+        self,
+        name: str,
+        *args,
+        **kwargs
+    ) -> Any:
+        """
+        Execute a registered tool from async code
+        
+        Async tools are awaited on the running loop; sync tools are
+        called inline (use ToolExecutor to offload blocking tools).
+        """
+        tool, validated_args, validated_kwargs = self.bind(name, args, kwargs)
+        
+        if tool.is_async:
+            return await tool.function(*validated_args, **validated_kwargs)
+        return tool.function(*validated_args, **validated_kwargs)
+    
+    def bind(self, name: str, args: tuple, kwargs: dict) -> tuple:
+        """
+        Look up a tool and validate call parameters
+        
+        Returns:
+            (tool, validated_args, validated_kwargs) tuple
+        
         Raises:
             KeyError: If tool not found
             ValidationError: If parameters invalid
@@ -224,15 +307,10 @@ class ToolRegistry:
         
         tool = self.tools[name]
         
-        # Validate parameters
-        validated_args, validated_kwargs = self.validator.validate_parameters(
-            tool.function,
-            args=args,
-            kwargs=kwargs
-        )
+        # Validate parameters with the tool's precompiled validator
+        validated_args, validated_kwargs = tool.validator(args, kwargs)
         
-        # Execute tool
-        return tool.function(*validated_args, **validated_kwargs)
+        return tool, validated_args, validated_kwargs
     
     def get_tool(self, name: str) -> Optional[Tool]:
         """Get tool by name"""
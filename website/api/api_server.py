@@ -53,6 +53,13 @@ app.add_middleware(
     allow_headers=["*"],
 )
 
+# Prometheus metrics (/metrics) - needs companion_baas on the path
+try:
+    from companion_baas.optimization.metrics import instrument_fastapi
+    instrument_fastapi(app)
+except ImportError as e:
+    logger.warning(f"Metrics endpoint not available: {e}")
+
 # Initialize clients based on provider
 groq_client = None
 if PROVIDER == "groq" and GROQ_API_KEY:
@@ -41,8 +41,32 @@ except ImportError:
     from config import (get_openrouter_headers, get_model_config, 
                        OPENROUTER_CONFIG, OLLAMA_CONFIG, GROQ_CONFIG, HUGGINGFACE_CONFIG)
 
+# Process-wide PrefixCache, so system prompts rendered here and the brain's
+# prompt builders share one bounded LRU and one set of stats. Reuses the
+# brain's copy when it is loaded; otherwise loads the stdlib-only module by
+# its top-level name (importing the companion_baas package would load the brain).
+if 'companion_baas.optimization.prompt_cache' in sys.modules:
+    from companion_baas.optimization.prompt_cache import prompt_cache as shared_prompt_cache
+else:
+    sys.path.append(os.path.join(os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))),
+                                 'companion_baas'))
+    from optimization.prompt_cache import prompt_cache as shared_prompt_cache
+
 logger = logging.getLogger(__name__)
 
+
+def _shared_model_router():
+    """
+    The brain's adaptive ModelRouter when CompanionBrain is loaded in this
+    process, so both route on the same live evidence. Looked up lazily
+    (never imported here) to avoid a circular import with core/brain.py.
+    """
+    for name in ('companion_baas.core.model_router', 'core.model_router'):
+        module = sys.modules.get(name)
+        if module is not None and getattr(module, 'model_router', None) is not None:
+            return module.model_router
+    return None
+
 @dataclass
 class APIResponse:
     """Standardized response from any API"""
@@ -502,8 +526,11 @@ class CompanionAPIWrapper:
         if not available_models:
             return self.model_categories['general'][0]  # Ultimate fallback
         
-        # Choose based on performance and load balancing
-        best_model = self._select_best_performing_model(available_models)
+        # Choose based on performance and load balancing (shared adaptive router if loaded)
+        router = _shared_model_router()
+        best_model = router.select(category, candidates=available_models) if router else None
+        if best_model is None:
+            best_model = self._select_best_performing_model(available_models)
         logger.info(f"🎯 Selected optimal model: {best_model} for category: {category}")
         return best_model
     
@@ -638,6 +665,10 @@ class CompanionAPIWrapper:
         
         metrics['success_rate'] = metrics['successful_requests'] / metrics['total_requests']
         metrics['avg_response_time'] = (metrics['avg_response_time'] + response_time) / 2
+        
+        router = _shared_model_router()
+        if router:
+            router.record(model, response_time, success, provider='api_wrapper')
     
     def generate_response(
         self, 
@@ -1024,6 +1055,15 @@ The desktop version of Companion has access to more advanced AI capabilities for
             )
     
     def _generate_system_prompt(self, tools: List[str]) -> str:
+        """
+        System prompt for the active tools, rendered once per tool set.
+        It is always the first message and byte-identical for a given tool
+        set, so providers with prefix caching reuse its prefill.
+        """
+        return shared_prompt_cache.get(('system_prompt', tuple(tools)),
+                                          lambda: self._render_system_prompt(tools))
+    
+    def _render_system_prompt(self, tools: List[str]) -> str:
         """Generate system prompt based on active tools"""
         base_prompt = "You are Companion AI, an advanced and helpful AI assistant."
         